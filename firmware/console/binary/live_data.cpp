@@ -174,6 +174,11 @@ const lambda_monitor_s* getLiveData(size_t) {
 	return &engine->lambdaMonitor;
 }
 
+template<>
+const module_timing_s* getLiveData(size_t) {
+	return &engine->moduleDispatcher;
+}
+
 static const FragmentEntry fragments[] = {
 // This header is generated - do not edit by hand!
 #include "live_data_fragments.h"
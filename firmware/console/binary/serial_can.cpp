@@ -37,35 +37,92 @@ static CanTsListener listener;
 
 #if HAL_USE_CAN || EFI_UNIT_TEST
 
+can_msg_t ICanStreamer::transmitPayload(const uint8_t *data, size_t size, can_sysinterval_t timeout) {
+	CanTxMessage txmsg(CAN_ECU_SERIAL_TX_ID, size, CanBusIndex::Bus0, false);
+	for (size_t i = 0; i < size; i++) {
+		txmsg[i] = data[i];
+	}
+
+	return transmit(CAN_ANY_MAILBOX, &txmsg, timeout);
+}
+
+can_msg_t ICanStreamer::receivePayload(uint8_t *data, size_t &size, can_sysinterval_t timeout) {
+	CANRxFrame rxmsg;
+	can_msg_t msg = receive(CAN_ANY_MAILBOX, &rxmsg, timeout);
+	if (msg == CAN_MSG_OK) {
+		size = minI(minI((int)size, rxmsg.DLC), (int)sizeof(rxmsg.data8));
+		memcpy(data, rxmsg.data8, size);
+	}
+	return msg;
+}
+
+// classic frames are always padded to 8 bytes, CAN-FD frames to the next length a DLC can express
+static int getPaddedFrameLength(int length) {
+	static const int lengths[] = { 8, 12, 16, 20, 24, 32, 48, 64 };
+	for (int padded : lengths) {
+		if (length <= padded) {
+			return padded;
+		}
+	}
+	return ISO_TP_MAX_FRAME_SIZE;
+}
+
+// STmin of the FC frame, see ISO 15765-2
+static int getSeparationTimeUs(uint8_t separationTime) {
+	if (separationTime <= 0x7f) {
+		return separationTime * 1000;
+	}
+	if (separationTime >= 0xf1 && separationTime <= 0xf9) {
+		return (separationTime - 0xf0) * 100;
+	}
+	// reserved values mean the longest STmin
+	return 0x7f * 1000;
+}
+
 int CanStreamerState::sendFrame(const IsoTpFrameHeader & header, const uint8_t *data, int num, can_sysinterval_t timeout) {
-	int dlc = 8; // standard 8 bytes
-	CanTxMessage txmsg(CAN_ECU_SERIAL_TX_ID, dlc, CanBusIndex::Bus0, false);
+	int frameSize = streamer->getFrameSize();
+	uint8_t frame[ISO_TP_MAX_FRAME_SIZE] = {};
 	
 	// fill the frame data according to the CAN-TP protocol (ISO 15765-2)
-	txmsg[0] = (uint8_t)((header.frameType & 0xf) << 4);
+	frame[0] = (uint8_t)((header.frameType & 0xf) << 4);
 	int offset, maxNumBytes;
 	switch (header.frameType) {
 	case ISO_TP_FRAME_SINGLE:
-		offset = 1;
-		maxNumBytes = minI(header.numBytes, dlc - offset);
-		txmsg[0] |= maxNumBytes;
+		if (header.numBytes <= ISO_TP_CLASSIC_FRAME_SIZE - 1) {
+			offset = 1;
+			maxNumBytes = header.numBytes;
+			frame[0] |= maxNumBytes;
+		} else {
+			// CAN-FD escape: the length goes into the second byte
+			offset = 2;
+			maxNumBytes = minI(header.numBytes, frameSize - offset);
+			frame[1] = (uint8_t)maxNumBytes;
+		}
 		break;
 	case ISO_TP_FRAME_FIRST:
-		txmsg[0] |= (header.numBytes >> 8) & 0xf;
-		txmsg[1] = (uint8_t)(header.numBytes & 0xff);
-		offset = 2;
-		maxNumBytes = minI(header.numBytes, dlc - offset);
+		if (header.numBytes <= 0xfff) {
+			frame[0] |= (header.numBytes >> 8) & 0xf;
+			frame[1] = (uint8_t)(header.numBytes & 0xff);
+			offset = 2;
+		} else {
+			// escape: a zero 12-bit length is followed by a 32-bit one
+			frame[2] = (uint8_t)(header.numBytes >> 24);
+			frame[3] = (uint8_t)(header.numBytes >> 16);
+			frame[4] = (uint8_t)(header.numBytes >> 8);
+			frame[5] = (uint8_t)(header.numBytes);
+			offset = 6;
+		}
+		maxNumBytes = minI(header.numBytes, frameSize - offset);
 		break;
 	case ISO_TP_FRAME_CONSECUTIVE:
-		txmsg[0] |= header.index & 0xf;
+		frame[0] |= header.index & 0xf;
 		offset = 1;
-		// todo: is it correct?
-		maxNumBytes = dlc - offset;
+		maxNumBytes = frameSize - offset;
 		break;
 	case ISO_TP_FRAME_FLOW_CONTROL:
-		txmsg[0] |= header.fcFlag & 0xf;
-		txmsg[1] = (uint8_t)(header.blockSize);
-		txmsg[2] = (uint8_t)(header.separationTime);
+		frame[0] |= header.fcFlag & 0xf;
+		frame[1] = (uint8_t)(header.blockSize);
+		frame[2] = (uint8_t)(header.separationTime);
 		offset = 3;
 		maxNumBytes = 0;	// no data is sent with 'flow control' frame
 		break;
@@ -77,50 +134,72 @@ int CanStreamerState::sendFrame(const IsoTpFrameHeader & header, const uint8_t *
 	int numBytes = minI(maxNumBytes, num);
 	// copy the contents
 	if (data != nullptr) {
-		for (int i = 0; i < numBytes; i++) {
-			txmsg[i + offset] = data[i];
-		}
+		memcpy(frame + offset, data, numBytes);
 	}
 
 	// send the frame!
-	if (streamer->transmit(CAN_ANY_MAILBOX, &txmsg, timeout) == CAN_MSG_OK)
-		return numBytes;
-	return 0;
+	if (streamer->transmitPayload(frame, getPaddedFrameLength(offset + numBytes), timeout) != CAN_MSG_OK) {
+		return 0;
+	}
+
+	counters.txFrames++;
+	counters.txBytes += numBytes;
+	return numBytes;
 }
 
 // returns the number of copied bytes
-int CanStreamerState::receiveFrame(CANRxFrame *rxmsg, uint8_t *buf, int num, can_sysinterval_t timeout) {
-	if (rxmsg == nullptr || rxmsg->DLC < 1) {
+int CanStreamerState::receiveFrame(const uint8_t *frame, size_t frameLength, uint8_t *buf, int num, can_sysinterval_t timeout) {
+	if (frame == nullptr || frameLength < 1) {
 		return 0;
 	}
 
-	int frameType = (rxmsg->data8[0] >> 4) & 0xf;
+	counters.rxFrames++;
+
+	int frameType = (frame[0] >> 4) & 0xf;
 	int numBytesAvailable, frameIdx;
-	uint8_t *srcBuf = rxmsg->data8;
+	const uint8_t *srcBuf = frame;
 	switch (frameType) {
 	case ISO_TP_FRAME_SINGLE:
-		numBytesAvailable = rxmsg->data8[0] & 0xf;
-		srcBuf = rxmsg->data8 + 1;
+		numBytesAvailable = frame[0] & 0xf;
+		srcBuf = frame + 1;
+		if (numBytesAvailable == 0 && frameLength > ISO_TP_CLASSIC_FRAME_SIZE) {
+			// CAN-FD escape
+			numBytesAvailable = frame[1];
+			srcBuf = frame + 2;
+		}
+		numBytesAvailable = minI(numBytesAvailable, (int)(frameLength - (srcBuf - frame)));
 		this->waitingForNumBytes = -1;
+		counters.rxMessages++;
 		break;
 	case ISO_TP_FRAME_FIRST:
-		this->waitingForNumBytes = ((rxmsg->data8[0] & 0xf) << 8) | rxmsg->data8[1];
+		this->waitingForNumBytes = ((frame[0] & 0xf) << 8) | frame[1];
+		srcBuf = frame + 2;
+		if (this->waitingForNumBytes == 0 && frameLength >= 6) {
+			// more than 4095 bytes
+			this->waitingForNumBytes = (frame[2] << 24) | (frame[3] << 16) | (frame[4] << 8) | frame[5];
+			srcBuf = frame + 6;
+		}
 		this->waitingForFrameIndex = 1;
-		numBytesAvailable = minI(this->waitingForNumBytes, 6);
-		srcBuf = rxmsg->data8 + 2;
+		this->framesUntilFlowControl = CAN_FIFO_FRAME_SIZE;
+		numBytesAvailable = minI(this->waitingForNumBytes, (int)(frameLength - (srcBuf - frame)));
 		break;
 	case ISO_TP_FRAME_CONSECUTIVE:
-		frameIdx = rxmsg->data8[0] & 0xf;
-		if (this->waitingForNumBytes < 0 || this->waitingForFrameIndex != frameIdx) {
-			// todo: that's an abnormal situation, and we probably should react?
+		frameIdx = frame[0] & 0xf;
+		if (this->waitingForNumBytes <= 0 || this->waitingForFrameIndex != frameIdx) {
+			// a frame got lost, whatever is left of the message is useless
+			counters.rxSequenceErrors++;
+			this->waitingForNumBytes = -1;
 			return 0;
 		}
-		numBytesAvailable = minI(this->waitingForNumBytes, 7);
-		srcBuf = rxmsg->data8 + 1;
+		numBytesAvailable = minI(this->waitingForNumBytes, (int)frameLength - 1);
+		srcBuf = frame + 1;
 		this->waitingForFrameIndex = (this->waitingForFrameIndex + 1) & 0xf;
+		if (numBytesAvailable == this->waitingForNumBytes) {
+			counters.rxMessages++;
+		}
 		break;
 	case ISO_TP_FRAME_FLOW_CONTROL:
-		// todo: currently we just ignore the FC frame
+		// FC frames are only expected while we send, see waitForFlowControl()
 		return 0;
 	default:
 		// bad frame type
@@ -150,6 +229,8 @@ int CanStreamerState::receiveFrame(CANRxFrame *rxmsg, uint8_t *buf, int num, can
 	}
 #endif /* TS_CAN_DEVICE_SHORT_PACKETS_IN_ONE_FRAME */
 
+	counters.rxBytes += numBytesAvailable;
+
 	int numBytesToCopy = minI(num, numBytesAvailable);
 	if (buf != nullptr) {
 		memcpy(buf, srcBuf, numBytesToCopy);
@@ -162,12 +243,16 @@ int CanStreamerState::receiveFrame(CANRxFrame *rxmsg, uint8_t *buf, int num, can
 		rxFifoBuf.put(srcBuf[i]);
 	}
 
-	// according to the specs, we need to acknowledge the received multi-frame start frame
-	if (frameType == ISO_TP_FRAME_FIRST) {
+	// according to the specs, we need to acknowledge the received multi-frame start frame,
+	// and then every block of frames: by the time we get here the frames of the block have left the listener FIFO
+	bool isEndOfBlock = frameType == ISO_TP_FRAME_CONSECUTIVE && waitingForNumBytes > 0 && --framesUntilFlowControl == 0;
+	if (frameType == ISO_TP_FRAME_FIRST || isEndOfBlock) {
+		this->framesUntilFlowControl = CAN_FIFO_FRAME_SIZE;
+
 		IsoTpFrameHeader header;
 		header.frameType = ISO_TP_FRAME_FLOW_CONTROL;
-		header.fcFlag = 0;			// = "continue to send"
-		header.blockSize = 0;		// = the remaining "frames" to be sent without flow control or delay
+		header.fcFlag = CAN_FLOW_STATUS_OK;			// = "continue to send"
+		header.blockSize = CAN_FIFO_FRAME_SIZE;		// = no more than the listener FIFO holds until the next FC
 		header.separationTime = 0;	// = wait 0 milliseconds, send immediately
 		sendFrame(header, nullptr, 0, timeout);
 	}
@@ -175,6 +260,48 @@ int CanStreamerState::receiveFrame(CANRxFrame *rxmsg, uint8_t *buf, int num, can
 	return numBytesToCopy;
 }
 
+bool CanStreamerState::waitForFlowControl(int &blockSize, int &separationTimeUs, can_sysinterval_t timeout) {
+	for (int numWaits = 0; ; numWaits++) {
+		uint8_t frame[ISO_TP_MAX_FRAME_SIZE];
+		size_t frameLength = sizeof(frame);
+		if (streamer->receivePayload(frame, frameLength, timeout) != CAN_MSG_OK) {
+#ifdef SERIAL_CAN_DEBUG
+			PRINT("*** ERROR: CAN Flow Control frame not received" PRINT_EOL);
+#endif /* SERIAL_CAN_DEBUG */
+			//warning(ObdCode::CUSTOM_ERR_CAN_COMMUNICATION, "CAN Flow Control frame not received");
+			return false;
+		}
+		counters.rxFrames++;
+
+		int frameType = (frame[0] >> 4) & 0xf;
+		int flowStatus = frame[0] & 0xf;
+		if (frameType != ISO_TP_FRAME_FLOW_CONTROL || frameLength < 3) {
+#ifdef SERIAL_CAN_DEBUG
+			PRINT("*** ERROR: CAN Flow Control frame expected, got %d" PRINT_EOL, frameType);
+#endif /* SERIAL_CAN_DEBUG */
+			return false;
+		}
+
+		if (flowStatus == CAN_FLOW_STATUS_OK) {
+			blockSize = frame[1];
+			separationTimeUs = getSeparationTimeUs(frame[2]);
+			return true;
+		}
+
+		// if the receiver is not ready yet and asks to wait for the next FC frame (give it a few attempts)
+		if (flowStatus == CAN_FLOW_STATUS_WAIT_MORE && numWaits < ISO_TP_MAX_FLOW_CONTROL_WAITS) {
+			counters.flowControlWaits++;
+			continue;
+		}
+
+#ifdef SERIAL_CAN_DEBUG
+		PRINT("*** ERROR: CAN Flow Control status %d" PRINT_EOL, flowStatus);
+#endif /* SERIAL_CAN_DEBUG */
+		//warning(ObdCode::CUSTOM_ERR_CAN_COMMUNICATION, "CAN Flow Control mode not supported");
+		return false;
+	}
+}
+
 int CanStreamerState::sendDataTimeout(const uint8_t *txbuf, int numBytes, can_sysinterval_t timeout) {
 	int offset = 0;
 
@@ -185,12 +312,21 @@ int CanStreamerState::sendDataTimeout(const uint8_t *txbuf, int numBytes, can_sy
 	if (numBytes < 1)
 		return 0;
 
-	// 1 frame
-	if (numBytes <= 7) {
+	int frameSize = streamer->getFrameSize();
+
+	// 1 frame, with the CAN-FD escape the length takes a byte of its own
+	int singleFrameMaxBytes = frameSize > ISO_TP_CLASSIC_FRAME_SIZE ? frameSize - 2 : frameSize - 1;
+	if (numBytes <= singleFrameMaxBytes) {
 		IsoTpFrameHeader header;
 		header.frameType = ISO_TP_FRAME_SINGLE;
 		header.numBytes = numBytes;
-		return sendFrame(header, txbuf, numBytes, timeout);
+		int numSent = sendFrame(header, txbuf, numBytes, timeout);
+		if (numSent == numBytes) {
+			counters.txMessages++;
+		} else {
+			counters.txAborts++;
+		}
+		return numSent;
 	}
 
 	// multiple frames
@@ -203,65 +339,46 @@ int CanStreamerState::sendDataTimeout(const uint8_t *txbuf, int numBytes, can_sy
 		header.frameType = ISO_TP_FRAME_FIRST;
 		header.numBytes = numBytes;
 		int numSent = sendFrame(header, txbuf + offset, numBytes, timeout);
+		if (numSent < 1) {
+			counters.txAborts++;
+			return 0;
+		}
 		offset += numSent;
 		numBytes -= numSent;
 		totalNumSent += numSent;
+	}
 
-		// get a flow control (FC) frame
-#if !EFI_UNIT_TEST // todo: add FC to unit-tests?
-		CANRxFrame rxmsg;
-		for (int numFcReceived = 0; ; numFcReceived++) {
-			if (streamer->receive(CAN_ANY_MAILBOX, &rxmsg, timeout) != CAN_MSG_OK) {
-#ifdef SERIAL_CAN_DEBUG
-				PRINT("*** ERROR: CAN Flow Control frame not received" PRINT_EOL);
-#endif /* SERIAL_CAN_DEBUG */
-				//warning(ObdCode::CUSTOM_ERR_CAN_COMMUNICATION, "CAN Flow Control frame not received");
-				return 0;
-			}
-			receiveFrame(&rxmsg, nullptr, 0, timeout);
-			int flowStatus = rxmsg.data8[0] & 0xf;
-			// if something is not ok
-			if (flowStatus != CAN_FLOW_STATUS_OK) {
-				// if the receiver is not ready yet and asks to wait for the next FC frame (give it 3 attempts)
-				if (flowStatus == CAN_FLOW_STATUS_WAIT_MORE && numFcReceived < 3) {
-					continue;
-				}
-#ifdef SERIAL_CAN_DEBUG
-				efiPrintf("*** ERROR: CAN Flow Control mode not supported");
-#endif /* SERIAL_CAN_DEBUG */
-				//warning(ObdCode::CUSTOM_ERR_CAN_COMMUNICATION, "CAN Flow Control mode not supported");
-				return 0;
+	// send the rest of the data: a block of consecutive frames (CF) per flow control (FC) frame
+	int idx = 1;
+	while (numBytes > 0) {
+		int blockSize, separationTimeUs;
+		if (!waitForFlowControl(blockSize, separationTimeUs, timeout)) {
+			counters.txAborts++;
+			return totalNumSent;
+		}
+
+		// without STmin the whole block is queued back to back, keeping all TX mailboxes busy
+		for (int numFramesInBlock = 0; numBytes > 0 && (blockSize == 0 || numFramesInBlock < blockSize); numFramesInBlock++) {
+			if (numFramesInBlock > 0 && separationTimeUs > 0) {
+				streamer->sleepUs(separationTimeUs);
 			}
-			int blockSize = rxmsg.data8[1];
-			int minSeparationTime = rxmsg.data8[2];
-			if (blockSize != 0 || minSeparationTime != 0) {
-				// todo: process other Flow Control fields (see ISO 15765-2)
-#ifdef SERIAL_CAN_DEBUG
-				efiPrintf("*** ERROR: CAN Flow Control fields not supported");
-#endif /* SERIAL_CAN_DEBUG */
-				//warning(ObdCode::CUSTOM_ERR_CAN_COMMUNICATION, "CAN Flow Control fields not supported");
+
+			IsoTpFrameHeader header;
+			header.frameType = ISO_TP_FRAME_CONSECUTIVE;
+			header.index = ((idx++) & 0x0f);
+			header.numBytes = minI(numBytes, frameSize - 1);
+			int numSent = sendFrame(header, txbuf + offset, header.numBytes, timeout);
+			if (numSent < 1) {
+				counters.txAborts++;
+				return totalNumSent;
 			}
-			break;
+			totalNumSent += numSent;
+			offset += numSent;
+			numBytes -= numSent;
 		}
-#endif /* EFI_UNIT_TEST */
 	}
 
-	// send the rest of the data
-	int idx = 1;
-	while (numBytes > 0) {
-		int len = minI(numBytes, 7);
-		// send the consecutive frames
-		IsoTpFrameHeader header;
-		header.frameType = ISO_TP_FRAME_CONSECUTIVE;
-		header.index = ((idx++) & 0x0f);
-		header.numBytes = len;
-		int numSent = sendFrame(header, txbuf + offset, len, timeout);
-		if (numSent < 1)
-			break;
-		totalNumSent += numSent;
-		offset += numSent;
-		numBytes -= numSent;
-	}
+	counters.txMessages++;
 	return totalNumSent;
 }
 
@@ -337,9 +454,10 @@ can_msg_t CanStreamerState::streamReceiveTimeout(size_t *np, uint8_t *rxbuf, can
 
 	// if even more data is needed, then we receive more CAN frames
 	while (availableBufferSpace > 0) {
-		CANRxFrame rxmsg;
-		if (streamer->receive(CAN_ANY_MAILBOX, &rxmsg, timeout) == CAN_MSG_OK) {
-			int numReceived = receiveFrame(&rxmsg, rxbuf + i, availableBufferSpace, timeout);
+		uint8_t frame[ISO_TP_MAX_FRAME_SIZE];
+		size_t frameLength = sizeof(frame);
+		if (streamer->receivePayload(frame, frameLength, timeout) == CAN_MSG_OK) {
+			int numReceived = receiveFrame(frame, frameLength, rxbuf + i, availableBufferSpace, timeout);
 
 			if (numReceived < 1)
 				break;
@@ -379,6 +497,8 @@ void CanTsListener::decodeFrame(const CANRxFrame& frame, efitick_t /*nowNt*/) {
 
 #if HAL_USE_CAN
 
+static_assert(ISO_TP_FRAME_SIZE <= sizeof(CANTxFrame::data8));
+
 void CanStreamer::init() {
 	registerCanListener(listener);
 }
@@ -398,10 +518,18 @@ can_msg_t CanStreamer::receive(canmbx_t /*mailbox*/, CANRxFrame *crfp, can_sysin
 	return CAN_MSG_TIMEOUT;
 }
 
+void CanStreamer::sleepUs(int us) {
+	chThdSleepMicroseconds(us);
+}
+
 void canStreamInit(void) {
 	streamer.init();
 }
 
+const IsoTpCounters& getIsoTpCounters() {
+	return state.counters;
+}
+
 msg_t canStreamAddToTxTimeout(size_t *np, const uint8_t *txbuf, sysinterval_t timeout) {
 	return state.streamAddToTxTimeout(np, txbuf, timeout);
 }
@@ -24,9 +24,25 @@
 
 #define CAN_TIME_IMMEDIATE ((can_sysinterval_t)0)
 
-// most efficient sizes are 6 + x * 7 that way whole buffer is transmitted as (x+1) full packets
+// leftover of the last received frame, so at least one CAN-FD frame
 #define CAN_FIFO_BUF_SIZE 76
-#define CAN_FIFO_FRAME_SIZE 8
+// whole TS packet, including size and CRC, goes out as one ISO-TP message: one FF/FC round trip per packet
+#define CAN_TX_FIFO_BUF_SIZE (BLOCKING_FACTOR + 10)
+// received frames waiting for the TS thread, this is also the block size we ask the sender for
+#define CAN_FIFO_FRAME_SIZE 16
+
+#define ISO_TP_CLASSIC_FRAME_SIZE 8
+#define ISO_TP_MAX_FRAME_SIZE 64
+
+// payload of the frames we send, ports with CAN-FD frames may go up to ISO_TP_MAX_FRAME_SIZE
+#ifndef ISO_TP_FRAME_SIZE
+#define ISO_TP_FRAME_SIZE ISO_TP_CLASSIC_FRAME_SIZE
+#endif
+
+// how many times in a row the receiver may ask us to wait before we give up on the message
+#define ISO_TP_MAX_FLOW_CONTROL_WAITS 3
+
+static_assert(CAN_FIFO_BUF_SIZE >= ISO_TP_MAX_FRAME_SIZE);
 
 #define CAN_FLOW_STATUS_OK 0
 #define CAN_FLOW_STATUS_WAIT_MORE 1
@@ -59,21 +75,59 @@ class ICanStreamer {
 public:
 	virtual can_msg_t transmit(canmbx_t mailbox, const CanTxMessage *ctfp, can_sysinterval_t timeout) = 0;
 	virtual can_msg_t receive(canmbx_t mailbox, CANRxFrame *crfp, can_sysinterval_t timeout) = 0;
+
+	// largest payload of one frame: 8 for classic CAN, up to 64 for CAN-FD
+	virtual size_t getFrameSize() const {
+		return ISO_TP_CLASSIC_FRAME_SIZE;
+	}
+
+	/**
+	 * Frame level I/O of the ISO-TP engine. By default these go through transmit() and receive()
+	 * with classic CAN frames, CAN-FD capable streamers override them along with getFrameSize().
+	 */
+	virtual can_msg_t transmitPayload(const uint8_t *data, size_t size, can_sysinterval_t timeout);
+	// size is the capacity of data on the way in, the payload length on the way out
+	virtual can_msg_t receivePayload(uint8_t *data, size_t &size, can_sysinterval_t timeout);
+
+	// used to honour the STmin the receiver asks for between consecutive frames
+	virtual void sleepUs(int us) = 0;
+};
+
+struct IsoTpCounters {
+	// TS bytes in complete or partial messages
+	uint32_t txBytes = 0;
+	uint32_t rxBytes = 0;
+	// frames on the wire, flow control included
+	uint32_t txFrames = 0;
+	uint32_t rxFrames = 0;
+	// complete messages
+	uint32_t txMessages = 0;
+	uint32_t rxMessages = 0;
+	// the receiver asked us to wait
+	uint32_t flowControlWaits = 0;
+	// no or bad flow control, or a frame we could not send
+	uint32_t txAborts = 0;
+	// consecutive frames out of sequence, the rest of the message is dropped
+	uint32_t rxSequenceErrors = 0;
 };
 
 class CanStreamerState {
 public:
 	fifo_buffer<uint8_t, CAN_FIFO_BUF_SIZE> rxFifoBuf;
-	fifo_buffer<uint8_t, CAN_FIFO_BUF_SIZE> txFifoBuf;
+	fifo_buffer<uint8_t, CAN_TX_FIFO_BUF_SIZE> txFifoBuf;
 
 #if defined(TS_CAN_DEVICE_SHORT_PACKETS_IN_ONE_FRAME)
 	// used to restore the original packet with CRC
-    uint8_t tmpRxBuf[13];
+    uint8_t tmpRxBuf[ISO_TP_MAX_FRAME_SIZE + 6];
 #endif
 
 	// used for multi-frame ISO-TP packets
 	int waitingForNumBytes = 0;
 	int waitingForFrameIndex = 0;
+	// consecutive frames left until we send the next flow control frame
+	int framesUntilFlowControl = 0;
+
+	IsoTpCounters counters;
 
 	ICanStreamer *streamer;
 	
@@ -81,7 +135,9 @@ public:
 	CanStreamerState(ICanStreamer *s) : streamer(s) {}
 
 	int sendFrame(const IsoTpFrameHeader & header, const uint8_t *data, int num, can_sysinterval_t timeout);
-	int receiveFrame(CANRxFrame *rxmsg, uint8_t *buf, int num, can_sysinterval_t timeout);
+	int receiveFrame(const uint8_t *frame, size_t frameLength, uint8_t *buf, int num, can_sysinterval_t timeout);
+	// waits for a 'continue to send' FC frame, returns false if the message has to be given up
+	bool waitForFlowControl(int &blockSize, int &separationTimeUs, can_sysinterval_t timeout);
 	int getDataFromFifo(uint8_t *rxbuf, size_t &numBytes);
 	// returns the number of bytes sent
 	int sendDataTimeout(const uint8_t *txbuf, int numBytes, can_sysinterval_t timeout);
@@ -132,9 +188,16 @@ public:
 
 	virtual can_msg_t transmit(canmbx_t mailbox, const CanTxMessage *ctfp, can_sysinterval_t timeout) override;
 	virtual can_msg_t receive(canmbx_t mailbox, CANRxFrame *crfp, can_sysinterval_t timeout) override;
+
+	size_t getFrameSize() const override {
+		return ISO_TP_FRAME_SIZE;
+	}
+
+	void sleepUs(int us) override;
 };
 
 void canStreamInit(void);
+const IsoTpCounters& getIsoTpCounters();
 
 // we don't have canStreamSendTimeout() because we need to "bufferize" the stream and send it in fixed-length packets
 msg_t canStreamAddToTxTimeout(size_t *np, const uint8_t *txbuf, sysinterval_t timeout);
@@ -0,0 +1,107 @@
+/**
+ * @file ts_output_stream.cpp
+ *
+ * Only one channel streams at a time - the encoder state is a few kilobytes, and
+ * a second host asking for a stream takes it over from the first one.
+ */
+
+#include "pch.h"
+
+#include "ts_output_stream.h"
+
+#if EFI_TUNER_STUDIO
+
+#include "tunerstudio.h"
+#include "tunerstudio_io.h"
+#include "live_data.h"
+
+// Faster than this and the TS thread does nothing but encode frames
+#define TS_OUTPUT_STREAM_MIN_PERIOD_MS 5
+
+// No ack or other command from the host for this long, assume it's gone
+#define TS_OUTPUT_STREAM_HOST_TIMEOUT_SEC 3
+
+static CCM_OPTIONAL OutputChannelStream outputChannelStream;
+
+OutputChannelStream& getOutputChannelStream() {
+	return outputChannelStream;
+}
+
+void OutputChannelStream::start(TsChannelBase* channel, uint16_t periodMs) {
+	chibios_rt::CriticalSectionLocker csl;
+
+	m_channel = channel;
+	m_periodMs = maxI(periodMs, TS_OUTPUT_STREAM_MIN_PERIOD_MS);
+	m_encoder.resync();
+
+	m_lastFrame.init();
+	m_lastHostActivity.reset();
+}
+
+void OutputChannelStream::stop(TsChannelBase* channel) {
+	chibios_rt::CriticalSectionLocker csl;
+
+	if (channel == m_channel) {
+		m_channel = nullptr;
+	}
+}
+
+void OutputChannelStream::acknowledge(TsChannelBase* channel, uint16_t sequence) {
+	if (!isStreamingTo(channel)) {
+		return;
+	}
+
+	// Acks arrive on the same thread that encodes frames, no locking needed
+	m_encoder.acknowledge(sequence);
+	m_lastHostActivity.reset();
+}
+
+void OutputChannelStream::resync(TsChannelBase* channel) {
+	if (!isStreamingTo(channel)) {
+		return;
+	}
+
+	m_encoder.resync();
+	m_lastHostActivity.reset();
+}
+
+bool OutputChannelStream::isStreamingTo(const TsChannelBase* channel) const {
+	return channel && channel == m_channel;
+}
+
+int OutputChannelStream::sendIfDue(TsChannelBase* channel) {
+	if (!isStreamingTo(channel)) {
+		return 0;
+	}
+
+	if (m_lastHostActivity.hasElapsedSec(TS_OUTPUT_STREAM_HOST_TIMEOUT_SEC)) {
+		efiPrintf("TS: %s stopped acknowledging output stream, stopping", channel->getName());
+		stop(channel);
+		return 0;
+	}
+
+	float remainingMs = m_periodMs - m_lastFrame.getElapsedUs() / 1000;
+	if (remainingMs > 0) {
+		return maxI(1, remainingMs);
+	}
+
+	m_lastFrame.reset();
+
+	tsState.outputChannelsCommandCounter++;
+	updateTunerStudioState();
+
+	// Same snapshot as TS_OUTPUT_COMMAND would send, words past the end padded with zeroes
+	using Encoder = OutputChannelDeltaEncoder<TS_TOTAL_OUTPUT_SIZE>;
+	static_assert(sizeof(channel->scratchBuffer) >= 4 * Encoder::wordCount);
+
+	uint8_t* snapshot = channel->scratchBuffer;
+	copyRange(snapshot, getLiveDataFragments(), 0, TS_TOTAL_OUTPUT_SIZE);
+	memset(snapshot + TS_TOTAL_OUTPUT_SIZE, 0, 4 * Encoder::wordCount - TS_TOTAL_OUTPUT_SIZE);
+
+	size_t size = m_encoder.encode(snapshot, m_frame);
+	channel->writeCrcPacketLocked(TS_RESPONSE_OUTPUT_STREAM, m_frame, size);
+
+	return m_periodMs;
+}
+
+#endif // EFI_TUNER_STUDIO
@@ -0,0 +1,168 @@
+/**
+ * @file ts_output_stream.h
+ *
+ * Output channel streaming: instead of waiting to be polled with TS_OUTPUT_COMMAND, the ECU
+ * pushes frames at a fixed rate, each carrying only the 4 byte words that changed since a frame
+ * the host acknowledged. Over slow links (bluetooth, CAN) this buys a much higher gauge refresh rate.
+ *
+ * Frame layout, payload of a TS_RESPONSE_OUTPUT_STREAM packet, little endian:
+ *   uint16_t sequence
+ *   uint16_t baseSequence - frame this one is relative to, TS_OUTPUT_STREAM_NO_BASE for a full frame
+ *   uint8_t flags - TS_OUTPUT_STREAM_ACK_REQUEST: host should acknowledge this frame
+ *   full frame: every word
+ *   delta frame: bitmap of changed words (word N is bit N % 8 of byte N / 8), then the changed words in order
+ *
+ * Only one frame at a time is flagged for acknowledgement. Once its ack arrives, the following frames
+ * are relative to it, so the host only ever needs to keep the state of its current base and of the
+ * frame it acknowledged last. A host that lost track asks for a resync and gets a full frame.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#define TS_OUTPUT_STREAM_NO_BASE 0xFFFF
+#define TS_OUTPUT_STREAM_ACK_REQUEST 1
+
+// Frames to wait for an ack before asking for one on a newer frame (the ack or the flagged frame got lost)
+#define TS_OUTPUT_STREAM_ACK_TIMEOUT 50
+
+template <size_t TSize>
+class OutputChannelDeltaEncoder {
+public:
+	static constexpr size_t wordCount = (TSize + 3) / 4;
+	static constexpr size_t bitmapSize = (wordCount + 7) / 8;
+	static constexpr size_t headerSize = 5;
+	// A delta that would be bigger than every word is sent as a full frame instead
+	static constexpr size_t maxFrameSize = headerSize + 4 * wordCount;
+
+	// Next frame is sent as a full frame, and nothing is acknowledged until then
+	void resync() {
+		m_hasBase = false;
+		m_hasPending = false;
+	}
+
+	void acknowledge(uint16_t sequence) {
+		// Acks for anything but the flagged frame are stale, ignore them
+		if (!m_hasPending || sequence != m_pendingSequence) {
+			return;
+		}
+
+		memcpy(m_base, m_pending, sizeof(m_base));
+		m_baseSequence = sequence;
+		m_hasBase = true;
+		m_hasPending = false;
+	}
+
+	/**
+	 * @param current wordCount * 4 bytes of output channels, padding past TSize zeroed
+	 * @param out at least maxFrameSize bytes
+	 * @return size of the frame written to out
+	 */
+	size_t encode(const uint8_t* current, uint8_t* out) {
+		uint16_t sequence = m_nextSequence;
+		m_nextSequence = (m_nextSequence + 1) % TS_OUTPUT_STREAM_NO_BASE;
+
+		uint8_t flags = 0;
+
+		if (!m_hasPending || ++m_framesSincePending > TS_OUTPUT_STREAM_ACK_TIMEOUT) {
+			flags |= TS_OUTPUT_STREAM_ACK_REQUEST;
+			memcpy(m_pending, current, sizeof(m_pending));
+			m_pendingSequence = sequence;
+			m_hasPending = true;
+			m_framesSincePending = 0;
+		}
+
+		uint16_t baseSequence = m_baseSequence;
+		size_t size = m_hasBase ? encodeDelta(current, out) : 0;
+
+		if (size == 0) {
+			baseSequence = TS_OUTPUT_STREAM_NO_BASE;
+			memcpy(out + headerSize, current, 4 * wordCount);
+			size = maxFrameSize;
+		}
+
+		memcpy(out, &sequence, sizeof(sequence));
+		memcpy(out + 2, &baseSequence, sizeof(baseSequence));
+		out[4] = flags;
+
+		return size;
+	}
+
+private:
+	// Returns 0 if a full frame would be smaller
+	size_t encodeDelta(const uint8_t* current, uint8_t* out) const {
+		uint8_t* bitmap = out + headerSize;
+		uint8_t* payload = bitmap + bitmapSize;
+		size_t changed = 0;
+
+		memset(bitmap, 0, bitmapSize);
+
+		for (size_t i = 0; i < wordCount; i++) {
+			uint32_t word;
+			memcpy(&word, current + 4 * i, sizeof(word));
+
+			if (word == m_base[i]) {
+				continue;
+			}
+
+			if (headerSize + bitmapSize + 4 * (changed + 1) >= maxFrameSize) {
+				return 0;
+			}
+
+			bitmap[i / 8] |= 1 << (i % 8);
+			memcpy(payload + 4 * changed, &word, sizeof(word));
+			changed++;
+		}
+
+		return headerSize + bitmapSize + 4 * changed;
+	}
+
+	// What the host has, as of the last frame it acknowledged
+	uint32_t m_base[wordCount];
+	uint16_t m_baseSequence = 0;
+	bool m_hasBase = false;
+
+	// Contents of the frame waiting for an ack
+	uint32_t m_pending[wordCount];
+	uint16_t m_pendingSequence = 0;
+	bool m_hasPending = false;
+	uint16_t m_framesSincePending = 0;
+
+	uint16_t m_nextSequence = 0;
+};
+
+#if EFI_TUNER_STUDIO
+
+#include "timer.h"
+
+class TsChannelBase;
+
+class OutputChannelStream {
+public:
+	void start(TsChannelBase* channel, uint16_t periodMs);
+	void stop(TsChannelBase* channel);
+	void acknowledge(TsChannelBase* channel, uint16_t sequence);
+	void resync(TsChannelBase* channel);
+
+	bool isStreamingTo(const TsChannelBase* channel) const;
+
+	// Sends a frame if one is due, returns the number of ms until the next one
+	int sendIfDue(TsChannelBase* channel);
+
+private:
+	TsChannelBase* m_channel = nullptr;
+	uint16_t m_periodMs = 0;
+
+	Timer m_lastFrame;
+	// Any command from the host, the stream stops if it goes quiet
+	Timer m_lastHostActivity;
+
+	OutputChannelDeltaEncoder<TS_TOTAL_OUTPUT_SIZE> m_encoder;
+	uint8_t m_frame[OutputChannelDeltaEncoder<TS_TOTAL_OUTPUT_SIZE>::maxFrameSize];
+};
+
+OutputChannelStream& getOutputChannelStream();
+
+#endif // EFI_TUNER_STUDIO
@@ -75,6 +75,7 @@
 #include "trigger_scope.h"
 #include "electronic_throttle.h"
 #include "live_data.h"
+#include "ts_output_stream.h"
 #include "crc_accelerator.h"
 
 #include <string.h>
@@ -88,12 +89,24 @@
 #include "rusEfiFunctionalTest.h"
 #endif /* EFI_SIMULATOR */
 
+#if EFI_CAN_SERIAL
+#include "serial_can.h"
+#endif /* EFI_CAN_SERIAL */
+
 static void printErrorCounters() {
 	efiPrintf("TunerStudio total=%d / errors=%d / H=%d / O=%d / P=%d / B=%d",
 			tsState.totalCounter, tsState.errorCounter, tsState.queryCommandCounter,
 			tsState.outputChannelsCommandCounter, tsState.readPageCommandsCounter, tsState.burnCommandCounter);
 	efiPrintf("TunerStudio W=%d / C=%d", tsState.writeValueCommandCounter,
 			tsState.writeChunkCommandCounter);
+
+#if EFI_CAN_SERIAL
+	const IsoTpCounters& isoTp = getIsoTpCounters();
+	efiPrintf("ISO-TP TX bytes=%d / frames=%d / messages=%d / FC waits=%d / aborts=%d",
+			isoTp.txBytes, isoTp.txFrames, isoTp.txMessages, isoTp.flowControlWaits, isoTp.txAborts);
+	efiPrintf("ISO-TP RX bytes=%d / frames=%d / messages=%d / sequence errors=%d",
+			isoTp.rxBytes, isoTp.rxFrames, isoTp.rxMessages, isoTp.rxSequenceErrors);
+#endif /* EFI_CAN_SERIAL */
 }
 
 #if EFI_TUNER_STUDIO
@@ -141,6 +154,9 @@ void TunerStudio::handleWriteChunkCommand(TsChannelBase* tsChannel, uint16_t off
 	if (!rebootForPresetPending) {
 		uint8_t * addr = (uint8_t *) (getWorkingPageAddr() + offset);
 		memcpy(addr, content, count);
+
+		// Live edits apply without a burn, let anything caching the configuration know
+		configurationWriteCounter++;
 	}
 	// Force any board configuration options that humans shouldn't be able to change
 	setBoardConfigOverrides();
@@ -221,6 +237,9 @@ static void handleBurnCommand(TsChannelBase* tsChannel) {
 
 static bool isKnownCommand(char command) {
 	return command == TS_HELLO_COMMAND || command == TS_READ_COMMAND || command == TS_OUTPUT_COMMAND
+			|| command == TS_OUTPUT_STREAM_COMMAND
+			|| command == TS_CAPTURE_LOG_COMMAND
+			|| command == TS_ENGINE_SNIFFER_COMMAND
 			|| command == TS_BURN_COMMAND
 			|| command == TS_CHUNK_WRITE_COMMAND || command == TS_EXECUTE
 			|| command == TS_IO_TEST_COMMAND
@@ -300,12 +319,25 @@ static int tsProcessOne(TsChannelBase* tsChannel) {
 
 	tsState.totalCounter++;
 
+	auto& stream = getOutputChannelStream();
+	int firstByteTimeout = TS_COMMUNICATION_TIMEOUT;
+
+	if (stream.isStreamingTo(tsChannel)) {
+		// Don't sit waiting for the host, wake up in time to push the next frame
+		firstByteTimeout = TIME_MS2I(stream.sendIfDue(tsChannel));
+	}
+
 	uint8_t firstByte;
-	size_t received = tsChannel->readTimeout(&firstByte, 1, TS_COMMUNICATION_TIMEOUT);
+	size_t received = tsChannel->readTimeout(&firstByte, 1, firstByteTimeout);
 #if EFI_SIMULATOR
 		logMsg("received %d\r\n", received);
 #endif
 
+	if (received != 1 && stream.isStreamingTo(tsChannel)) {
+		// A quiet host is normal while streaming
+		return -1;
+	}
+
 	if (received != 1) {
 //			tunerStudioError("ERROR: no command");
 #if EFI_BLUETOOTH_SETUP
@@ -466,15 +498,17 @@ static void handleGetText(TsChannelBase* tsChannel) {
 
 	printOverallStatus();
 
-	size_t outputSize;
-	const char* output = swapOutputBuffers(&outputSize);
+	const LogSpan* lines;
+	size_t lineCount = getLogLines(&lines);
 #if EFI_SIMULATOR
-			logMsg("get test sending [%d]\r\n", outputSize);
+			logMsg("get test sending [%d]\r\n", lineCount);
 #endif
 
-	tsChannel->writeCrcPacketLocked(reinterpret_cast<const uint8_t*>(output), outputSize);
+	// Straight from the log ring, it's only released after it's sent
+	tsChannel->writeCrcPacketLocked(TS_RESPONSE_OK, lines, lineCount);
+	releaseLogLines();
 #if EFI_SIMULATOR
-			logMsg("sent [%d]\r\n", outputSize);
+			logMsg("sent [%d]\r\n", lineCount);
 #endif
 }
 #endif // EFI_TEXT_LOGGING
@@ -538,6 +572,17 @@ int TunerStudio::handleCrcCommand(TsChannelBase* tsChannel, uint8_t* data, int i
 	case TS_READ_COMMAND:
 		handlePageReadCommand(tsChannel, offset, count);
 		break;
+	case TS_OUTPUT_STREAM_COMMAND:
+		handleOutputStreamCommand(tsChannel, data, incomingPacketSize - 1);
+		break;
+	case TS_CAPTURE_LOG_COMMAND:
+		handleCaptureLogCommand(tsChannel, data, incomingPacketSize - 1);
+		break;
+#if EFI_ENGINE_SNIFFER
+	case TS_ENGINE_SNIFFER_COMMAND:
+		handleEngineSnifferCommand(tsChannel, data, incomingPacketSize - 1);
+		break;
+#endif /* EFI_ENGINE_SNIFFER */
 	case TS_IO_TEST_COMMAND:
 		{
 			uint16_t subsystem = SWAP_UINT16(data16[0]);
@@ -5,6 +5,9 @@
 #include "tunerstudio_io.h"
 
 #include "live_data.h"
+#include "ts_output_stream.h"
+#include "capture_log.h"
+#include "engine_sniffer_binary.h"
 
 #include "status_loop.h"
 
@@ -64,4 +67,126 @@ void TunerStudio::cmdOutputChannels(TsChannelBase* tsChannel, uint16_t offset, u
 	tsChannel->writeCrcPacketLocked(TS_RESPONSE_OK, scratchBuffer, count);
 }
 
+/**
+ * @brief Start, stop or acknowledge the output channel stream, see ts_output_stream.h
+ */
+void TunerStudio::handleOutputStreamCommand(TsChannelBase* tsChannel, const uint8_t* data, size_t size) {
+	auto& stream = getOutputChannelStream();
+
+	uint8_t subcommand = size >= 1 ? data[0] : 0;
+	uint16_t argument = 0;
+
+	if (size >= 3) {
+		memcpy(&argument, data + 1, sizeof(argument));
+	}
+
+	switch (subcommand) {
+	case TS_OUTPUT_STREAM_START:
+		stream.start(tsChannel, argument);
+		break;
+	case TS_OUTPUT_STREAM_STOP:
+		stream.stop(tsChannel);
+		break;
+	case TS_OUTPUT_STREAM_ACK:
+		// Sent once per frame round trip, don't waste bandwidth on a response
+		stream.acknowledge(tsChannel, argument);
+		return;
+	case TS_OUTPUT_STREAM_RESYNC:
+		stream.resync(tsChannel);
+		break;
+	default:
+		sendErrorCode(tsChannel, TS_RESPONSE_OUT_OF_RANGE);
+		return;
+	}
+
+	tsChannel->writeCrcResponse(TS_RESPONSE_OK);
+}
+
+void TunerStudio::handleCaptureLogCommand(TsChannelBase* tsChannel, const uint8_t* data, size_t size) {
+	auto& capture = getCaptureLog();
+
+	uint8_t subcommand = size >= 1 ? data[0] : 0;
+
+	switch (subcommand) {
+	case TS_CAPTURE_LOG_STATUS: {
+		uint8_t* response = tsChannel->scratchBuffer;
+		uint32_t fileSize = capture.getFileSize();
+
+		response[0] = static_cast<uint8_t>(capture.getState());
+		response[1] = static_cast<uint8_t>(capture.getReason());
+		memcpy(response + 2, &fileSize, sizeof(fileSize));
+
+		tsChannel->writeCrcPacketLocked(response, 2 + sizeof(fileSize));
+		return;
+	}
+	case TS_CAPTURE_LOG_READ: {
+		uint32_t offset;
+		uint16_t count;
+
+		if (size < 1 + sizeof(offset) + sizeof(count)) {
+			break;
+		}
+
+		memcpy(&offset, data + 1, sizeof(offset));
+		memcpy(&count, data + 1 + sizeof(offset), sizeof(count));
+
+		if (count > BLOCKING_FACTOR || offset + count > capture.getFileSize()) {
+			break;
+		}
+
+		size_t copied = capture.readForTunerStudio(offset, tsChannel->scratchBuffer, count);
+		tsChannel->writeCrcPacketLocked(tsChannel->scratchBuffer, copied);
+		return;
+	}
+	case TS_CAPTURE_LOG_REARM:
+		if (capture.getState() == CaptureLog::State::Ready) {
+			capture.rearm();
+		}
+
+		tsChannel->writeCrcResponse(TS_RESPONSE_OK);
+		return;
+	}
+
+	sendErrorCode(tsChannel, TS_RESPONSE_OUT_OF_RANGE);
+}
+
+#if EFI_ENGINE_SNIFFER
+/**
+ * @brief Start, stop or read the binary engine sniffer, see engine_sniffer_binary.h
+ */
+void TunerStudio::handleEngineSnifferCommand(TsChannelBase* tsChannel, const uint8_t* data, size_t size) {
+	auto& sniffer = getBinaryEngineSniffer();
+
+	uint8_t subcommand = size >= 1 ? data[0] : 0;
+
+	switch (subcommand) {
+	case TS_ENGINE_SNIFFER_START:
+		if (!sniffer.start()) {
+			// Somebody else is using the big buffer
+			break;
+		}
+
+		tsChannel->writeCrcResponse(TS_RESPONSE_OK);
+		return;
+	case TS_ENGINE_SNIFFER_STOP:
+		sniffer.stop();
+
+		tsChannel->writeCrcResponse(TS_RESPONSE_OK);
+		return;
+	case TS_ENGINE_SNIFFER_READ: {
+		if (!sniffer.isStarted()) {
+			break;
+		}
+
+		size_t count = sniffer.freeze();
+		tsChannel->writeCrcPacketLocked(reinterpret_cast<const uint8_t*>(sniffer.getRecords()), count * sizeof(EngineSnifferRecord));
+		sniffer.restart();
+		return;
+	}
+	}
+
+	sendErrorCode(tsChannel, TS_RESPONSE_OUT_OF_RANGE);
+}
+#endif /* EFI_ENGINE_SNIFFER */
+
 #endif // EFI_TUNER_STUDIO
@@ -35,6 +35,9 @@ public:
 			void *content);
 	void handleCrc32Check(TsChannelBase *tsChannel, uint16_t offset, uint16_t count);
 	void handlePageReadCommand(TsChannelBase* tsChannel, uint16_t offset, uint16_t count);
+	void handleOutputStreamCommand(TsChannelBase* tsChannel, const uint8_t* data, size_t size);
+	void handleCaptureLogCommand(TsChannelBase* tsChannel, const uint8_t* data, size_t size);
+	void handleEngineSnifferCommand(TsChannelBase* tsChannel, const uint8_t* data, size_t size);
 
 private:
 	void sendErrorCode(TsChannelBase* tsChannel, uint8_t code);
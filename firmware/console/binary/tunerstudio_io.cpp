@@ -39,6 +39,17 @@ void TsChannelBase::copyAndWriteSmallCrcPacket(const uint8_t* buf, size_t size)
 }
 
 void TsChannelBase::writeCrcPacketLocked(const uint8_t responseCode, const uint8_t* buf, const size_t size) {
+	LogSpan part = { reinterpret_cast<const char*>(buf), size };
+
+	writeCrcPacketLocked(responseCode, &part, size ? 1 : 0);
+}
+
+void TsChannelBase::writeCrcPacketLocked(const uint8_t responseCode, const LogSpan* parts, const size_t partCount) {
+	size_t size = 0;
+	for (size_t i = 0; i < partCount; i++) {
+		size += parts[i].length;
+	}
+
 	uint8_t headerBuffer[3];
 	*(uint16_t*)headerBuffer = SWAP_UINT16(size + 1);
 	*(uint8_t*)(headerBuffer + 2) = responseCode;
@@ -46,8 +57,8 @@ void TsChannelBase::writeCrcPacketLocked(const uint8_t responseCode, const uint8
 	write(headerBuffer, sizeof(headerBuffer), /*isEndOfPacket*/false);
 
 	// If data, write that
-	if (size) {
-		write(buf, size, /*isEndOfPacket*/false);
+	for (size_t i = 0; i < partCount; i++) {
+		write(reinterpret_cast<const uint8_t*>(parts[i].data), parts[i].length, /*isEndOfPacket*/false);
 	}
 
 	uint8_t crcBuffer[4];
@@ -57,9 +68,9 @@ void TsChannelBase::writeCrcPacketLocked(const uint8_t responseCode, const uint8
 		Crc crc(size);
 		crc.addData(headerBuffer + 2, 1);
 
-		if (size) {
-			// Data part of CRC
-			crc.addData(buf, size);
+		// Data part of CRC
+		for (size_t i = 0; i < partCount; i++) {
+			crc.addData(parts[i].data, parts[i].length);
 		}
 
 		*(uint32_t*)crcBuffer = SWAP_UINT32(crc.getCrc());
@@ -9,6 +9,7 @@
 #pragma once
 #include "global.h"
 #include "tunerstudio_impl.h"
+#include "log_ring.h"
 
 #if EFI_USB_SERIAL
 #include "usbconsole.h"
@@ -53,6 +54,8 @@ public:
 
 	// Use when buf cannot change during execution. Computes checksum without an extra copy.
 	void writeCrcPacketLocked(uint8_t responseCode, const uint8_t* buf, size_t size);
+	// Same, for data in pieces, sent as one packet
+	void writeCrcPacketLocked(uint8_t responseCode, const LogSpan* parts, size_t partCount);
 	inline void writeCrcPacketLocked(const uint8_t* buf, size_t size) {
 		writeCrcPacketLocked(TS_RESPONSE_OK, buf, size);
 	}
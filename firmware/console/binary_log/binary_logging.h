@@ -3,8 +3,10 @@
  */
 
 #include <cstddef>
+#include <cstdint>
 
 struct Writer;
 void writeFileHeader(Writer& buffer);
-void writeSdLogLine(Writer& buffer);
-void writeSdBlock(Writer& outBuffer);
+
+// Samples every logged field into a complete MLG data record, valid until the next call
+const uint8_t* buildSdLogRecord(size_t* size);
@@ -0,0 +1,269 @@
+/**
+ * @file capture_log.cpp
+ *
+ * Records only hold a dozen channels, so that a few kilobytes cover well over a hundred
+ * milliseconds at 1khz - a full output channel record would only fit a handful of samples.
+ */
+
+#include "pch.h"
+
+#include "capture_log.h"
+#include "log_field.h"
+#include "log_record.h"
+#include "buffered_writer.h"
+
+static scaled_channel<uint32_t, 10000> captureTime;
+static scaled_channel<uint16_t> captureRpm;
+static scaled_pressure captureMap;
+static scaled_percent captureTps;
+static scaled_lambda captureLambda;
+static scaled_angle captureTiming;
+static scaled_ms captureInjectorPw;
+static float captureKnockLevel;
+static uint8_t captureTriggerSync;
+static int8_t captureFuelCut;
+static int8_t captureSparkCut;
+static uint8_t captureReason;
+
+static constexpr LogField captureFields[] = {
+	{ captureTime, "Time", "sec", 4 },
+	{ captureRpm, "RPM", "rpm", 0 },
+	{ captureMap, "MAP", "kPa", 1 },
+	{ captureTps, "TPS", "%", 1 },
+	{ captureLambda, "Lambda", "", 3 },
+	{ captureTiming, "Ignition timing", "deg", 1 },
+	{ captureInjectorPw, "Injector pulse width", "ms", 2 },
+	{ captureKnockLevel, "Knock level", "dBv", 0 },
+	{ captureTriggerSync, "Trigger synced", "", 0 },
+	{ captureFuelCut, "Fuel cut reason", "", 0 },
+	{ captureSparkCut, "Spark cut reason", "", 0 },
+	// Non-zero on the record where the event happened
+	{ captureReason, "Capture reason", "", 0 },
+};
+
+static constexpr auto capturePlan = makeLogRecordPlan(captureFields);
+static constexpr uint16_t captureRecordLength = capturePlan.dataSize;
+
+using CaptureRecord = LogRecordBuilder<captureRecordLength>;
+static CaptureRecord captureRecord;
+
+static constexpr size_t captureHeaderSize = MLQ_HEADER_SIZE + efi::size(captureFields) * MLQ_FIELD_HEADER_SIZE;
+
+static CaptureLog captureLog CCM_OPTIONAL;
+
+CaptureLog& getCaptureLog() {
+	return captureLog;
+}
+
+static bool shouldTriggerOn(CaptureReason reason) {
+	switch (reason) {
+		case CaptureReason::Knock:
+			return engineConfiguration->captureLogOnKnock;
+		case CaptureReason::Lean:
+			return engineConfiguration->captureLogOnLean;
+		case CaptureReason::SyncLoss:
+			return engineConfiguration->captureLogOnSyncLoss;
+		case CaptureReason::Limp:
+			return engineConfiguration->captureLogOnLimp;
+		default:
+			return false;
+	}
+}
+
+void triggerCaptureLog(CaptureReason reason) {
+	if (shouldTriggerOn(reason)) {
+		captureLog.trigger(reason);
+	}
+}
+
+void CaptureLog::trigger(CaptureReason reason) {
+	// The first event wins, anything else before the capture is saved is ignored
+	if (m_state == State::PreTrigger && m_pendingReason == CaptureReason::None) {
+		m_pendingReason = reason;
+	}
+}
+
+bool CaptureLog::isEnabled() const {
+	return engineConfiguration->captureLogOnKnock
+		|| engineConfiguration->captureLogOnLean
+		|| engineConfiguration->captureLogOnSyncLoss
+		|| engineConfiguration->captureLogOnLimp;
+}
+
+void CaptureLog::arm() {
+	m_capacity = sizeof(m_buffer) / CaptureRecord::size;
+	rearm();
+}
+
+void CaptureLog::disarm() {
+	m_state = State::Disarmed;
+	m_count = 0;
+}
+
+void CaptureLog::rearm() {
+	m_sequence++;
+	m_tsReading = false;
+
+	m_head = 0;
+	m_count = 0;
+	m_pendingReason = CaptureReason::None;
+	m_reason = CaptureReason::None;
+
+	// Last, as this is what lets the sampler touch the records again
+	m_state = State::PreTrigger;
+}
+
+void CaptureLog::sample(efitick_t nowNt) {
+	if (!isEnabled()) {
+		if (m_state != State::Disarmed) {
+			disarm();
+		}
+
+		return;
+	}
+
+	if (m_state == State::Disarmed) {
+		arm();
+	}
+
+	if (m_state == State::Ready) {
+		return;
+	}
+
+	CaptureReason reason = m_pendingReason;
+
+	if (reason != CaptureReason::None && m_state == State::PreTrigger) {
+		m_reason = reason;
+		m_state = State::PostTrigger;
+
+		size_t postTrigger = m_capacity * minI(engineConfiguration->captureLogPostTrigger, 100) / 100;
+		// The event record itself counts as post-trigger
+		m_postRemaining = maxI(1, postTrigger);
+	} else {
+		reason = CaptureReason::None;
+	}
+
+	writeRecord(nowNt, reason);
+
+	if (m_state == State::PostTrigger && --m_postRemaining == 0) {
+		m_state = State::Ready;
+	}
+}
+
+void CaptureLog::writeRecord(efitick_t nowNt, CaptureReason reason) {
+	// A float in seconds would lose the sub-millisecond part after a few minutes
+	*reinterpret_cast<uint32_t*>(&captureTime) = nowNt / (US_TO_NT_MULTIPLIER * 100);
+	captureRpm = Sensor::getOrZero(SensorType::Rpm);
+	captureMap = Sensor::getOrZero(SensorType::Map);
+	captureTps = Sensor::getOrZero(SensorType::Tps1);
+	captureLambda = Sensor::getOrZero(SensorType::Lambda1);
+	captureTiming = engine->cylinders[0].getIgnitionTimingBtdc();
+	captureInjectorPw = engine->engineState.injectionDuration;
+	captureKnockLevel = engine->module<KnockController>()->m_knockLevel;
+#if EFI_SHAFT_POSITION_INPUT
+	captureTriggerSync = engine->triggerCentral.triggerState.getShaftSynchronized();
+#endif // EFI_SHAFT_POSITION_INPUT
+	captureFuelCut = engine->outputChannels.fuelCutReason;
+	captureSparkCut = engine->outputChannels.sparkCutReason;
+	captureReason = static_cast<uint8_t>(reason);
+
+	// Timestamp at 10us resolution, same as the regular log
+	uint16_t timestamp = nowNt / (US_TO_NT_MULTIPLIER * 10);
+	const uint8_t* record = captureRecord.build(capturePlan, timestamp);
+
+	size_t slot = (m_head + m_count) % m_capacity;
+	memcpy(m_buffer + slot * CaptureRecord::size, record, CaptureRecord::size);
+
+	if (m_count < m_capacity) {
+		m_count++;
+	} else {
+		// Full, the oldest record was just overwritten
+		m_head = (m_head + 1) % m_capacity;
+	}
+}
+
+size_t CaptureLog::getFileSize() const {
+	if (m_state != State::Ready) {
+		return 0;
+	}
+
+	return captureHeaderSize + m_count * CaptureRecord::size;
+}
+
+void CaptureLog::writeTo(Writer& writer) const {
+	writeMlgFileHeader(writer, captureFields, efi::size(captureFields), captureRecordLength);
+
+	// Oldest first: from the head to the end of the buffer, then wrap around
+	const char* records = reinterpret_cast<const char*>(m_buffer);
+	size_t firstPart = minI(m_count, m_capacity - m_head);
+
+	writer.write(records + m_head * CaptureRecord::size, firstPart * CaptureRecord::size);
+	writer.write(records, (m_count - firstPart) * CaptureRecord::size);
+}
+
+/**
+ * Keeps only the part of a stream that lands in a range, so that a range of the file
+ * can be read without ever having the whole file in memory.
+ */
+class RangeWriter final : public Writer {
+public:
+	RangeWriter(size_t offset, uint8_t* buffer, size_t count)
+		: m_offset(offset)
+		, m_buffer(buffer)
+		, m_count(count)
+	{
+	}
+
+	size_t write(const char* data, size_t size) override {
+		size_t start = std::max(m_position, m_offset);
+		size_t end = std::min(m_position + size, m_offset + m_count);
+
+		if (start < end) {
+			memcpy(m_buffer + (start - m_offset), data + (start - m_position), end - start);
+			m_copied += end - start;
+		}
+
+		m_position += size;
+		return size;
+	}
+
+	size_t flush() override {
+		return 0;
+	}
+
+	size_t getCopied() const {
+		return m_copied;
+	}
+
+private:
+	const size_t m_offset;
+	uint8_t* const m_buffer;
+	const size_t m_count;
+
+	size_t m_position = 0;
+	size_t m_copied = 0;
+};
+
+size_t CaptureLog::read(size_t offset, uint8_t* buffer, size_t count) const {
+	if (m_state != State::Ready) {
+		return 0;
+	}
+
+	RangeWriter writer(offset, buffer, count);
+	writeTo(writer);
+	return writer.getCopied();
+}
+
+size_t CaptureLog::readForTunerStudio(size_t offset, uint8_t* buffer, size_t count) {
+	size_t copied = read(offset, buffer, count);
+
+	m_lastTsRead.reset();
+	// Done once the end of the file has been sent
+	m_tsReading = copied != 0 && offset + copied < getFileSize();
+
+	return copied;
+}
+
+bool CaptureLog::isBeingRead() const {
+	return m_tsReading && !m_lastTsRead.hasElapsedSec(CAPTURE_LOG_READ_TIMEOUT_SEC);
+}
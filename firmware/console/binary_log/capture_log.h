@@ -0,0 +1,126 @@
+/**
+ * @file capture_log.h
+ *
+ * High rate capture around rare events. A short MLG record of the fast moving channels is
+ * sampled at 1khz in to a ring. When one of the configured events happens the ring keeps going
+ * for the post-trigger window, then freezes until the capture has been saved to the SD card
+ * (as its own .mlg file) and isn't being read out over TunerStudio.
+ *
+ * The ring has its own storage rather than the big buffer: it records all the time the feature
+ * is enabled, so holding the big buffer would lock the tooth logger, trigger scope and perf
+ * trace out.
+ */
+
+#pragma once
+
+#include "timer.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#ifndef CAPTURE_LOG_BUFFER_SIZE
+// A little over 140ms at 1khz
+#define CAPTURE_LOG_BUFFER_SIZE 4096
+#endif
+
+// A TunerStudio read of a capture that went quiet for this long has been abandoned
+#define CAPTURE_LOG_READ_TIMEOUT_SEC 3
+
+struct Writer;
+
+enum class CaptureReason : uint8_t {
+	None = 0,
+	Knock = 1,
+	Lean = 2,
+	SyncLoss = 3,
+	Limp = 4,
+};
+
+/**
+ * Report an event that may freeze the capture, if the capture is configured to trigger on it.
+ * Safe to call from any context.
+ */
+void triggerCaptureLog(CaptureReason reason);
+
+class CaptureLog {
+public:
+	enum class State : uint8_t {
+		// Not configured
+		Disarmed,
+		// Recording the window leading up to an event
+		PreTrigger,
+		// Event happened, recording what follows it
+		PostTrigger,
+		// Frozen, waiting to be saved
+		Ready,
+	};
+
+	void trigger(CaptureReason reason);
+
+	// Called at 1khz
+	void sample(efitick_t nowNt);
+
+	State getState() const {
+		return m_state;
+	}
+
+	CaptureReason getReason() const {
+		return m_reason;
+	}
+
+	size_t getRecordCount() const {
+		return m_count;
+	}
+
+	// Changes every time the capture is rearmed, to tell one ready capture from the next
+	uint32_t getSequence() const {
+		return m_sequence;
+	}
+
+	// Size of the .mlg file of a ready capture, 0 otherwise
+	size_t getFileSize() const;
+
+	// Copies a range of the .mlg file, returns the number of bytes copied
+	size_t read(size_t offset, uint8_t* buffer, size_t count) const;
+
+	/**
+	 * Same as read(), for TunerStudio: until the last byte of the file has been read, or the
+	 * reads stop for CAPTURE_LOG_READ_TIMEOUT_SEC, the capture counts as being read.
+	 */
+	size_t readForTunerStudio(size_t offset, uint8_t* buffer, size_t count);
+
+	// Rearming now would pull the capture out from under a TunerStudio transfer
+	bool isBeingRead() const;
+
+	// Writes the whole .mlg file, oldest record first
+	void writeTo(Writer& writer) const;
+
+	// Done with this capture, start recording the next one
+	void rearm();
+
+private:
+	bool isEnabled() const;
+	void arm();
+	void disarm();
+
+	void writeRecord(efitick_t nowNt, CaptureReason reason);
+
+	volatile State m_state = State::Disarmed;
+	volatile CaptureReason m_pendingReason = CaptureReason::None;
+	CaptureReason m_reason = CaptureReason::None;
+
+	// Ring of records, m_head is the oldest record once full
+	alignas(4) uint8_t m_buffer[CAPTURE_LOG_BUFFER_SIZE];
+	size_t m_capacity = 0;
+	size_t m_head = 0;
+	size_t m_count = 0;
+
+	size_t m_postRemaining = 0;
+
+	volatile uint32_t m_sequence = 0;
+
+	volatile bool m_tsReading = false;
+	Timer m_lastTsRead;
+};
+
+CaptureLog& getCaptureLog();
@@ -52,6 +52,10 @@ public:
 		return m_size;
 	}
 
+	constexpr const void* getAddr() const {
+		return m_addr;
+	}
+
 	// Write the header data describing this field.
 	void writeHeader(Writer& outBuffer) const;
 
@@ -0,0 +1,71 @@
+#include "log_record.h"
+#include "buffered_writer.h"
+#include "rusefi_generated.h"
+
+void writeMlgFileHeader(Writer& writer, const LogField* fields, size_t fieldCount, uint16_t recordLength) {
+	char buffer[MLQ_HEADER_SIZE];
+	// File format: MLVLG\0
+	strncpy(buffer, "MLVLG", 6);
+
+	// Format version = 02
+	buffer[6] = 0;
+	buffer[7] = 2;
+
+	// Timestamp
+	buffer[8] = 0;
+	buffer[9] = 0;
+	buffer[10] = 0;
+	buffer[11] = 0;
+
+	// Info data start
+	buffer[12] = 0;
+	buffer[13] = 0;
+	buffer[14] = 0;
+	buffer[15] = 0;
+
+	size_t headerSize = MLQ_HEADER_SIZE + fieldCount * MLQ_FIELD_HEADER_SIZE;
+
+	// Data begin index: begins immediately after the header
+	buffer[16] = 0;
+	buffer[17] = 0;
+	buffer[18] = (headerSize >> 8) & 0xFF;
+	buffer[19] = headerSize & 0xFF;
+
+	// Record length - length of a single data record: sum size of all fields
+	buffer[20] = recordLength >> 8;
+	buffer[21] = recordLength & 0xFF;
+
+	// Number of logger fields
+	buffer[22] = fieldCount >> 8;
+	buffer[23] = fieldCount;
+
+	writer.write(buffer, MLQ_HEADER_SIZE);
+
+	// Write the actual logger fields, offset 22
+	for (size_t i = 0; i < fieldCount; i++) {
+		fields[i].writeHeader(writer);
+	}
+}
+
+uint8_t logRecordChecksum(const uint32_t* words, size_t count) {
+	uint32_t sum = 0;
+
+	while (count) {
+		// Two 16 bit lanes, each collecting two bytes per word - 128 words (at most 510 each) fit
+		// before a lane could carry into the other one
+		size_t chunk = count < 128 ? count : 128;
+		uint32_t lanes = 0;
+
+		for (size_t i = 0; i < chunk; i++) {
+			uint32_t word = words[i];
+			lanes += (word & 0x00FF00FF) + ((word >> 8) & 0x00FF00FF);
+		}
+
+		sum += (lanes & 0xFFFF) + (lanes >> 16);
+
+		words += chunk;
+		count -= chunk;
+	}
+
+	return sum;
+}
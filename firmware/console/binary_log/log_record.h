@@ -0,0 +1,141 @@
+/**
+ * @file log_record.h
+ *
+ * Builds MLG data records in one go instead of field by field.
+ *
+ * The fields get sorted by size into a copy plan at compile time, so filling a record is
+ * three tight loops of load, byteswap, store. The record lives in a word aligned buffer
+ * with zero padding at the end, which lets the checksum add up four bytes at a time.
+ */
+
+#pragma once
+
+#include "log_field.h"
+
+#include <cstring>
+#include <initializer_list>
+
+// Offset 0 block type, offset 1 rolling counter, offset 2 timestamp
+#define LOG_RECORD_HEADER_SIZE 4
+// 1 byte checksum footer
+#define LOG_RECORD_FOOTER_SIZE 1
+
+struct LogFieldCopy {
+	const void* src;
+	uint16_t offset;
+};
+
+template <size_t N>
+struct LogRecordPlan {
+	// 4 byte fields first, then 2 byte fields, then single bytes
+	LogFieldCopy copies[N];
+	uint16_t wordCount;
+	uint16_t halfCount;
+	uint16_t byteCount;
+
+	// Sum of all field sizes
+	uint16_t dataSize;
+};
+
+template <size_t N>
+constexpr LogRecordPlan<N> makeLogRecordPlan(const LogField (&fields)[N]) {
+	LogRecordPlan<N> plan = {};
+	size_t next = 0;
+
+	for (size_t size : { 4, 2, 1 }) {
+		uint16_t offset = LOG_RECORD_HEADER_SIZE;
+
+		for (size_t i = 0; i < N; i++) {
+			if (fields[i].getSize() == size) {
+				plan.copies[next++] = { fields[i].getAddr(), offset };
+
+				if (size == 4) {
+					plan.wordCount++;
+				} else if (size == 2) {
+					plan.halfCount++;
+				} else {
+					plan.byteCount++;
+				}
+			}
+
+			offset += fields[i].getSize();
+		}
+
+		plan.dataSize = offset - LOG_RECORD_HEADER_SIZE;
+	}
+
+	return plan;
+}
+
+/**
+ * MLG file header followed by the description of each field, records follow immediately after.
+ */
+void writeMlgFileHeader(Writer& writer, const LogField* fields, size_t fieldCount, uint16_t recordLength);
+
+/**
+ * Sum of all bytes in the words, modulo 256.
+ */
+uint8_t logRecordChecksum(const uint32_t* words, size_t count);
+
+template <size_t N>
+void copyLogFields(const LogRecordPlan<N>& plan, uint8_t* record) {
+	const LogFieldCopy* copy = plan.copies;
+
+	// MLG is big endian
+	for (size_t i = 0; i < plan.wordCount; i++, copy++) {
+		uint32_t value;
+		memcpy(&value, copy->src, sizeof(value));
+		value = __builtin_bswap32(value);
+		memcpy(record + copy->offset, &value, sizeof(value));
+	}
+
+	for (size_t i = 0; i < plan.halfCount; i++, copy++) {
+		uint16_t value;
+		memcpy(&value, copy->src, sizeof(value));
+		value = __builtin_bswap16(value);
+		memcpy(record + copy->offset, &value, sizeof(value));
+	}
+
+	for (size_t i = 0; i < plan.byteCount; i++, copy++) {
+		record[copy->offset] = *reinterpret_cast<const uint8_t*>(copy->src);
+	}
+}
+
+template <size_t TDataSize>
+class LogRecordBuilder {
+public:
+	static constexpr size_t size = LOG_RECORD_HEADER_SIZE + TDataSize + LOG_RECORD_FOOTER_SIZE;
+
+	/**
+	 * Fill in the record from current field values.
+	 * @param timestamp in 10us units
+	 */
+	template <size_t N>
+	const uint8_t* build(const LogRecordPlan<N>& plan, uint16_t timestamp) {
+		uint8_t* bytes = reinterpret_cast<uint8_t*>(m_words);
+
+		// Block type: standard data block
+		bytes[0] = 0;
+		bytes[1] = m_rollCounter++;
+		bytes[2] = timestamp >> 8;
+		bytes[3] = timestamp & 0xFF;
+
+		copyLogFields(plan, bytes);
+
+		// The checksum covers field data only, not the header. The footer byte from
+		// the previous record is cleared so that it doesn't count either.
+		bytes[LOG_RECORD_HEADER_SIZE + TDataSize] = 0;
+		bytes[LOG_RECORD_HEADER_SIZE + TDataSize] = logRecordChecksum(m_words + 1, wordCount - 1);
+
+		return bytes;
+	}
+
+private:
+	static_assert(LOG_RECORD_HEADER_SIZE == sizeof(uint32_t), "header has to be exactly one word for the checksum to skip it");
+
+	static constexpr size_t wordCount = (size + 3) / 4;
+
+	// Padding past the footer stays zero forever
+	uint32_t m_words[wordCount] = {};
+	uint8_t m_rollCounter = 0;
+};
@@ -4,30 +4,31 @@
 
 #include "mmc_card.h"
 #include "binary_logging.h"
+#include "tunerstudio.h"
+#include "capture_log.h"
 
 int totalLoggedBytes = 0;
 
 #if EFI_PROD_CODE
 
-static int writeCounter = 0;
-static int totalWritesCounter = 0;
-static int totalSyncCounter = 0;
-
 #include <stdio.h>
 #include <string.h>
 #include "ff.h"
 #include "mass_storage_init.h"
 #include "rtc_helper.h"
+#include "sd_log_file.h"
 #include <charconv>
 
 // 10 because we want at least 4 character name
 #define MIN_FILE_INDEX 10
 static char logName[_MAX_FILLER + 20];
 
-// at about 20Hz we write about 2Kb per second, looks like we flush once every ~2 seconds
-#define F_SYNC_FREQUENCY 10
-
 #define LOG_INDEX_FILENAME "index.txt"
+// Name of the log that has clusters preallocated past its end, until they're given back
+#define LOG_PREALLOCATED_FILENAME "prealloc.txt"
+
+// About 20 minutes of a typical log, it grows as usual after that
+#define SD_LOG_PREALLOCATE_SIZE (64 * 1024 * 1024)
 
 #define FOME_LOG_PREFIX "fome_"
 #define PREFIX_LEN 5
@@ -106,6 +107,46 @@ static void prepareLogFileName(int index) {
 	}
 }
 
+/**
+ * The last log may not have been closed (power was cut), give back what it didn't use of its
+ * preallocation.
+ */
+static void releasePreviousPreallocation() {
+	char name[sizeof(logName)];
+	UINT nameLength = 0;
+
+	memset(sd_mem::getLogFileFd(), 0, sizeof(FIL));
+	if (f_open(sd_mem::getLogFileFd(), LOG_PREALLOCATED_FILENAME, FA_READ) != FR_OK) {
+		// No log to clean up after
+		return;
+	}
+
+	f_read(sd_mem::getLogFileFd(), name, sizeof(name) - 1, &nameLength);
+	f_close(sd_mem::getLogFileFd());
+	name[nameLength] = '\0';
+
+	if (nameLength > 0) {
+		FRESULT err = releasePreallocation(sd_mem::getLogFileFd(), name);
+		if (err != FR_OK && err != FR_NO_FILE) {
+			printFatFsError("release preallocation", err);
+		}
+	}
+
+	f_unlink(LOG_PREALLOCATED_FILENAME);
+}
+
+static void writePreallocatedName() {
+	memset(sd_mem::getLogFileFd(), 0, sizeof(FIL));
+	if (f_open(sd_mem::getLogFileFd(), LOG_PREALLOCATED_FILENAME, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) {
+		return;
+	}
+
+	f_write(sd_mem::getLogFileFd(), logName, strlen(logName), nullptr);
+	f_close(sd_mem::getLogFileFd());
+}
+
+static SdLogFile logFile;
+
 /**
  * @brief Create a new file with the specified name
  *
@@ -115,48 +156,134 @@ static void prepareLogFileName(int index) {
 static bool createLogFile(int logFileIndex) {
 	prepareLogFileName(logFileIndex);
 
-	memset(sd_mem::getLogFileFd(), 0, sizeof(FIL));
-	FRESULT err = f_open(sd_mem::getLogFileFd(), logName, FA_CREATE_ALWAYS | FA_WRITE);
+	bool preallocate = engineConfiguration->sdCardLogPreallocate;
+
+	// Before the clusters are allocated, so that they're given back whenever power is cut
+	if (preallocate) {
+		writePreallocatedName();
+	}
+
+	FRESULT err = logFile.open(sd_mem::getLogFileFd(), logName, preallocate ? SD_LOG_PREALLOCATE_SIZE : 0);
 	if (err != FR_OK && err != FR_EXIST) {
 		warning(ObdCode::CUSTOM_ERR_SD_MOUNT_FAILED, "SD: mount failed");
 		printFatFsError("FS mount failed", err);	// else - show error
 		return false;
 	}
 
+	if (preallocate) {
+		efiPrintf("SD log preallocated %d bytes", (int)logFile.getPreallocated());
+
+		if (!logFile.getPreallocated()) {
+			// Nothing to give back
+			f_unlink(LOG_PREALLOCATED_FILENAME);
+		}
+	}
+
 	return true;
 }
 
-size_t SdLogBufferWriter::writeInternal(const char* buffer, size_t count) {
-	size_t bytesWritten;
+// Syncing rewrites the directory entry (and the FAT, if the file isn't preallocated), so only do it once in a while
+#define F_SYNC_PERIOD_SEC 1
+// ...and when the card is busy all the time, no less often than this
+#define F_SYNC_MAX_PERIOD_SEC 5
 
+static bool writeLogFile(const uint8_t* buffer, size_t count) {
 	totalLoggedBytes += count;
 
-	FRESULT err = f_write(sd_mem::getLogFileFd(), buffer, count, &bytesWritten);
+	FRESULT err = logFile.write(buffer, count);
 
-	if (bytesWritten != count) {
+	if (err != FR_OK) {
 		printFatFsError("write error or disk full", err);
 
 		// Close file and unmount volume (ignore errors, we're already in the shutdown path)
-		f_close(sd_mem::getLogFileFd());
+		logFile.close();
 
 		unmountSdFilesystem();
-		failed = true;
-		return 0;
-	} else {
-		writeCounter++;
-		totalWritesCounter++;
-		if (writeCounter >= F_SYNC_FREQUENCY) {
-			/**
-			 * Performance optimization: not f_sync after each line, f_sync is probably a heavy operation
-			 * todo: one day someone should actually measure the relative cost of f_sync
-			 */
-			f_sync(sd_mem::getLogFileFd());
-			totalSyncCounter++;
-			writeCounter = 0;
+		return false;
+	}
+
+	return true;
+}
+
+// Preferably when no data is waiting to be written, so that syncing doesn't hold any up
+static void syncLogFile(bool idle) {
+	if (!logFile.needsSync(idle ? F_SYNC_PERIOD_SEC : F_SYNC_MAX_PERIOD_SEC)) {
+		return;
+	}
+
+	FRESULT err = logFile.sync();
+	if (err != FR_OK) {
+		printFatFsError("sync", err);
+	}
+}
+
+/**
+ * Writes in pieces smaller than a sector, so FatFs copies them through the file's own
+ * (DMA safe) buffer instead of pointing the SD DMA at the capture ring, which lives in CCM
+ * where the DMA can't reach it.
+ */
+class CaptureFileWriter final : public Writer {
+public:
+	bool failed = false;
+
+	size_t write(const char* buffer, size_t count) override {
+		size_t written = 0;
+
+		while (count && !failed) {
+			size_t chunk = minI(count, 256);
+			UINT bytesWritten;
+
+			FRESULT err = f_write(sd_mem::getCaptureFileFd(), buffer, chunk, &bytesWritten);
+			if (err != FR_OK || bytesWritten != chunk) {
+				printFatFsError("capture log write", err);
+				failed = true;
+			}
+
+			buffer += chunk;
+			count -= chunk;
+			written += bytesWritten;
 		}
+
+		totalLoggedBytes += written;
+		return written;
+	}
+
+	size_t flush() override {
+		return 0;
+	}
+};
+
+static bool writeCaptureFile(int index) {
+	// Named after the regular log it belongs to
+	char name[sizeof(logName) + 16];
+	strcpy(name, logName);
+
+	char* ptr = strrchr(name, '.');
+	if (!ptr) {
+		ptr = name + strlen(name);
 	}
 
-	return bytesWritten;
+	strcpy(ptr, "_cap");
+	ptr = itoa10(ptr + 4, index);
+	strcpy(ptr, ".mlg");
+
+	memset(sd_mem::getCaptureFileFd(), 0, sizeof(FIL));
+	FRESULT err = f_open(sd_mem::getCaptureFileFd(), name, FA_CREATE_ALWAYS | FA_WRITE);
+	if (err != FR_OK) {
+		printFatFsError("capture log open", err);
+		return false;
+	}
+
+	CaptureFileWriter writer;
+	getCaptureLog().writeTo(writer);
+
+	f_close(sd_mem::getCaptureFileFd());
+
+	if (!writer.failed) {
+		efiPrintf("Capture log saved to %s", name);
+	}
+
+	return !writer.failed;
 }
 
 #else // not EFI_PROD_CODE (simulator)
@@ -168,36 +295,209 @@ bool mountSdFilesystem() {
 	return true;
 }
 
-class SdLogBufferWriter final : public BufferedWriter<512> {
-public:
-	bool failed = false;
+static bool writeLogFile(const uint8_t* buffer, size_t count) {
+	static std::ofstream stream("fome_simulator_log.mlg", std::ios::binary | std::ios::trunc);
 
-	SdLogBufferWriter()
-		: m_stream("fome_simulator_log.mlg", std::ios::binary | std::ios::trunc)
+	stream.write(reinterpret_cast<const char*>(buffer), count);
+	stream.flush();
+	return true;
+}
+
+static void syncLogFile(bool) {
+	// Flushed on every write
+}
+
+class CaptureFileWriter final : public Writer {
+public:
+	CaptureFileWriter(const char* name)
+		: m_stream(name, std::ios::binary | std::ios::trunc)
 	{
 	}
 
-	size_t writeInternal(const char* buffer, size_t count) override {
+	size_t write(const char* buffer, size_t count) override {
 		m_stream.write(buffer, count);
-		m_stream.flush();
 		return count;
 	}
 
+	size_t flush() override {
+		m_stream.flush();
+		return 0;
+	}
+
 private:
 	std::ofstream m_stream;
 };
 
+static bool writeCaptureFile(int index) {
+	char name[64];
+	snprintf(name, sizeof(name), "fome_simulator_capture_%d.mlg", index);
+
+	CaptureFileWriter writer(name);
+	getCaptureLog().writeTo(writer);
+	writer.flush();
+	return true;
+}
+
 namespace sd_mem {
-	SdLogBufferWriter& getLogBuffer() {
-		static SdLogBufferWriter logBuffer;
-		return logBuffer;
+	uint8_t* getLogBlock(size_t index) {
+		alignas(4) static uint8_t logBlocks[SD_LOG_BLOCK_COUNT][SD_LOG_BLOCK_SIZE];
+		return logBlocks[index];
 	}
 }
 
 #endif // EFI_PROD_CODE
 
+// Blocks travel from the logger thread to the writer thread and back
+static chibios_rt::Mailbox<uint8_t*, SD_LOG_BLOCK_COUNT> freeBlocks;
+static chibios_rt::Mailbox<uint8_t*, SD_LOG_BLOCK_COUNT> filledBlocks;
+
+/**
+ * Packs log data in to whole blocks for the writer thread. Data is copied exactly once,
+ * straight in to memory the SD DMA can read from.
+ */
+class SdLogBlockWriter final : public Writer {
+public:
+	// Set by the writer thread once the card has gone away
+	volatile bool failed = false;
+
+	void init() {
+		for (size_t i = 0; i < SD_LOG_BLOCK_COUNT; i++) {
+			freeBlocks.post(sd_mem::getLogBlock(i), TIME_INFINITE);
+		}
+	}
+
+	// Waits for the writer thread if every block is full
+	size_t write(const char* buffer, size_t count) override {
+		size_t written = 0;
+
+		while (count) {
+			if (!m_block) {
+				freeBlocks.fetch(&m_block, TIME_INFINITE);
+				m_used = 0;
+			}
+
+			size_t chunk = minI(count, SD_LOG_BLOCK_SIZE - m_used);
+			memcpy(m_block + m_used, buffer, chunk);
+			m_used += chunk;
+
+			buffer += chunk;
+			count -= chunk;
+			written += chunk;
+
+			if (m_used == SD_LOG_BLOCK_SIZE) {
+				filledBlocks.post(m_block, TIME_INFINITE);
+				m_block = nullptr;
+			}
+		}
+
+		return written;
+	}
+
+	// Blocks are only ever written whole, partial blocks wait for more data
+	size_t flush() override {
+		return 0;
+	}
+
+	// Writes the whole record if there's room for it without waiting, otherwise nothing at all
+	bool tryWrite(const uint8_t* record, size_t size) {
+		size_t room = m_block ? SD_LOG_BLOCK_SIZE - m_used : 0;
+
+		if (size > room) {
+			size_t blocksNeeded = (size - room + SD_LOG_BLOCK_SIZE - 1) / SD_LOG_BLOCK_SIZE;
+
+			chibios_rt::CriticalSectionLocker csl;
+			if ((size_t)freeBlocks.getUsedCountI() < blocksNeeded) {
+				return false;
+			}
+		}
+
+		// Only this thread takes free blocks, so this can't wait
+		write(reinterpret_cast<const char*>(record), size);
+		return true;
+	}
+
+private:
+	uint8_t* m_block = nullptr;
+	size_t m_used = 0;
+};
+
+static SdLogBlockWriter blockWriter;
+
+static THD_WORKING_AREA(sdCardWriterStack, 2 * UTILITY_THREAD_STACK_SIZE);
+static THD_FUNCTION(sdCardWriterThread, arg) {
+	(void)arg;
+	chRegSetThreadName("MMC Card Writer");
+
+	int captureIndex = 0;
+	// Sequence number of the last capture written to the card
+	uint32_t savedCaptureSequence = 0;
+
+	while (true) {
+		uint8_t* blocks[SD_LOG_BLOCK_COUNT];
+
+		// Wake up every now and then even if the log is idle, to sync it and to check for a finished capture
+		if (filledBlocks.fetch(&blocks[0], TIME_MS2I(100)) == MSG_OK) {
+			// Take whatever else is already full, to write blocks that follow each other in memory
+			// as one multi-block transfer
+			size_t count = 1;
+			while (count < SD_LOG_BLOCK_COUNT && filledBlocks.fetch(&blocks[count], TIME_IMMEDIATE) == MSG_OK) {
+				count++;
+			}
+
+			size_t runStart = 0;
+			for (size_t i = 1; i <= count; i++) {
+				if (i < count && blocks[i] == blocks[i - 1] + SD_LOG_BLOCK_SIZE) {
+					continue;
+				}
+
+				// Keep handing blocks back after a failure, so the logger never gets stuck waiting for one
+				if (!blockWriter.failed && !writeLogFile(blocks[runStart], (i - runStart) * SD_LOG_BLOCK_SIZE)) {
+					blockWriter.failed = true;
+				}
+
+				for (; runStart < i; runStart++) {
+					freeBlocks.post(blocks[runStart], TIME_INFINITE);
+				}
+			}
+		}
+
+		bool idle;
+		{
+			chibios_rt::CriticalSectionLocker csl;
+			idle = filledBlocks.getUsedCountI() == 0;
+		}
+
+		if (!blockWriter.failed) {
+			syncLogFile(idle);
+		}
+
+		auto& capture = getCaptureLog();
+		if (!blockWriter.failed && capture.getState() == CaptureLog::State::Ready) {
+			uint32_t sequence = capture.getSequence();
+
+			// Even if it didn't make it to the card, don't get stuck retrying the same capture forever
+			if (sequence != savedCaptureSequence) {
+				writeCaptureFile(captureIndex++);
+				savedCaptureSequence = sequence;
+			}
+
+			// TunerStudio may still be reading it out, rearm once that's done or abandoned
+			if (!capture.isBeingRead()) {
+				capture.rearm();
+			}
+		}
+	}
+}
+
+extern bool main_loop_started;
+
+// Records that didn't fit because the card fell behind
+static uint32_t droppedRecords = 0;
+
 // Log 'regular' ECU log to MLG file
 void mlgLogger() {
+	bool headerWritten = false;
+
 	while (true) {
 		// if the SPI device got un-picked somehow, cancel SD card
 		// Don't do this check at all if using SDMMC interface instead of SPI
@@ -209,16 +509,31 @@ void mlgLogger() {
 
 		systime_t before = chVTGetSystemTime();
 
-		writeSdLogLine(sd_mem::getLogBuffer());
+		if (!main_loop_started) {
+			// Nothing worth logging yet
+		} else if (!headerWritten) {
+			writeFileHeader(blockWriter);
+			headerWritten = true;
+		} else {
+			updateTunerStudioState();
+
+			size_t size;
+			const uint8_t* record = buildSdLogRecord(&size);
+
+			// Never wait on the card here, that would stretch the sample period
+			if (!blockWriter.tryWrite(record, size) && droppedRecords++ == 0) {
+				efiPrintf("SD card can't keep up with the log rate, dropping records");
+			}
+		}
 
 		// Something went wrong (already handled), so cancel further writes
-		if (sd_mem::getLogBuffer().failed) {
+		if (blockWriter.failed) {
 			return;
 		}
 
 		auto freq = engineConfiguration->sdCardLogFrequency;
-		if (freq > 250) {
-			freq = 250;
+		if (freq > 500) {
+			freq = 500;
 		} else if (freq < 1) {
 			freq = 1;
 		}
@@ -237,7 +552,7 @@ static void sdTriggerLogger() {
 		auto buffer = GetToothLoggerBufferBlocking();
 
 		if (buffer) {
-			sd_mem::getLogBuffer().write(reinterpret_cast<const char*>(buffer->buffer), buffer->nextIdx * sizeof(composite_logger_s));
+			blockWriter.write(reinterpret_cast<const char*>(buffer->buffer), buffer->nextIdx * sizeof(composite_logger_s));
 			ReturnToothLoggerBuffer(buffer);
 		}
 
@@ -256,12 +571,17 @@ static THD_FUNCTION(sdCardLoggerThread, arg) {
 	}
 
 	#if EFI_PROD_CODE
+		releasePreviousPreallocation();
+
 		int logFileIndex = incLogFileName();
 		if (!createLogFile(logFileIndex)) {
 			return;
 		}
 	#endif // EFI_PROD_CODE
 
+	blockWriter.init();
+	chThdCreateStatic(sdCardWriterStack, sizeof(sdCardWriterStack), SD_CARD_WRITER, sdCardWriterThread, nullptr);
+
 	#if EFI_TUNER_STUDIO
 		engine->outputChannels.sd_logging_internal = true;
 	#endif
@@ -274,6 +594,13 @@ static THD_FUNCTION(sdCardLoggerThread, arg) {
 }
 
 void initSdCardLogger() {
+#if EFI_PROD_CODE
+	addConsoleAction("sdlogstats", []() {
+		logFile.printStats();
+		efiPrintf("SD log records dropped: %d", (int)droppedRecords);
+	});
+#endif // EFI_PROD_CODE
+
 	chThdCreateStatic(sdCardLoggerStack, sizeof(sdCardLoggerStack), SD_CARD_LOGGER, sdCardLoggerThread, nullptr);
 }
 
@@ -0,0 +1,166 @@
+/**
+ * @file sd_log_file.cpp
+ *
+ * See sd_log_file.h
+ */
+
+#include "pch.h"
+
+#if (EFI_FILE_LOGGING && EFI_PROD_CODE) || EFI_UNIT_TEST
+
+#include "sd_log_file.h"
+
+#include <algorithm>
+#include <cstring>
+
+/**
+ * Truncating at the end of the file does nothing, so step one byte past it first: in write mode,
+ * f_lseek follows the clusters still chained to the file, and only adds one if there are none.
+ */
+static FRESULT releaseTail(FIL* fd) {
+	FSIZE_t size = f_size(fd);
+
+	FRESULT err = f_lseek(fd, size + 1);
+	if (err == FR_OK) {
+		err = f_lseek(fd, size);
+	}
+	if (err == FR_OK) {
+		err = f_truncate(fd);
+	}
+
+	return err;
+}
+
+FRESULT SdLogFile::open(FIL* fd, const char* name, uint32_t preallocateBytes) {
+	m_fd = fd;
+	m_preallocated = 0;
+	m_unsynced = false;
+
+	m_stats = {};
+	m_stats.writeTimeMinUs = UINT32_MAX;
+
+	memset(fd, 0, sizeof(FIL));
+	FRESULT err = f_open(fd, name, FA_CREATE_ALWAYS | FA_WRITE);
+	if (err != FR_OK) {
+		return err;
+	}
+
+	bool isExFat = fd->obj.fs->fs_type == FS_EXFAT;
+
+	for (uint32_t size = preallocateBytes; size >= SD_LOG_PREALLOCATE_MIN; size /= 2) {
+		// Allocated on FAT, only reserved on exFAT
+		err = f_expand(fd, size, isExFat ? 0 : 1);
+
+		if (err == FR_OK) {
+			if (!isExFat) {
+				// The clusters stay chained to the file, but it's only as long as what's been written
+				fd->obj.objsize = 0;
+				m_preallocated = size;
+
+				// So that the chain is on the card before the clusters are written
+				err = f_sync(fd);
+			}
+
+			break;
+		}
+
+		// Not enough contiguous space, try with less
+		if (err != FR_DENIED) {
+			break;
+		}
+	}
+
+	// The file still works without it
+	return err == FR_DENIED ? FR_OK : err;
+}
+
+FRESULT SdLogFile::write(const uint8_t* buffer, size_t count) {
+	efitick_t start = getTimeNowNt();
+
+	UINT bytesWritten;
+	FRESULT err = f_write(m_fd, buffer, count, &bytesWritten);
+
+	uint32_t us = NT2US(getTimeNowNt() - start);
+
+	m_stats.writeCount++;
+	m_stats.writeTimeMinUs = std::min(m_stats.writeTimeMinUs, us);
+	m_stats.writeTimeMaxUs = std::max(m_stats.writeTimeMaxUs, us);
+	m_stats.writeTimeSumUs += us;
+	if (us > SD_LOG_SLOW_WRITE_US) {
+		m_stats.slowWriteCount++;
+	}
+
+	m_stats.bytesWritten += bytesWritten;
+	m_unsynced = true;
+
+	// Disk full
+	if (err == FR_OK && bytesWritten != count) {
+		err = FR_DENIED;
+	}
+
+	return err;
+}
+
+bool SdLogFile::needsSync(float periodSec) const {
+	return m_unsynced && m_lastSync.hasElapsedSec(periodSec);
+}
+
+FRESULT SdLogFile::sync() {
+	efitick_t start = getTimeNowNt();
+
+	FRESULT err = f_sync(m_fd);
+
+	uint32_t us = NT2US(getTimeNowNt() - start);
+
+	m_stats.syncCount++;
+	m_stats.syncTimeMaxUs = std::max(m_stats.syncTimeMaxUs, us);
+
+	m_unsynced = false;
+	m_lastSync.reset();
+
+	return err;
+}
+
+FRESULT SdLogFile::close() {
+	FRESULT err = FR_OK;
+
+	if (m_preallocated) {
+		err = releaseTail(m_fd);
+	}
+
+	FRESULT closeErr = f_close(m_fd);
+
+	return err != FR_OK ? err : closeErr;
+}
+
+void SdLogFile::printStats() const {
+	efiPrintf("SD log: %d bytes, preallocated %d bytes", (int)m_stats.bytesWritten, (int)m_preallocated);
+
+	if (m_stats.writeCount) {
+		efiPrintf("SD log writes: %d, min %dus avg %dus max %dus, %d slower than %dus",
+			(int)m_stats.writeCount,
+			(int)m_stats.writeTimeMinUs,
+			(int)(m_stats.writeTimeSumUs / m_stats.writeCount),
+			(int)m_stats.writeTimeMaxUs,
+			(int)m_stats.slowWriteCount,
+			SD_LOG_SLOW_WRITE_US);
+	}
+
+	efiPrintf("SD log syncs: %d, max %dus", (int)m_stats.syncCount, (int)m_stats.syncTimeMaxUs);
+}
+
+FRESULT releasePreallocation(FIL* fd, const char* name) {
+	memset(fd, 0, sizeof(FIL));
+	FRESULT err = f_open(fd, name, FA_READ | FA_WRITE);
+	if (err != FR_OK) {
+		return err;
+	}
+
+	err = releaseTail(fd);
+
+	FRESULT closeErr = f_close(fd);
+
+	return err != FR_OK ? err : closeErr;
+}
+
+#endif // (EFI_FILE_LOGGING && EFI_PROD_CODE) || EFI_UNIT_TEST
@@ -0,0 +1,91 @@
+/**
+ * @file sd_log_file.h
+ *
+ * The file the SD log is streamed in to, on top of FatFs.
+ *
+ * Growing a file a cluster at a time means FatFs has to look for a free cluster and update the
+ * FAT in the middle of writing log data, which is where the long stalls of a card come from.
+ * Instead, the file can be given a contiguous run of clusters up front (f_expand). The size in
+ * its directory entry is kept at what has actually been written, so the log is readable at any
+ * time, and the clusters past it are given back when the file is closed, or by
+ * releasePreallocation() if the ECU lost power first. Past the end of the preallocation the
+ * file just grows as usual.
+ *
+ * On exFAT the directory entry of a contiguous file can't describe more clusters than its size,
+ * so the run is only reserved as the place the next allocations come from - exFAT doesn't
+ * touch the FAT for a contiguous file anyway, only the allocation bitmap.
+ *
+ * Writes should be whole sectors, so FatFs sends them straight to the card as one multi-block
+ * transfer, and the file position stays sector aligned. Syncing (directory entry, FSINFO) is
+ * left to the caller, to do when there's nothing waiting to be written.
+ */
+
+#pragma once
+
+#include "ff.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Writes that take longer than this are counted separately
+#define SD_LOG_SLOW_WRITE_US 10000
+
+struct SdLogFileStats {
+	uint32_t writeCount;
+	uint32_t writeTimeMinUs;
+	uint32_t writeTimeMaxUs;
+	uint64_t writeTimeSumUs;
+	// Took longer than SD_LOG_SLOW_WRITE_US
+	uint32_t slowWriteCount;
+
+	uint32_t syncCount;
+	uint32_t syncTimeMaxUs;
+
+	uint32_t bytesWritten;
+};
+
+class SdLogFile {
+public:
+	/**
+	 * Creates the file, with preallocateBytes of contiguous space if it can find that much,
+	 * halving it down to SD_LOG_PREALLOCATE_MIN otherwise. 0 to just let it grow.
+	 */
+	FRESULT open(FIL* fd, const char* name, uint32_t preallocateBytes);
+
+	FRESULT write(const uint8_t* buffer, size_t count);
+
+	// Written since the last sync, and the last sync was at least this long ago
+	bool needsSync(float periodSec) const;
+	FRESULT sync();
+
+	// Gives back the preallocated clusters that weren't used, and closes the file
+	FRESULT close();
+
+	// Space allocated to the file up front, 0 if none (always on exFAT)
+	uint32_t getPreallocated() const {
+		return m_preallocated;
+	}
+
+	const SdLogFileStats& getStats() const {
+		return m_stats;
+	}
+
+	void printStats() const;
+
+private:
+	FIL* m_fd = nullptr;
+	uint32_t m_preallocated = 0;
+	bool m_unsynced = false;
+	Timer m_lastSync;
+
+	SdLogFileStats m_stats = {};
+};
+
+// Smallest preallocation worth having
+#define SD_LOG_PREALLOCATE_MIN (4 * 1024 * 1024)
+
+/**
+ * Gives back the clusters preallocated past the end of a log that wasn't closed. Anything else
+ * is left as it is.
+ */
+FRESULT releasePreallocation(FIL* fd, const char* name);
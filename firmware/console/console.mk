@@ -1,5 +1,7 @@
 CONSOLE_COMMON_SRC_CPP = 	$(PROJECT_DIR)/console/binary/tooth_logger.cpp \
                          	$(PROJECT_DIR)/console/binary_log/log_field.cpp \
+                         	$(PROJECT_DIR)/console/binary_log/log_record.cpp \
+                         	$(PROJECT_DIR)/console/binary_log/capture_log.cpp \
                          	$(PROJECT_DIR)/console/status_loop.cpp \
 
 
@@ -10,6 +12,7 @@ CONSOLE_SRC_CPP = $(CONSOLE_COMMON_SRC_CPP) \
 	$(PROJECT_DIR)/console/binary_log/binary_logging.cpp \
 	$(PROJECT_DIR)/console/binary_log/usb_console.cpp \
 	$(PROJECT_DIR)/console/binary_log/sd_file_log.cpp \
+	$(PROJECT_DIR)/console/binary_log/sd_log_file.cpp \
 	$(PROJECT_DIR)/console/wifi_console.cpp \
 
 
@@ -45,6 +45,7 @@
 #include "frequency_sensor.h"
 #include "digital_input_exti.h"
 #include "dc_motors.h"
+#include "event_latency.h"
 
 extern bool main_loop_started;
 
@@ -449,6 +450,7 @@ void updateTunerStudioState() {
 #if EFI_PROD_CODE
 	executorStatistics();
 #endif /* EFI_PROD_CODE */
+	updateEventLatencyOutputChannels();
 
 	// header
 	tsOutputChannels->tsConfigVersion = TS_FILE_VERSION;
@@ -17,7 +17,7 @@
 static SimplePwm alternatorControl("alt");
 static Pid alternatorPid(&persistentState.persistentConfiguration.engineConfiguration.alternatorControl);
 
-void AlternatorController::onFastCallback() {
+void AlternatorController::onPeriodicCallback() {
 	if (!isBrainPinValid(engineConfiguration->alternatorControlPin)) {
 		return;
 	}
@@ -51,7 +51,7 @@ expected<percent_t> AlternatorController::getOpenLoop(float /*target*/) {
 }
 
 expected<percent_t> AlternatorController::getClosedLoop(float setpoint, float observation) {
-	return alternatorPid.getOutput(setpoint, observation, FAST_CALLBACK_PERIOD_MS / 1000.0f);
+	return alternatorPid.getOutput(setpoint, observation, moduleRatePeriodMs(getPeriodicRate()) / 1000.0f);
 }
 
 void AlternatorController::setOutput(expected<percent_t> outputValue) {
@@ -17,7 +17,12 @@ void initAlternatorCtrl();
 
 class AlternatorController : public EngineModule, public ClosedLoopController<float, percent_t> {
 public:
-	void onFastCallback() override;
+	// Battery voltage moves slowly, no need to run at the fast callback rate
+	ModuleRate getPeriodicRate() const override {
+		return ModuleRate::Hz50;
+	}
+
+	void onPeriodicCallback() override;
 	void onConfigurationChange(engine_configuration_s const* previousConfiguration) override;
 
 protected:
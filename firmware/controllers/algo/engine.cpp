@@ -24,6 +24,8 @@
 #include "boost_control.h"
 #include "ac_control.h"
 #include "vr_pwm.h"
+#include "capture_log.h"
+#include "sensor_snapshot.h"
 #if EFI_MC33816
  #include "mc33816.h"
 #endif // EFI_MC33816
@@ -91,7 +93,7 @@ void Engine::periodicSlowCallback() {
 
 	updateGppwm();
 
-	engine->engineModules.apply_all([](auto & m) { m.onSlowCallback(); });
+	moduleDispatcher.onSlowCallback();
 
 #if (BOARD_TLE8888_COUNT > 0)
 	tle8888startup();
@@ -160,6 +162,10 @@ void Engine::updateSwitchInputs() {
 
 Engine::Engine() {
 	reset();
+
+	// +1: the EngineModule placeholder at the end of the list isn't given to the dispatcher
+	static_assert(decltype(engineModules)::count() <= ENGINE_MODULE_MAX_COUNT + 1, "increase ENGINE_MODULE_MAX_COUNT");
+	moduleDispatcher.setModules(engineModules);
 }
 
 int Engine::getGlobalConfigurationVersion() const {
@@ -196,6 +202,8 @@ void Engine::OnTriggerStateProperState(efitick_t nowNt) {
 }
 
 void Engine::OnTriggerSynchronizationLost() {
+	triggerCaptureLog(CaptureReason::SyncLoss);
+
 	// Needed for early instant-RPM detection
 	rpmCalculator.setStopSpinning();
 
@@ -401,11 +409,19 @@ injection_mode_e getCurrentInjectionMode() {
 void Engine::periodicFastCallback() {
 	ScopePerf pc(PE::EnginePeriodicFastCallback);
 
+	// Everything in this tick sees the sensors as they were right now
+	getSensorSnapshot().capture();
+	SensorSnapshotScope sensorSnapshotScope;
+
 	engineState.periodicFastCallback();
 
+#if EFI_ENGINE_CONTROL
+	toothEventIndex.update();
+#endif // EFI_ENGINE_CONTROL
+
 	speedoUpdate();
 
-	engineModules.apply_all([](auto & m) { m.onFastCallback(); });
+	moduleDispatcher.onFastCallback();
 }
 
 void Engine::onEngineStopped() {
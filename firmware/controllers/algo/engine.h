@@ -9,6 +9,7 @@
 
 #include "global_shared.h"
 #include "engine_module.h"
+#include "module_dispatcher.h"
 #include "engine_state.h"
 #include "rpm_calculator.h"
 #include "event_registry.h"
@@ -41,6 +42,7 @@
 #include "ignition_state.h"
 #include "sensor_checker.h"
 #include "fuel_schedule.h"
+#include "tooth_event_index.h"
 #include "prime_injection.h"
 #include "throttle_model.h"
 #include "lambda_monitor.h"
@@ -226,6 +228,9 @@ public:
 		EngineModule // dummy placeholder so the previous entries can all have commas
 		> engineModules;
 
+	// Calls the modules' periodic callbacks and times them
+	ModuleDispatcher moduleDispatcher;
+
 	/**
 	 * Slightly shorter helper function to keep the code looking clean.
 	 */
@@ -285,6 +290,7 @@ public:
 #if EFI_ENGINE_CONTROL
 	FuelSchedule injectionEvents;
 	IgnitionEventList ignitionEvents;
+	ToothEventIndex toothEventIndex;
 	scheduling_s tdcScheduler[2];
 	OneCylinder cylinders[MAX_CYLINDER_COUNT];
 #endif /* EFI_ENGINE_CONTROL */
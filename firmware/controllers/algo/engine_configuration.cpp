@@ -109,6 +109,8 @@
  */
 engine_configuration_s activeConfiguration;
 
+uint32_t configurationWriteCounter = 0;
+
 void rememberCurrentConfiguration() {
 	activeConfiguration = *engineConfiguration;
 }
@@ -143,6 +145,7 @@ __attribute__((weak)) void boardOnConfigurationChange(engine_configuration_s* /*
  */
 void incrementGlobalConfigurationVersion() {
 	engine->globalConfigurationVersion++;
+	configurationWriteCounter++;
 
 	applyNewHardwareSettings();
 
@@ -166,6 +169,7 @@ void incrementGlobalConfigurationVersion() {
 	engine->engineModules.apply_all([](auto & m) {
 			m.onConfigurationChange(&activeConfiguration);
 		});
+	engine->moduleDispatcher.reschedule();
 	rememberCurrentConfiguration();
 }
 
@@ -402,6 +406,11 @@ static void setDefaultEngineConfiguration() {
 	setArrayValues(config->wifiAccessPointPassword, 0);
 
 	engineConfiguration->sdCardLogFrequency = 50;
+	// Mostly what led up to the event, plus a bit of the aftermath
+	engineConfiguration->captureLogPostTrigger = 30;
+
+	// A million instructions is a couple hundred ms of Lua, far more than any sane tick needs
+	engineConfiguration->luaTickInstructionBudget = 1000;
 
 	engineConfiguration->mapMinBufferLength = 1;
 	engineConfiguration->vvtActivationDelayMs = 6000;
@@ -884,6 +893,8 @@ void resetConfigurationExt(configuration_callback_t boardCallback, engine_type_e
 		firmwareError(ObdCode::CUSTOM_UNEXPECTED_ENGINE_TYPE, "Unexpected engine type: %d", (int)engineType);
 	}
 	applyNonPersistentConfiguration();
+
+	configurationWriteCounter++;
 }
 
 void emptyCallbackWithConfiguration(engine_configuration_s*) { }
@@ -13,14 +13,22 @@
 #include "fl_stack.h"
 #include "trigger_structure.h"
 
+// AngleBasedEvent::queuedTooth of an event that isn't waiting for a tooth
+#define TRIGGER_SCHEDULER_NOT_QUEUED 0xFFFF
+// ...and of one waiting while the trigger shape isn't known, it's checked on every tooth
+#define TRIGGER_SCHEDULER_UNBUCKETED 0xFFFE
+
 struct AngleBasedEvent {
 	scheduling_s scheduling;
 	action_s action;
 	/**
-	 * Trigger-based scheduler maintains a linked list of all pending tooth-based events.
+	 * Trigger-based scheduler keeps pending tooth-based events in linked lists, one per tooth.
 	 */
 	AngleBasedEvent* next = nullptr;
 
+	// Which of the trigger scheduler's lists this event is on, if any
+	uint16_t queuedTooth = TRIGGER_SCHEDULER_NOT_QUEUED;
+
 	TrgPhase eventPhase;
 
 	void setAngle(EngPhase angle);
@@ -56,12 +56,14 @@ float FuelComputer::getStoichiometricRatio() const {
 }
 
 
+static lambda_Map3D_t lambdaMap;
+
+void initLambdaMap() {
+	lambdaMap.init(config->lambdaTable, config->lambdaLoadBins, config->lambdaRpmBins);
+}
+
 float FuelComputer::getTargetLambda(float rpm, float load) const {
-	return interpolate3d(
-		config->lambdaTable,
-		config->lambdaLoadBins, load,
-		config->lambdaRpmBins, rpm
-	);
+	return lambdaMap.getValue(rpm, load);
 }
 
 float FuelComputer::getTargetLambdaLoadAxis(float defaultLoad) const {
@@ -36,4 +36,7 @@ public:
 };
 
 float getLoadOverride(float defaultLoad, load_override_e overrideMode);
+
+// Points the target lambda lookup at the configuration
+void initLambdaMap();
 constexpr float fuelDensity = 0.72; // g/cc
@@ -35,6 +35,7 @@
 #include "lua_hooks.h"
 
 static mapEstimate_Map3D_t mapEstimationTable;
+static ve_Map3D_t veMap;
 
 #if EFI_ENGINE_CONTROL
 
@@ -140,9 +141,9 @@ float getRunningFuel(float baseFuel) {
 	return runningFuel;
 }
 
-static SpeedDensityAirmass sdAirmass(nullptr, mapEstimationTable);
-static MafAirmass mafAirmass;
-static AlphaNAirmass alphaNAirmass;
+static SpeedDensityAirmass sdAirmass(&veMap, mapEstimationTable);
+static MafAirmass mafAirmass(&veMap);
+static AlphaNAirmass alphaNAirmass(&veMap);
 
 AirmassModelBase* getAirmassModel(engine_load_mode_e mode) {
 	switch (mode) {
@@ -339,6 +340,9 @@ float getCycleInjectionMass(float rpm, bool isCranking) {
  */
 void initFuelMap() {
 	mapEstimationTable.init(config->mapEstimateTable, config->mapEstimateTpsBins, config->mapEstimateRpmBins);
+	veMap.init(config->veTable, config->veLoadBins, config->veRpmBins);
+	initLambdaMap();
+	initIgnitionMap();
 }
 
 /**
@@ -29,6 +29,12 @@
 // todo: reset this between cranking attempts?! #2735
 float minCrankingRpm = 0;
 
+static ign_Map3D_t ignitionMap;
+
+void initIgnitionMap() {
+	ignitionMap.init(config->ignitionTable, config->ignitionLoadBins, config->ignitionRpmBins);
+}
+
 /**
  * @return ignition timing angle advance before TDC
  */
@@ -45,11 +51,7 @@ static angle_t getRunningAdvance(float rpm, float engineLoad) {
 	efiAssert(ObdCode::CUSTOM_ERR_ASSERT, !std::isnan(engineLoad), "invalid el", NAN);
 
 	// compute base ignition angle from main table
-	float advanceAngle = interpolate3d(
-		config->ignitionTable,
-		config->ignitionLoadBins, engineLoad,
-		config->ignitionRpmBins, rpm
-	);
+	float advanceAngle = ignitionMap.getValue(rpm, engineLoad);
 
 #if EFI_ANTILAG_SYSTEM
 	if (engine->antilagController.isAntilagCondition) {
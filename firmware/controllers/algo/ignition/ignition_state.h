@@ -16,3 +16,6 @@ private:
 
 	floatms_t getSparkDwell(float rpm, bool isCranking);
 };
+
+// Points the main ignition table lookup at the configuration
+void initIgnitionMap();
@@ -657,6 +657,46 @@ enum class DtcSeverity : uint8_t {
 	LimpLevel2 = 3,
 };
 
+// Sensor a configured CAN RX signal is published as, see can_rx_signals.h
+enum class CanRxSignalTarget : uint8_t {
+	None = 0,
+	VehicleSpeed = 1,
+	Map = 2,
+	Clt = 3,
+	Iat = 4,
+	Tps1 = 5,
+	AcceleratorPedal = 6,
+	OilPressure = 7,
+	OilTemperature = 8,
+	FuelPressureLow = 9,
+	FuelPressureHigh = 10,
+	FuelLevel = 11,
+	BatteryVoltage = 12,
+	BarometricPressure = 13,
+	AmbientTemperature = 14,
+	WheelSpeedLF = 15,
+	WheelSpeedRF = 16,
+	WheelSpeedLR = 17,
+	WheelSpeedRR = 18,
+	TurbochargerSpeed = 19,
+	FuelEthanolPercent = 20,
+	Lambda1 = 21,
+	Lambda2 = 22,
+	AuxTemp1 = 23,
+	AuxTemp2 = 24,
+	AuxLinear1 = 25,
+	AuxLinear2 = 26,
+	AuxLinear3 = 27,
+	AuxLinear4 = 28,
+};
+
+// Size of the lookup tables sensor conversions are compiled in to, see compiled_func.h
+enum class SensorLutMode : uint8_t {
+	Off = 0,
+	Points256 = 1,
+	Points1024 = 2,
+};
+
 typedef enum __attribute__ ((__packed__)) {
 	none = 0,
 	first,
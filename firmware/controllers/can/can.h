@@ -89,6 +89,10 @@ public:
 		return CanInterval::None != (m_cycleFlags & interval);
 	}
 
+	CanInterval getIntervals() const {
+		return m_cycleFlags;
+	}
+
 private:
 	static CanInterval computeFlags(uint32_t cycleCount);
 
@@ -11,27 +11,18 @@
 
 #if EFI_CAN_SUPPORT
 #include "can_dash.h"
+#include "can_dash_table.h"
 #include "can_msg_tx.h"
-#include "can_bmw.h"
-#include "can_vag.h"
 
 #include "rusefi_types.h"
 #include "rtc_helper.h"
-#include "fuel_math.h"
 
 // CAN Bus ID for broadcast
-#define CAN_FIAT_MOTOR_INFO           0x561
 #define CAN_MAZDA_RX_RPM_SPEED        0x201
 #define CAN_MAZDA_RX_STEERING_WARNING 0x300
 #define CAN_MAZDA_RX_STATUS_1         0x212
 #define CAN_MAZDA_RX_STATUS_2         0x420
 
-//w202 DASH
-#define W202_STAT_1	     0x308 /* _20ms cycle */
-#define W202_STAT_2      0x608 /* _100ms cycle */
-#define W202_ALIVE	     0x210 /* _200ms cycle */
-#define W202_STAT_3      0x310 /* _200ms cycle */
-
 //BMW E90 DASH
 #define E90_ABS_COUNTER      0x0C0
 #define E90_SEATBELT_COUNTER 0x0D7
@@ -54,8 +45,6 @@ static time_msecs_t mph_ctr;
 /**
  * https://docs.google.com/spreadsheets/d/1IkP05ODpjNt-k4YQLYl58_TNlN9U4IBu5z7i0BPVEM4
  */
-#define GENESIS_COUPLE_RPM_316 0x316
-#define GENESIS_COUPLE_COOLANT_329 0x329
 #define GENESIS_COUPLE_SENSORS_382 0x382
 // when A/C compressor is allowed to be on, these values need to be sent so the A/C panel activates the compressor
 #define GENESIS_COUPLE_AC_ENABLE_18F 0x18F
@@ -119,53 +108,31 @@ static bool cluster_time_set;
 constexpr uint8_t e90_temp_offset = 49;
 
 // todo: those forward declarations are out of overall code style
-void canDashboardBMW(CanCycle cycle);
-void canDashboardFiat(CanCycle cycle);
 void canMazdaRX8(CanCycle cycle);
-void canDashboardW202(CanCycle cycle);
 void canDashboardBMWE90(CanCycle cycle);
-void canDashboardVagMqb(CanCycle cycle);
 void canDashboardNissanVQ(CanCycle cycle);
-void canDashboardGenesisCoupe(CanCycle cycle);
 void canDashboardAim(CanCycle cycle);
-void canDashboardHaltech(CanCycle cycle);
 
 void updateDash(CanCycle cycle) {
+	// Dashes that are just sensor values in frames, see can_dash_table.cpp
+	if (const DashTable* table = getDashTable(engineConfiguration->canNbcType)) {
+		sendDashFrames(*table, cycle.getIntervals());
+		return;
+	}
 
 	// Transmit dash data, if enabled
 	switch (engineConfiguration->canNbcType) {
 	case CAN_BUS_NBC_NONE:
 		break;
-	case CAN_BUS_NBC_BMW:
-		canDashboardBMW(cycle);
-		break;
-	case CAN_BUS_Haltech:
-		canDashboardHaltech(cycle);
-		break;
-	case CAN_BUS_NBC_FIAT:
-		canDashboardFiat(cycle);
-		break;
-	case CAN_BUS_NBC_VAG:
-		canDashboardVAG(cycle);
-		break;
 	case CAN_BUS_MAZDA_RX8:
 		canMazdaRX8(cycle);
 		break;
-	case CAN_BUS_W202_C180:
-		canDashboardW202(cycle);
-		break;
 	case CAN_BUS_BMW_E90:
 		canDashboardBMWE90(cycle);
 		break;
-	case CAN_BUS_MQB:
-		canDashboardVagMqb(cycle);
-		break;
 	case CAN_BUS_NISSAN_VQ:
 		canDashboardNissanVQ(cycle);
 		break;
-	case CAN_BUS_GENESIS_COUPE:
-		canDashboardGenesisCoupe(cycle);
-		break;
 	case CAN_AIM_DASH:
 		canDashboardAim(cycle);
 		break;
@@ -175,28 +142,6 @@ void updateDash(CanCycle cycle) {
 	}
 }
 
-//BMW Dashboard
-//todo: we use 50ms fixed cycle, trace is needed to check for correct period
-void canDashboardBMW(CanCycle cycle) {
-	
-	if (cycle.isInterval(CI::_50ms)) {
-		{
-			CanTxMessage msg(CAN_BMW_E46_SPEED, 8);
-			msg.setShortValue(10 * 8, 1);
-		}
-
-		{
-			CanTxMessage msg(CAN_BMW_E46_RPM, 8);
-			msg.setShortValue((int) (Sensor::getOrZero(SensorType::Rpm) * 6.4), 2);
-		}
-
-		{
-			CanTxMessage msg(CAN_BMW_E46_DME2, 8);
-			msg.setShortValue((int) ((Sensor::getOrZero(SensorType::Clt) + 48.373) / 0.75), 1);
-		}
-	}
-}
-
 //todo: we use 50ms fixed cycle, trace is needed to check for correct period
 void canMazdaRX8(CanCycle cycle) {
 	if (cycle.isInterval(CI::_50ms)) {
@@ -254,120 +199,8 @@ void canMazdaRX8(CanCycle cycle) {
 
 }
 
-void canDashboardFiat(CanCycle cycle) {
-	if (cycle.isInterval(CI::_50ms)) {
-		{
-			//Fiat Dashboard
-			CanTxMessage msg(CAN_FIAT_MOTOR_INFO, 8);
-			msg.setShortValue((int) (Sensor::getOrZero(SensorType::Clt) - 40), 3); //Coolant Temp
-			msg.setShortValue(Sensor::getOrZero(SensorType::Rpm) / 32, 6); //RPM
-		}
-	}
-}
-
-void canDashboardVAG(CanCycle cycle) {
-	if (cycle.isInterval(CI::_10ms)) {
-		{
-			// https://github.com/commaai/opendbc/blob/57c8340a180dd8c75139b18050eb17c72c9cb6e4/vw_golf_mk4.dbc#L394
-			//VAG Dashboard
-			CanTxMessage msg(CAN_VAG_Motor_1, 8);
-			msg.setShortValue(Sensor::getOrZero(SensorType::Rpm) * 4, 2); //RPM
-		}
-
-		float clt = Sensor::getOrZero(SensorType::Clt);
-
-		{
-			CanTxMessage msg(CAN_VAG_Motor_2, 8);
-			msg.setShortValue((int) ((clt + 48.373) / 0.75), 1); //Coolant Temp
-		}
-
-		{
-			CanTxMessage msg(CAN_VAG_CLT_V2, 8);
-			msg.setShortValue((int) ((clt + 48.373) / 0.75), 4); //Coolant Temp
-		}
-
-		{
-			CanTxMessage msg(CAN_VAG_IMMO, 8);
-			msg.setShortValue(0x80, 1);
-		}
-	}
-}
-
-void canDashboardW202(CanCycle cycle) {
-	if (cycle.isInterval(CI::_20ms)) {
-		{
-			CanTxMessage msg(W202_STAT_1, 8);
-			uint16_t tmp = Sensor::getOrZero(SensorType::Rpm);
-			msg[0] = 0x08; // Unknown
-			msg[1] = (tmp >> 8); //RPM
-			msg[2] = (tmp & 0xff); //RPM
-			msg[3] = 0x00; // 0x01 - tank blink, 0x02 - EPC
-			msg[4] = 0x00; // Unknown
-			msg[5] = 0x00; // Unknown
-			msg[6] = 0x00; // Unknown - oil info
-			msg[7] = 0x00; // Unknown - oil info
-		}
-	}
-
-	if (cycle.isInterval(CI::_100ms)) {
-		{
-			CanTxMessage msg(W202_STAT_2, 8); //dlc 7
-			msg[0] = (int)(Sensor::getOrZero(SensorType::Clt) + 40); // CLT -40 offset
-			msg[1] = 0x3D; // TBD
-			msg[2] = 0x63; // Const
-			msg[3] = 0x41; // Const
-			msg[4] = 0x00; // Unknown
-			msg[5] = 0x05; // Const
-			msg[6] = 0x50; // TBD
-			msg[7] = 0x00; // Unknown
-		}
-	}
-
-	if (cycle.isInterval(CI::_200ms)) {
-		{
-			CanTxMessage msg(W202_ALIVE, 8);
-			msg[0] = 0x0A; // Const
-			msg[1] = 0x18; // Const
-			msg[2] = 0x00; // Const
-			msg[3] = 0x00; // Const
-			msg[4] = 0xC0; // Const
-			msg[5] = 0x00; // Const
-			msg[6] = 0x00; // Const
-			msg[7] = 0x00; // Const
-		}	
-
-		{
-			CanTxMessage msg(W202_STAT_3, 8);
-			msg[0] = 0x00; // Const
-			msg[1] = 0x00; // Const
-			msg[2] = 0x6D; // TBD
-			msg[3] = 0x7B; // Const
-			msg[4] = 0x21; // TBD
-			msg[5] = 0x07; // Const
-			msg[6] = 0x33; // Const
-			msg[7] = 0x05; // Const
-		}
-	}
-}
-
 static int rollingId = 0;
 
-void canDashboardGenesisCoupe(CanCycle cycle) {
-	if (cycle.isInterval(CI::_50ms)) {
-		{
-			CanTxMessage msg(GENESIS_COUPLE_RPM_316, 8);
-			int rpm8 = Sensor::getOrZero(SensorType::Rpm) * 4;
-			msg[3] = rpm8 >> 8;
-			msg[4] = rpm8 & 0xFF;
-		}
-		{
-			CanTxMessage msg(GENESIS_COUPLE_COOLANT_329, 8);
-			int clt = Sensor::getOrZero(SensorType::Clt) * 2;
-			msg[1] = clt;
-		}
-	}
-}
-
 void canDashboardNissanVQ(CanCycle cycle) {
 	if (cycle.isInterval(CI::_50ms)) {
 		{
@@ -406,26 +239,6 @@ void canDashboardNissanVQ(CanCycle cycle) {
 	}
 }
 
-/**
- * https://docs.google.com/spreadsheets/d/1XMfeGlhgl0lBL54lNtPdmmFd8gLr2T_YTriokb30kJg
- */
-void canDashboardVagMqb(CanCycle cycle) {
-	if (cycle.isInterval(CI::_50ms)) {
-
-		{ // 'turn-on'
-			CanTxMessage msg(0x3C0, 4);
-			// ignition ON
-			msg[2] = 3;
-		}
-	
-		{ //RPM
-			CanTxMessage msg(0x107, 8);
-			msg[3] = ((int)(Sensor::getOrZero(SensorType::Rpm) / 3.5)) & 0xFF;
-			msg[4] = ((int)(Sensor::getOrZero(SensorType::Rpm) / 3.5)) >> 8;
-		}
-	}
-}
-
 void canDashboardBMWE90(CanCycle cycle)
 {
 
@@ -580,587 +393,6 @@ void canDashboardBMWE90(CanCycle cycle)
 	}
 }
 
-void canDashboardHaltech(CanCycle cycle) {
-	
-	uint16_t tmp;
-
-	if (cycle.isInterval(CI::_20ms)) {
-		/* 0x360 - 50Hz rate */
-		{
-			CanTxMessage msg(0x360, 8);
-			tmp = Sensor::getOrZero(SensorType::Rpm);
-			/* RPM */
-			msg[0] = (tmp >> 8);
-			msg[1] = (tmp & 0x00ff);
-			/* MAP */
-			tmp = (((uint16_t)(Sensor::getOrZero(SensorType::Map))) * 10); 
-			msg[2] = (tmp >> 8);
-			msg[3] = (tmp & 0x00ff);
-			/* TPS  y = x/10 */
-			tmp = (uint16_t)((float)(Sensor::getOrZero(SensorType::Tps1)) * 10);
-			msg[4] = (tmp >> 8);
-			msg[5] = (tmp & 0x00ff);
-			/* Coolant pressure */
-			msg[6] = 0;
-			msg[7] = 0;
-		}
-
-		/* 0x361 - 50Hz rate */
-		{ 
-			CanTxMessage msg(0x361, 8);
-			/* Fuel pressure */
-			tmp =  (uint16_t)((Sensor::getOrZero(SensorType::FuelPressureLow) + 101.3) * 10);
-			msg[0] = (tmp >> 8);
-			msg[1] = (tmp&0x00ff);
-			/* Oil pressure */
-			tmp =  (uint16_t)((Sensor::getOrZero(SensorType::OilPressure) + 101.3) * 10);
-			msg[2] = (tmp >> 8);
-			msg[3] = (tmp & 0x00ff);
-			/* Engine Demand */
-			tmp =  (uint16_t)(Sensor::getOrZero(SensorType::Map));
-			msg[4] = (tmp >> 8);
-			msg[5] = (tmp & 0x00ff);
-			/* Wastegate Pressure */
-			msg[6] = 0;
-			msg[7] = 0;			
-		}
-
-		/* 0x362 - 50Hz rate */
-		{ 
-			CanTxMessage msg(0x362, 6);
-			/* Injection Stage 1 Duty Cycle - y = x/10 */
-			uint16_t rpm = Sensor::getOrZero(SensorType::Rpm);
-			tmp = (uint16_t)( getInjectorDutyCycle(rpm) * 10) ;
-			msg[0] = (tmp >> 8);
-			msg[1] = (tmp & 0x00ff);
-			/* Injcetion Stage 2 Duty Cycle */
-			msg[2] = 0x00;
-			msg[3] = 0x00;
-			/* Ignition Angle (Leading) - y = x/10 */
-			float timing = engine->cylinders[0].getIgnitionTimingBtdc();
-			int16_t ignAngle = ((timing > 360 ? timing - 720 : timing) * 10);
-			msg[4] = (ignAngle >> 8);			
-			msg[5] = (ignAngle & 0x00ff);
-		}
-
-		/* todo: 0x3E5 = 50Hz rate */
-		{ 
-			CanTxMessage msg(0x3E5, 8);
-			msg[0] = 0x00; 
-			msg[1] = 0x00;
-			msg[2] = 0x00;
-			msg[3] = 0x00;
-			msg[4] = 0x00;
-			msg[5] = 0x00;
-			msg[6] = 0x00;
-			msg[7] = 0x00;
-		}
-
-		/* todo: 0x3EA = 50Hz rate */
-		{ 
-			CanTxMessage msg(0x3EA, 8);
-			msg[0] = 0x00; 
-			msg[1] = 0x00;
-			msg[2] = 0x00;
-			msg[3] = 0x00;
-			msg[4] = 0x00;
-			msg[5] = 0x00;
-			msg[6] = 0x00;
-			msg[7] = 0x00;
-		}
-
-		/* todo: 0x3EB = 50Hz rate */
-		{ 
-			CanTxMessage msg(0x3EB, 8);
-			msg[0] = 0x00; 
-			msg[1] = 0x00;
-			msg[2] = 0x00;
-			msg[3] = 0x00;
-			msg[4] = 0x00;
-			msg[5] = 0x00;
-			msg[6] = 0x00;
-			msg[7] = 0x00;
-		}
-
-		/* todo: 0x3EC = 50Hz rate */
-		{ 
-			CanTxMessage msg(0x3EC, 8);
-			msg[0] = 0x00; 
-			msg[1] = 0x00;
-			msg[2] = 0x00;
-			msg[3] = 0x00;
-			msg[4] = 0x00;
-			msg[5] = 0x00;
-			msg[6] = 0x00;
-			msg[7] = 0x00;
-		}
-
-		/* todo: 0x3ED = 50Hz rate */
-		{ 
-			CanTxMessage msg(0x3ED, 2);
-			msg[0] = 0x00; 
-			msg[1] = 0x00;
-		}
-
-		/* todo: 0x471 = 50Hz rate */
-		{ 
-			CanTxMessage msg(0x471, 2);
-			msg[0] = 0x00; 
-			msg[1] = 0x00;
-			msg[2] = 0x00;
-			msg[3] = 0x00;
-		}
-	}
-
-	if (cycle.isInterval(CI::_50ms)) {
-	
-		/* 0x363 - 20Hz rate */
-		{ 
-			CanTxMessage msg(0x363, 4);
-			/* Wheel Slip */
-			msg[0] = 0x00;
-			msg[1] = 0x00;
-			/* Wheel Diff */
-			msg[2] = 0x00;
-			msg[3] = 0x00 ;
-		}
-
-		/* 0x368 - 20Hz rate */
-		{ 
-			CanTxMessage msg(0x368, 8);
-			/* Wideband Sensor 1 */
-			tmp = (uint16_t)(Sensor::getOrZero(SensorType::Lambda1) * 1000 * 14.7);
-			msg[0] = (tmp >> 8);
-			msg[1] = (tmp & 0x00ff);
-			/* Wideband Sensor 2 */
-			tmp =  (uint16_t)(Sensor::getOrZero(SensorType::Lambda2) * 1000);
-			msg[2] = (tmp >> 8);
-			msg[3] = (tmp & 0x00ff);
-			/* Wideband Sensor 3 */
-			msg[4] = 0x00;
-			msg[5] = 0x00;
-			/* Wideband Sensor 4 */			
-			msg[6] = 0x00;
-			msg[7] = 0x00;
-		}
-
-#if EFI_SHAFT_POSITION_INPUT
-		/* 0x369 - 20Hz rate */
-		{ 
-			CanTxMessage msg(0x369, 8);
-			/* Trigger System Error Count */
-			tmp = engine->triggerCentral.triggerState.triggerErrorCounter;
-			msg[0] = (tmp >> 8);
-			msg[1] = (tmp & 0x00ff);
-			/* Trigger Counter ?? */
-			tmp =  engine->triggerCentral.triggerState.edgeCountRise;
-			msg[2] = (tmp >> 8);
-			msg[3] = (tmp & 0x00ff);
-			/* unused */
-			msg[4] = 0x00;
-			msg[5] = 0x00;
-			/* Trigger Sync Level ?? */
-			msg[6] = 0x00;			
-			msg[7] = 0x00;
-		}
-#endif // EFI_SHAFT_POSITION_INPUT
-
-		/* 0x36A - 20Hz rate */
-		/* todo: one day we should split this */
-		{ 
-			CanTxMessage msg(0x36A, 4);
-			/* Knock Level 1 */
-			tmp = (engine->module<KnockController>()->m_knockLevel * 100);
-			msg[0] = (tmp >> 8);
-			msg[1] = (tmp & 0x00ff);
-			/* Knock Level 2 */
-			msg[2] = (tmp >> 8);
-			msg[3] = (tmp * 0x00ff);
-		}
-
-		/* 0x36B - 20Hz rate */
-		{ 
-			CanTxMessage msg(0x36B, 8);
-			/* Break Pressure */
-			msg[0] = 0x00;
-			msg[1] = 0x00;
-			/* NOS pressure Sensor 1 */
-			msg[2] = 0x00;
-			msg[3] = 0x00;
-			/* Turbo Speed Sensor 1 */
-			msg[4] = 0x00;
-			msg[5] = 0x00;
-			/* Lateral G */
-			msg[6] = 0x00;
-			msg[7] = 0x00;
-		}
-
-		/* 0x36C = 20Hz rate */
-		{ 
-			CanTxMessage msg(0x36C, 8);
-			/* Wheel Speed Front Left */
-			auto vehicleSpeed = Sensor::getOrZero(SensorType::VehicleSpeed);
-			tmp = (vehicleSpeed * 10 );
-			msg[0] = (tmp >> 8);
-			msg[1] = (tmp & 0x00ff);
-			/* Wheel Speed Front Right */
-			msg[2] = (tmp >> 8);
-			msg[3] = (tmp & 0x00ff);
-			/* Wheel Speed Read Left */
-			msg[4] = (tmp >> 8);
-			msg[5] = (tmp & 0x00ff);
-			/* Wheel Speed Read Right */
-			msg[6] = (tmp >> 8);
-			msg[7] = (tmp & 0x00ff);
-		}
-
-		/* 0x36D = 20Hz rate */
-		{ 
-			CanTxMessage msg(0x36D, 8);
-			/* Unused */
-			msg[0] = 0x00;
-			msg[1] = 0x00;
-			msg[2] = 0x00;
-			msg[3] = 0x00;
-			/* Exhaust Cam Angle 1 */
-			msg[4] = 0x00;
-			msg[5] = 0x00;
-			/* Exhaust Cam Angle 2 */
-			msg[6] = 0x00;
-			msg[7] = 0x00;
-		}	
-
-		/* 0x36E = 20Hz rate */
-		{ 
-			CanTxMessage msg(0x36E, 8);
-			/* Engine Limiting Active 0 = off/1=on*/
-			msg[0] = 0x00;
-			msg[1] = 0x00;
-			/* Launch Control Ignition Retard */
-			msg[2] = 0x00;
-			msg[3] = 0x00;
-			/* Launch Control Fuel Enrich */
-			msg[4] = 0x00;
-			msg[5] = 0x00;
-			/* Longitudinal G */
-			msg[6] = 0x00;
-			msg[7] = 0x00;
-		}
-
-		/* 0x36F = 20Hz rate */
-		{ 
-			CanTxMessage msg(0x36F, 4);
-			/* Generic Output 1 Duty Cycle */
-			msg[0] = 0x00;
-			msg[1] = 0x00;
-			/* Boost Control Output */
-			msg[2] = 0x00;
-			msg[3] = 0x00;
-		}
-
-		/* 0x370 = 20Hz rate */
-		{ 
-			CanTxMessage msg(0x370, 8);
-			/* Vehicle Speed */
-			auto vehicleSpeed = Sensor::getOrZero(SensorType::VehicleSpeed);
-			tmp = (vehicleSpeed * 10 );
-			msg[0] = (tmp >> 8);
-			msg[1] = (tmp & 0x00ff);
-			/* unused */
-			msg[2] = 0x00;
-			msg[3] = 0x00;
-			/* Intake Cam Angle 1 */
-			msg[4] = 0x00;
-			msg[5] = 0x00;
-			/* Intake Cam Angle 2 */
-			msg[6] = 0x00;
-			msg[7] = 0x00;
-		}
-
-		/* todo: 0x3E6 = 20Hz rate */
-		{ 
-			CanTxMessage msg(0x3E6, 8);
-			msg[0] = 0x00; 
-			msg[1] = 0x00;
-			msg[2] = 0x00;
-			msg[3] = 0x00;
-			msg[4] = 0x00;
-			msg[5] = 0x00;
-			msg[6] = 0x00;
-			msg[7] = 0x00;
-		}
-
-		/* todo: 0x3E7 = 20Hz rate */
-		{ 
-			CanTxMessage msg(0x3E7, 8);
-			msg[0] = 0x00; 
-			msg[1] = 0x00;
-			msg[2] = 0x00;
-			msg[3] = 0x00;
-			msg[4] = 0x00;
-			msg[5] = 0x00;
-			msg[6] = 0x00;
-			msg[7] = 0x00;
-		}
-	
-		/* todo: 0x3E8 = 20Hz rate */
-		{ 
-			CanTxMessage msg(0x3E8, 8);
-			msg[0] = 0x00; 
-			msg[1] = 0x00;
-			msg[2] = 0x00;
-			msg[3] = 0x00;
-			msg[4] = 0x00;
-			msg[5] = 0x00;
-			msg[6] = 0x00;
-			msg[7] = 0x00;
-		}
-
-		/* todo: 0x3E9 = 20Hz rate */
-		{ 
-			CanTxMessage msg(0x3E9, 8);
-			msg[0] = 0x00; 
-			msg[1] = 0x00;
-			msg[2] = 0x00;
-			msg[3] = 0x00;
-			msg[4] = 0x00;
-			msg[5] = 0x00;
-			msg[6] = 0x00;
-			msg[7] = 0x00;
-		}
-
-		/* todo: 0x3EE = 20Hz rate */
-		{ 
-			CanTxMessage msg(0x3EE, 8);
-			msg[0] = 0x00; 
-			msg[1] = 0x00;
-			msg[2] = 0x00;
-			msg[3] = 0x00;
-			msg[4] = 0x00;
-			msg[5] = 0x00;
-			msg[6] = 0x00;
-			msg[7] = 0x00;
-		}
-
-		/* todo: 0x3EF = 20Hz rate */
-		{ 
-			CanTxMessage msg(0x3EF, 8);
-			msg[0] = 0x00; 
-			msg[1] = 0x00;
-			msg[2] = 0x00;
-			msg[3] = 0x00;
-			msg[4] = 0x00;
-			msg[5] = 0x00;
-			msg[6] = 0x00;
-			msg[7] = 0x00;
-		}
-
-		/* todo: 0x470 = 20Hz rate */
-		{ 
-			CanTxMessage msg(0x470, 8);
-			msg[0] = 0x00; 
-			msg[1] = 0x00;
-			msg[2] = 0x00;
-			msg[3] = 0x00;
-			msg[4] = 0x00;
-			msg[5] = 0x00;
-			msg[6] = 0x00;
-			msg[7] = 0x00;
-		}
-
-		/* todo: 0x472 = 20Hz rate */
-		{ 
-			CanTxMessage msg(0x472, 8);
-			msg[0] = 0x00; 
-			msg[1] = 0x00;
-			msg[2] = 0x00;
-			msg[3] = 0x00;
-			msg[4] = 0x00;
-			msg[5] = 0x00;
-			msg[6] = 0x00;
-			msg[7] = 0x00;
-		}		
-	}
-
-	if (cycle.isInterval(CI::_100ms)) {
-		
-		/* 0x371 = 10Hz rate */
-		{ 
-			CanTxMessage msg(0x371, 4);
-			/* Fuel Flow */
-			msg[0] = 0x00;
-			msg[1] = 0x00;
-			/* Fuel Flow Return */
-			msg[2] = 0x00;
-			msg[3] = 0x00;
-		}
-
-		/* 0x372 = 10Hz rate */
-		{ 
-			CanTxMessage msg(0x372, 8);
-			/* Battery Voltage */
-			tmp =  (uint16_t)(Sensor::getOrZero(SensorType::BatteryVoltage) * 10);
-			msg[0] = (tmp >> 8);
-			msg[1] = (tmp & 0x00ff);
-			/* unused */
-			msg[2] = 0x00;
-			msg[3] = 0x00;
-			/* Target Boost Level todo */
-			msg[4] = 0x00;
-			msg[5] = 0x00;
-			/* Barometric pressure */
-			tmp = (uint16_t)(Sensor::getOrZero(SensorType::BarometricPressure) * 10);
-			msg[6] = (tmp >> 8);
-			msg[7] = (tmp & 0x00ff);
-		}
-	
-		/* 0x373 = 10Hz rate */
-		{ 
-			CanTxMessage msg(0x373, 8);
-			/* EGT1 */
-			msg[0] = 0x00;
-			msg[1] = 0x00;
-			/* EGT2 */
-			msg[2] = 0x00;
-			msg[3] = 0x00;
-			/* EGT3 */
-			msg[4] = 0x00;
-			msg[5] = 0x00;
-			/* EGT4 */
-			msg[6] = 0x00;
-			msg[7] = 0x00;
-		}
-
-		/* 0x374 = 10Hz rate */
-		{ 
-			CanTxMessage msg(0x374, 8);
-			/* EGT5 */
-			msg[0] = 0x00;
-			msg[1] = 0x00;
-			/* EGT6 */
-			msg[2] = 0x00;
-			msg[3] = 0x00;
-			/* EGT7 */
-			msg[4] = 0x00;
-			msg[5] = 0x00;
-			/* EGT8 */
-			msg[6] = 0x00;
-			msg[7] = 0x00;
-		}
-
-		/* 0x375 = 10Hz rate */
-		{ 
-			CanTxMessage msg(0x375, 8);
-			/* EGT9 */
-			msg[0] = 0x00;
-			msg[1] = 0x00;
-			/* EGT10 */
-			msg[2] = 0x00;
-			msg[3] = 0x00;
-			/* EGT11 */
-			msg[4] = 0x00;
-			msg[5] = 0x00;
-			/* EGT12 */
-			msg[6] = 0x00;
-			msg[7] = 0x00;
-		}
-
-		/* 0x376 = 10Hz rate */
-		{ 
-			CanTxMessage msg(0x376, 8);
-			/* Ambient Air Temperature */
-			msg[0] = 0x00;
-			msg[1] = 0x00;
-			/* Relative Humidity */
-			msg[2] = 0x00;
-			msg[3] = 0x00;
-			/* Specific Humidity */
-			msg[4] = 0x00;
-			msg[5] = 0x00;
-			/* Absolute Humidity */
-			msg[6] = 0x00;
-			msg[7] = 0x00;
-		}
-	}
-
-	if (cycle.isInterval(CI::_200ms)) {
-		/* 0x3E0 = 5Hz rate */
-		{ 
-			CanTxMessage msg(0x3E0, 8);
-			/* Coolant temperature in K y = x/10 */
-			tmp = ((Sensor::getOrZero(SensorType::Clt) + 273.15) * 10);
-			msg[0] = (tmp >> 8);
-			msg[1] = (tmp & 0x00ff);
-			/* Air Temperature */
-			tmp = ((Sensor::getOrZero(SensorType::Iat) + 273.15) * 10);
-			msg[2] = (tmp >> 8);
-			msg[3] = (tmp & 0x00ff);
-			/* Fuel Temperature */
-			msg[4] = 0x00;
-			msg[5] = 0x00;
-			/* Oil Temperature */
-			msg[6] = 0x00;
-			msg[7] = 0x00;
-		}
-
-		/* 0x3E1 = 5Hz rate */
-		{ 
-			CanTxMessage msg(0x3E1, 6);
-			/* Gearbox Oil Temperature */
-			msg[0] = 0x00;
-			msg[1] = 0x00;
-			/* Diff oil Temperature */
-			msg[2] = 0x00;
-			msg[3] = 0x00;
-			/* Fuel Composition */
-			msg[4] = 0x00;
-			msg[5] = 0x00;
-		}
-
-		/* 0x3E2 = 5Hz rate */
-		{ 
-			CanTxMessage msg(0x3E2, 2);
-			/* Fuel Level in Liters */
-			tmp = (Sensor::getOrZero(SensorType::FuelLevel)* 10);
-			msg[0] = (tmp >> 8);
-			msg[1] = (tmp & 0x00ff);
-		}
-
-		/* 0x3E3 = 5Hz rate */
-		{ 
-			CanTxMessage msg(0x3E3, 8);
-			/* Fuel Trim Short Term Bank 1*/
-			msg[0] = 0x00;
-			msg[1] = 0x00;
-			/* Fuel Trim Short Term Bank 2*/
-			msg[2] = 0x00;
-			msg[3] = 0x00;
-			/* Fuel Trim Long Term Bank 1*/
-			msg[4] = 0x00;
-			msg[5] = 0x00;
-			/* Fuel Trim Long Term Bank 2*/
-			msg[6] = 0x00;
-			msg[7] = 0x00;
-		}
-
-		/* todo: 0x3E4 = 5Hz rate */
-		{ 
-			CanTxMessage msg(0x3E4, 8);
-			msg[0] = 0x00; //unused
-			/* Switch status */
-			msg[1] = 0x00;
-			/* Switch status */
-			msg[2] = 0x00;
-			msg[3] = 0x00;
-			msg[4] = 0x00;
-			msg[5] = 0x00;
-			msg[6] = 0x00;
-			msg[7] = 0x00;
-		}
-
-	}
-}
-
 //Based on AIM can protocol
 //https://www.aimtechnologies.com/support/racingecu/AiM_CAN_101_eng.pdf
 
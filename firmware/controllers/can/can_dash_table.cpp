@@ -0,0 +1,387 @@
+/**
+ * @file	can_dash_table.cpp
+ *
+ * Table driven dashboards, see can_dash_table.h
+ */
+
+#include "pch.h"
+
+#if EFI_CAN_SUPPORT || EFI_UNIT_TEST
+#include "can_dash_table.h"
+#include "can_msg_tx.h"
+#include "can_bmw.h"
+#include "can_vag.h"
+#include "fuel_math.h"
+
+#define CAN_FIAT_MOTOR_INFO           0x561
+
+#define W202_STAT_1	     0x308 /* _20ms cycle */
+#define W202_STAT_2      0x608 /* _100ms cycle */
+#define W202_ALIVE	     0x210 /* _200ms cycle */
+#define W202_STAT_3      0x310 /* _200ms cycle */
+
+#define GENESIS_COUPLE_RPM_316 0x316
+#define GENESIS_COUPLE_COOLANT_329 0x329
+
+using DS = DashSource;
+
+//BMW Dashboard
+//todo: we use 50ms fixed cycle, trace is needed to check for correct period
+static constexpr DashSignal bmwE46Dash[] = {
+	dashLittleEndian16(CAN_BMW_E46_SPEED, CI::_50ms, 8, 1, DS::Const, 1, 10 * 8),
+	dashLittleEndian16(CAN_BMW_E46_RPM, CI::_50ms, 8, 2, DS::Rpm, 6.4),
+	dashLittleEndian16(CAN_BMW_E46_DME2, CI::_50ms, 8, 1, DS::Clt, 1 / 0.75, 48.373),
+};
+
+static constexpr DashSignal fiatDash[] = {
+	dashLittleEndian16(CAN_FIAT_MOTOR_INFO, CI::_50ms, 8, 3, DS::Clt, 1, -40),
+	dashLittleEndian16(CAN_FIAT_MOTOR_INFO, CI::_50ms, 8, 6, DS::Rpm, 1 / 32.0),
+};
+
+// https://github.com/commaai/opendbc/blob/57c8340a180dd8c75139b18050eb17c72c9cb6e4/vw_golf_mk4.dbc#L394
+static constexpr DashSignal vagDash[] = {
+	dashLittleEndian16(CAN_VAG_Motor_1, CI::_10ms, 8, 2, DS::Rpm, 4),
+	dashLittleEndian16(CAN_VAG_Motor_2, CI::_10ms, 8, 1, DS::Clt, 1 / 0.75, 48.373),
+	dashLittleEndian16(CAN_VAG_CLT_V2, CI::_10ms, 8, 4, DS::Clt, 1 / 0.75, 48.373),
+	dashConstByte(CAN_VAG_IMMO, CI::_10ms, 8, 1, 0x80),
+};
+
+static constexpr DashSignal w202Dash[] = {
+	dashConstByte(W202_STAT_1, CI::_20ms, 8, 0, 0x08), // Unknown
+	dashBigEndian16(W202_STAT_1, CI::_20ms, 8, 1, DS::Rpm),
+	// 3: 0x01 - tank blink, 0x02 - EPC, 6-7: Unknown - oil info
+
+	dashByte(W202_STAT_2, CI::_100ms, 8, 0, DS::Clt, 1, 40), // CLT -40 offset
+	dashConstByte(W202_STAT_2, CI::_100ms, 8, 1, 0x3D), // TBD
+	dashConstByte(W202_STAT_2, CI::_100ms, 8, 2, 0x63), // Const
+	dashConstByte(W202_STAT_2, CI::_100ms, 8, 3, 0x41), // Const
+	dashConstByte(W202_STAT_2, CI::_100ms, 8, 5, 0x05), // Const
+	dashConstByte(W202_STAT_2, CI::_100ms, 8, 6, 0x50), // TBD
+
+	dashConstByte(W202_ALIVE, CI::_200ms, 8, 0, 0x0A),
+	dashConstByte(W202_ALIVE, CI::_200ms, 8, 1, 0x18),
+	dashConstByte(W202_ALIVE, CI::_200ms, 8, 4, 0xC0),
+
+	dashConstByte(W202_STAT_3, CI::_200ms, 8, 2, 0x6D), // TBD
+	dashConstByte(W202_STAT_3, CI::_200ms, 8, 3, 0x7B),
+	dashConstByte(W202_STAT_3, CI::_200ms, 8, 4, 0x21), // TBD
+	dashConstByte(W202_STAT_3, CI::_200ms, 8, 5, 0x07),
+	dashConstByte(W202_STAT_3, CI::_200ms, 8, 6, 0x33),
+	dashConstByte(W202_STAT_3, CI::_200ms, 8, 7, 0x05),
+};
+
+static constexpr DashSignal genesisCoupeDash[] = {
+	dashBigEndian16(GENESIS_COUPLE_RPM_316, CI::_50ms, 8, 3, DS::Rpm, 4),
+	dashByte(GENESIS_COUPLE_COOLANT_329, CI::_50ms, 8, 1, DS::Clt, 2),
+};
+
+/**
+ * https://docs.google.com/spreadsheets/d/1XMfeGlhgl0lBL54lNtPdmmFd8gLr2T_YTriokb30kJg
+ */
+static constexpr DashSignal vagMqbDash[] = {
+	// 'turn-on', ignition ON
+	dashConstByte(0x3C0, CI::_50ms, 4, 2, 3),
+	dashLittleEndian16(0x107, CI::_50ms, 8, 3, DS::Rpm, 1 / 3.5),
+};
+
+//todo: we use 50ms fixed cycle, trace is needed to check for correct period
+static constexpr DashSignal haltechDash[] = {
+	/* 50Hz rate */
+	dashBigEndian16(0x360, CI::_20ms, 8, 0, DS::Rpm),
+	dashBigEndian16(0x360, CI::_20ms, 8, 2, DS::Map, 10),
+	/* TPS  y = x/10 */
+	dashBigEndian16(0x360, CI::_20ms, 8, 4, DS::Tps1, 10),
+	/* 6: Coolant pressure */
+
+	dashBigEndian16(0x361, CI::_20ms, 8, 0, DS::FuelPressureLow, 10, 101.3),
+	dashBigEndian16(0x361, CI::_20ms, 8, 2, DS::OilPressure, 10, 101.3),
+	/* Engine Demand */
+	dashBigEndian16(0x361, CI::_20ms, 8, 4, DS::Map),
+	/* 6: Wastegate Pressure */
+
+	/* Injection Stage 1 Duty Cycle - y = x/10 */
+	dashBigEndian16(0x362, CI::_20ms, 6, 0, DS::InjectorDutyCycle, 10),
+	/* 2: Injection Stage 2 Duty Cycle */
+	/* Ignition Angle (Leading) - y = x/10 */
+	dashBigEndian16(0x362, CI::_20ms, 6, 4, DS::IgnitionTiming, 10),
+
+	/* todo: 50Hz rate */
+	dashConstByte(0x3E5, CI::_20ms, 8, 0, 0),
+	dashConstByte(0x3EA, CI::_20ms, 8, 0, 0),
+	dashConstByte(0x3EB, CI::_20ms, 8, 0, 0),
+	dashConstByte(0x3EC, CI::_20ms, 8, 0, 0),
+	dashConstByte(0x3ED, CI::_20ms, 2, 0, 0),
+	/* the hand written Haltech code also filled bytes 2 and 3 of this 2 byte frame, the table does not */
+	dashConstByte(0x471, CI::_20ms, 2, 0, 0),
+
+	/* 20Hz rate */
+	/* Wheel Slip, Wheel Diff */
+	dashConstByte(0x363, CI::_50ms, 4, 0, 0),
+
+	/* Wideband Sensor 1 */
+	dashBigEndian16(0x368, CI::_50ms, 8, 0, DS::Lambda1, 1000 * 14.7),
+	/* Wideband Sensor 2 */
+	dashBigEndian16(0x368, CI::_50ms, 8, 2, DS::Lambda2, 1000),
+	/* 4: Wideband Sensor 3, 6: Wideband Sensor 4 */
+
+#if EFI_SHAFT_POSITION_INPUT
+	/* Trigger System Error Count */
+	dashBigEndian16(0x369, CI::_50ms, 8, 0, DS::TriggerErrorCount),
+	/* Trigger Counter ?? */
+	dashBigEndian16(0x369, CI::_50ms, 8, 2, DS::TriggerEdgeCount),
+	/* 6: Trigger Sync Level ?? */
+#endif // EFI_SHAFT_POSITION_INPUT
+
+	/* todo: one day we should split this */
+	/* Knock Level 1 */
+	dashBigEndian16(0x36A, CI::_50ms, 4, 0, DS::KnockLevel, 100),
+	/* Knock Level 2 */
+	dashBigEndian16(0x36A, CI::_50ms, 4, 2, DS::KnockLevel, 100),
+
+	/* Break Pressure, NOS pressure Sensor 1, Turbo Speed Sensor 1, Lateral G */
+	dashConstByte(0x36B, CI::_50ms, 8, 0, 0),
+
+	/* Wheel Speed Front Left, Front Right, Rear Left, Rear Right */
+	dashBigEndian16(0x36C, CI::_50ms, 8, 0, DS::VehicleSpeed, 10),
+	dashBigEndian16(0x36C, CI::_50ms, 8, 2, DS::VehicleSpeed, 10),
+	dashBigEndian16(0x36C, CI::_50ms, 8, 4, DS::VehicleSpeed, 10),
+	dashBigEndian16(0x36C, CI::_50ms, 8, 6, DS::VehicleSpeed, 10),
+
+	/* Unused, Exhaust Cam Angle 1, Exhaust Cam Angle 2 */
+	dashConstByte(0x36D, CI::_50ms, 8, 0, 0),
+	/* Engine Limiting Active, Launch Control Ignition Retard, Launch Control Fuel Enrich, Longitudinal G */
+	dashConstByte(0x36E, CI::_50ms, 8, 0, 0),
+	/* Generic Output 1 Duty Cycle, Boost Control Output */
+	dashConstByte(0x36F, CI::_50ms, 4, 0, 0),
+
+	/* Vehicle Speed */
+	dashBigEndian16(0x370, CI::_50ms, 8, 0, DS::VehicleSpeed, 10),
+	/* 4: Intake Cam Angle 1, 6: Intake Cam Angle 2 */
+
+	/* todo: 20Hz rate */
+	dashConstByte(0x3E6, CI::_50ms, 8, 0, 0),
+	dashConstByte(0x3E7, CI::_50ms, 8, 0, 0),
+	dashConstByte(0x3E8, CI::_50ms, 8, 0, 0),
+	dashConstByte(0x3E9, CI::_50ms, 8, 0, 0),
+	dashConstByte(0x3EE, CI::_50ms, 8, 0, 0),
+	dashConstByte(0x3EF, CI::_50ms, 8, 0, 0),
+	dashConstByte(0x470, CI::_50ms, 8, 0, 0),
+	dashConstByte(0x472, CI::_50ms, 8, 0, 0),
+
+	/* 10Hz rate */
+	/* Fuel Flow, Fuel Flow Return */
+	dashConstByte(0x371, CI::_100ms, 4, 0, 0),
+
+	/* Battery Voltage */
+	dashBigEndian16(0x372, CI::_100ms, 8, 0, DS::BatteryVoltage, 10),
+	/* 4: Target Boost Level todo */
+	/* Barometric pressure */
+	dashBigEndian16(0x372, CI::_100ms, 8, 6, DS::BarometricPressure, 10),
+
+	/* EGT1 - EGT12 */
+	dashConstByte(0x373, CI::_100ms, 8, 0, 0),
+	dashConstByte(0x374, CI::_100ms, 8, 0, 0),
+	dashConstByte(0x375, CI::_100ms, 8, 0, 0),
+	/* Ambient Air Temperature, Relative Humidity, Specific Humidity, Absolute Humidity */
+	dashConstByte(0x376, CI::_100ms, 8, 0, 0),
+
+	/* 5Hz rate */
+	/* Coolant temperature in K y = x/10 */
+	dashBigEndian16(0x3E0, CI::_200ms, 8, 0, DS::Clt, 10, 273.15),
+	/* Air Temperature */
+	dashBigEndian16(0x3E0, CI::_200ms, 8, 2, DS::Iat, 10, 273.15),
+	/* 4: Fuel Temperature, 6: Oil Temperature */
+
+	/* Gearbox Oil Temperature, Diff oil Temperature, Fuel Composition */
+	dashConstByte(0x3E1, CI::_200ms, 6, 0, 0),
+
+	/* Fuel Level in Liters */
+	dashBigEndian16(0x3E2, CI::_200ms, 2, 0, DS::FuelLevel, 10),
+
+	/* Fuel Trim Short Term Bank 1, 2, Fuel Trim Long Term Bank 1, 2 */
+	dashConstByte(0x3E3, CI::_200ms, 8, 0, 0),
+	/* todo: Switch status */
+	dashConstByte(0x3E4, CI::_200ms, 8, 0, 0),
+};
+
+static_assert(isValidDashTable(bmwE46Dash));
+static_assert(isValidDashTable(fiatDash));
+static_assert(isValidDashTable(vagDash));
+static_assert(isValidDashTable(w202Dash));
+static_assert(isValidDashTable(genesisCoupeDash));
+static_assert(isValidDashTable(vagMqbDash));
+static_assert(isValidDashTable(haltechDash));
+
+template <size_t N>
+static constexpr DashTable makeDashTable(const DashSignal (&signals)[N]) {
+	return { signals, N };
+}
+
+static constexpr DashTable bmwE46Table = makeDashTable(bmwE46Dash);
+static constexpr DashTable fiatTable = makeDashTable(fiatDash);
+static constexpr DashTable vagTable = makeDashTable(vagDash);
+static constexpr DashTable w202Table = makeDashTable(w202Dash);
+static constexpr DashTable genesisCoupeTable = makeDashTable(genesisCoupeDash);
+static constexpr DashTable vagMqbTable = makeDashTable(vagMqbDash);
+static constexpr DashTable haltechTable = makeDashTable(haltechDash);
+
+const DashTable* getDashTable(can_nbc_e type) {
+	switch (type) {
+	case CAN_BUS_NBC_BMW:
+		return &bmwE46Table;
+	case CAN_BUS_NBC_FIAT:
+		return &fiatTable;
+	case CAN_BUS_NBC_VAG:
+		return &vagTable;
+	case CAN_BUS_W202_C180:
+		return &w202Table;
+	case CAN_BUS_GENESIS_COUPE:
+		return &genesisCoupeTable;
+	case CAN_BUS_MQB:
+		return &vagMqbTable;
+	case CAN_BUS_Haltech:
+		return &haltechTable;
+	default:
+		return nullptr;
+	}
+}
+
+static float readDashSource(DashSource source) {
+	switch (source) {
+	case DS::Rpm:
+		return Sensor::getOrZero(SensorType::Rpm);
+	case DS::Map:
+		return Sensor::getOrZero(SensorType::Map);
+	case DS::Tps1:
+		return Sensor::getOrZero(SensorType::Tps1);
+	case DS::Clt:
+		return Sensor::getOrZero(SensorType::Clt);
+	case DS::Iat:
+		return Sensor::getOrZero(SensorType::Iat);
+	case DS::VehicleSpeed:
+		return Sensor::getOrZero(SensorType::VehicleSpeed);
+	case DS::BatteryVoltage:
+		return Sensor::getOrZero(SensorType::BatteryVoltage);
+	case DS::BarometricPressure:
+		return Sensor::getOrZero(SensorType::BarometricPressure);
+	case DS::FuelPressureLow:
+		return Sensor::getOrZero(SensorType::FuelPressureLow);
+	case DS::OilPressure:
+		return Sensor::getOrZero(SensorType::OilPressure);
+	case DS::FuelLevel:
+		return Sensor::getOrZero(SensorType::FuelLevel);
+	case DS::Lambda1:
+		return Sensor::getOrZero(SensorType::Lambda1);
+	case DS::Lambda2:
+		return Sensor::getOrZero(SensorType::Lambda2);
+	case DS::InjectorDutyCycle: {
+		uint16_t rpm = Sensor::getOrZero(SensorType::Rpm);
+		return getInjectorDutyCycle(rpm);
+	}
+	case DS::IgnitionTiming: {
+		float timing = engine->cylinders[0].getIgnitionTimingBtdc();
+		return timing > 360 ? timing - 720 : timing;
+	}
+#if EFI_SHAFT_POSITION_INPUT
+	case DS::TriggerErrorCount:
+		return engine->triggerCentral.triggerState.triggerErrorCounter;
+	case DS::TriggerEdgeCount:
+		return engine->triggerCentral.triggerState.edgeCountRise;
+#endif // EFI_SHAFT_POSITION_INPUT
+	case DS::KnockLevel:
+		return engine->module<KnockController>()->m_knockLevel;
+	default:
+		return 0;
+	}
+}
+
+namespace {
+// Each source is read the first time a due frame needs it, at most once per cycle
+class DashSnapshot {
+public:
+	float get(DashSource source) {
+		size_t index = static_cast<size_t>(source);
+		uint32_t bit = 1 << index;
+
+		if (!(m_read & bit)) {
+			m_values[index] = readDashSource(source);
+			m_read |= bit;
+		}
+
+		return m_values[index];
+	}
+
+private:
+	static_assert(static_cast<size_t>(DashSource::Count) <= 32);
+
+	float m_values[static_cast<size_t>(DashSource::Count)];
+	uint32_t m_read = 0;
+};
+}
+
+void encodeDashSignal(const DashSignal& signal, float value, uint8_t* data) {
+	uint32_t raw = signal.source == DS::Const
+		? (uint32_t)signal.add
+		: (uint32_t)(int32_t)((value + signal.add) * signal.mul);
+
+	size_t bytes = signal.bits / 8;
+
+	for (size_t i = 0; i < bytes; i++) {
+		size_t index = signal.order == DashByteOrder::BigEndian
+			? signal.offset + bytes - 1 - i
+			: signal.offset + i;
+
+		data[index] = raw >> (8 * i);
+	}
+}
+
+namespace {
+struct DashFrame {
+	uint16_t id;
+	uint8_t dlc;
+	uint8_t data[8];
+};
+}
+
+// Only the CAN TX thread sends dashboards, and its stack is small
+static DashFrame dashBatch[DASH_MAX_FRAMES];
+
+size_t sendDashFrames(const DashTable& table, CanInterval dueIntervals) {
+	DashSnapshot snapshot;
+	size_t count = 0;
+
+	size_t first = 0;
+	while (first < table.count) {
+		const DashSignal& frame = table.signals[first];
+
+		size_t end = first + 1;
+		while (end < table.count && table.signals[end].id == frame.id) {
+			end++;
+		}
+
+		if ((frame.interval & dueIntervals) != CI::None) {
+			DashFrame& packed = dashBatch[count++];
+			packed.id = frame.id;
+			packed.dlc = frame.dlc;
+			memset(packed.data, 0, sizeof(packed.data));
+
+			for (size_t i = first; i < end; i++) {
+				const DashSignal& signal = table.signals[i];
+				float value = signal.source == DS::Const ? 0 : snapshot.get(signal.source);
+				encodeDashSignal(signal, value, packed.data);
+			}
+		}
+
+		first = end;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		// Transmitted once it goes out of scope
+		CanTxMessage msg(dashBatch[i].id, dashBatch[i].dlc);
+		memcpy(&msg[0], dashBatch[i].data, sizeof(dashBatch[i].data));
+	}
+
+	return count;
+}
+
+#endif // EFI_CAN_SUPPORT || EFI_UNIT_TEST
@@ -0,0 +1,140 @@
+/**
+ * @file	can_dash_table.h
+ *
+ * Dashboards described by a table of signals instead of hand written frames.
+ *
+ * Each row is one signal: the frame it goes in (ID, period, DLC), where in the frame (byte offset,
+ * bit width, byte order), where the value comes from and how it is scaled. Rows of one frame are
+ * next to each other. Once per CAN cycle all due frames of the table are packed in one pass, and
+ * each source is read only once no matter how many frames it goes in.
+ */
+
+#pragma once
+
+#include "can.h"
+#include "rusefi_enums.h"
+
+enum class DashSource : uint8_t {
+	// add of the row, e.g. constant bytes of a frame
+	Const,
+
+	Rpm,
+	Map,
+	Tps1,
+	Clt,
+	Iat,
+	VehicleSpeed,
+	BatteryVoltage,
+	BarometricPressure,
+	FuelPressureLow,
+	OilPressure,
+	FuelLevel,
+	Lambda1,
+	Lambda2,
+
+	// at the RPM truncated to integer, as the dashes show it
+	InjectorDutyCycle,
+	// cylinder 1, BTDC in -360..360
+	IgnitionTiming,
+	TriggerErrorCount,
+	TriggerEdgeCount,
+	KnockLevel,
+
+	Count,
+};
+
+enum class DashByteOrder : uint8_t {
+	LittleEndian,
+	BigEndian,
+};
+
+struct DashSignal {
+	uint16_t id;
+	CanInterval interval;
+	uint8_t dlc;
+
+	// first byte of the signal in the frame
+	uint8_t offset;
+	uint8_t bits;
+	DashByteOrder order;
+
+	DashSource source;
+	// raw = (value + add) * mul, truncated to integer like the casts of the hand written frames
+	float mul;
+	float add;
+};
+
+constexpr DashSignal dashBigEndian16(uint16_t id, CanInterval interval, uint8_t dlc, uint8_t offset, DashSource source, float mul = 1, float add = 0) {
+	return { id, interval, dlc, offset, 16, DashByteOrder::BigEndian, source, mul, add };
+}
+
+constexpr DashSignal dashLittleEndian16(uint16_t id, CanInterval interval, uint8_t dlc, uint8_t offset, DashSource source, float mul = 1, float add = 0) {
+	return { id, interval, dlc, offset, 16, DashByteOrder::LittleEndian, source, mul, add };
+}
+
+constexpr DashSignal dashByte(uint16_t id, CanInterval interval, uint8_t dlc, uint8_t offset, DashSource source, float mul = 1, float add = 0) {
+	return { id, interval, dlc, offset, 8, DashByteOrder::LittleEndian, source, mul, add };
+}
+
+// Also used for frames that are all zeros
+constexpr DashSignal dashConstByte(uint16_t id, CanInterval interval, uint8_t dlc, uint8_t offset, uint8_t value) {
+	return { id, interval, dlc, offset, 8, DashByteOrder::LittleEndian, DashSource::Const, 1, static_cast<float>(value) };
+}
+
+struct DashTable {
+	const DashSignal* signals;
+	size_t count;
+};
+
+// Most frames a table can have, they are all packed before any is queued
+#define DASH_MAX_FRAMES 48
+
+/**
+ * Rows of a frame have to be next to each other, agree on the period and DLC, and fit in the DLC
+ */
+template <size_t N>
+constexpr bool isValidDashTable(const DashSignal (&signals)[N]) {
+	size_t frames = 0;
+
+	for (size_t i = 0; i < N; i++) {
+		const DashSignal& signal = signals[i];
+
+		if (signal.bits == 0 || signal.bits % 8 != 0 || signal.offset + signal.bits / 8 > signal.dlc || signal.dlc > 8) {
+			return false;
+		}
+
+		if (i > 0 && signals[i - 1].id == signal.id) {
+			if (signals[i - 1].interval != signal.interval || signals[i - 1].dlc != signal.dlc) {
+				return false;
+			}
+		} else {
+			// First row of a frame, there can't be more of it further up
+			for (size_t j = 0; j < i; j++) {
+				if (signals[j].id == signal.id) {
+					return false;
+				}
+			}
+
+			frames++;
+		}
+	}
+
+	return frames <= DASH_MAX_FRAMES;
+}
+
+/**
+ * @return nullptr if this dash is not table driven
+ */
+const DashTable* getDashTable(can_nbc_e type);
+
+/**
+ * Writes the signal in to the frame data
+ */
+void encodeDashSignal(const DashSignal& signal, float value, uint8_t* data);
+
+/**
+ * Sends the frames of the table that are due in this cycle. All of them are packed first, then
+ * queued back to back, so the sensor reads don't spread the burst out on the bus.
+ * @return number of frames sent
+ */
+size_t sendDashFrames(const DashTable& table, CanInterval dueIntervals);
@@ -17,14 +17,22 @@ public:
 	}
 
 	CanListener* processFrame(CanBusIndex busIndex, const CANRxFrame& frame, efitick_t nowNt) {
+		handleFrame(busIndex, frame, nowNt);
+
+		return m_next;
+	}
+
+	// Returns true if the frame was accepted
+	bool handleFrame(CanBusIndex busIndex, const CANRxFrame& frame, efitick_t nowNt) {
 		if (acceptFrame(busIndex, frame)) {
 			decodeFrame(frame, nowNt);
+			return true;
 		}
 
-		return m_next;
+		return false;
 	}
 
-	uint32_t getId() {
+	uint32_t getId() const {
 		return m_id;
 	}
 
@@ -46,11 +54,27 @@ public:
 		return CAN_ID(frame) == m_id;
 	}
 
+	// Return false if acceptFrame takes frames other than the ones with getId(),
+	// then the listener is offered every frame instead of only the ones with its ID.
+	virtual bool isIdIndexed() const {
+		return true;
+	}
+
+	// Next listener in the same CAN RX index chain, see can_rx_index.h
+	CanListener* getNextIndexed() const {
+		return m_nextIndexed;
+	}
+
+	void setNextIndexed(CanListener* next) {
+		m_nextIndexed = next;
+	}
+
 protected:
 	virtual void decodeFrame(const CANRxFrame& frame, efitick_t nowNt) = 0;
 
 private:
 	CanListener* m_next = nullptr;
+	CanListener* m_nextIndexed = nullptr;
 
 	const uint32_t m_id;
 };
@@ -12,6 +12,8 @@
 
 #include "rusefi_lua.h"
 #include "can_bench_test.h"
+#include "can_rx_index.h"
+#include "can_rx_signals.h"
 
 typedef float SCRIPT_TABLE_8x8_f32t_linear[SCRIPT_TABLE_8 * SCRIPT_TABLE_8];
 
@@ -99,19 +101,13 @@ struct CanListenerTailSentinel : public CanListener {
 static CanListenerTailSentinel tailSentinel;
 CanListener *canListeners_head = &tailSentinel;
 
-static void serviceCanSubscribers(CanBusIndex busIndex, const CANRxFrame &frame, efitick_t nowNt) {
-	CanListener *current = canListeners_head;
-
-	while (current) {
-		current = current->processFrame(busIndex, frame, nowNt);
-	}
-}
-
 void registerCanListener(CanListener& listener) {
 	// If the listener already has a next, it's already registered
 	if (!listener.hasNext()) {
 		listener.setNext(canListeners_head);
 		canListeners_head = &listener;
+
+		getCanRxIndex().addListener(listener);
 	}
 }
 
@@ -250,7 +246,11 @@ void processCanRxMessage(CanBusIndex busIndex, const CANRxFrame& frame, efitick_
 		printPacket(busIndex, frame);
 	}
 
-	serviceCanSubscribers(busIndex, frame, nowNt);
+	auto& index = getCanRxIndex();
+	// Only a lookup: IDs nobody registered for don't get an entry
+	auto entry = index.find(CAN_ID(frame));
+
+	bool taken = index.dispatch(entry, busIndex, frame, nowNt);
 
 	// todo: convert to CanListener or not?
 	//Vss is configurable, should we handle it here:
@@ -261,7 +261,11 @@ void processCanRxMessage(CanBusIndex busIndex, const CANRxFrame& frame, efitick_
 
 	processCanBenchTest(frame);
 
-	processLuaCan(busIndex, frame);
+	taken |= getCanRxSignals().decode(busIndex, frame, nowNt);
+
+	taken |= processLuaCan(busIndex, frame);
+
+	index.countFrame(entry, busIndex, taken);
 
 	processEgtCan(busIndex, frame);
 
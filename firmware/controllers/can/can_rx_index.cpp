@@ -0,0 +1,277 @@
+/**
+ * @file	can_rx_index.cpp
+ *
+ * Open addressing hash table. Added entries are written in full under lock before they are
+ * marked used, so the CAN RX threads can look things up without taking the lock.
+ *
+ * Removed entries stay in the table as markers, so lookups for IDs further along the probe keep
+ * working, until an add takes one over. Only the Lua thread removes and re-adds entries, and the
+ * CAN RX threads run above it, so a lookup can't be holding an entry while it changes hands.
+ */
+
+#include "pch.h"
+
+#include "can_rx_index.h"
+#include "can_listener.h"
+
+static CCM_OPTIONAL CanRxIndex canRxIndex;
+
+CanRxIndex& getCanRxIndex() {
+	return canRxIndex;
+}
+
+static bool isValidBus(CanBusIndex busIndex) {
+	int bus = static_cast<int>(busIndex);
+	return bus >= 0 && bus < CAN_RX_BUS_COUNT;
+}
+
+bool CanRxIndexEntry::isSubscribed(CanBusIndex busIndex) const {
+	if (listeners) {
+		return true;
+	}
+
+	return isValidBus(busIndex) && luaFilter[static_cast<int>(busIndex)] >= 0;
+}
+
+size_t CanRxIndex::hashId(uint32_t id) {
+	// Fibonacci hashing: the top bits of the product depend on every bit of the ID
+	return (id * 2654435761u) >> (32 - CAN_RX_INDEX_BITS);
+}
+
+CanRxIndexEntry* CanRxIndex::find(uint32_t id) {
+	size_t slot = hashId(id);
+
+	for (size_t i = 0; i < CAN_RX_INDEX_SIZE; i++) {
+		auto& entry = m_entries[slot];
+
+		if (!entry.used) {
+			return nullptr;
+		}
+
+		if (entry.id == id && !entry.removed) {
+			return &entry;
+		}
+
+		slot = (slot + 1) & (CAN_RX_INDEX_SIZE - 1);
+	}
+
+	return nullptr;
+}
+
+CanRxIndexEntry* CanRxIndex::findOrAdd(uint32_t id) {
+	if (auto entry = find(id)) {
+		return entry;
+	}
+
+	chibios_rt::CriticalSectionLocker csl;
+
+	// Keep some room, so that probing for IDs that aren't there stays short
+	if (m_entryCount >= CAN_RX_INDEX_SIZE * 3 / 4) {
+		return nullptr;
+	}
+
+	size_t slot = hashId(id);
+	CanRxIndexEntry* free = nullptr;
+
+	for (size_t i = 0; i < CAN_RX_INDEX_SIZE; i++) {
+		auto& entry = m_entries[slot];
+
+		if (!entry.used) {
+			if (!free) {
+				free = &entry;
+			}
+
+			break;
+		}
+
+		if (entry.removed) {
+			// The first one on the way is the closest place for it, but the ID may still be further along
+			if (!free) {
+				free = &entry;
+			}
+		} else if (entry.id == id) {
+			// Somebody else added it while we weren't looking
+			return &entry;
+		}
+
+		slot = (slot + 1) & (CAN_RX_INDEX_SIZE - 1);
+	}
+
+	// There's always one, the index is never let fill up
+	free->id = id;
+	free->listeners = nullptr;
+	for (size_t bus = 0; bus < CAN_RX_BUS_COUNT; bus++) {
+		free->luaFilter[bus] = -1;
+		free->hits[bus] = 0;
+		free->drops[bus] = 0;
+	}
+
+	// Last, this is what makes it visible
+	free->removed = false;
+	free->used = true;
+	m_entryCount++;
+
+	return free;
+}
+
+void CanRxIndex::addListener(CanListener& listener) {
+	CanRxIndexEntry* entry = listener.isIdIndexed() ? findOrAdd(listener.getId()) : nullptr;
+
+	chibios_rt::CriticalSectionLocker csl;
+
+	if (entry) {
+		listener.setNextIndexed(entry->listeners);
+		entry->listeners = &listener;
+	} else {
+		// Either it picks its own frames, or the index is full: it'll have to see every frame
+		listener.setNextIndexed(m_fallbackListeners);
+		m_fallbackListeners = &listener;
+	}
+}
+
+bool CanRxIndex::dispatch(CanRxIndexEntry* entry, CanBusIndex busIndex, const CANRxFrame& frame, efitick_t nowNt) {
+	bool taken = false;
+
+	if (entry) {
+		for (CanListener* current = entry->listeners; current; current = current->getNextIndexed()) {
+			taken |= current->handleFrame(busIndex, frame, nowNt);
+		}
+	}
+
+	for (CanListener* current = m_fallbackListeners; current; current = current->getNextIndexed()) {
+		taken |= current->handleFrame(busIndex, frame, nowNt);
+	}
+
+	return taken;
+}
+
+bool CanRxIndex::addLuaFilter(uint32_t id, CanBusIndex busIndex, int filterIndex) {
+	auto entry = findOrAdd(id);
+
+	if (!entry) {
+		return false;
+	}
+
+	chibios_rt::CriticalSectionLocker csl;
+
+	for (int bus = 0; bus < CAN_RX_BUS_COUNT; bus++) {
+		bool busMatches = busIndex == CanBusIndex::Any || static_cast<int>(busIndex) == bus;
+
+		// Filters are checked in the order they were added, so a later filter never replaces an earlier one
+		if (busMatches && entry->luaFilter[bus] < 0) {
+			entry->luaFilter[bus] = filterIndex;
+		}
+	}
+
+	return true;
+}
+
+int CanRxIndex::getLuaFilter(uint32_t id, CanBusIndex busIndex) {
+	if (!isValidBus(busIndex)) {
+		return -1;
+	}
+
+	auto entry = find(id);
+
+	if (!entry) {
+		return -1;
+	}
+
+	return entry->luaFilter[static_cast<int>(busIndex)];
+}
+
+void CanRxIndex::addLuaMaskFilter() {
+	m_luaMaskFilterCount++;
+}
+
+void CanRxIndex::clearLuaFilters() {
+	chibios_rt::CriticalSectionLocker csl;
+
+	for (auto& entry : m_entries) {
+		if (!entry.used || entry.removed) {
+			continue;
+		}
+
+		for (size_t bus = 0; bus < CAN_RX_BUS_COUNT; bus++) {
+			entry.luaFilter[bus] = -1;
+		}
+
+		// Nobody else wanted it, the next script may not either
+		if (!entry.listeners) {
+			entry.removed = true;
+			m_entryCount--;
+		}
+	}
+
+	m_luaMaskFilterCount = 0;
+}
+
+void CanRxIndex::countFrame(CanRxIndexEntry* entry, CanBusIndex busIndex, bool hit) {
+	if (!isValidBus(busIndex)) {
+		return;
+	}
+
+	int bus = static_cast<int>(busIndex);
+
+	if (!entry) {
+		if (hit) {
+			m_unindexedHits[bus]++;
+		} else {
+			m_unindexedDrops[bus]++;
+		}
+
+		return;
+	}
+
+	if (hit) {
+		entry->hits[bus]++;
+	} else {
+		entry->drops[bus]++;
+	}
+}
+
+int CanRxIndex::getSubscribedIds(CanBusIndex busIndex, uint32_t* ids, size_t maxCount) {
+	if (m_fallbackListeners || m_luaMaskFilterCount != 0) {
+		return -1;
+	}
+
+	size_t count = 0;
+
+	for (const auto& entry : m_entries) {
+		if (!entry.used || entry.removed || !entry.isSubscribed(busIndex)) {
+			continue;
+		}
+
+		if (count == maxCount) {
+			// More than the hardware can take, it'll have to let everything through
+			return -1;
+		}
+
+		ids[count++] = entry.id;
+	}
+
+	return count;
+}
+
+void CanRxIndex::printStats() {
+	efiPrintf("CAN RX index: %d IDs of %d, %s fallback listeners, %d Lua mask filters",
+		m_entryCount, CAN_RX_INDEX_SIZE,
+		m_fallbackListeners ? "with" : "no",
+		m_luaMaskFilterCount);
+	efiPrintf("  other IDs bus0 hit %d drop %d bus1 hit %d drop %d",
+		m_unindexedHits[0], m_unindexedDrops[0],
+		m_unindexedHits[1], m_unindexedDrops[1]);
+
+	for (const auto& entry : m_entries) {
+		if (!entry.used || entry.removed) {
+			continue;
+		}
+
+		efiPrintf("  ID %x(%d) %s%s bus0 hit %d drop %d bus1 hit %d drop %d",
+			entry.id, entry.id,
+			entry.listeners ? "L" : "-",
+			(entry.luaFilter[0] >= 0 || entry.luaFilter[1] >= 0) ? "S" : "-",
+			entry.hits[0], entry.drops[0],
+			entry.hits[1], entry.drops[1]);
+	}
+}
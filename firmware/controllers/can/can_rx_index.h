@@ -0,0 +1,103 @@
+/**
+ * @file	can_rx_index.h
+ *
+ * Index of who wants which received CAN frame, so that a frame only visits the listeners
+ * and Lua filters for its ID instead of every one of them.
+ *
+ * Built as listeners register and Lua adds its filters. Listeners that decide for themselves
+ * which frames they take (overriding acceptFrame) go on a fallback list that still sees every frame.
+ *
+ * Only registration adds entries, the RX path just looks IDs up: traffic nobody asked for must not
+ * be able to fill the index. Frames for IDs without an entry are only counted per bus. If the
+ * index does fill up, a listener goes on the fallback list and a Lua filter is checked the way
+ * mask filters are, so both still get their frames, just without the shortcut.
+ *
+ * Listeners stay registered for good, Lua filters go with the script: clearing them removes the
+ * entries only Lua wanted, so reloading a script with other IDs doesn't use the index up.
+ */
+
+#pragma once
+
+#include "can.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#define CAN_RX_INDEX_BITS 7
+#define CAN_RX_INDEX_SIZE (1 << CAN_RX_INDEX_BITS)
+#define CAN_RX_BUS_COUNT 2
+
+struct CanRxIndexEntry {
+	uint32_t id;
+	bool used;
+	// Was used, and only Lua wanted it. Lookups probe past it, a later add can take it over
+	bool removed;
+
+	// Listeners registered for exactly this ID, on any bus
+	CanListener* listeners;
+
+	// First Lua filter added for exactly this ID, for each bus. -1 for none
+	int8_t luaFilter[CAN_RX_BUS_COUNT];
+
+	// Frames somebody took, and frames nobody wanted
+	uint32_t hits[CAN_RX_BUS_COUNT];
+	uint32_t drops[CAN_RX_BUS_COUNT];
+
+	bool isSubscribed(CanBusIndex busIndex) const;
+};
+
+class CanRxIndex {
+public:
+	// nullptr if nothing registered for the ID
+	CanRxIndexEntry* find(uint32_t id);
+
+	// nullptr only if the index is full
+	CanRxIndexEntry* findOrAdd(uint32_t id);
+
+	void addListener(CanListener& listener);
+
+	/**
+	 * Offers a frame to the listeners for its ID, then to the fallback listeners.
+	 * @return true if any of them took it
+	 */
+	bool dispatch(CanRxIndexEntry* entry, CanBusIndex busIndex, const CANRxFrame& frame, efitick_t nowNt);
+
+	/**
+	 * Lua filters for one exact ID, the earliest added one wins.
+	 * @return false if the index is full, the caller has to check that filter itself
+	 */
+	bool addLuaFilter(uint32_t id, CanBusIndex busIndex, int filterIndex);
+	int getLuaFilter(uint32_t id, CanBusIndex busIndex);
+	// Lua filters with a mask can't be indexed, Lua checks those itself
+	void addLuaMaskFilter();
+	void clearLuaFilters();
+
+	// Frames without an entry are counted for the bus
+	void countFrame(CanRxIndexEntry* entry, CanBusIndex busIndex, bool hit);
+
+	/**
+	 * IDs that something wants on a bus, for programming the hardware acceptance filters.
+	 * @return the number of IDs written, or -1 if a fallback listener needs to see every frame
+	 */
+	int getSubscribedIds(CanBusIndex busIndex, uint32_t* ids, size_t maxCount);
+
+	void printStats();
+
+private:
+	static size_t hashId(uint32_t id);
+
+	CanRxIndexEntry m_entries[CAN_RX_INDEX_SIZE] = {};
+	// Used and not removed
+	size_t m_entryCount = 0;
+
+	// Listeners with their own acceptFrame
+	CanListener* m_fallbackListeners = nullptr;
+
+	size_t m_luaMaskFilterCount = 0;
+
+	// Frames for IDs nothing registered for
+	uint32_t m_unindexedHits[CAN_RX_BUS_COUNT] = {};
+	uint32_t m_unindexedDrops[CAN_RX_BUS_COUNT] = {};
+};
+
+CanRxIndex& getCanRxIndex();
@@ -0,0 +1,281 @@
+/**
+ * @file	can_rx_signals.cpp
+ *
+ * User configured CAN signals, see can_rx_signals.h
+ */
+
+#include "pch.h"
+
+#if EFI_CAN_SUPPORT || EFI_UNIT_TEST
+
+#include "can_rx_signals.h"
+
+#include <cstring>
+
+static CanRxSignalDecoder canRxSignals;
+
+CanRxSignalDecoder& getCanRxSignals() {
+	return canRxSignals;
+}
+
+// Same order as CanRxSignalTarget, without None
+static CanRxSignalSensor targetSensors[] = {
+	SensorType::VehicleSpeed,
+	SensorType::Map,
+	SensorType::Clt,
+	SensorType::Iat,
+	SensorType::Tps1,
+	SensorType::AcceleratorPedal,
+	SensorType::OilPressure,
+	SensorType::OilTemperature,
+	SensorType::FuelPressureLow,
+	SensorType::FuelPressureHigh,
+	SensorType::FuelLevel,
+	SensorType::BatteryVoltage,
+	SensorType::BarometricPressure,
+	SensorType::AmbientTemperature,
+	SensorType::WheelSpeedLF,
+	SensorType::WheelSpeedRF,
+	SensorType::WheelSpeedLR,
+	SensorType::WheelSpeedRR,
+	SensorType::TurbochargerSpeed,
+	SensorType::FuelEthanolPercent,
+	SensorType::Lambda1,
+	SensorType::Lambda2,
+	SensorType::AuxTemp1,
+	SensorType::AuxTemp2,
+	SensorType::AuxLinear1,
+	SensorType::AuxLinear2,
+	SensorType::AuxLinear3,
+	SensorType::AuxLinear4,
+};
+
+static_assert(efi::size(targetSensors) == static_cast<size_t>(CanRxSignalTarget::AuxLinear4));
+
+static CanRxSignalSensor* getTargetSensor(CanRxSignalTarget target) {
+	size_t index = static_cast<size_t>(target);
+
+	if (index == 0 || index > efi::size(targetSensors)) {
+		return nullptr;
+	}
+
+	return &targetSensors[index - 1];
+}
+
+bool compileCanRxSignal(const can_rx_signal_s& signal, CanRxExtractor& extractor) {
+	int length = signal.length;
+	int startBit = signal.startBit;
+
+	if (length < 1 || length > 32 || startBit > 63) {
+		return false;
+	}
+
+	int lsb;
+	if (signal.bigEndian) {
+		// DBC numbers the bits of a big endian signal within their byte, byte 0 first. In the frame
+		// loaded as a big endian word byte 0 is the top one, and the start bit is the MSB.
+		int msb = (7 - startBit / 8) * 8 + startBit % 8;
+		lsb = msb - (length - 1);
+
+		if (lsb < 0) {
+			return false;
+		}
+
+		extractor.minDlc = 8 - lsb / 8;
+	} else {
+		lsb = startBit;
+
+		if (lsb + length > 64) {
+			return false;
+		}
+
+		extractor.minDlc = (lsb + length + 7) / 8;
+	}
+
+	extractor.shift = lsb;
+	extractor.bigEndian = signal.bigEndian;
+	extractor.mask = length == 32 ? 0xFFFFFFFF : (1u << length) - 1;
+	extractor.signBit = signal.isSigned ? 1u << (length - 1) : 0;
+	extractor.factor = signal.factor;
+	extractor.offset = signal.offset;
+	extractor.bus = signal.bus;
+	extractor.sensor = nullptr;
+
+	return true;
+}
+
+static uint64_t loadFrameData(const CANRxFrame& frame, bool bigEndian) {
+	uint64_t data;
+	memcpy(&data, frame.data8, sizeof(data));
+
+	return bigEndian ? __builtin_bswap64(data) : data;
+}
+
+static float extract(const CanRxExtractor& extractor, uint64_t data) {
+	uint32_t raw = (data >> extractor.shift) & extractor.mask;
+
+	float value;
+	if (extractor.signBit) {
+		// Sign extend
+		value = static_cast<int32_t>((raw ^ extractor.signBit) - extractor.signBit);
+	} else {
+		value = raw;
+	}
+
+	return value * extractor.factor + extractor.offset;
+}
+
+float extractCanRxSignal(const CanRxExtractor& extractor, const CANRxFrame& frame) {
+	return extract(extractor, loadFrameData(frame, extractor.bigEndian));
+}
+
+size_t CanRxSignalDecoder::configure(const can_rx_signal_s* signals, size_t count) {
+	unregisterSensors();
+
+	Bank& bank = m_banks[m_active ^ 1];
+	bank.extractorCount = 0;
+	bank.groupCount = 0;
+
+	uint32_t ids[CAN_RX_SIGNAL_COUNT];
+
+	for (size_t i = 0; i < count && bank.extractorCount < efi::size(bank.extractors); i++) {
+		const auto& signal = signals[i];
+
+		if (signal.target == CanRxSignalTarget::None) {
+			continue;
+		}
+
+		CanRxSignalSensor* sensor = getTargetSensor(signal.target);
+		CanRxExtractor extractor;
+
+		if (!sensor || !compileCanRxSignal(signal, extractor)) {
+			efiPrintf("CAN RX signal %d is invalid: start bit %d length %d", (int)i, signal.startBit, signal.length);
+			continue;
+		}
+
+		// Either configured as a regular sensor, or by an earlier signal
+		if (Sensor::hasSensor(sensor->type())) {
+			efiPrintf("CAN RX signal %d: sensor %s is already in use", (int)i, sensor->getSensorName());
+			continue;
+		}
+
+		sensor->canId = signal.id;
+		sensor->setTimeout(signal.timeout);
+		sensor->invalidate();
+		sensor->Register();
+		extractor.sensor = sensor;
+
+		// Insert sorted by ID, signals of the same ID keep their order
+		size_t pos = bank.extractorCount;
+		while (pos > 0 && ids[pos - 1] > signal.id) {
+			ids[pos] = ids[pos - 1];
+			bank.extractors[pos] = bank.extractors[pos - 1];
+			pos--;
+		}
+
+		ids[pos] = signal.id;
+		bank.extractors[pos] = extractor;
+		bank.extractorCount++;
+	}
+
+	for (size_t i = 0; i < bank.extractorCount; i++) {
+		if (bank.groupCount == 0 || bank.groups[bank.groupCount - 1].id != ids[i]) {
+			bank.groups[bank.groupCount++] = { ids[i], static_cast<uint8_t>(i), 0 };
+		}
+
+		bank.groups[bank.groupCount - 1].count++;
+	}
+
+	// Now it's complete, the decoder can have it
+	m_active ^= 1;
+
+	return bank.extractorCount;
+}
+
+void CanRxSignalDecoder::unregisterSensors() {
+	const Bank& bank = m_banks[m_active];
+
+	// Decoding in to them until the next bank is active is harmless
+	for (size_t i = 0; i < bank.extractorCount; i++) {
+		bank.extractors[i].sensor->unregister();
+	}
+}
+
+void CanRxSignalDecoder::reset() {
+	unregisterSensors();
+
+	Bank& empty = m_banks[m_active ^ 1];
+	empty.extractorCount = 0;
+	empty.groupCount = 0;
+
+	m_active ^= 1;
+}
+
+const CanRxSignalGroup* CanRxSignalDecoder::findGroup(const Bank& bank, uint32_t id) const {
+	size_t low = 0;
+	size_t high = bank.groupCount;
+
+	while (low < high) {
+		size_t mid = (low + high) / 2;
+		const auto& group = bank.groups[mid];
+
+		if (group.id == id) {
+			return &group;
+		} else if (group.id < id) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+
+	return nullptr;
+}
+
+bool CanRxSignalDecoder::decode(CanBusIndex busIndex, const CANRxFrame& frame, efitick_t nowNt) {
+	const Bank& bank = m_banks[m_active];
+
+	const CanRxSignalGroup* group = findGroup(bank, CAN_ID(frame));
+
+	if (!group) {
+		return false;
+	}
+
+	uint64_t little = loadFrameData(frame, false);
+	uint64_t big = __builtin_bswap64(little);
+	uint8_t bus = static_cast<uint8_t>(busIndex) + 1;
+
+	bool taken = false;
+
+	for (size_t i = group->first; i < group->first + group->count; i++) {
+		const auto& extractor = bank.extractors[i];
+
+		if ((extractor.bus != 0 && extractor.bus != bus) || frame.DLC < extractor.minDlc) {
+			continue;
+		}
+
+		extractor.sensor->set(extract(extractor, extractor.bigEndian ? big : little), nowNt);
+		taken = true;
+	}
+
+	if (taken) {
+		m_frameCount++;
+	}
+
+	return taken;
+}
+
+void CanRxSignalDecoder::printStats() const {
+	const Bank& bank = m_banks[m_active];
+
+	efiPrintf("CAN RX signals: %d in %d IDs, %d frames decoded", (int)bank.extractorCount, (int)bank.groupCount, (int)m_frameCount);
+
+	for (size_t i = 0; i < bank.extractorCount; i++) {
+		const auto& extractor = bank.extractors[i];
+		const auto value = extractor.sensor->get();
+
+		efiPrintf("  ID %x %s: valid %s value %.2f", extractor.sensor->canId, extractor.sensor->getSensorName(),
+			boolToString(value.Valid), value.Value);
+	}
+}
+
+#endif // EFI_CAN_SUPPORT || EFI_UNIT_TEST
@@ -0,0 +1,114 @@
+/**
+ * @file	can_rx_signals.h
+ *
+ * Decodes user configured CAN signals, described the way a DBC file does (ID, start bit, length,
+ * byte order, signedness, factor and offset), and publishes them as sensors. Replaces a Lua
+ * onCanRx handler for the plain "this value is in that frame" case.
+ *
+ * The configured signals are compiled when the configuration changes: each becomes an extractor
+ * that is one shift and one mask of the frame data loaded as a 64 bit word, and the extractors are
+ * grouped by CAN ID. A received frame then costs a binary search over the configured IDs, plus a
+ * few instructions per signal it carries.
+ */
+
+#pragma once
+
+#include "can.h"
+#include "stored_value_sensor.h"
+
+class CanRxSignalSensor final : public StoredValueSensor {
+public:
+	CanRxSignalSensor(SensorType type)
+		: StoredValueSensor(type, efidur_t{0})
+	{
+	}
+
+	void set(float value, efitick_t nowNt) {
+		setValidValue(value, nowNt);
+	}
+
+	void showInfo(const char* sensorName) const override;
+
+	uint32_t canId = 0;
+};
+
+struct CanRxExtractor {
+	uint32_t mask;
+	// Top bit of the raw value for signed signals, 0 for unsigned ones
+	uint32_t signBit;
+	float factor;
+	float offset;
+
+	// Of the LSB, in the frame data loaded as a little or big endian 64 bit word
+	uint8_t shift;
+	bool bigEndian;
+	// Shorter frames don't carry the signal
+	uint8_t minDlc;
+	// 0 for any bus, otherwise CanBusIndex + 1
+	uint8_t bus;
+
+	CanRxSignalSensor* sensor;
+};
+
+struct CanRxSignalGroup {
+	uint32_t id;
+	uint8_t first;
+	uint8_t count;
+};
+
+/**
+ * Compiles one configured signal.
+ * @return false if the signal doesn't fit in a CAN frame
+ */
+bool compileCanRxSignal(const can_rx_signal_s& signal, CanRxExtractor& extractor);
+
+float extractCanRxSignal(const CanRxExtractor& extractor, const CANRxFrame& frame);
+
+class CanRxSignalDecoder {
+public:
+	/**
+	 * Compiles the signals and registers their sensors, replacing what was configured before.
+	 * Safe to call while frames are being decoded.
+	 * @return number of signals in use
+	 */
+	size_t configure(const can_rx_signal_s* signals, size_t count);
+
+	// Unregisters the sensors, and stops decoding
+	void reset();
+
+	/**
+	 * @return true if the frame carried any of the signals
+	 */
+	bool decode(CanBusIndex busIndex, const CANRxFrame& frame, efitick_t nowNt);
+
+	size_t getSignalCount() const {
+		return m_banks[m_active].extractorCount;
+	}
+
+	uint32_t getFrameCount() const {
+		return m_frameCount;
+	}
+
+	void printStats() const;
+
+private:
+	// The decoder keeps reading the active bank while the other one is compiled
+	struct Bank {
+		CanRxExtractor extractors[CAN_RX_SIGNAL_COUNT];
+		size_t extractorCount;
+
+		// Sorted by ID
+		CanRxSignalGroup groups[CAN_RX_SIGNAL_COUNT];
+		size_t groupCount;
+	};
+
+	const CanRxSignalGroup* findGroup(const Bank& bank, uint32_t id) const;
+	void unregisterSensors();
+
+	Bank m_banks[2] = {};
+	volatile uint8_t m_active = 0;
+
+	uint32_t m_frameCount = 0;
+};
+
+CanRxSignalDecoder& getCanRxSignals();
@@ -3,8 +3,6 @@
 #include "pch.h"
 #include "can.h"
 
-void canDashboardVAG(CanCycle cycle);
-
 /**
  * B6
  * https://mdac.com.au/2021/04/11/dsg-control-with-rabbit-ecu/
@@ -13,6 +13,7 @@ enum class BigBufferUser {
 	ToothLogger,
 	PerfTrace,
 	TriggerScope,
+	EngineSniffer,
 };
 
 class BigBufferHandle {
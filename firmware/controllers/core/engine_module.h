@@ -7,6 +7,38 @@
 #include "engine_configuration.h"
 #include "engine_phase_angle.h"
 
+// Rates onPeriodicCallback can be called at. They all divide the fast callback rate.
+enum class ModuleRate : uint8_t {
+	// onPeriodicCallback isn't called
+	None = 0,
+	Hz250,
+	Hz125,
+	Hz50,
+	Hz25,
+	Hz10,
+	Hz5,
+	Hz1,
+};
+
+constexpr int hzForModuleRate(ModuleRate rate) {
+	switch (rate) {
+		case ModuleRate::None: return 0;
+		case ModuleRate::Hz250: return 250;
+		case ModuleRate::Hz125: return 125;
+		case ModuleRate::Hz50: return 50;
+		case ModuleRate::Hz25: return 25;
+		case ModuleRate::Hz10: return 10;
+		case ModuleRate::Hz5: return 5;
+		case ModuleRate::Hz1: return 1;
+	}
+
+	return 0;
+}
+
+constexpr float moduleRatePeriodMs(ModuleRate rate) {
+	return 1000.0f / hzForModuleRate(rate);
+}
+
 class EngineModule {
 public:
 	// Called exactly once during boot, before configuration is loaded
@@ -18,9 +50,19 @@ public:
 	// Called approx 20Hz
 	virtual void onSlowCallback() { }
 
-	// Called approx 200Hz
+	// Called at FAST_CALLBACK_RATE, 250Hz. Modules that don't need that much ask for a slower onPeriodicCallback
 	virtual void onFastCallback() { }
 
+	// Rate onPeriodicCallback is called at, read again on 'Burn'. Modules of a lower rate are
+	// spread over the fast callback ticks, see module_dispatcher.h
+	virtual ModuleRate getPeriodicRate() const { return ModuleRate::None; }
+
+	// Among modules of the same rate, higher priority ones are called first
+	virtual uint8_t getPeriodicPriority() const { return 0; }
+
+	// Called at getPeriodicRate(), from the same thread as onFastCallback
+	virtual void onPeriodicCallback() { }
+
 	// Called when the engine stops. Reset your state, etc to prepare for the next start.
 	virtual void onEngineStop() { }
 
@@ -2,6 +2,7 @@
 
 #include "periodic_thread_controller.h"
 #include "electronic_throttle.h"
+#include "capture_log.h"
 
 #define MAIN_LOOP_RATE 1000
 
@@ -60,6 +61,10 @@ void MainLoop::PeriodicTask(efitick_t nowNt) {
 	if (p & FAST_CALLBACK_RATE) {
 		engine->periodicFastCallback();
 	}
+
+	if (p & CAPTURE_LOG_RATE) {
+		getCaptureLog().sample(nowNt);
+	}
 }
 
 template <LoopPeriod flag>
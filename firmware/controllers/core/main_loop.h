@@ -42,6 +42,7 @@ constexpr float loopPeriodMs(LoopPeriod p) {
 #define ETB_UPDATE_RATE LoopPeriod::Period500hz
 #define FAST_CALLBACK_RATE LoopPeriod::Period250hz
 #define SLOW_CALLBACK_RATE LoopPeriod::Period20hz
+#define CAPTURE_LOG_RATE LoopPeriod::Period1000hz
 
 #define FAST_CALLBACK_PERIOD_MS loopPeriodMs(FAST_CALLBACK_RATE)
 #define SLOW_CALLBACK_PERIOD_MS loopPeriodMs(SLOW_CALLBACK_RATE)
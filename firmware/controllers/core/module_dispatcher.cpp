@@ -0,0 +1,335 @@
+/**
+ * @file module_dispatcher.cpp
+ *
+ * See module_dispatcher.h
+ */
+
+#include "pch.h"
+
+#include "module_dispatcher.h"
+
+#include <algorithm>
+#include <cstring>
+
+static constexpr int fastCallbackHz = hzForPeriod(FAST_CALLBACK_RATE);
+
+// The schedule repeats every this many ticks
+static constexpr size_t ticksPerSecond = fastCallbackHz;
+
+static constexpr bool dividesFastCallbackRate(ModuleRate rate) {
+	return fastCallbackHz % hzForModuleRate(rate) == 0;
+}
+
+static_assert(dividesFastCallbackRate(ModuleRate::Hz250));
+static_assert(dividesFastCallbackRate(ModuleRate::Hz125));
+static_assert(dividesFastCallbackRate(ModuleRate::Hz50));
+static_assert(dividesFastCallbackRate(ModuleRate::Hz25));
+static_assert(dividesFastCallbackRate(ModuleRate::Hz10));
+static_assert(dividesFastCallbackRate(ModuleRate::Hz5));
+static_assert(dividesFastCallbackRate(ModuleRate::Hz1));
+static_assert(ticksPerSecond <= UINT8_MAX + 1, "dividers have to fit a uint8_t");
+
+// Modules with a live data channel of their own, by type name. Mockable ones are listed by the
+// type they wrap, which is what the dispatcher is given
+static const struct {
+	const char* name;
+	module_time_s module_timing_s::* channel;
+} moduleTimeChannels[] = {
+	{ "InjectorModelPrimary", &module_timing_s::injectorModelPrimaryTime },
+	{ "InjectorModelSecondary", &module_timing_s::injectorModelSecondaryTime },
+	{ "IdleController", &module_timing_s::idleTime },
+	{ "TriggerScheduler", &module_timing_s::triggerSchedulerTime },
+	{ "HpfpController", &module_timing_s::hpfpTime },
+	{ "ThrottleModel", &module_timing_s::throttleModelTime },
+	{ "AlternatorController", &module_timing_s::alternatorTime },
+	{ "MainRelayController", &module_timing_s::mainRelayTime },
+	{ "IgnitionController", &module_timing_s::ignitionTime },
+	{ "AcController", &module_timing_s::acTime },
+	{ "PrimeController", &module_timing_s::primeTime },
+	{ "DfcoController", &module_timing_s::dfcoTime },
+	{ "HarleyAcr", &module_timing_s::harleyAcrTime },
+	{ "WallFuelController", &module_timing_s::wallFuelTime },
+	{ "KnockController", &module_timing_s::knockTime },
+	{ "SensorChecker", &module_timing_s::sensorCheckerTime },
+	{ "LimpManager", &module_timing_s::limpManagerTime },
+	{ "VvtController1", &module_timing_s::vvt1Time },
+	{ "VvtController2", &module_timing_s::vvt2Time },
+	{ "VvtController3", &module_timing_s::vvt3Time },
+	{ "VvtController4", &module_timing_s::vvt4Time },
+	{ "BoostController", &module_timing_s::boostTime },
+	{ "LedBlinkingTask", &module_timing_s::ledBlinkingTime },
+	{ "TpsAccelEnrichment", &module_timing_s::tpsAccelTime },
+	{ "FanControl1", &module_timing_s::fan1Time },
+	{ "FanControl2", &module_timing_s::fan2Time },
+	{ "FuelPumpController", &module_timing_s::fuelPumpTime },
+	{ "GearDetector", &module_timing_s::gearDetectorTime },
+	{ "TachometerModule", &module_timing_s::tachometerTime },
+	{ "TripOdometer", &module_timing_s::tripOdometerTime },
+	{ "MapAveragingModule", &module_timing_s::mapAveragingTime },
+	{ "EthernetConsoleModule", &module_timing_s::ethernetConsoleTime },
+};
+
+// "... [with T = HpfpController]" or "... [T = HpfpController]" -> "HpfpController"
+static void getModuleName(char* buffer, size_t size, const char* signature) {
+	const char* start = strstr(signature, "T = ");
+	start = start ? start + 4 : signature;
+
+	size_t length = strcspn(start, "];");
+	length = std::min(length, size - 1);
+
+	memcpy(buffer, start, length);
+	buffer[length] = '\0';
+}
+
+module_time_s* findModuleTimeChannel(module_timing_s& timing, const char* signature) {
+	char name[40];
+	getModuleName(name, sizeof(name), signature);
+
+	for (const auto& channel : moduleTimeChannels) {
+		if (strcmp(channel.name, name) == 0) {
+			return &(timing.*channel.channel);
+		}
+	}
+
+	return nullptr;
+}
+
+// Load of each tick of the second while modules are being placed, in microseconds
+static uint16_t tickLoad[ticksPerSecond];
+
+static uint32_t now() {
+	// Mocked time in unit tests, so that they can see modules take time
+	return static_cast<uint32_t>(getTimeNowNt());
+}
+
+void ModuleDispatcher::add(EngineModule& module, const char* signature, bool hasFastCallback, bool hasSlowCallback) {
+	if (m_count >= efi::size(m_entries)) {
+		firmwareError(ObdCode::OBD_PCM_Processor_Fault, "Too many engine modules, increase ENGINE_MODULE_MAX_COUNT");
+		return;
+	}
+
+	m_entries[m_count++] = {
+		.module = &module,
+		.signature = signature,
+		.channel = findModuleTimeChannel(*this, signature),
+		.hasFastCallback = hasFastCallback,
+		.hasSlowCallback = hasSlowCallback,
+		.divider = 0,
+		.offset = 0,
+		.priority = 0,
+		.minNt = UINT32_MAX,
+		.maxNt = 0,
+		.sumNt = 0,
+		.calls = 0,
+		.averageNt = 0,
+		.published = {},
+	};
+}
+
+void ModuleDispatcher::schedule() {
+	m_needsSchedule = false;
+	m_periodicCount = 0;
+
+	for (size_t i = 0; i < m_count; i++) {
+		auto& entry = m_entries[i];
+
+		int hz = hzForModuleRate(entry.module->getPeriodicRate());
+
+		entry.divider = hz > 0 ? fastCallbackHz / hz : 0;
+		entry.offset = 0;
+		entry.priority = entry.module->getPeriodicPriority();
+
+		if (entry.divider == 0) {
+			continue;
+		}
+
+		// Insertion sort: higher rate first, then higher priority, then list order
+		size_t position = m_periodicCount++;
+		while (position > 0) {
+			auto& previous = m_entries[m_periodic[position - 1]];
+
+			bool goesBefore = entry.divider < previous.divider
+				|| (entry.divider == previous.divider && entry.priority > previous.priority);
+
+			if (!goesBefore) {
+				break;
+			}
+
+			m_periodic[position] = m_periodic[position - 1];
+			position--;
+		}
+
+		m_periodic[position] = i;
+	}
+
+	memset(tickLoad, 0, sizeof(tickLoad));
+
+	for (size_t i = 0; i < m_periodicCount; i++) {
+		auto& entry = m_entries[m_periodic[i]];
+
+		// Not measured yet, everybody weighs the same
+		uint32_t weight = std::max<uint32_t>(1, NT2US(entry.averageNt));
+
+		// Pick the offset whose busiest tick is the least busy, then the one with the least total
+		uint32_t bestPeak = UINT32_MAX;
+		uint32_t bestSum = UINT32_MAX;
+
+		for (size_t offset = 0; offset < entry.divider; offset++) {
+			uint32_t peak = 0;
+			uint32_t sum = 0;
+
+			for (size_t tick = offset; tick < ticksPerSecond; tick += entry.divider) {
+				peak = std::max<uint32_t>(peak, tickLoad[tick]);
+				sum += tickLoad[tick];
+			}
+
+			if (peak < bestPeak || (peak == bestPeak && sum < bestSum)) {
+				bestPeak = peak;
+				bestSum = sum;
+				entry.offset = offset;
+			}
+		}
+
+		for (size_t tick = entry.offset; tick < ticksPerSecond; tick += entry.divider) {
+			tickLoad[tick] = std::min<uint32_t>(UINT16_MAX, tickLoad[tick] + weight);
+		}
+	}
+}
+
+template <typename TCallback>
+void ModuleDispatcher::run(Entry& entry, TCallback callback) {
+	uint32_t start = now();
+
+	(entry.module->*callback)();
+
+	uint32_t duration = now() - start;
+
+	entry.minNt = std::min(entry.minNt, duration);
+	entry.maxNt = std::max(entry.maxNt, duration);
+	entry.sumNt += duration;
+	entry.calls++;
+}
+
+void ModuleDispatcher::onFastCallback() {
+	if (m_needsSchedule) {
+		schedule();
+	}
+
+	uint32_t tickStart = now();
+
+	for (size_t i = 0; i < m_count; i++) {
+		if (m_entries[i].hasFastCallback) {
+			run(m_entries[i], &EngineModule::onFastCallback);
+		}
+	}
+
+	for (size_t i = 0; i < m_periodicCount; i++) {
+		auto& entry = m_entries[m_periodic[i]];
+
+		if (m_tick % entry.divider == entry.offset) {
+			run(entry, &EngineModule::onPeriodicCallback);
+		}
+	}
+
+	uint32_t tickDuration = now() - tickStart;
+	m_tickMaxNt = std::max(m_tickMaxNt, tickDuration);
+	m_tickSumNt += tickDuration;
+
+	m_tick++;
+	if (m_tick >= ticksPerSecond) {
+		m_tick = 0;
+		publish();
+	}
+}
+
+void ModuleDispatcher::onSlowCallback() {
+	for (size_t i = 0; i < m_count; i++) {
+		if (m_entries[i].hasSlowCallback) {
+			run(m_entries[i], &EngineModule::onSlowCallback);
+		}
+	}
+}
+
+static float toUs(uint32_t nt) {
+	// Saturate rather than wrap the live data
+	return std::min(NT2USF(nt), 6553.5f);
+}
+
+void ModuleDispatcher::publish() {
+	for (size_t i = 0; i < m_count; i++) {
+		auto& entry = m_entries[i];
+
+		// Only modules called in this second
+		if (entry.calls > 0) {
+			entry.averageNt = entry.sumNt / entry.calls;
+
+			entry.published.min = toUs(entry.minNt);
+			entry.published.avg = toUs(entry.averageNt);
+			entry.published.max = toUs(entry.maxNt);
+		}
+
+		entry.published.calls = entry.calls;
+
+		if (entry.channel) {
+			*entry.channel = entry.published;
+		}
+
+		entry.minNt = UINT32_MAX;
+		entry.maxNt = 0;
+		entry.sumNt = 0;
+		entry.calls = 0;
+	}
+
+	tickTimeAvg = toUs(m_tickSumNt / ticksPerSecond);
+	tickTimeMax = toUs(m_tickMaxNt);
+
+	m_tickSumNt = 0;
+	m_tickMaxNt = 0;
+}
+
+const ModuleDispatcher::Entry* ModuleDispatcher::findEntry(const EngineModule* module) const {
+	for (size_t i = 0; i < m_count; i++) {
+		if (m_entries[i].module == module) {
+			return &m_entries[i];
+		}
+	}
+
+	return nullptr;
+}
+
+int ModuleDispatcher::getTickOffset(const EngineModule* module) const {
+	auto entry = findEntry(module);
+
+	return entry && entry->divider ? entry->offset : -1;
+}
+
+const module_time_s* ModuleDispatcher::getModuleTime(const EngineModule* module) const {
+	auto entry = findEntry(module);
+
+	return entry ? &entry->published : nullptr;
+}
+
+void ModuleDispatcher::printStats() const {
+	efiPrintf("Engine modules, per call over the last second: tick avg %.1fus max %.1fus",
+		(float)tickTimeAvg, (float)tickTimeMax);
+
+	for (size_t i = 0; i < m_count; i++) {
+		auto& entry = m_entries[i];
+
+		char name[40];
+		getModuleName(name, sizeof(name), entry.signature);
+
+		float averageUs = NT2USF(entry.averageNt);
+
+		if (entry.divider) {
+			efiPrintf("%2d %-32s %3dHz tick %3d prio %3d: avg %.1fus",
+				(int)i, name, fastCallbackHz / entry.divider, entry.offset, entry.priority, averageUs);
+		} else {
+			efiPrintf("%2d %-32s %s%s: avg %.1fus",
+				(int)i, name, entry.hasFastCallback ? "fast " : "", entry.hasSlowCallback ? "slow " : "", averageUs);
+		}
+
+		efiPrintf("   min %.1fus max %.1fus, %d calls%s", (float)entry.published.min, (float)entry.published.max,
+			entry.published.calls, entry.channel ? "" : ", no live data channel");
+	}
+}
@@ -0,0 +1,128 @@
+/**
+ * @file module_dispatcher.h
+ *
+ * Calls the engine modules' periodic callbacks from the main loop and measures how long each
+ * module takes.
+ *
+ * On top of the fixed fast and slow callbacks, a module can ask for onPeriodicCallback at one of
+ * the ModuleRate rates. Those divide the fast callback rate, so the whole schedule repeats every
+ * second. Modules are placed rate monotonic - higher rate first, then higher priority - and each
+ * one gets the tick within its period that adds least to the busiest tick it would share, so that
+ * the slower modules don't all land in the same tick. Once modules have been measured, they are
+ * weighted by their average time when placed again on 'Burn'.
+ *
+ * Min/avg/max time per call of each module, over the last second, are published as live data
+ * channels named after the modules (module_timing.txt), and printed by the "moduletiming" command.
+ * Modules without a channel of their own are only printed.
+ */
+
+#pragma once
+
+#include "engine_module.h"
+#include "module_timing_generated.h"
+
+#include <type_traits>
+
+#define ENGINE_MODULE_MAX_COUNT 48
+
+// Type name of a module, from the compiler since there's no RTTI: "... [with T = HpfpController]"
+template <typename T>
+const char* getModuleSignature() {
+	return __PRETTY_FUNCTION__;
+}
+
+// Live data channel of the module with this signature, nullptr if it doesn't have one
+module_time_s* findModuleTimeChannel(module_timing_s& timing, const char* signature);
+
+class ModuleDispatcher : public module_timing_s {
+public:
+	template <typename TModules>
+	void setModules(TModules& modules) {
+		m_count = 0;
+
+		modules.apply_all([this](auto& m) {
+			using T = std::decay_t<decltype(m)>;
+			using callback_t = void (EngineModule::*)();
+
+			// Dummy placeholder at the end of the list
+			if constexpr (!std::is_same_v<T, EngineModule>) {
+				// Callbacks the module doesn't override are not called at all
+				add(m, getModuleSignature<T>(),
+					!std::is_same_v<decltype(&T::onFastCallback), callback_t>,
+					!std::is_same_v<decltype(&T::onSlowCallback), callback_t>);
+			}
+		});
+
+		// Rates may depend on configuration, which isn't loaded yet
+		m_needsSchedule = true;
+	}
+
+	void onFastCallback();
+	void onSlowCallback();
+
+	// Place the modules again before the next tick, rates and weights may have changed
+	void reschedule() {
+		m_needsSchedule = true;
+	}
+
+	void printStats() const;
+
+	// For unit tests: tick within its period the module's onPeriodicCallback runs in, -1 if it doesn't
+	int getTickOffset(const EngineModule* module) const;
+
+	// Published times of the module, nullptr if it isn't dispatched
+	const module_time_s* getModuleTime(const EngineModule* module) const;
+
+private:
+	void add(EngineModule& module, const char* signature, bool hasFastCallback, bool hasSlowCallback);
+	void schedule();
+	void publish();
+
+	struct Entry {
+		EngineModule* module;
+		const char* signature;
+		// Its live data channel, if it has one
+		module_time_s* channel;
+
+		bool hasFastCallback;
+		bool hasSlowCallback;
+
+		// onPeriodicCallback every this many fast callback ticks, 0 if never
+		uint8_t divider;
+		// ...in the ticks where the tick counter modulo divider is this
+		uint8_t offset;
+		uint8_t priority;
+
+		// Current window
+		uint32_t minNt;
+		uint32_t maxNt;
+		uint32_t sumNt;
+		uint16_t calls;
+
+		// Average of the last window, to weigh the module with when it's placed
+		uint32_t averageNt;
+
+		// Last window, as published
+		module_time_s published;
+	};
+
+	const Entry* findEntry(const EngineModule* module) const;
+
+	template <typename TCallback>
+	void run(Entry& entry, TCallback callback);
+
+	Entry m_entries[ENGINE_MODULE_MAX_COUNT];
+	size_t m_count = 0;
+
+	// Entries with onPeriodicCallback, rate monotonic
+	uint8_t m_periodic[ENGINE_MODULE_MAX_COUNT];
+	size_t m_periodicCount = 0;
+
+	bool m_needsSchedule = true;
+
+	// Fast callback tick within the second
+	uint16_t m_tick = 0;
+
+	uint32_t m_tickMaxNt = 0;
+	uint32_t m_tickSumNt = 0;
+};
@@ -0,0 +1,135 @@
+#pragma once
+#include "rusefi_types.h"
+struct module_time_s {
+	// Min
+	// us
+	// offset 0
+	scaled_channel<uint16_t, 10, 1> min = (uint16_t)0;
+	// Avg
+	// us
+	// offset 2
+	scaled_channel<uint16_t, 10, 1> avg = (uint16_t)0;
+	// Max
+	// us
+	// offset 4
+	scaled_channel<uint16_t, 10, 1> max = (uint16_t)0;
+	// Calls
+	// offset 6
+	uint16_t calls = (uint16_t)0;
+};
+static_assert(sizeof(module_time_s) == 8);
+static_assert(offsetof(module_time_s, min) == 0);
+static_assert(offsetof(module_time_s, avg) == 2);
+static_assert(offsetof(module_time_s, max) == 4);
+static_assert(offsetof(module_time_s, calls) == 6);
+
+struct module_timing_s {
+	// Modules: Tick avg
+	// us
+	// offset 0
+	scaled_channel<uint16_t, 10, 1> tickTimeAvg = (uint16_t)0;
+	// Modules: Tick max
+	// us
+	// offset 2
+	scaled_channel<uint16_t, 10, 1> tickTimeMax = (uint16_t)0;
+	// offset 4
+	module_time_s injectorModelPrimaryTime;
+	// offset 12
+	module_time_s injectorModelSecondaryTime;
+	// offset 20
+	module_time_s idleTime;
+	// offset 28
+	module_time_s triggerSchedulerTime;
+	// offset 36
+	module_time_s hpfpTime;
+	// offset 44
+	module_time_s throttleModelTime;
+	// offset 52
+	module_time_s alternatorTime;
+	// offset 60
+	module_time_s mainRelayTime;
+	// offset 68
+	module_time_s ignitionTime;
+	// offset 76
+	module_time_s acTime;
+	// offset 84
+	module_time_s primeTime;
+	// offset 92
+	module_time_s dfcoTime;
+	// offset 100
+	module_time_s harleyAcrTime;
+	// offset 108
+	module_time_s wallFuelTime;
+	// offset 116
+	module_time_s knockTime;
+	// offset 124
+	module_time_s sensorCheckerTime;
+	// offset 132
+	module_time_s limpManagerTime;
+	// offset 140
+	module_time_s vvt1Time;
+	// offset 148
+	module_time_s vvt2Time;
+	// offset 156
+	module_time_s vvt3Time;
+	// offset 164
+	module_time_s vvt4Time;
+	// offset 172
+	module_time_s boostTime;
+	// offset 180
+	module_time_s ledBlinkingTime;
+	// offset 188
+	module_time_s tpsAccelTime;
+	// offset 196
+	module_time_s fan1Time;
+	// offset 204
+	module_time_s fan2Time;
+	// offset 212
+	module_time_s fuelPumpTime;
+	// offset 220
+	module_time_s gearDetectorTime;
+	// offset 228
+	module_time_s tachometerTime;
+	// offset 236
+	module_time_s tripOdometerTime;
+	// offset 244
+	module_time_s mapAveragingTime;
+	// offset 252
+	module_time_s ethernetConsoleTime;
+};
+static_assert(sizeof(module_timing_s) == 260);
+static_assert(offsetof(module_timing_s, tickTimeAvg) == 0);
+static_assert(offsetof(module_timing_s, tickTimeMax) == 2);
+static_assert(offsetof(module_timing_s, injectorModelPrimaryTime) == 4);
+static_assert(offsetof(module_timing_s, injectorModelSecondaryTime) == 12);
+static_assert(offsetof(module_timing_s, idleTime) == 20);
+static_assert(offsetof(module_timing_s, triggerSchedulerTime) == 28);
+static_assert(offsetof(module_timing_s, hpfpTime) == 36);
+static_assert(offsetof(module_timing_s, throttleModelTime) == 44);
+static_assert(offsetof(module_timing_s, alternatorTime) == 52);
+static_assert(offsetof(module_timing_s, mainRelayTime) == 60);
+static_assert(offsetof(module_timing_s, ignitionTime) == 68);
+static_assert(offsetof(module_timing_s, acTime) == 76);
+static_assert(offsetof(module_timing_s, primeTime) == 84);
+static_assert(offsetof(module_timing_s, dfcoTime) == 92);
+static_assert(offsetof(module_timing_s, harleyAcrTime) == 100);
+static_assert(offsetof(module_timing_s, wallFuelTime) == 108);
+static_assert(offsetof(module_timing_s, knockTime) == 116);
+static_assert(offsetof(module_timing_s, sensorCheckerTime) == 124);
+static_assert(offsetof(module_timing_s, limpManagerTime) == 132);
+static_assert(offsetof(module_timing_s, vvt1Time) == 140);
+static_assert(offsetof(module_timing_s, vvt2Time) == 148);
+static_assert(offsetof(module_timing_s, vvt3Time) == 156);
+static_assert(offsetof(module_timing_s, vvt4Time) == 164);
+static_assert(offsetof(module_timing_s, boostTime) == 172);
+static_assert(offsetof(module_timing_s, ledBlinkingTime) == 180);
+static_assert(offsetof(module_timing_s, tpsAccelTime) == 188);
+static_assert(offsetof(module_timing_s, fan1Time) == 196);
+static_assert(offsetof(module_timing_s, fan2Time) == 204);
+static_assert(offsetof(module_timing_s, fuelPumpTime) == 212);
+static_assert(offsetof(module_timing_s, gearDetectorTime) == 220);
+static_assert(offsetof(module_timing_s, tachometerTime) == 228);
+static_assert(offsetof(module_timing_s, tripOdometerTime) == 236);
+static_assert(offsetof(module_timing_s, mapAveragingTime) == 244);
+static_assert(offsetof(module_timing_s, ethernetConsoleTime) == 252);
+
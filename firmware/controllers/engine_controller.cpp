@@ -48,6 +48,7 @@
 #include "start_stop.h"
 #include "vr_pwm.h"
 #include "adc_subscription.h"
+#include "event_latency.h"
 
 #if EFI_TUNER_STUDIO
 #include "tunerstudio.h"
@@ -622,6 +623,10 @@ bool validateConfig() {
 
 void initEngineController() {
 	addConsoleAction("sensorinfo", printSensorInfo);
+	addConsoleAction("moduletiming", []() {
+		engine->moduleDispatcher.printStats();
+	});
+	initEventLatency();
 
 	commonInitEngineController();
 
@@ -314,6 +314,7 @@ bool InjectionEvent::updateInjectionAngle(injection_mode_e mode) {
 		// don't miss injections at or above 100% duty
 		if (getEngineState()->shouldUpdateInjectionTiming) {
 			injectionStartAngle = result.Value;
+			engine->toothEventIndex.setFuelAngle(ownIndex, injectionStartAngle);
 		}
 
 		return true;
@@ -355,12 +356,30 @@ void FuelSchedule::addFuelEvents() {
 	isReady = true;
 }
 
-void FuelSchedule::onTriggerTooth(const EnginePhaseInfo& phase) {
+void FuelSchedule::onTriggerTooth(uint32_t toothIndex, const EnginePhaseInfo& phase) {
 	// Wait for schedule to be built - this happens the first time we get RPM
 	if (!isReady) {
 		return;
 	}
 
+	// Only visit the injectors due before the next tooth, if we know which those are
+	if (auto toothEvents = engine->toothEventIndex.get(toothIndex, phase)) {
+		uint16_t mask = toothEvents.Value.fuelMask;
+
+		while (mask) {
+			size_t i = __builtin_ctz(mask);
+			mask &= mask - 1;
+
+			if (i >= engineConfiguration->cylindersCount) {
+				break;
+			}
+
+			elements[i].onTriggerTooth(phase);
+		}
+
+		return;
+	}
+
 	for (size_t i = 0; i < engineConfiguration->cylindersCount; i++) {
 		elements[i].onTriggerTooth(phase);
 	}
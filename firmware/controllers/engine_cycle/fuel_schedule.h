@@ -87,7 +87,7 @@ public:
 	void invalidate();
 
 	// Call this every trigger tooth.  It will schedule all required injector events.
-	void onTriggerTooth(const EnginePhaseInfo& phase);
+	void onTriggerTooth(uint32_t toothIndex, const EnginePhaseInfo& phase);
 
 	// Calculate injector opening angle, pins, and mode for all injectors
 	void addFuelEvents();
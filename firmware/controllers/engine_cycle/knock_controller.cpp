@@ -7,6 +7,7 @@
 
 #include "pch.h"
 #include "knock_logic.h"
+#include "capture_log.h"
 
 int getCylinderKnockBank(uint8_t cylinderNumber) {
 	// C/C++ can't index in to bit fields, we have to provide lookup ourselves
@@ -56,6 +57,7 @@ bool KnockControllerBase::onKnockSenseCompleted(uint8_t cylinderNumber, uint8_t
 	if (isKnock) {
 		m_knockCount++;
 		m_lastKnockTimer.reset(lastKnockTime);
+		triggerCaptureLog(CaptureReason::Knock);
 
 		auto baseTiming = engine->cylinders[cylinderNumber].getIgnitionTimingBtdc();
 
@@ -79,6 +81,27 @@ bool KnockControllerBase::onKnockSenseCompleted(uint8_t cylinderNumber, uint8_t
 	return isKnock;
 }
 
+void KnockControllerBase::onKnockBandsSensed(uint8_t cylinderNumber, const float (&bandDb)[KNOCK_BAND_COUNT]) {
+	static_assert(efi::size(m_knockBand) == KNOCK_BAND_COUNT);
+
+	if (cylinderNumber >= efi::size(m_bandDb)) {
+		return;
+	}
+
+	for (size_t i = 0; i < KNOCK_BAND_COUNT; i++) {
+		m_bandDb[cylinderNumber][i] = roundf(bandDb[i]);
+		m_knockBand[i] = m_bandDb[cylinderNumber][i];
+	}
+}
+
+float KnockControllerBase::getBandEnergy(uint8_t cylinderNumber, size_t band) const {
+	if (cylinderNumber >= efi::size(m_bandDb) || band >= KNOCK_BAND_COUNT) {
+		return -100;
+	}
+
+	return m_bandDb[cylinderNumber][band];
+}
+
 float KnockControllerBase::getKnockRetard() const {
 	return m_knockRetard;
 }
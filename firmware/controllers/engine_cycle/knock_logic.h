@@ -9,6 +9,7 @@
 
 #include "peak_detect.h"
 #include "knock_controller_generated.h"
+#include "knock_dsp.h"
 
 int getCylinderKnockBank(uint8_t cylinderNumber);
 
@@ -24,6 +25,10 @@ public:
 	// onKnockSenseCompleted is the callback from the knock sense driver to report a sensed knock level
 	bool onKnockSenseCompleted(uint8_t cylinderNumber, uint8_t channelIdx, float dbv, efitick_t lastKnockTime);
 
+	// Energy of each resonance band, reported by software knock alongside onKnockSenseCompleted
+	void onKnockBandsSensed(uint8_t cylinderNumber, const float (&bandDb)[KNOCK_BAND_COUNT]);
+	float getBandEnergy(uint8_t cylinderNumber, size_t band) const;
+
 	float getKnockRetard() const;
 	uint32_t getKnockCount() const;
 
@@ -38,6 +43,9 @@ private:
 	Timer m_lastKnockTimer;
 
 	int8_t m_gain[MAX_CYLINDER_COUNT];
+
+	// Last reported band energies of each cylinder, dBv
+	int8_t m_bandDb[MAX_CYLINDER_COUNT][KNOCK_BAND_COUNT] = {};
 };
 
 class KnockController : public KnockControllerBase {
@@ -31,7 +31,7 @@
 
 #include "spark_logic.h"
 
-static void handleFuel(const EnginePhaseInfo& phase) {
+static void handleFuel(uint32_t trgEventIndex, const EnginePhaseInfo& phase) {
 	ScopePerf perf(PE::HandleFuel);
 
 	if (!getLimpManager()->allowInjection().value) {
@@ -45,7 +45,7 @@ static void handleFuel(const EnginePhaseInfo& phase) {
 		fs->addFuelEvents();
 	}
 
-	fs->onTriggerTooth(phase);
+	fs->onTriggerTooth(trgEventIndex, phase);
 }
 
 /**
@@ -74,6 +74,8 @@ void mainTriggerCallback(uint32_t trgEventIndex, const EnginePhaseInfo& phase) {
 		if (getTriggerCentral()->checkIfTriggerConfigChanged()) {
 			getIgnitionEvents()->isReady = false; // we need to rebuild complete ignition schedule
 			getFuelSchedule()->invalidate();
+			engine->toothEventIndex.invalidate();
+			engine->module<TriggerScheduler>()->onTriggerShapeChanged();
 			// moved 'triggerIndexByAngle' into trigger initialization (why was it invoked from here if it's only about trigger shape & optimization?)
 			// see updateTriggerWaveform() -> prepareOutputSignals()
 
@@ -88,12 +90,12 @@ void mainTriggerCallback(uint32_t trgEventIndex, const EnginePhaseInfo& phase) {
 	 * For fuel we schedule start of injection based on trigger angle, and then inject for
 	 * specified duration of time
 	 */
-	handleFuel(phase);
+	handleFuel(trgEventIndex, phase);
 
 	/**
 	 * For spark we schedule both start of coil charge and actual spark based on trigger angle
 	 */
-	onTriggerEventSparkLogic(phase);
+	onTriggerEventSparkLogic(trgEventIndex, phase);
 }
 
 #endif /* EFI_ENGINE_CONTROL */
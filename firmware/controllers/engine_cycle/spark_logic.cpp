@@ -123,6 +123,7 @@ static void prepareCylinderIgnitionSchedule(angle_t dwellAngleDuration, floatms_
 
 	event.m_ignitionMode = ignitionMode;
 	event.dwellAngle = dwellStartAngle;
+	engine->toothEventIndex.setSparkAngle(event.cylinderIndex, dwellStartAngle);
 
 	engine->outputChannels.currentIgnitionMode = static_cast<uint8_t>(ignitionMode);
 }
@@ -362,7 +363,60 @@ static void prepareIgnitionSchedule() {
 	initializeIgnitionActions();
 }
 
-void onTriggerEventSparkLogic(const EnginePhaseInfo& phase) {
+static void onTriggerEventSpark(bool limitedSpark, float dwellMs, bool enableOddCylinderWastedSpark, IgnitionEvent& event, const EnginePhaseInfo& phase) {
+	angle_t dwellAngle = event.dwellAngle;
+
+	angle_t sparkAngleAdjust = 0;
+
+	bool isOddCylWastedEvent = false;
+	if (enableOddCylinderWastedSpark) {
+		auto dwellAngleWastedEvent = dwellAngle + 360;
+		if (dwellAngleWastedEvent > 720) {
+			dwellAngleWastedEvent -= 720;
+		}
+
+		// Check whether this event hits 360 degrees out from now (ie, wasted spark),
+		// and if so, twiddle the dwell and spark angles so it happens now instead
+		isOddCylWastedEvent = isPhaseInRange(EngPhase{dwellAngleWastedEvent}, phase);
+
+		if (isOddCylWastedEvent) {
+			dwellAngle = dwellAngleWastedEvent;
+
+			sparkAngleAdjust = 360;
+		}
+	}
+
+	if (!isOddCylWastedEvent && !isPhaseInRange(EngPhase{dwellAngle}, phase)) {
+		return;
+	}
+
+	angle_t sparkAngle = sparkAngleAdjust + event.calculateSparkAngle();
+	if (sparkAngle > 720) {
+		sparkAngle -= 720;
+	}
+	if (std::isnan(sparkAngle)) {
+		warning(ObdCode::CUSTOM_ADVANCE_SPARK, "NaN advance");
+		return;
+	}
+
+#if EFI_LAUNCH_CONTROL
+	if (engine->softSparkLimiter.shouldSkip()) {
+		return;
+	}
+#endif // EFI_LAUNCH_CONTROL
+
+#if EFI_ANTILAG_SYSTEM && EFI_LAUNCH_CONTROL
+	if (engine->ALSsoftSparkLimiter.shouldSkip()) {
+		return;
+	}
+	auto ALSSkipRatio = engineConfiguration->ALSSkipRatio;
+	engine->ALSsoftSparkLimiter.setTargetSkipRatio(ALSSkipRatio);
+#endif // EFI_ANTILAG_SYSTEM
+
+	scheduleSparkEvent(limitedSpark, event, dwellMs, { dwellAngle }, { sparkAngle }, phase);
+}
+
+void onTriggerEventSparkLogic(uint32_t toothIndex, const EnginePhaseInfo& phase) {
 	ScopePerf perf(PE::OnTriggerEventSparkLogic);
 
 	if (!engineConfiguration->isIgnitionEnabled) {
@@ -394,60 +448,29 @@ void onTriggerEventSparkLogic(const EnginePhaseInfo& phase) {
 		engine->engineState.useOddFireWastedSpark
 		&& getCurrentIgnitionMode() == IM_WASTED_SPARK;
 
-	if (engine->ignitionEvents.isReady) {
-		for (size_t i = 0; i < engineConfiguration->cylindersCount; i++) {
-			auto& event = engine->ignitionEvents.elements[i];
-
-			angle_t dwellAngle = event.dwellAngle;
-
-			angle_t sparkAngleAdjust = 0;
-
-			bool isOddCylWastedEvent = false;
-			if (enableOddCylinderWastedSpark) {
-				auto dwellAngleWastedEvent = dwellAngle + 360;
-				if (dwellAngleWastedEvent > 720) {
-					dwellAngleWastedEvent -= 720;
-				}
-
-				// Check whether this event hits 360 degrees out from now (ie, wasted spark),
-				// and if so, twiddle the dwell and spark angles so it happens now instead
-				isOddCylWastedEvent = isPhaseInRange(EngPhase{dwellAngleWastedEvent}, phase);
-
-				if (isOddCylWastedEvent) {
-					dwellAngle = dwellAngleWastedEvent;
-
-					sparkAngleAdjust = 360;
-				}
-			}
+	if (!engine->ignitionEvents.isReady) {
+		return;
+	}
 
-			if (!isOddCylWastedEvent && !isPhaseInRange(EngPhase{dwellAngle}, phase)) {
-				continue;
-			}
+	auto toothEvents = engine->toothEventIndex.get(toothIndex, phase);
 
-			angle_t sparkAngle = sparkAngleAdjust + event.calculateSparkAngle();
-			if (sparkAngle > 720) {
-				sparkAngle -= 720;
-			}
-			if (std::isnan(sparkAngle)) {
-				warning(ObdCode::CUSTOM_ADVANCE_SPARK, "NaN advance");
-				continue;
-			}
+	// The tooth index only knows about the primary dwell angle, not the odd cylinder wasted spark twin
+	if (toothEvents && !enableOddCylinderWastedSpark) {
+		uint16_t mask = toothEvents.Value.sparkMask;
 
-#if EFI_LAUNCH_CONTROL
-			if (engine->softSparkLimiter.shouldSkip()) {
-				continue;
-			}
-#endif // EFI_LAUNCH_CONTROL
+		while (mask) {
+			size_t i = __builtin_ctz(mask);
+			mask &= mask - 1;
 
-#if EFI_ANTILAG_SYSTEM && EFI_LAUNCH_CONTROL
-			if (engine->ALSsoftSparkLimiter.shouldSkip()) {
-				continue;
+			if (i >= engineConfiguration->cylindersCount) {
+				break;
 			}
-			auto ALSSkipRatio = engineConfiguration->ALSSkipRatio;
-			engine->ALSsoftSparkLimiter.setTargetSkipRatio(ALSSkipRatio);
-#endif // EFI_ANTILAG_SYSTEM
 
-			scheduleSparkEvent(limitedSpark, event, dwellMs, { dwellAngle }, { sparkAngle }, phase);
+			onTriggerEventSpark(limitedSpark, dwellMs, false, engine->ignitionEvents.elements[i], phase);
+		}
+	} else {
+		for (size_t i = 0; i < engineConfiguration->cylindersCount; i++) {
+			onTriggerEventSpark(limitedSpark, dwellMs, enableOddCylinderWastedSpark, engine->ignitionEvents.elements[i], phase);
 		}
 	}
 }
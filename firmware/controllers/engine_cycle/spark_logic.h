@@ -7,7 +7,7 @@
 
 #pragma once
 
-void onTriggerEventSparkLogic(const EnginePhaseInfo& phase);
+void onTriggerEventSparkLogic(uint32_t toothIndex, const EnginePhaseInfo& phase);
 int getNumberOfSparks(ignition_mode_e mode);
 percent_t getCoilDutyCycle(float rpm);
 void initializeIgnitionActions();
@@ -0,0 +1,187 @@
+/**
+ * @file tooth_event_index.cpp
+ *
+ * Teeth are stored in trigger order, which is also engine phase order once rotated to start
+ * at m_firstTooth (converting trigger phase to engine phase is a constant offset plus a wrap).
+ * That lets an event find its tooth with a binary search whenever its angle changes,
+ * instead of every tooth having to check every event.
+ */
+
+#include "pch.h"
+
+#include "tooth_event_index.h"
+
+#if EFI_ENGINE_CONTROL
+
+void ToothEventIndex::invalidate() {
+	m_isReady = false;
+}
+
+void ToothEventIndex::update() {
+#if EFI_SHAFT_POSITION_INPUT
+	TriggerCentral* tc = getTriggerCentral();
+
+	// Tooth phases only move if the trigger, its offset or the cam phase adjustment change,
+	// event angles keep themselves up to date through setFuelAngle/setSparkAngle.
+	float phaseKey = tc->toEngPhase({ 0 }).angle;
+
+	if (m_isReady && phaseKey == m_phaseKey && tc->engineCycleEventCount == m_toothCount) {
+		return;
+	}
+
+	rebuild();
+#endif // EFI_SHAFT_POSITION_INPUT
+}
+
+void ToothEventIndex::rebuild() {
+	chibios_rt::CriticalSectionLocker csl;
+
+	m_isReady = false;
+
+#if EFI_SHAFT_POSITION_INPUT
+	TriggerCentral* tc = getTriggerCentral();
+
+	size_t toothCount = tc->engineCycleEventCount;
+	if (tc->triggerShape.shapeDefinitionError || toothCount == 0 || toothCount > efi::size(m_teeth)) {
+		return;
+	}
+
+	m_toothCount = toothCount;
+	m_phaseKey = tc->toEngPhase({ 0 }).angle;
+	m_firstTooth = 0;
+
+	for (size_t i = 0; i < m_toothCount; i++) {
+		// Exactly the same computation as TriggerCentral::handleShaftSignal, so that get() can compare phases for equality
+		m_teeth[i].phase = tc->toEngPhase({ tc->triggerFormDetails.eventAngles[i] }).angle;
+		m_teeth[i].fuelMask = 0;
+		m_teeth[i].sparkMask = 0;
+
+		if (m_teeth[i].phase < m_teeth[m_firstTooth].phase) {
+			m_firstTooth = i;
+		}
+	}
+
+	m_isReady = true;
+
+	// Now that the teeth are known, put every event in its place
+	for (size_t i = 0; i < efi::size(m_fuelTooth); i++) {
+		m_fuelTooth[i] = TOOTH_EVENT_INDEX_NONE;
+		m_sparkTooth[i] = TOOTH_EVENT_INDEX_NONE;
+	}
+
+	if (engine->injectionEvents.isReady) {
+		for (size_t i = 0; i < engineConfiguration->cylindersCount; i++) {
+			setFuelAngle(i, engine->injectionEvents.elements[i].injectionStartAngle);
+		}
+	}
+
+	if (engine->ignitionEvents.isReady) {
+		for (size_t i = 0; i < engineConfiguration->cylindersCount; i++) {
+			setSparkAngle(i, engine->ignitionEvents.elements[i].dwellAngle);
+		}
+	}
+#endif // EFI_SHAFT_POSITION_INPUT
+}
+
+expected<uint16_t> ToothEventIndex::findTooth(angle_t angle) const {
+	if (!m_isReady || std::isnan(angle)) {
+		return unexpected;
+	}
+
+	auto toothAt = [this](uint32_t phaseOrder) {
+		return (m_firstTooth + phaseOrder) % m_toothCount;
+	};
+
+	// Find the last tooth (in phase order) at or before this angle
+	int32_t left = 0;
+	int32_t right = m_toothCount - 1;
+	int32_t found = -1;
+
+	while (left <= right) {
+		int32_t middle = (left + right) / 2;
+
+		if (m_teeth[toothAt(middle)].phase <= angle) {
+			found = middle;
+			left = middle + 1;
+		} else {
+			right = middle - 1;
+		}
+	}
+
+	// Before the first tooth in the cycle: belongs to the last tooth, whose window wraps around through zero
+	if (found < 0) {
+		found = m_toothCount - 1;
+	}
+
+	return toothAt(found);
+}
+
+void ToothEventIndex::updateMask(uint16_t tooth, uint16_t ToothEvents::* mask, uint16_t bit, bool set) {
+	float phase = m_teeth[tooth].phase;
+
+	auto apply = [&](uint16_t i) {
+		if (set) {
+			m_teeth[i].*mask |= bit;
+		} else {
+			m_teeth[i].*mask &= ~bit;
+		}
+	};
+
+	apply(tooth);
+
+	// Teeth sharing a phase (both edges reported at the same angle) share the same window,
+	// so they all need to know about the event - same as checking the angle on each of them would.
+	for (uint16_t i = (tooth + 1) % m_toothCount; i != tooth && m_teeth[i].phase == phase; i = (i + 1) % m_toothCount) {
+		apply(i);
+	}
+
+	for (uint16_t i = (tooth + m_toothCount - 1) % m_toothCount; i != tooth && m_teeth[i].phase == phase; i = (i + m_toothCount - 1) % m_toothCount) {
+		apply(i);
+	}
+}
+
+void ToothEventIndex::moveEvent(uint16_t (&eventTooth)[MAX_CYLINDER_COUNT], uint16_t ToothEvents::* mask, size_t eventIndex, angle_t angle) {
+	if (!m_isReady || eventIndex >= efi::size(eventTooth)) {
+		return;
+	}
+
+	uint16_t bit = 1 << eventIndex;
+
+	chibios_rt::CriticalSectionLocker csl;
+
+	if (eventTooth[eventIndex] != TOOTH_EVENT_INDEX_NONE) {
+		updateMask(eventTooth[eventIndex], mask, bit, false);
+		eventTooth[eventIndex] = TOOTH_EVENT_INDEX_NONE;
+	}
+
+	if (auto tooth = findTooth(angle)) {
+		updateMask(tooth.Value, mask, bit, true);
+		eventTooth[eventIndex] = tooth.Value;
+	}
+}
+
+void ToothEventIndex::setFuelAngle(size_t eventIndex, angle_t angle) {
+	moveEvent(m_fuelTooth, &ToothEvents::fuelMask, eventIndex, angle);
+}
+
+void ToothEventIndex::setSparkAngle(size_t eventIndex, angle_t angle) {
+	moveEvent(m_sparkTooth, &ToothEvents::sparkMask, eventIndex, angle);
+}
+
+expected<ToothEvents> ToothEventIndex::get(uint32_t toothIndex, const EnginePhaseInfo& phase) const {
+	if (!m_isReady || toothIndex >= m_toothCount) {
+		return unexpected;
+	}
+
+	const auto& tooth = m_teeth[toothIndex];
+
+	// If the phase moved (cam sync changed phase adjustment, trigger offset changed, etc)
+	// the index is stale until the next rebuild
+	if (tooth.phase != phase.currentEngPhase.angle) {
+		return unexpected;
+	}
+
+	return tooth;
+}
+
+#endif // EFI_ENGINE_CONTROL
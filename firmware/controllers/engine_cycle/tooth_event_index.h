@@ -0,0 +1,67 @@
+/**
+ * @file tooth_event_index.h
+ *
+ * For every trigger tooth, which injection and ignition events are due before the next tooth.
+ *
+ * Without this the trigger callback has to check every cylinder's event angle against the
+ * current tooth, on every tooth. With it, the trigger callback only looks at the events
+ * that actually need scheduling from this tooth.
+ */
+
+#pragma once
+
+#include "state_sequence.h"
+#include "engine_phase_angle.h"
+
+#include <rusefi/expected.h>
+
+#define TOOTH_EVENT_INDEX_SIZE (2 * PWM_PHASE_MAX_COUNT)
+#define TOOTH_EVENT_INDEX_NONE 0xFFFF
+
+struct ToothEvents {
+	// Engine phase of this tooth at the time the index was built
+	float phase;
+
+	// Bit N set means event N of FuelSchedule/IgnitionEventList is due before the next tooth
+	uint16_t fuelMask;
+	uint16_t sparkMask;
+};
+
+class ToothEventIndex {
+public:
+	// Rebuild the index if the trigger or its phase changed since last time. Called from the fast callback.
+	void update();
+	// Recompute tooth phases and re-bucket every event
+	void rebuild();
+	void invalidate();
+
+	// Move one event to the tooth matching its new angle, call whenever an event angle changes
+	void setFuelAngle(size_t eventIndex, angle_t angle);
+	void setSparkAngle(size_t eventIndex, angle_t angle);
+
+	/**
+	 * Returns unexpected if the index doesn't match the current trigger phase (not built yet,
+	 * trigger just changed, etc) - in that case the caller has to check every event itself.
+	 */
+	expected<ToothEvents> get(uint32_t toothIndex, const EnginePhaseInfo& phase) const;
+
+private:
+	expected<uint16_t> findTooth(angle_t angle) const;
+
+	// Set or clear 'bit' in 'mask' of the tooth and all of the teeth sharing its phase
+	void updateMask(uint16_t tooth, uint16_t ToothEvents::* mask, uint16_t bit, bool set);
+	void moveEvent(uint16_t (&eventTooth)[MAX_CYLINDER_COUNT], uint16_t ToothEvents::* mask, size_t eventIndex, angle_t angle);
+
+	bool m_isReady = false;
+	uint16_t m_toothCount = 0;
+	float m_phaseKey = 0;
+
+	// Index of the tooth with the smallest engine phase - teeth are in phase order starting from here
+	uint16_t m_firstTooth = 0;
+
+	ToothEvents m_teeth[TOOTH_EVENT_INDEX_SIZE];
+
+	// Which tooth each event currently lives on, so that it can be removed when it moves
+	uint16_t m_fuelTooth[MAX_CYLINDER_COUNT];
+	uint16_t m_sparkTooth[MAX_CYLINDER_COUNT];
+};
@@ -320,6 +320,8 @@ void readFromFlash() {
 	// we can only change the state after the CRC check
 	engineConfiguration->byFirmwareVersion = getRusEfiVersion();
 	validateConfiguration();
+
+	configurationWriteCounter++;
 }
 
 static void rewriteConfig() {
@@ -3,6 +3,7 @@
 #include "limp_manager.h"
 #include "fuel_math.h"
 #include "main_trigger_callback.h"
+#include "capture_log.h"
 
 #define CLEANUP_MODE_TPS 90
 
@@ -297,6 +298,10 @@ void LimpManager::fatalError() {
 void LimpManager::setFaultRevLimit(int limit) {
 	// Only allow decreasing the limit
 	// aka uses the limit of the worst fault to yet occur
+	if (limit < m_faultRevLimit) {
+		triggerCaptureLog(CaptureReason::Limp);
+	}
+
 	m_faultRevLimit = minI(m_faultRevLimit, limit);
 }
 
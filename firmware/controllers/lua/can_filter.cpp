@@ -1,15 +1,30 @@
 #include "pch.h"
 #include "can_filter.h"
 #include "can_hw.h"
+#include "can_rx_index.h"
 
 static constexpr size_t maxFilterCount = 48;
 
 static size_t filterCount = 0;
 static CCM_OPTIONAL CanFilter filters[maxFilterCount];
 
+// Filters that match on exactly one ID live in the CAN RX index, only those with a mask (or that
+// didn't fit in the index) are checked here
+static size_t maskFilterCount = 0;
+static uint8_t maskFilters[maxFilterCount];
+
 CanFilter* getFilterForId(CanBusIndex busIndex, int Id) {
-	for (size_t i = 0; i < filterCount; i++) {
-		auto& filter = filters[i];
+	int exact = getCanRxIndex().getLuaFilter(Id, busIndex);
+
+	// Filters apply in the order they were added: a mask filter only wins if it came first
+	for (size_t i = 0; i < maskFilterCount; i++) {
+		size_t filterIndex = maskFilters[i];
+
+		if (exact >= 0 && filterIndex > (size_t)exact) {
+			break;
+		}
+
+		auto& filter = filters[filterIndex];
 
 		if (filter.accept(Id)) {
 			if (filter.Bus == CanBusIndex::Any || filter.Bus == busIndex) {
@@ -18,17 +33,20 @@ CanFilter* getFilterForId(CanBusIndex busIndex, int Id) {
 		}
 	}
 
-	return nullptr;
+	return exact >= 0 ? &filters[exact] : nullptr;
 }
 
 void resetLuaCanRx() {
 	// Clear all lua filters - reloading the script will reinit them
 	filterCount = 0;
+	maskFilterCount = 0;
+	getCanRxIndex().clearLuaFilters();
 }
 
 void addLuaCanRxFilter(int32_t eid, uint32_t mask, CanBusIndex bus, int callback) {
 	if (filterCount >= maxFilterCount) {
 		firmwareError("Too many Lua CAN RX filters");
+		return;
 	}
 
 	efiPrintf("Added Lua CAN RX filter id 0x%x mask 0x%x with%s custom function", (unsigned int)eid, (unsigned int)mask, (callback == -1 ? "out" : ""));
@@ -38,5 +56,10 @@ void addLuaCanRxFilter(int32_t eid, uint32_t mask, CanBusIndex bus, int callback
 	filters[filterCount].Bus = bus;
 	filters[filterCount].Callback = callback;
 
+	if (mask != FILTER_SPECIFIC || !getCanRxIndex().addLuaFilter(eid, bus, filterCount)) {
+		maskFilters[maskFilterCount++] = filterCount;
+		getCanRxIndex().addLuaMaskFilter();
+	}
+
 	filterCount++;
 }
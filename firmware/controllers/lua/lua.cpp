@@ -7,6 +7,8 @@
 
 #include "lua.hpp"
 #include "lua_hooks.h"
+#include "lua_allocator.h"
+#include "lua_tick_monitor.h"
 #include "can_filter.h"
 
 #define TAG "LUA "
@@ -26,17 +28,39 @@ SDRAM_OPTIONAL
 class Heap {
 public:
 	memory_heap_t m_heap;
+	LuaSmallObjectPool m_pool;
 
 	size_t m_memoryUsed = 0;
 	size_t m_size;
 	char* m_buffer;
 
 	void* alloc(size_t n) {
+		if (n <= LuaSmallObjectPool::maxBlockSize) {
+			if (void* obj = m_pool.alloc(n)) {
+				return obj;
+			}
+
+			// Out of slabs, the general purpose heap can still take it
+		}
+
 		return chHeapAlloc(&m_heap, n);
 	}
 
 	void free(void* obj) {
-		chHeapFree(obj);
+		if (m_pool.owns(obj)) {
+			m_pool.free(obj);
+		} else {
+			chHeapFree(obj);
+		}
+	}
+
+	bool canResizeInPlace(void* obj, size_t osize, size_t nsize) const {
+		if (m_pool.owns(obj)) {
+			return nsize <= m_pool.getBlockSize(obj);
+		}
+
+		// A heap block can't give back its tail, so only keep it if not too much of it goes to waste
+		return nsize <= chHeapGetSize(obj) && nsize >= osize / 2;
 	}
 
 public:
@@ -66,6 +90,11 @@ public:
 			return nullptr;
 		}
 
+		if (ptr && canResizeInPlace(ptr, osize, nsize)) {
+			m_memoryUsed = m_memoryUsed - osize + nsize;
+			return ptr;
+		}
+
 		void *new_mem = alloc(nsize);
 
 		// Don't count the memory use if not allocated
@@ -80,7 +109,7 @@ public:
 
 		// An old pointer was passed in, copy the old data in, then free
 		if (new_mem != nullptr) {
-			memcpy(new_mem, ptr, chHeapGetSize(ptr) > nsize ? nsize : chHeapGetSize(ptr));
+			memcpy(new_mem, ptr, osize > nsize ? nsize : osize);
 			free(ptr);
 			m_memoryUsed -= osize;
 		}
@@ -96,9 +125,23 @@ public:
 		return m_memoryUsed;
 	}
 
-	// Use only in case of emergency - obliterates all heap objects and starts over
+	size_t poolSlabsUsed() const {
+		return m_pool.getSlabsUsed();
+	}
+
+	size_t poolSize() const {
+		return m_pool.getSize();
+	}
+
+	// Obliterates all heap objects and starts over
 	void reset() {
 		chHeapObjectInit(&m_heap, m_buffer, m_size);
+
+		// The pool takes its slabs from the heap as the script needs them, they all come back here
+		m_pool.init([](void* context) {
+			return chHeapAllocAligned(static_cast<memory_heap_t*>(context), LuaSmallObjectPool::slabSize, LuaSmallObjectPool::granularity);
+		}, &m_heap);
+
 		m_memoryUsed = 0;
 	}
 };
@@ -110,6 +153,7 @@ static void printLuaMemoryInfo() {
 	auto memoryUsed = userHeap.used();
 	float pct = 100.0f * memoryUsed / heapSize;
 	efiPrintf("Lua memory heap usage: %d / %d bytes = %.1f%%", memoryUsed, heapSize, pct);
+	efiPrintf("Lua small object pool: %d slabs = %d bytes of the heap", userHeap.poolSlabsUsed(), userHeap.poolSize());
 }
 
 static void* myAlloc(void* /*ud*/, void* ptr, size_t osize, size_t nsize) {
@@ -137,6 +181,8 @@ static void* myAlloc(void* /*ud*/, void* ptr, size_t /*osize*/, size_t nsize) {
 
 static int luaTickPeriodUs;
 
+static LuaTickMonitor tickMonitor;
+
 static int lua_setTickRate(lua_State* l) {
 	float freq = luaL_checknumber(l, 1);
 
@@ -186,11 +232,16 @@ static LuaHandle setupLuaState(lua_Alloc alloc) {
 	lua_register(ls, "setTickRate", lua_setTickRate);
 	configureRusefiLuaHooks(ls);
 
+	// Instruction budget and profiler
+	tickMonitor.install(ls);
+
 	// run a GC cycle
 	lua_gc(ls, LUA_GCCOLLECT, 0);
 
 	// set GC settings
 	// see https://www.lua.org/manual/5.4/manual.html#2.5.1
+	// A step is also run after every tick (see runOneLua), so the collector keeps up from
+	// there and rarely has to do work in the middle of a tick.
 	lua_gc(ls, LUA_GCINC, 50, 1000, 9);
 
 	return ls;
@@ -218,6 +269,45 @@ static bool loadScript(LuaHandle& ls, const char* scriptStr) {
 static bool interactivePending = false;
 static char interactiveCmd[100];
 
+enum class ProfileCommand : uint8_t {
+	None,
+	Start,
+	Stop,
+	Print,
+};
+
+static volatile ProfileCommand profileCommand = ProfileCommand::None;
+
+// Console commands are handled here, on the Lua thread, as the hook changes the Lua state
+static void doProfileCommand() {
+	switch (profileCommand) {
+		case ProfileCommand::Start:
+			tickMonitor.setProfiling(true);
+			efiPrintf(TAG "profiler started");
+			break;
+		case ProfileCommand::Stop:
+			tickMonitor.setProfiling(false);
+			tickMonitor.printProfile();
+			break;
+		case ProfileCommand::Print:
+			tickMonitor.printProfile();
+			break;
+		default:
+			return;
+	}
+
+	profileCommand = ProfileCommand::None;
+}
+
+static void updateTickOutputChannels() {
+	engine->outputChannels.luaTickInstructions = tickMonitor.getTickInstructions();
+	engine->outputChannels.luaBudgetExceededCounter = tickMonitor.getBudgetExceededCount();
+
+	if (tickMonitor.isProfiling()) {
+		tickMonitor.getTopShares(engine->outputChannels.luaProfileShare, efi::size(engine->outputChannels.luaProfileShare));
+	}
+}
+
 void doInteractive(LuaHandle& ls) {
 	if (!interactivePending) {
 		// no cmd pending, return
@@ -313,6 +403,9 @@ static bool runOneLua(lua_Alloc alloc, const char* script) {
 	// Reset default tick rate
 	luaTickPeriodUs = MS2US(100);
 
+	// The script's top level gets the same budget as a tick
+	tickMonitor.beginTick(engineConfiguration->luaTickInstructionBudget);
+
 	if (!loadScript(ls, script)) {
 		return false;
 	}
@@ -320,6 +413,10 @@ static bool runOneLua(lua_Alloc alloc, const char* script) {
 	while (!needsReset && !chThdShouldTerminateX()) {
 		Timer t;
 		t.reset();
+
+		doProfileCommand();
+		tickMonitor.beginTick(engineConfiguration->luaTickInstructionBudget);
+
 #if EFI_CAN_SUPPORT
 		// First, process any pending can RX messages
 		doLuaCanRx(ls);
@@ -330,8 +427,12 @@ static bool runOneLua(lua_Alloc alloc, const char* script) {
 
 		invokeTick(ls);
 
+		// Move the collector along now, between ticks, rather than when the next tick allocates
+		lua_gc(ls, LUA_GCSTEP, 0);
+
 		engine->outputChannels.luaLastCycleDuration = t.getElapsedUs();
 		engine->outputChannels.luaInvocationCounter++;
+		updateTickOutputChannels();
 
 		chThdSleep(TIME_US2I(luaTickPeriodUs));
 	}
@@ -348,12 +449,13 @@ void LuaThread::ThreadTask() {
 		auto usedAfterRun = userHeap.used();
 		if (usedAfterRun != 0) {
 			efiPrintf(TAG "MEMORY LEAK DETECTED: %d bytes used after teardown", usedAfterRun);
-
-			// Lua blew up in some terrible way that left memory allocated, reset the heap
-			// so that subsequent runs don't overflow the heap
-			userHeap.reset();
 		}
 
+		// If Lua blew up in some terrible way that left memory allocated, this makes sure
+		// subsequent runs don't overflow the heap. Otherwise it's all free anyway, and this
+		// hands the pool's slabs back to the heap.
+		userHeap.reset();
+
 		// Reset any lua adjustments the script made
 		engine->resetLua();
 
@@ -406,6 +508,14 @@ void startLua() {
 	});
 
 	addConsoleAction("luamemory", printLuaMemoryInfo);
+
+	addConsoleActionI("luaprofile", [](int enable) {
+		profileCommand = enable ? ProfileCommand::Start : ProfileCommand::Stop;
+	});
+
+	addConsoleAction("luaprofileinfo", []() {
+		profileCommand = ProfileCommand::Print;
+	});
 #endif
 }
 
@@ -3,6 +3,8 @@ LUA_EXT=$(PROJECT_DIR)/ext/lua
 
 ALLCPPSRC += $(LUA_DIR)/lua.cpp \
 			 $(LUA_DIR)/lua_hooks.cpp \
+			 $(LUA_DIR)/lua_allocator.cpp \
+			 $(LUA_DIR)/lua_tick_monitor.cpp \
 			 $(LUA_DIR)/can_filter.cpp \
 			 $(LUA_DIR)/lua_hooks_util.cpp \
 			 $(LUA_DIR)/script_impl.cpp \
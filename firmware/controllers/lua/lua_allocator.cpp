@@ -0,0 +1,101 @@
+#include "pch.h"
+
+#include "lua_allocator.h"
+
+void LuaSmallObjectPool::init(SlabSource source, void* context) {
+	m_source = source;
+	m_sourceContext = context;
+	m_slabCount = 0;
+
+	for (size_t i = 0; i < classCount; i++) {
+		m_freeLists[i] = nullptr;
+	}
+}
+
+bool LuaSmallObjectPool::addSlab(size_t sizeClass) {
+	if (m_slabCount >= maxSlabs || !m_source) {
+		return false;
+	}
+
+	char* slab = static_cast<char*>(m_source(m_sourceContext));
+	if (!slab) {
+		return false;
+	}
+
+	// Keep the list sorted: shift everything above the new slab up by one
+	size_t index = m_slabCount;
+	while (index > 0 && m_slabs[index - 1].start > slab) {
+		m_slabs[index] = m_slabs[index - 1];
+		index--;
+	}
+
+	m_slabs[index] = { slab, static_cast<uint8_t>(sizeClass) };
+	m_slabCount++;
+
+	size_t blockSize = classBlockSize(sizeClass);
+
+	// Thread the new blocks on to the free list, lowest address first out
+	FreeBlock* head = m_freeLists[sizeClass];
+	for (size_t offset = (slabSize / blockSize) * blockSize; offset > 0; offset -= blockSize) {
+		auto block = reinterpret_cast<FreeBlock*>(slab + offset - blockSize);
+		block->next = head;
+		head = block;
+	}
+
+	m_freeLists[sizeClass] = head;
+
+	return true;
+}
+
+int LuaSmallObjectPool::findSlab(const void* ptr) const {
+	auto p = static_cast<const char*>(ptr);
+
+	// Last slab starting at or below the pointer
+	size_t low = 0;
+	size_t high = m_slabCount;
+	while (low < high) {
+		size_t mid = (low + high) / 2;
+
+		if (m_slabs[mid].start <= p) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+
+	if (low == 0) {
+		return -1;
+	}
+
+	const Slab& slab = m_slabs[low - 1];
+	return p < slab.start + slabSize ? static_cast<int>(low - 1) : -1;
+}
+
+void* LuaSmallObjectPool::alloc(size_t size) {
+	if (size == 0 || size > maxBlockSize) {
+		return nullptr;
+	}
+
+	size_t sizeClass = sizeClassFor(size);
+
+	if (!m_freeLists[sizeClass] && !addSlab(sizeClass)) {
+		return nullptr;
+	}
+
+	FreeBlock* block = m_freeLists[sizeClass];
+	m_freeLists[sizeClass] = block->next;
+
+	return block;
+}
+
+void LuaSmallObjectPool::free(void* ptr) {
+	size_t sizeClass = m_slabs[findSlab(ptr)].sizeClass;
+
+	auto block = static_cast<FreeBlock*>(ptr);
+	block->next = m_freeLists[sizeClass];
+	m_freeLists[sizeClass] = block;
+}
+
+size_t LuaSmallObjectPool::getBlockSize(const void* ptr) const {
+	return classBlockSize(m_slabs[findSlab(ptr)].sizeClass);
+}
@@ -0,0 +1,92 @@
+/**
+ * @file lua_allocator.h
+ *
+ * Size class pool for Lua's small objects.
+ *
+ * Most of what Lua allocates is tiny: short strings, closures, upvalues, the parts of small tables.
+ * Going through the general purpose heap for each of them costs a block header per object and a
+ * walk of the free list per call. The pool instead carves fixed size blocks out of slabs, so
+ * alloc and free are a pointer swap, and a block can be resized in place as long as the new size
+ * still fits its size class.
+ *
+ * Slabs are taken from a SlabSource (the Lua heap) one at a time as a size class runs out, so the
+ * pool only ever holds as much as the script has needed. They're handed back all at once by init().
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class LuaSmallObjectPool {
+public:
+	// Block sizes are multiples of this, which is also the alignment Lua needs
+	static constexpr size_t granularity = 8;
+	static constexpr size_t classCount = 8;
+	static constexpr size_t maxBlockSize = granularity * classCount;
+
+	static constexpr size_t slabSize = 512;
+	static constexpr size_t maxSlabs = 64;
+
+	// Returns slabSize bytes aligned to granularity, nullptr if there's no memory left
+	using SlabSource = void* (*)(void* context);
+
+	/**
+	 * Drops anything allocated before. The caller takes care of giving back the slabs it handed
+	 * out, usually by resetting the memory they came from.
+	 */
+	void init(SlabSource source, void* context);
+
+	/**
+	 * @return nullptr if the size is too big for the pool, or there's no slab for it
+	 */
+	void* alloc(size_t size);
+	void free(void* ptr);
+
+	bool owns(const void* ptr) const {
+		return findSlab(ptr) >= 0;
+	}
+
+	// Usable size of a block owned by the pool
+	size_t getBlockSize(const void* ptr) const;
+
+	size_t getSlabsUsed() const {
+		return m_slabCount;
+	}
+
+	size_t getSize() const {
+		return m_slabCount * slabSize;
+	}
+
+private:
+	struct FreeBlock {
+		FreeBlock* next;
+	};
+
+	struct Slab {
+		char* start;
+		uint8_t sizeClass;
+	};
+
+	static size_t sizeClassFor(size_t size) {
+		return (size - 1) / granularity;
+	}
+
+	static size_t classBlockSize(size_t sizeClass) {
+		return (sizeClass + 1) * granularity;
+	}
+
+	bool addSlab(size_t sizeClass);
+
+	// Index in m_slabs of the slab the pointer is in, -1 if none
+	int findSlab(const void* ptr) const;
+
+	SlabSource m_source = nullptr;
+	void* m_sourceContext = nullptr;
+
+	// Sorted by address, so a lookup is a binary search
+	Slab m_slabs[maxSlabs];
+	size_t m_slabCount = 0;
+
+	FreeBlock* m_freeLists[classCount] = {};
+};
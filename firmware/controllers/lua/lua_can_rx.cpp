@@ -27,12 +27,12 @@ chibios_rt::Mailbox<CanFrameData*, canFrameCount> freeBuffers;
 // CAN frame buffers that are waiting to be processed by the lua thread
 chibios_rt::Mailbox<CanFrameData*, canFrameCount> filledBuffers;
 
-void processLuaCan(CanBusIndex busIndex, const CANRxFrame& frame) {
+bool processLuaCan(CanBusIndex busIndex, const CANRxFrame& frame) {
 	auto filter = getFilterForId(busIndex, CAN_ID(frame));
 
 	// Filter the frame if we aren't listening for it
 	if (!filter) {
-		return;
+		return false;
 	}
 
 	CanFrameData* frameBuffer;
@@ -47,7 +47,7 @@ void processLuaCan(CanBusIndex busIndex, const CANRxFrame& frame) {
 	if (msg != MSG_OK) {
 		// all buffers are already in use, this frame will be dropped!
 		// TODO: warn the user
-		return;
+		return true;
 	}
 
 	// Copy the frame in to the buffer
@@ -60,6 +60,8 @@ void processLuaCan(CanBusIndex busIndex, const CANRxFrame& frame) {
 		chibios_rt::CriticalSectionLocker csl;
 		filledBuffers.postI(frameBuffer);
 	}
+
+	return true;
 }
 
 // From lapi.c:756, modified slightly
@@ -886,6 +886,9 @@ void configureRusefiLuaHooks(lua_State* l) {
 		setConfigValueByName(propertyName, value);
 		if (incrementVersion) {
 			incrementGlobalConfigurationVersion();
+		} else {
+			// Not a full configuration change, but anything caching the configuration has to see it
+			configurationWriteCounter++;
 		}
 		return 0;
 	});
@@ -0,0 +1,255 @@
+#include "pch.h"
+
+#include "lua_tick_monitor.h"
+
+static void tickHook(lua_State* l, lua_Debug* ar) {
+	auto monitor = *static_cast<LuaTickMonitor**>(lua_getextraspace(l));
+	monitor->onHook(l, ar);
+}
+
+void LuaTickMonitor::install(lua_State* l) {
+	m_state = l;
+
+	// The hook only gets the lua_State, find the monitor through the state's extra space
+	*static_cast<LuaTickMonitor**>(lua_getextraspace(l)) = this;
+
+	// Anything profiled before was for a state that's gone
+	m_entryCount = 0;
+	m_cCallKey = nullptr;
+
+	updateHook();
+}
+
+void LuaTickMonitor::updateHook() {
+	if (!m_state) {
+		return;
+	}
+
+	int mask = LUA_MASKCOUNT;
+
+	if (m_profiling) {
+		mask |= LUA_MASKCALL | LUA_MASKRET;
+		m_hookInterval = LUA_PROFILER_SAMPLE_INSTRUCTIONS;
+	} else {
+		m_hookInterval = LUA_HOOK_INSTRUCTIONS;
+	}
+
+	lua_sethook(m_state, tickHook, mask, m_hookInterval);
+}
+
+void LuaTickMonitor::beginTick(uint32_t budget) {
+	m_tickInstructions = 0;
+	m_budgetInstructions = budget * 1000;
+
+	// Time between ticks belongs to nobody
+	m_lastSampleNt = getTimeNowNt();
+	m_cTimeSinceSampleUs = 0;
+	m_cCallKey = nullptr;
+}
+
+void LuaTickMonitor::setProfiling(bool enable) {
+	if (enable) {
+		m_entryCount = 0;
+		m_profileStartNt = getTimeNowNt();
+		m_lastSampleNt = m_profileStartNt;
+		m_cTimeSinceSampleUs = 0;
+		m_cCallKey = nullptr;
+	}
+
+	m_profiling = enable;
+	updateHook();
+}
+
+void LuaTickMonitor::onHook(lua_State* l, lua_Debug* ar) {
+	switch (ar->event) {
+		case LUA_HOOKCOUNT:
+			onInstructions(l);
+			break;
+		case LUA_HOOKCALL:
+			onCall(l, ar);
+			break;
+		case LUA_HOOKRET:
+			onReturn(l, ar);
+			break;
+		default:
+			break;
+	}
+}
+
+void LuaTickMonitor::onInstructions(lua_State* l) {
+	m_tickInstructions += m_hookInterval;
+
+	if (m_profiling) {
+		sample(l);
+	}
+
+	if (m_budgetInstructions != 0 && m_tickInstructions > m_budgetInstructions) {
+		m_budgetExceededCount++;
+
+		// Unwinds to the pcall that started this part of the tick
+		luaL_error(l, "tick exceeded instruction budget of %dk", (int)(m_budgetInstructions / 1000));
+	}
+}
+
+void LuaTickMonitor::sample(lua_State* l) {
+	efitick_t nowNt = getTimeNowNt();
+	uint32_t elapsedUs = NT2US(nowNt - m_lastSampleNt);
+	m_lastSampleNt = nowNt;
+
+	// C functions were already charged with their own time
+	elapsedUs = elapsedUs > m_cTimeSinceSampleUs ? elapsedUs - m_cTimeSinceSampleUs : 0;
+	m_cTimeSinceSampleUs = 0;
+
+	// Instructions ran since a C function was entered: either it called back in to Lua,
+	// or it raised an error and will never return. Either way, stop timing it.
+	m_cCallKey = nullptr;
+
+	lua_Debug ar;
+	if (!lua_getstack(l, 0, &ar)) {
+		return;
+	}
+
+	lua_getinfo(l, "nSf", &ar);
+	const void* key = lua_topointer(l, -1);
+	lua_pop(l, 1);
+
+	Entry* entry = findEntry(key, ar.name, ar.linedefined, false);
+	entry->timeUs += elapsedUs;
+	entry->count++;
+}
+
+void LuaTickMonitor::onCall(lua_State* l, lua_Debug* ar) {
+	// Only the outermost C call is timed
+	if (m_cCallKey) {
+		return;
+	}
+
+	lua_getinfo(l, "S", ar);
+	if (ar->what[0] != 'C') {
+		return;
+	}
+
+	lua_getinfo(l, "nf", ar);
+	m_cCallKey = lua_topointer(l, -1);
+	lua_pop(l, 1);
+
+	// Make sure there is an entry before the clock starts
+	findEntry(m_cCallKey, ar->name, 0, true);
+
+	m_cCallStartNt = getTimeNowNt();
+}
+
+void LuaTickMonitor::onReturn(lua_State* l, lua_Debug* ar) {
+	if (!m_cCallKey) {
+		return;
+	}
+
+	efitick_t nowNt = getTimeNowNt();
+
+	lua_getinfo(l, "f", ar);
+	const void* key = lua_topointer(l, -1);
+	lua_pop(l, 1);
+
+	if (key != m_cCallKey) {
+		return;
+	}
+
+	m_cCallKey = nullptr;
+
+	uint32_t elapsedUs = NT2US(nowNt - m_cCallStartNt);
+	m_cTimeSinceSampleUs += elapsedUs;
+
+	// The entry was made on the way in
+	Entry* entry = findEntry(key, nullptr, 0, true);
+	entry->timeUs += elapsedUs;
+	entry->count++;
+}
+
+LuaTickMonitor::Entry* LuaTickMonitor::findEntry(const void* key, const char* name, int line, bool isC) {
+	for (size_t i = 0; i < m_entryCount; i++) {
+		if (m_entries[i].key == key) {
+			return &m_entries[i];
+		}
+	}
+
+	// Full, the last entry collects everything that didn't get its own
+	if (m_entryCount == LUA_PROFILER_ENTRY_COUNT) {
+		return &m_entries[LUA_PROFILER_ENTRY_COUNT - 1];
+	}
+
+	Entry& entry = m_entries[m_entryCount++];
+	entry = {};
+
+	if (m_entryCount == LUA_PROFILER_ENTRY_COUNT) {
+		strcpy(entry.name, "(other)");
+		return &entry;
+	}
+
+	entry.key = key;
+	entry.isC = isC;
+
+	if (name) {
+		strncpy(entry.name, name, sizeof(entry.name) - 1);
+	} else if (isC) {
+		strcpy(entry.name, "(C function)");
+	} else if (line == 0) {
+		strcpy(entry.name, "(main chunk)");
+	} else {
+		chsnprintf(entry.name, sizeof(entry.name), "line %d", line);
+	}
+
+	return &entry;
+}
+
+void LuaTickMonitor::getTopShares(uint8_t* shares, size_t count) const {
+	uint64_t totalUs = 0;
+	for (size_t i = 0; i < m_entryCount; i++) {
+		totalUs += m_entries[i].timeUs;
+	}
+
+	static_assert(LUA_PROFILER_ENTRY_COUNT <= 32);
+	uint32_t taken = 0;
+
+	for (size_t n = 0; n < count; n++) {
+		// Pick the most expensive entry not reported yet
+		int best = -1;
+		for (size_t i = 0; i < m_entryCount; i++) {
+			if (!(taken & (1 << i)) && (best < 0 || m_entries[i].timeUs > m_entries[best].timeUs)) {
+				best = i;
+			}
+		}
+
+		if (best < 0 || totalUs == 0) {
+			shares[n] = 0;
+			continue;
+		}
+
+		taken |= 1 << best;
+		shares[n] = 100 * m_entries[best].timeUs / totalUs;
+	}
+}
+
+void LuaTickMonitor::printProfile() const {
+	uint64_t totalUs = 0;
+	for (size_t i = 0; i < m_entryCount; i++) {
+		totalUs += m_entries[i].timeUs;
+	}
+
+	int elapsedMs = NT2US(getTimeNowNt() - m_profileStartNt) / 1000;
+
+	efiPrintf("Lua profile %s, %d ms since start, %d us in Lua and C hooks",
+		m_profiling ? "running" : "stopped", elapsedMs, (int)totalUs);
+
+	for (size_t i = 0; i < m_entryCount; i++) {
+		const auto& entry = m_entries[i];
+		int share = totalUs == 0 ? 0 : 100 * entry.timeUs / totalUs;
+
+		efiPrintf("  %s %-20s %8d us %3d%% %8d %s",
+			entry.isC ? "C  " : "Lua",
+			entry.name,
+			entry.timeUs,
+			share,
+			entry.count,
+			entry.isC ? "calls" : "samples");
+	}
+}
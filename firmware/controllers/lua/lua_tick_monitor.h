@@ -0,0 +1,104 @@
+/**
+ * @file lua_tick_monitor.h
+ *
+ * Watches the Lua VM through its debug hook: enforces the per-tick instruction budget,
+ * and when asked to, profiles where the tick spends its time.
+ *
+ * The profiler samples the running Lua function every few instructions and charges it with the
+ * time since the previous sample. Calls in to C functions (the hooks in lua_hooks.cpp) are timed
+ * exactly on their way in and out, and that time isn't charged to the Lua function calling them.
+ */
+
+#pragma once
+
+#include "lua.hpp"
+
+// Instructions between count hooks while only the budget is enforced
+#define LUA_HOOK_INSTRUCTIONS 1000
+// Instructions between count hooks while profiling
+#define LUA_PROFILER_SAMPLE_INSTRUCTIONS 100
+
+#define LUA_PROFILER_ENTRY_COUNT 16
+
+class LuaTickMonitor {
+public:
+	struct Entry {
+		const void* key;
+		char name[20];
+		bool isC;
+
+		uint32_t timeUs;
+		// Samples for Lua functions, calls for C functions
+		uint32_t count;
+	};
+
+	// Hooks the monitor in to a fresh Lua state
+	void install(lua_State* l);
+
+	/**
+	 * Starts counting instructions for the next tick.
+	 * @param budget thousands of instructions the tick may run, 0 for no limit
+	 */
+	void beginTick(uint32_t budget);
+
+	// Thousands of instructions run since beginTick, rounded to the hook interval
+	uint32_t getTickInstructions() const {
+		return m_tickInstructions / 1000;
+	}
+
+	uint32_t getBudgetExceededCount() const {
+		return m_budgetExceededCount;
+	}
+
+	// Starting clears whatever was profiled before
+	void setProfiling(bool enable);
+
+	bool isProfiling() const {
+		return m_profiling;
+	}
+
+	size_t getEntryCount() const {
+		return m_entryCount;
+	}
+
+	const Entry& getEntry(size_t index) const {
+		return m_entries[index];
+	}
+
+	// Share of the profiled time taken by each of the most expensive entries, in percent
+	void getTopShares(uint8_t* shares, size_t count) const;
+
+	void printProfile() const;
+
+	// Called from the Lua debug hook
+	void onHook(lua_State* l, lua_Debug* ar);
+
+private:
+	void updateHook();
+	void onInstructions(lua_State* l);
+	void sample(lua_State* l);
+	void onCall(lua_State* l, lua_Debug* ar);
+	void onReturn(lua_State* l, lua_Debug* ar);
+
+	Entry* findEntry(const void* key, const char* name, int line, bool isC);
+
+	lua_State* m_state = nullptr;
+
+	int m_hookInterval = LUA_HOOK_INSTRUCTIONS;
+	uint32_t m_tickInstructions = 0;
+	uint32_t m_budgetInstructions = 0;
+	uint32_t m_budgetExceededCount = 0;
+
+	bool m_profiling = false;
+	efitick_t m_profileStartNt = 0;
+	efitick_t m_lastSampleNt = 0;
+	// Time spent in C functions since the last sample, already charged to them
+	uint32_t m_cTimeSinceSampleUs = 0;
+
+	// The outermost C function call in progress, if any
+	const void* m_cCallKey = nullptr;
+	efitick_t m_cCallStartNt = 0;
+
+	Entry m_entries[LUA_PROFILER_ENTRY_COUNT];
+	size_t m_entryCount = 0;
+};
@@ -61,5 +61,6 @@ void initLuaCanRx();
 // Called from the Lua loop to process any pending CAN frames
 void doLuaCanRx(LuaHandle& ls);
 // Called from the CAN RX thread to queue a frame for Lua consumption
-void processLuaCan(CanBusIndex busIndex, const CANRxFrame& frame);
+// Returns true if the script listens for the frame
+bool processLuaCan(CanBusIndex busIndex, const CANRxFrame& frame);
 #endif // not EFI_CAN_SUPPORT
@@ -1,6 +1,7 @@
 #include "pch.h"
 
 #include "lambda_monitor.h"
+#include "capture_log.h"
 
 float LambdaMonitor::getMaxAllowedLambda(float rpm, float load) const {
 	return
@@ -30,6 +31,10 @@ void LambdaMonitorBase::update(float rpm, float load) {
 	lambdaTimeSinceGood = m_timeSinceGoodLambda.getElapsedSeconds();
 
 	if (m_timeSinceGoodLambda.hasElapsedSec(getTimeout())) {
+		if (!lambdaMonitorCut) {
+			triggerCaptureLog(CaptureReason::Lean);
+		}
+
 		// Things have been bad long enough, cut!
 		lambdaMonitorCut = true;
 	}
@@ -0,0 +1,146 @@
+/**
+ * @file compiled_func.cpp
+ */
+
+#include "pch.h"
+
+#include "compiled_func.h"
+
+#include <cmath>
+
+// Inputs checked against the exact chain per step of the table
+static constexpr size_t accuracyPointsPerStep = 4;
+
+float* SensorLutPool::take(size_t size) {
+	if (size > getFree()) {
+		return nullptr;
+	}
+
+	float* table = m_storage + m_used;
+	m_used += size;
+
+	return table;
+}
+
+#if SENSOR_LUT_POOL_SIZE > 0
+static float sensorLutStorage[SENSOR_LUT_POOL_SIZE];
+static SensorLutPool sensorLutPool(sensorLutStorage, SENSOR_LUT_POOL_SIZE);
+#else
+static SensorLutPool sensorLutPool(nullptr, 0);
+#endif
+
+SensorLutPool& getSensorLutPool() {
+	return sensorLutPool;
+}
+
+size_t getSensorLutSize(SensorLutMode mode) {
+	switch (mode) {
+		case SensorLutMode::Points256:
+			return 256;
+		case SensorLutMode::Points1024:
+			return 1024;
+		default:
+			return 0;
+	}
+}
+
+void CompiledFunc::compile(const SensorConverter& source, float minInput, float maxInput, size_t size, SensorLutPool& pool) {
+	// Whoever converts while we're in here gets the source
+	m_size.store(0, std::memory_order_release);
+
+	m_source = &source;
+	m_accuracy = {};
+	m_requestedSize = size;
+
+	if (size < 2 || !(maxInput > minInput)) {
+		return;
+	}
+
+	m_values = pool.take(size);
+	if (!m_values) {
+		return;
+	}
+
+	m_minInput = minInput;
+	m_step = (maxInput - minInput) / (size - 1);
+	m_inverseStep = 1 / m_step;
+
+	for (size_t i = 0; i < size; i++) {
+		auto result = source.convert(minInput + i * m_step);
+
+		m_values[i] = result.Valid ? result.Value : NAN;
+	}
+
+	m_size.store(size, std::memory_order_release);
+
+	checkAccuracy();
+}
+
+SensorResult CompiledFunc::convert(float input) const {
+	size_t size = m_size.load(std::memory_order_acquire);
+
+	if (size == 0) {
+		if (!m_source) {
+			return UnexpectedCode::Configuration;
+		}
+
+		return m_source->convert(input);
+	}
+
+	float position = (input - m_minInput) * m_inverseStep;
+
+	// Negated so that NaN input goes to the source too
+	if (!(position >= 0 && position < size - 1)) {
+		return m_source->convert(input);
+	}
+
+	size_t index = static_cast<size_t>(position);
+	float fraction = position - index;
+
+	float low = m_values[index];
+	float result = low + fraction * (m_values[index + 1] - low);
+
+	// One of the two samples is invalid: this step is at the edge of the valid range
+	if (std::isnan(result)) {
+		return m_source->convert(input);
+	}
+
+	return result;
+}
+
+void CompiledFunc::checkAccuracy() {
+	size_t size = m_size.load(std::memory_order_relaxed);
+
+	float errorSum = 0;
+
+	for (size_t i = 0; i < size - 1; i++) {
+		for (size_t j = 0; j < accuracyPointsPerStep; j++) {
+			float input = m_minInput + (i + (j + 0.5f) / accuracyPointsPerStep) * m_step;
+
+			auto table = convert(input);
+			auto exact = m_source->convert(input);
+
+			if (table.Valid != exact.Valid) {
+				m_accuracy.validityMismatchCount++;
+				continue;
+			}
+
+			if (!table.Valid) {
+				continue;
+			}
+
+			float error = std::abs(table.Value - exact.Value);
+			errorSum += error;
+			m_accuracy.checkedCount++;
+
+			if (error > m_accuracy.maxError) {
+				m_accuracy.maxError = error;
+				m_accuracy.maxErrorInput = input;
+			}
+		}
+	}
+
+	if (m_accuracy.checkedCount > 0) {
+		m_accuracy.meanError = errorSum / m_accuracy.checkedCount;
+	}
+}
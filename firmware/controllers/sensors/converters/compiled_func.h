@@ -0,0 +1,111 @@
+/**
+ * @file compiled_func.h
+ *
+ * A converter that samples another converter (usually a FuncChain) over its input range in to a
+ * table with a uniform step, so that converting costs an index computation and one lerp instead
+ * of the whole chain: no logf for thermistors, no bin search for table functions.
+ *
+ * Compile it when the configuration changes. The source is kept: inputs outside the table, and
+ * steps next to an input where the source is invalid, are passed to it, so invalid results keep
+ * their exact code and the valid range its exact edges.
+ *
+ * Tables are taken from a pool shared by all sensors, so the memory is spent once rather than per
+ * sensor, and only by boards that opt in with the size of the pool. Without one the source is
+ * always used.
+ *
+ * Only compile stateless converters - a filter in the chain would run at compile time only.
+ */
+
+#pragma once
+
+#include "sensor_converter_func.h"
+
+#include <atomic>
+
+// Floats in the pool the firmware's tables are taken from, 0 and they are never used
+#ifndef SENSOR_LUT_POOL_SIZE
+#define SENSOR_LUT_POOL_SIZE 0
+#endif
+
+// Table size for the configured accuracy, 0 if the tables are off
+size_t getSensorLutSize(SensorLutMode mode);
+
+class SensorLutPool {
+public:
+	SensorLutPool(float* storage, size_t capacity)
+		: m_storage(storage)
+		, m_capacity(capacity)
+	{
+	}
+
+	// nullptr if there isn't that much left
+	float* take(size_t size);
+
+	// Only once the tables taken so far are no longer used, or about to be compiled again
+	void reset() {
+		m_used = 0;
+	}
+
+	size_t getFree() const {
+		return m_capacity - m_used;
+	}
+
+private:
+	float* const m_storage;
+	const size_t m_capacity;
+	size_t m_used = 0;
+};
+
+// The firmware's pool, SENSOR_LUT_POOL_SIZE floats
+SensorLutPool& getSensorLutPool();
+
+class CompiledFunc final : public SensorConverter {
+public:
+	/**
+	 * Samples source at size evenly spaced inputs, minInput and maxInput included, in to a table
+	 * taken from pool. Less than 2, or no room in the pool, and everything is passed to source.
+	 */
+	void compile(const SensorConverter& source, float minInput, float maxInput, size_t size, SensorLutPool& pool);
+
+	SensorResult convert(float input) const override;
+
+	void showInfo(float testInputValue) const override;
+
+	size_t getSize() const {
+		return m_size.load(std::memory_order_relaxed);
+	}
+
+	// Table against the exact chain, checked at compile time between the sampled inputs
+	struct Accuracy {
+		float maxError = 0;
+		float maxErrorInput = 0;
+		float meanError = 0;
+		// Inputs where both gave a value
+		uint32_t checkedCount = 0;
+		// Inputs where the table gave a value and the chain didn't, or the other way round
+		uint32_t validityMismatchCount = 0;
+	};
+
+	const Accuracy& getAccuracy() const {
+		return m_accuracy;
+	}
+
+private:
+	void checkAccuracy();
+
+	const SensorConverter* m_source = nullptr;
+
+	float m_minInput = 0;
+	float m_step = 1;
+	float m_inverseStep = 1;
+
+	// Published last, so that the table is not used while it is being written
+	std::atomic<size_t> m_size{0};
+
+	// NaN where the source is invalid
+	float* m_values = nullptr;
+	// What compile was asked for, to tell a full pool from tables turned off
+	size_t m_requestedSize = 0;
+
+	Accuracy m_accuracy;
+};
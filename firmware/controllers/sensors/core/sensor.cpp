@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "auto_generated_sensor.h"
+#include "sensor_snapshot.h"
 
 // This struct represents one sensor in the registry.
 // It stores whether the sensor should use a mock value,
@@ -51,6 +52,12 @@ public:
 	}
 
 	SensorResult get() const {
+#if EFI_UNIT_TEST
+		if (m_useMock || m_sensor) {
+			Sensor::s_sensorReadCount++;
+		}
+#endif // EFI_UNIT_TEST
+
 		// Check if mock
 		if (m_useMock) {
 			if (!m_valid) {
@@ -167,6 +174,19 @@ void Sensor::unregister() {
  * @returns NotNull: sensor result or UnexpectedCode::Configuration if sensor is not registered
  */
 /*static*/ SensorResult Sensor::get(SensorType type) {
+#if EFI_UNIT_TEST
+	s_getCallCount++;
+#endif // EFI_UNIT_TEST
+
+	auto& snapshot = getSensorSnapshot();
+	if (snapshot.isInScope()) {
+		return snapshot.get(type);
+	}
+
+	return getLive(type);
+}
+
+/*static*/ SensorResult Sensor::getLive(SensorType type) {
 	const auto entry = getEntryForType(type);
 
 	// Check if this is a valid sensor entry
@@ -232,6 +252,11 @@ void Sensor::setInvalidMockValue(SensorType type) {
 
 /*static*/ bool Sensor::s_inhibitSensorTimeouts = false;
 
+#if EFI_UNIT_TEST
+/*static*/ uint32_t Sensor::s_getCallCount = 0;
+/*static*/ uint32_t Sensor::s_sensorReadCount = 0;
+#endif // EFI_UNIT_TEST
+
 /*static*/ void Sensor::inhibitTimeouts(bool inhibit) {
 	Sensor::s_inhibitSensorTimeouts = inhibit;
 }
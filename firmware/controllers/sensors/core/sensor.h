@@ -74,9 +74,15 @@ public:
 
 	/*
 	 * Get a reading from the specified sensor.
+	 * During a control tick, this is the reading from the start of the tick (see sensor_snapshot.h)
 	 */
 	static SensorResult get(SensorType type);
 
+	/*
+	 * Get a reading from the sensor itself, even during a control tick.
+	 */
+	static SensorResult getLive(SensorType type);
+
 	/*
 	 * Get a reading from the specified sensor, or zero if unavailable.
 	 */
@@ -163,6 +169,12 @@ public:
 		return m_type;
 	}
 
+#if EFI_UNIT_TEST
+	// Calls to Sensor::get, and how many of those (or of snapshot captures) asked a sensor for its value
+	static uint32_t s_getCallCount;
+	static uint32_t s_sensorReadCount;
+#endif // EFI_UNIT_TEST
+
 protected:
 	// Protected constructor - only subclasses call this
 	explicit Sensor(SensorType type)
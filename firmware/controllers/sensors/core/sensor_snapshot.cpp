@@ -0,0 +1,150 @@
+/**
+ * @file    sensor_snapshot.cpp
+ *
+ * See sensor_snapshot.h
+ */
+
+#include "pch.h"
+
+#include "sensor_snapshot.h"
+
+static SensorSnapshot snapshot;
+
+SensorSnapshot& getSensorSnapshot() {
+	return snapshot;
+}
+
+static void* getCurrentThread() {
+#if EFI_UNIT_TEST
+	return nullptr;
+#else
+	return chThdGetSelfX();
+#endif
+}
+
+bool SensorSnapshot::isIsrContext() const {
+#if EFI_UNIT_TEST
+	return m_isIsrContextForTest;
+#else
+	return port_is_isr_context();
+#endif
+}
+
+void SensorSnapshot::capture() {
+	if (!m_isEnabled) {
+		return;
+	}
+
+	// The trigger can run a tick of its own while this one captures, it gets the previous capture
+	if (m_isCapturing.exchange(true, std::memory_order_acquire)) {
+		return;
+	}
+
+	uint8_t index = m_published.load(std::memory_order_relaxed) ^ 1;
+	Bank& bank = m_banks[index];
+
+	uint32_t sequence = bank.sequence.load(std::memory_order_relaxed);
+	bank.sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	for (size_t i = 0; i < efi::size(bank.validBits); i++) {
+		bank.validBits[i] = 0;
+	}
+
+	for (size_t i = 0; i < sensorCount; i++) {
+		auto result = Sensor::getLive(static_cast<SensorType>(i));
+
+		if (result) {
+			bank.validBits[i / 32] |= 1u << (i % 32);
+			bank.values[i] = result.Value;
+		} else {
+			bank.codes[i] = static_cast<uint8_t>(result.Code);
+		}
+	}
+
+	bank.sequence.store(sequence + 2, std::memory_order_release);
+	m_published.store(index, std::memory_order_release);
+
+	m_hasCapture = true;
+	m_captureCount++;
+
+	m_isCapturing.store(false, std::memory_order_release);
+}
+
+SensorResult SensorSnapshot::get(SensorType type) const {
+	size_t index = static_cast<size_t>(type);
+
+	if (index >= sensorCount) {
+		return UnexpectedCode::Configuration;
+	}
+
+	while (true) {
+		const Bank& bank = m_banks[m_published.load(std::memory_order_acquire)];
+
+		uint32_t sequence = bank.sequence.load(std::memory_order_acquire);
+		if (sequence & 1) {
+			// Lapped by two captures since loading the bank index, take the new one
+			continue;
+		}
+
+		bool isValid = bank.validBits[index / 32] & (1u << (index % 32));
+		float value = bank.values[index];
+		uint8_t code = bank.codes[index];
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		if (bank.sequence.load(std::memory_order_relaxed) != sequence) {
+			continue;
+		}
+
+		if (isValid) {
+			return value;
+		}
+
+		return static_cast<UnexpectedCode>(code);
+	}
+}
+
+bool SensorSnapshot::isInScope() const {
+	// Composite sensors read the sensors they're made of live while being captured
+	if (m_isCapturing.load(std::memory_order_relaxed)) {
+		return false;
+	}
+
+	// Whatever thread an interrupt lands on, it reads the last capture
+	if (isIsrContext()) {
+		return m_hasCapture;
+	}
+
+	return m_scopeDepth != 0 && m_scopeThread == getCurrentThread();
+}
+
+void SensorSnapshot::setEnabled(bool isEnabled) {
+	m_isEnabled = isEnabled;
+
+	if (!isEnabled) {
+		m_hasCapture = false;
+	}
+}
+
+SensorSnapshotScope::SensorSnapshotScope() {
+	// Nothing to read before the first capture
+	m_isActive = snapshot.m_hasCapture;
+	m_previousThread = snapshot.m_scopeThread;
+
+	if (m_isActive) {
+		chibios_rt::CriticalSectionLocker csl;
+
+		snapshot.m_scopeThread = getCurrentThread();
+		snapshot.m_scopeDepth = snapshot.m_scopeDepth + 1;
+	}
+}
+
+SensorSnapshotScope::~SensorSnapshotScope() {
+	if (m_isActive) {
+		chibios_rt::CriticalSectionLocker csl;
+
+		snapshot.m_scopeDepth = snapshot.m_scopeDepth - 1;
+		snapshot.m_scopeThread = m_previousThread;
+	}
+}
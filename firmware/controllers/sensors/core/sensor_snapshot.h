@@ -0,0 +1,98 @@
+/**
+ * @file    sensor_snapshot.h
+ * @brief Every sensor read once per control tick
+ *
+ * Without this, every Sensor::get goes to the registry and the sensor itself (mock check, validity,
+ * timeout), and one pass of the fast callback can see CLT from one instant and MAP from another.
+ *
+ * At the start of the fast callback all sensors are read in to a flat array, and while the tick
+ * runs Sensor::get returns values from that array. Interrupts always read the last capture, also
+ * between ticks; other threads keep reading the sensors themselves.
+ *
+ * There are two banks: a capture fills the one readers aren't using, then publishes it. Each bank
+ * has a sequence number (seqlock), odd while it's being written, so that a reader that was
+ * preempted for long enough to have its bank rewritten notices and reads again. Readers never
+ * lock and never wait on a writer.
+ */
+
+#pragma once
+
+#include "sensor.h"
+
+#include <atomic>
+
+class SensorSnapshot {
+public:
+	// Reads every sensor and publishes the result. A capture that interrupts another one is skipped.
+	void capture();
+
+	// Reading from the last published capture, lock free
+	SensorResult get(SensorType type) const;
+
+	// Whether Sensor::get should read from here instead of the sensor
+	bool isInScope() const;
+
+	// For benchmarks and debugging: when disabled, nothing is captured and Sensor::get always reads the sensor
+	void setEnabled(bool isEnabled);
+
+	uint32_t getCaptureCount() const {
+		return m_captureCount;
+	}
+
+#if EFI_UNIT_TEST
+	// There are no interrupts in unit tests, this makes Sensor::get behave as if called from one
+	void setIsrContextForTest(bool isIsrContext) {
+		m_isIsrContextForTest = isIsrContext;
+	}
+#endif // EFI_UNIT_TEST
+
+private:
+	bool isIsrContext() const;
+
+	friend class SensorSnapshotScope;
+
+	static constexpr size_t sensorCount = static_cast<size_t>(SensorType::PlaceholderLast);
+
+	struct Bank {
+		// Odd while being written
+		std::atomic<uint32_t> sequence{0};
+
+		uint32_t validBits[(sensorCount + 31) / 32];
+		// Value of valid sensors
+		float values[sensorCount];
+		// UnexpectedCode of invalid ones
+		uint8_t codes[sensorCount];
+	};
+
+	Bank m_banks[2];
+	std::atomic<uint8_t> m_published{0};
+	std::atomic<bool> m_isCapturing{false};
+
+	bool m_isEnabled = true;
+	bool m_hasCapture = false;
+	uint32_t m_captureCount = 0;
+
+	volatile uint8_t m_scopeDepth = 0;
+	// Thread running the control tick
+	void* volatile m_scopeThread = nullptr;
+
+#if EFI_UNIT_TEST
+	bool m_isIsrContextForTest = false;
+#endif // EFI_UNIT_TEST
+};
+
+SensorSnapshot& getSensorSnapshot();
+
+/**
+ * Sensor::get reads the snapshot while one of these exists.
+ * Create it after the capture, for the duration of the control tick.
+ */
+class SensorSnapshotScope {
+public:
+	SensorSnapshotScope();
+	~SensorSnapshotScope();
+
+private:
+	bool m_isActive;
+	void* m_previousThread;
+};
@@ -10,6 +10,11 @@ public:
 
 	bool acceptFrame(CanBusIndex busIndex, const CANRxFrame& frame) const override;
 
+	// The ID depends on the configuration
+	bool isIdIndexed() const override {
+		return false;
+	}
+
 protected:
 	// Dispatches to one of the three decoders below
 	void decodeFrame(const CANRxFrame& frame, efitick_t nowNt) override;
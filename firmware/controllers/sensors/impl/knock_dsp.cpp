@@ -0,0 +1,109 @@
+#include "pch.h"
+
+#include "knock_dsp.h"
+
+// Resonance modes of a cylinder (1,0), (2,0), (0,1), (3,0), relative to the first one.
+// These are the ratios of the zeros of the Bessel function derivatives.
+static constexpr float modeRatios[KNOCK_BAND_COUNT] = { 1, 3.054f / 1.841f, 3.832f / 1.841f, 4.201f / 1.841f };
+
+// The first band keeps the Q the single filter always had, so existing knock thresholds still apply.
+// The higher modes sit close together and need narrower filters to stay apart.
+static constexpr float modeQ[KNOCK_BAND_COUNT] = { 3, 5, 8, 8 };
+
+void KnockDsp::configure(float sampleRate, float fundamentalHz) {
+	m_bandCount = 0;
+
+	for (size_t i = 0; i < KNOCK_BAND_COUNT; i++) {
+		float frequency = fundamentalHz * modeRatios[i];
+
+		// Same limit as Biquad - the bilinear transform gets too warped past this
+		if (sampleRate < 2.5f * frequency) {
+			break;
+		}
+
+		// Same as Biquad::configureBandpass
+		float K = tanf_taylor(CONST_PI * frequency / sampleRate);
+		float Q = modeQ[i];
+		float norm = 1 / (1 + K / Q + K * K);
+
+		auto& band = m_bands[m_bandCount++];
+		band.frequency = frequency;
+		band.a0 = K / Q * norm;
+		band.b1 = 2 * (K * K - 1) * norm;
+		band.b2 = (1 - K / Q + K * K) * norm;
+	}
+}
+
+void KnockDsp::process(const adcsample_t* samples, size_t count, float voltsPerCount, float (&bandDb)[KNOCK_BAND_COUNT]) const {
+	for (size_t i = 0; i < KNOCK_BAND_COUNT; i++) {
+		bandDb[i] = -100;
+	}
+
+	if (count == 0) {
+		return;
+	}
+
+	// Remove the DC offset up front: a bandpass doesn't care about it, and this way the
+	// filters start out in their steady state instead of ringing from a step.
+	// The single filter this replaced assumed the offset was vcc/2, so a sensor biased
+	// anywhere else used to read higher from that ringing - with the bias on vcc/2 the
+	// result is the same.
+	uint32_t sum = 0;
+	for (size_t i = 0; i < count; i++) {
+		sum += samples[i];
+	}
+
+	float offset = static_cast<float>(sum) / count;
+
+	struct BandState {
+		float z1 = 0;
+		float z2 = 0;
+		float sumSq = 0;
+	};
+
+	BandState states[KNOCK_BAND_COUNT];
+	float chunk[KNOCK_DSP_CHUNK_SIZE];
+
+	for (size_t start = 0; start < count; start += KNOCK_DSP_CHUNK_SIZE) {
+		size_t chunkSize = minI(count - start, KNOCK_DSP_CHUNK_SIZE);
+
+		for (size_t i = 0; i < chunkSize; i++) {
+			chunk[i] = samples[start + i] - offset;
+		}
+
+		for (size_t b = 0; b < m_bandCount; b++) {
+			const auto& band = m_bands[b];
+
+			// Locals so that the compiler keeps them in registers across the loop
+			const float a0 = band.a0;
+			const float b1 = band.b1;
+			const float b2 = band.b2;
+			float z1 = states[b].z1;
+			float z2 = states[b].z2;
+			float sumSq = states[b].sumSq;
+
+			for (size_t i = 0; i < chunkSize; i++) {
+				float x = a0 * chunk[i];
+				float y = x + z1;
+				z1 = z2 - b1 * y;
+				z2 = -x - b2 * y;
+
+				sumSq += y * y;
+			}
+
+			states[b].z1 = z1;
+			states[b].z2 = z2;
+			states[b].sumSq = sumSq;
+		}
+	}
+
+	// Scaling to volts is linear, so it can wait until the very end
+	float scale = voltsPerCount * voltsPerCount / count;
+
+	for (size_t b = 0; b < m_bandCount; b++) {
+		float meanSquares = states[b].sumSq * scale;
+
+		// clamp to reasonable range
+		bandDb[b] = clampF(-100, 10 * log10f(meanSquares), 100);
+	}
+}
@@ -0,0 +1,56 @@
+/**
+ * @file knock_dsp.h
+ *
+ * Knock signal processing for software knock: a bank of bandpass filters, one for each of the
+ * bore's first few resonance modes, run over a whole window of ADC samples at a time.
+ *
+ * Samples are converted to float in small chunks shared by every band, so each sample is converted
+ * once no matter how many bands there are, and each band's inner loop keeps its filter state in registers.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// First circumferential mode plus the next three resonance modes of the combustion chamber
+#define KNOCK_BAND_COUNT 4
+
+// Samples converted per pass through the band filters
+#define KNOCK_DSP_CHUNK_SIZE 64
+
+class KnockDsp {
+public:
+	/**
+	 * @param fundamentalHz frequency of the first mode, the other bands are placed relative to it
+	 */
+	void configure(float sampleRate, float fundamentalHz);
+
+	size_t getBandCount() const {
+		return m_bandCount;
+	}
+
+	float getBandFrequency(size_t band) const {
+		return m_bands[band].frequency;
+	}
+
+	/**
+	 * Mean square energy of each band over the window, in dBv.
+	 * Bands above what the sample rate can resolve report -100.
+	 * @param voltsPerCount ADC scale
+	 */
+	void process(const adcsample_t* samples, size_t count, float voltsPerCount, float (&bandDb)[KNOCK_BAND_COUNT]) const;
+
+private:
+	struct Band {
+		float frequency;
+
+		// Bandpass biquad, the zero coefficients (a1 = 0, a2 = -a0) are implied
+		float a0;
+		float b1;
+		float b2;
+	};
+
+	Band m_bands[KNOCK_BAND_COUNT];
+	size_t m_bandCount = 0;
+};
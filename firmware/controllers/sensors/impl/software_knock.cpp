@@ -1,6 +1,6 @@
 #include "pch.h"
 
-#include "biquad.h"
+#include "knock_dsp.h"
 #include "thread_controller.h"
 #include "knock_logic.h"
 #include "software_knock.h"
@@ -10,15 +10,23 @@
 #include "knock_config.h"
 #include "ch.hpp"
 
-static uint8_t currentCylinderNumber = 0;
-static uint8_t currentChannelIdx = 0;
-static efitick_t lastKnockSampleTime;
-static Biquad knockFilter;
+struct KnockWindow {
+	adcsample_t* samples;
+	size_t sampleCount;
+	uint8_t cylinderNumber;
+	uint8_t channelIdx;
+	efitick_t startTime;
+};
+
+// Ping-pong: one window can be sampled while the other one is being processed
+static KnockWindow knockWindows[KNOCK_WINDOW_COUNT];
+static chibios_rt::Mailbox<KnockWindow*, KNOCK_WINDOW_COUNT> freeWindows;
+static chibios_rt::Mailbox<KnockWindow*, KNOCK_WINDOW_COUNT> filledWindows;
 
-static bool knockNeedsProcess = false;
-static size_t sampleCount = 0;
+// Window the ADC is filling right now
+static KnockWindow* samplingWindow = nullptr;
 
-chibios_rt::BinarySemaphore knockSem(/* taken =*/ true);
+static KnockDsp knockDsp;
 
 static NamedOutputPin knockSnifferPin("knock window", "kn");
 
@@ -26,11 +34,12 @@ static NamedOutputPin knockSnifferPin("knock window", "kn");
 void onKnockSamplingComplete() {
 	knockSnifferPin.setLow();
 
-	knockNeedsProcess = true;
-
-	// Notify the processing thread that it's time to process this sample
+	// Hand the window to the processing thread
 	chSysLockFromISR();
-	knockSem.signalI();
+	if (samplingWindow) {
+		filledWindows.postI(samplingWindow);
+		samplingWindow = nullptr;
+	}
 	chSysUnlockFromISR();
 }
 
@@ -47,28 +56,32 @@ void onStartKnockSampling(uint8_t cylinderNumber, float samplingSeconds, uint8_t
 		return;
 	}
 
-	// If there's pending processing, skip this event
-	if (knockNeedsProcess) {
+	// Still marked as sampling while the ADC is idle means that conversion failed, so just reuse the window.
+	// Otherwise only skip this event if both windows are still waiting to be processed.
+	KnockWindow* window = samplingWindow;
+	if (!window && freeWindows.fetchI(&window) != MSG_OK) {
 		return;
 	}
 
 	// Convert sampling time to number of samples
 	constexpr int sampleRate = KNOCK_SAMPLE_RATE;
-	sampleCount = 0xFFFFFFFE & static_cast<size_t>(clampF(100, samplingSeconds * sampleRate, efi::size(knockSampleBuffer)));
+	window->sampleCount = 0xFFFFFFFE & static_cast<size_t>(clampF(100, samplingSeconds * sampleRate, efi::size(knockSampleBuffer[0])));
 
 	// Select the appropriate conversion group - it will differ depending on which sensor this cylinder should listen on
 	auto conversionGroup = getKnockConversionGroup(channelIdx);
 
 	// Stash the current cylinder's number so we can store the result appropriately
-	currentCylinderNumber = cylinderNumber;
-	currentChannelIdx = channelIdx;
+	window->cylinderNumber = cylinderNumber;
+	window->channelIdx = channelIdx;
+	samplingWindow = window;
 
-	adcStartConversionI(&KNOCK_ADC, conversionGroup, knockSampleBuffer, sampleCount);
-	lastKnockSampleTime = getTimeNowNt();
+	adcStartConversionI(&KNOCK_ADC, conversionGroup, window->samples, window->sampleCount);
+	window->startTime = getTimeNowNt();
 	knockSnifferPin.setHigh();
 }
 
-class KnockThread : public ThreadController<256> {
+// Room for the DSP's chunk of converted samples
+class KnockThread : public ThreadController<512> {
 public:
 	KnockThread() : ThreadController("knock", PRIO_KNOCK_PROCESS) {}
 	void ThreadTask() override;
@@ -99,9 +112,16 @@ void initSoftwareKnock() {
 			freqKhz = 1140.0f / bore;
 		}
 
-		efiPrintf("Knock sense configuring filter with frequency %.2f khz", freqKhz);
+		knockDsp.configure(KNOCK_SAMPLE_RATE, 1000 * freqKhz);
+
+		for (size_t i = 0; i < knockDsp.getBandCount(); i++) {
+			efiPrintf("Knock sense band %d: %.2f khz", i, knockDsp.getBandFrequency(i) / 1000);
+		}
 
-		knockFilter.configureBandpass(KNOCK_SAMPLE_RATE, 1000 * freqKhz, 3);
+		for (size_t i = 0; i < KNOCK_WINDOW_COUNT; i++) {
+			knockWindows[i].samples = knockSampleBuffer[i];
+			freeWindows.post(&knockWindows[i], TIME_INFINITE);
+		}
 
 		efiSetPadMode("knock ch1", KNOCK_PIN_CH1, PAL_MODE_INPUT_ANALOG);
 #if KNOCK_HAS_CH2		
@@ -111,57 +131,32 @@ void initSoftwareKnock() {
 	}
 }
 
-static void processLastKnockEvent() {
-	if (!knockNeedsProcess) {
-		return;
-	}
-
-	float sumSq = 0;
-
-	float vcc = engineConfiguration->adcVcc;
-
+static void processKnockWindow(const KnockWindow& window) {
 	// Ratio in units of volts per ADC count
-	float ratio = vcc / ADC_MAX_VALUE;
+	float ratio = engineConfiguration->adcVcc / ADC_MAX_VALUE;
 
-	size_t localCount = sampleCount;
+	float bandDb[KNOCK_BAND_COUNT];
+	knockDsp.process(window.samples, window.sampleCount, ratio, bandDb);
 
-	// Prepare the steady state at vcc/2 so that there isn't a step
-	// when samples begin
-	knockFilter.cookSteadyState(vcc / 2);
+	auto knock = engine->module<KnockController>();
+	knock->onKnockBandsSensed(window.cylinderNumber, bandDb);
 
-	// Compute the sum of squares
-	for (size_t i = 0; i < localCount; i++) {
-		float volts = ratio * knockSampleBuffer[i];
-
-		float filtered = knockFilter.filter(volts);
-
-		sumSq += filtered * filtered;
-	}
-
-	// take a local copy
-	auto lastKnockTime = lastKnockSampleTime;
-
-	// We're done with inspecting the buffer, another sample can be taken
-	knockNeedsProcess = false;
-
-	// mean of squares (not yet root)
-	float meanSquares = sumSq / localCount;
-
-	// RMS
-	float db = 10 * log10(meanSquares);
-
-	// clamp to reasonable range
-	db = clampF(-100, db, 100);
-
-	engine->module<KnockController>()->onKnockSenseCompleted(currentCylinderNumber, currentChannelIdx, db, lastKnockTime);
+	// The first band is the one knock detection runs on
+	knock->onKnockSenseCompleted(window.cylinderNumber, window.channelIdx, bandDb[0], window.startTime);
 }
 
 void KnockThread::ThreadTask() {
 	while (1) {
-		knockSem.wait();
+		KnockWindow* window;
+		filledWindows.fetch(&window, TIME_INFINITE);
+
+		{
+			ScopePerf perf(PE::SoftwareKnockProcess);
+			processKnockWindow(*window);
+		}
 
-		ScopePerf perf(PE::SoftwareKnockProcess);
-		processLastKnockEvent();
+		// Done with the samples, the ADC can have this window again
+		freeWindows.post(window, TIME_INFINITE);
 	}
 }
 
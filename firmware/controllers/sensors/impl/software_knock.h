@@ -6,4 +6,8 @@
 void initSoftwareKnock();
 void knockSamplingCallback(uint8_t cylinderIndex, efitick_t nowNt);
 
-extern adcsample_t knockSampleBuffer[2048];
+// Two windows, so that a cylinder can be sampled while the previous one is processed
+#define KNOCK_WINDOW_COUNT 2
+#define KNOCK_WINDOW_SIZE 2048
+
+extern adcsample_t knockSampleBuffer[KNOCK_WINDOW_COUNT][KNOCK_WINDOW_SIZE];
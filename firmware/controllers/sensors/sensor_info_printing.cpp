@@ -8,6 +8,7 @@
 #include "resistance_func.h"
 #include "thermistor_func.h"
 #include "identity_func.h"
+#include "compiled_func.h"
 
 void ProxySensor::showInfo(const char* sensorName) const {
 	efiPrintf("Sensor \"%s\" proxied from sensor \"%s\"", sensorName, getSensorName(m_proxiedSensor));
@@ -25,11 +26,17 @@ void FunctionalSensor::showInfo(const char* sensorName) const {
 
 #if EFI_CAN_SUPPORT || EFI_UNIT_TEST
 #include "can_sensor.h"
+#include "can_rx_signals.h"
 
 void CanSensorBase::showInfo(const char* sensorName) const {
 	const auto value = get();
 	efiPrintf("CAN Sensor \"%s\": valid: %s value: %.2f", sensorName, boolToString(value.Valid), value.Value);
 }
+
+void CanRxSignalSensor::showInfo(const char* sensorName) const {
+	const auto value = get();
+	efiPrintf("CAN RX signal \"%s\" from ID %x: valid: %s value: %.2f", sensorName, canId, boolToString(value.Valid), value.Value);
+}
 #endif // EFI_CAN_SUPPORT
 
 void RedundantSensor::showInfo(const char* sensorName) const {
@@ -82,3 +89,17 @@ void ThermistorFunc::showInfo(float testInputValue) const {
 void IdentityFunction::showInfo(float /*testInputValue*/) const {
 	efiPrintf("    Identity function passes along value.");
 }
+
+void CompiledFunc::showInfo(float testInputValue) const {
+	if (size_t size = getSize()) {
+		efiPrintf("    Lookup table of %d points from %.3f step %.4f: max error %.4f at %.3f, mean %.5f, %d validity mismatches",
+			(int)size, m_minInput, m_step,
+			m_accuracy.maxError, m_accuracy.maxErrorInput, m_accuracy.meanError, (int)m_accuracy.validityMismatchCount);
+	} else if (m_requestedSize) {
+		efiPrintf("    No room for a lookup table of %d points", (int)m_requestedSize);
+	}
+
+	if (m_source) {
+		m_source->showInfo(testInputValue);
+	}
+}
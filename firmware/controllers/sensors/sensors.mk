@@ -2,6 +2,7 @@
 CONTROLLERS_SENSORS_SRC_CPP = \
 	$(PROJECT_DIR)/controllers/sensors/core/functional_sensor.cpp \
 	$(PROJECT_DIR)/controllers/sensors/core/sensor.cpp \
+	$(PROJECT_DIR)/controllers/sensors/core/sensor_snapshot.cpp \
  	$(PROJECT_DIR)/controllers/sensors/thermistors.cpp \
 	$(PROJECT_DIR)/controllers/sensors/allsensors.cpp \
 	$(PROJECT_DIR)/controllers/sensors/impl/AemXSeriesLambda.cpp \
@@ -15,10 +16,12 @@ CONTROLLERS_SENSORS_SRC_CPP = \
 	$(PROJECT_DIR)/controllers/sensors/frequency_sensor.cpp \
 	$(PROJECT_DIR)/controllers/sensors/hella_oil_level.cpp \
 	$(PROJECT_DIR)/controllers/sensors/impl/software_knock.cpp \
+	$(PROJECT_DIR)/controllers/sensors/impl/knock_dsp.cpp \
 	$(PROJECT_DIR)/controllers/sensors/converters/linear_func.cpp \
 	$(PROJECT_DIR)/controllers/sensors/converters/resistance_func.cpp \
 	$(PROJECT_DIR)/controllers/sensors/converters/thermistor_func.cpp \
 	$(PROJECT_DIR)/controllers/sensors/converters/identity_func.cpp \
+	$(PROJECT_DIR)/controllers/sensors/converters/compiled_func.cpp \
 	$(PROJECT_DIR)/controllers/sensors/vr_pwm.cpp
 
 
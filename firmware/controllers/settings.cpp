@@ -112,6 +112,7 @@ static void setDebugMode(int value) {
 static void setWholeTimingMapCmd(float value) {
 	efiPrintf("Setting whole timing advance map to %.2f", value);
 	setWholeTimingTable(value);
+	configurationWriteCounter++;
 	engine->resetEngineSnifferIfInTestMode();
 }
 
@@ -442,6 +443,7 @@ static void setValue(const char *paramStr, const char *valueStr) {
 		setDateTime(valueStr);
 	}
 
+	configurationWriteCounter++;
 	engine->resetEngineSnifferIfInTestMode();
 }
 
@@ -148,20 +148,25 @@ EnginePins::EnginePins() :
 	static_assert(efi::size(sparkNames) >= MAX_CYLINDER_COUNT, "Too many ignition pins");
 	static_assert(efi::size(trailNames) >= MAX_CYLINDER_COUNT, "Too many ignition pins");
 	static_assert(efi::size(injectorNames) >= MAX_CYLINDER_COUNT, "Too many injection pins");
+	static_assert(MAX_CYLINDER_COUNT <= 0x10, "Too many cylinders for engine sniffer channels");
 	for (int i = 0; i < MAX_CYLINDER_COUNT; i++) {
 		enginePins.coils[i].setName(sparkNames[i]);
 		enginePins.coils[i].shortName = sparkShortNames[i];
+		enginePins.coils[i].engineSnifferChannel = engineSnifferChannel(EngineSnifferChannel::Coil1, i);
 
 		enginePins.trailingCoils[i].setName(trailNames[i]);
 		enginePins.trailingCoils[i].shortName = trailShortNames[i];
+		enginePins.trailingCoils[i].engineSnifferChannel = engineSnifferChannel(EngineSnifferChannel::TrailingCoil1, i);
 
 		enginePins.injectors[i].injectorIndex = i;
 		enginePins.injectors[i].setName(injectorNames[i]);
 		enginePins.injectors[i].shortName = injectorShortNames[i];
+		enginePins.injectors[i].engineSnifferChannel = engineSnifferChannel(EngineSnifferChannel::Injector1, i);
 
 		enginePins.injectorsStage2[i].injectorIndex = i;
 		enginePins.injectorsStage2[i].setName(injectorStage2Names[i]);
 		enginePins.injectorsStage2[i].shortName = injectorStage2ShortNames[i];
+		enginePins.injectorsStage2[i].engineSnifferChannel = engineSnifferChannel(EngineSnifferChannel::InjectorStage2_1, i);
 	}
 }
 
@@ -422,13 +427,17 @@ void OutputPin::setValue(int logicValue) {
 			setOnchipValue(electricalValue);
 		} else {
 			/* external pin */
-			gpiochips_writePad(m_brainPin, logicValue);
+			m_extPin.writePad(logicValue);
 			/* TODO: check return value */
 		}
 	#else
 		setOnchipValue(electricalValue);
 	#endif
 #else /* EFI_PROD_CODE */
+	#if (BOARD_EXT_GPIOCHIPS > 0)
+		// Tests may register a chip for the pin
+		m_extPin.writePad(logicValue);
+	#endif
 	setMockState(m_brainPin, electricalValue);
 #endif /* EFI_PROD_CODE */
 }
@@ -527,6 +536,11 @@ void OutputPin::initPin(const char *msg, brain_pin_e brainPin, pin_output_mode_e
 	#endif
 #endif // briefly leave the include guard because we need to set default state in tests
 
+#if (BOARD_EXT_GPIOCHIPS > 0)
+	// Don't search for the chip on every write
+	m_extPin = gpiochips_findPin(brainPin);
+#endif
+
 	m_brainPin = brainPin;
 
 	// The order of the next two calls may look strange, which is a good observation.
@@ -574,6 +588,7 @@ void OutputPin::deInit() {
 
 #if (BOARD_EXT_GPIOCHIPS > 0)
 	ext = false;
+	m_extPin = {};
 #endif // (BOARD_EXT_GPIOCHIPS > 0)
 
 	efiPrintf("unregistering %s", hwPortname(m_brainPin));
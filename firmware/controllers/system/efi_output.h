@@ -5,6 +5,8 @@
 
 #include "io_pins.h"
 #include "smart_gpio.h"
+#include "drivers/gpio/gpio_ext.h"
+#include "engine_sniffer_binary.h"
 
 #pragma once
 
@@ -50,6 +52,8 @@ public:
 #if (BOARD_EXT_GPIOCHIPS > 0)
 	/* used for external pins */
 	bool ext = false;
+	/* chip of the external pin, looked up on init */
+	GpioChipPin m_extPin;
 #endif /* BOARD_EXT_GPIOCHIPS */
 
 	int8_t m_currentLogicValue = INITIAL_PIN_STATE;
@@ -88,6 +92,9 @@ public:
 	 */
 	const char* shortName = nullptr;
 
+	// Binary engine sniffer equivalent of the short name
+	EngineSnifferChannel engineSnifferChannel = EngineSnifferChannel::OtherOutput;
+
 private:
 	const char* m_name = nullptr;
 };
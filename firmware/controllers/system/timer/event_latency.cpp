@@ -0,0 +1,129 @@
+/**
+ * @file event_latency.cpp
+ *
+ * maxEventCallbackDuration tells us how long the slowest callback took, but not how far
+ * from the requested time our outputs actually switch. This records exactly that, for every
+ * action executed by the event queue, cheaply enough to be always on.
+ */
+
+#include "pch.h"
+
+#include "event_latency.h"
+#include "spark_logic.h"
+
+static EventLatencyTracker eventLatencyTracker;
+
+EventLatencyTracker& getEventLatencyTracker() {
+	return eventLatencyTracker;
+}
+
+int getEventLatencyBucket(uint32_t latencyUs) {
+	if (latencyUs == 0) {
+		return 0;
+	}
+
+	// 1us -> 1, 2-3us -> 2, 4-7us -> 3, etc
+	int bucket = 32 - __builtin_clz(latencyUs);
+
+	return minI(bucket, EVENT_LATENCY_BUCKETS - 1);
+}
+
+void EventLatencyHistogram::add(uint32_t latencyUs) {
+	counts[getEventLatencyBucket(latencyUs)]++;
+	total++;
+	maxUs = maxI(maxUs, latencyUs);
+}
+
+void EventLatencyHistogram::reset() {
+	*this = {};
+}
+
+EventLatencyType getEventLatencyType(schfunc_t callback) {
+#if EFI_ENGINE_CONTROL
+	if (callback == bit_cast<schfunc_t>(&turnSparkPinHigh)) {
+		return EventLatencyType::SparkCharge;
+	} else if (callback == bit_cast<schfunc_t>(&fireSparkAndPrepareNextSchedule)) {
+		return EventLatencyType::SparkFire;
+	} else if (callback == bit_cast<schfunc_t>(&startInjection)) {
+		return EventLatencyType::InjectorOpen;
+	} else if (callback == bit_cast<schfunc_t>(&endInjection) || callback == bit_cast<schfunc_t>(&endInjectionStage2)) {
+		return EventLatencyType::InjectorClose;
+	}
+#else
+	(void)callback;
+#endif // EFI_ENGINE_CONTROL
+
+	return EventLatencyType::Other;
+}
+
+void EventLatencyTracker::record(schfunc_t callback, efidur_t latencyNt) {
+	// The unit test executor may run events with a "now" before the scheduled time
+	uint32_t latencyUs = latencyNt.count() > 0 ? NT2US(latencyNt.count()) : 0;
+
+	m_histograms[static_cast<size_t>(getEventLatencyType(callback))].add(latencyUs);
+}
+
+void EventLatencyTracker::reset() {
+	for (auto& histogram : m_histograms) {
+		histogram.reset();
+	}
+}
+
+const EventLatencyHistogram& EventLatencyTracker::get(EventLatencyType type) const {
+	return m_histograms[static_cast<size_t>(type)];
+}
+
+static void copyHistogram(uint16_t (&counts)[EVENT_LATENCY_BUCKETS], uint16_t& maxUs, const EventLatencyHistogram& histogram) {
+	for (size_t i = 0; i < EVENT_LATENCY_BUCKETS; i++) {
+		counts[i] = minI(histogram.counts[i], UINT16_MAX);
+	}
+
+	maxUs = minI(histogram.maxUs, UINT16_MAX);
+}
+
+void updateEventLatencyOutputChannels() {
+#if EFI_TUNER_STUDIO
+	auto& oc = engine->outputChannels;
+
+	copyHistogram(oc.sparkChargeLatency, oc.sparkChargeLatencyMax, eventLatencyTracker.get(EventLatencyType::SparkCharge));
+	copyHistogram(oc.sparkFireLatency, oc.sparkFireLatencyMax, eventLatencyTracker.get(EventLatencyType::SparkFire));
+	copyHistogram(oc.injectorOpenLatency, oc.injectorOpenLatencyMax, eventLatencyTracker.get(EventLatencyType::InjectorOpen));
+	copyHistogram(oc.injectorCloseLatency, oc.injectorCloseLatencyMax, eventLatencyTracker.get(EventLatencyType::InjectorClose));
+#endif // EFI_TUNER_STUDIO
+}
+
+static const char* getEventLatencyTypeName(EventLatencyType type) {
+	switch (type) {
+		case EventLatencyType::SparkCharge: return "spark charge";
+		case EventLatencyType::SparkFire: return "spark fire";
+		case EventLatencyType::InjectorOpen: return "injector open";
+		case EventLatencyType::InjectorClose: return "injector close";
+		default: return "other";
+	}
+}
+
+static_assert(EVENT_LATENCY_BUCKETS == 8, "printEventLatency prints exactly 8 buckets");
+
+static void printEventLatency() {
+	efiPrintf("Event latency histograms, bucket N is [2^(N-1), 2^N) us late");
+
+	for (size_t i = 0; i < static_cast<size_t>(EventLatencyType::Count); i++) {
+		auto type = static_cast<EventLatencyType>(i);
+		const auto& h = eventLatencyTracker.get(type);
+
+		efiPrintf("%-14s total=%lu max=%luus <1:%lu 1:%lu 2:%lu 4:%lu 8:%lu 16:%lu 32:%lu 64+:%lu",
+			getEventLatencyTypeName(type), h.total, h.maxUs,
+			h.counts[0], h.counts[1], h.counts[2], h.counts[3],
+			h.counts[4], h.counts[5], h.counts[6], h.counts[7]);
+	}
+}
+
+static void resetEventLatency() {
+	chibios_rt::CriticalSectionLocker csl;
+	eventLatencyTracker.reset();
+}
+
+void initEventLatency() {
+	addConsoleAction("latency", printEventLatency);
+	addConsoleAction("resetlatency", resetEventLatency);
+}
@@ -0,0 +1,57 @@
+/**
+ * @file event_latency.h
+ *
+ * Keeps log2 histograms of how late each scheduled action actually ran compared to
+ * the time it was scheduled for, split by the kind of output being driven.
+ */
+
+#pragma once
+
+#include "scheduler.h"
+
+#define EVENT_LATENCY_BUCKETS 8
+
+enum class EventLatencyType : uint8_t {
+	SparkCharge,
+	SparkFire,
+	InjectorOpen,
+	InjectorClose,
+	// pwm, map averaging, hpfp, trailing spark, etc
+	Other,
+
+	Count
+};
+
+/**
+ * Bucket 0 counts events less than 1us late, bucket N counts [2^(N-1), 2^N) us late.
+ * The last bucket also collects everything later than that.
+ */
+int getEventLatencyBucket(uint32_t latencyUs);
+
+struct EventLatencyHistogram {
+	void add(uint32_t latencyUs);
+	void reset();
+
+	uint32_t counts[EVENT_LATENCY_BUCKETS] = {};
+	uint32_t total = 0;
+	uint32_t maxUs = 0;
+};
+
+class EventLatencyTracker {
+public:
+	// Called by the event queue right before executing an action, under lock
+	void record(schfunc_t callback, efidur_t latencyNt);
+	void reset();
+
+	const EventLatencyHistogram& get(EventLatencyType type) const;
+
+private:
+	EventLatencyHistogram m_histograms[static_cast<size_t>(EventLatencyType::Count)];
+};
+
+EventLatencyType getEventLatencyType(schfunc_t callback);
+
+EventLatencyTracker& getEventLatencyTracker();
+
+void updateEventLatencyOutputChannels();
+void initEventLatency();
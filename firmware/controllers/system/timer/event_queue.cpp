@@ -1,9 +1,9 @@
 /**
  * @file event_queue.cpp
  * This is a data structure which keeps track of all pending events
- * Implemented as a linked list, which is fine since the number of
- * pending events is pretty low
- * todo: MAYBE migrate to a better data structure, but that's low priority
+ * Implemented as an intrusive binary heap: every scheduling_s knows its own position
+ * so insert, remove and pop are all O(log n) regardless of how deep the queue gets.
+ * Ties on momentX are broken by insertion order.
  *
  * this data structure is NOT thread safe
  *
@@ -14,9 +14,9 @@
 #include "pch.h"
 
 #include "event_queue.h"
+#include "event_latency.h"
 #include "efitime.h"
 #include "pool_allocator.h"
-#include "utlist.h"
 
 #if EFI_UNIT_TEST
 extern bool verboseMode;
@@ -26,8 +26,79 @@ EventQueue::EventQueue(efidur_t lateDelay)
 	: m_lateDelay(lateDelay)
 { }
 
+static bool isBefore(const scheduling_s* a, const scheduling_s* b) {
+	if (a->momentX != b->momentX) {
+		return a->momentX < b->momentX;
+	}
+
+	// Same timestamp: whoever was inserted first runs first (wrap-safe compare)
+	return static_cast<int32_t>(a->sequence - b->sequence) < 0;
+}
+
+void EventQueue::place(int index, scheduling_s* scheduling) {
+	m_heap[index] = scheduling;
+	scheduling->heapIndex = index;
+}
+
+void EventQueue::siftUp(int index) {
+	scheduling_s* item = m_heap[index];
+
+	while (index > 0) {
+		int parent = (index - 1) / 2;
+		if (!isBefore(item, m_heap[parent])) {
+			break;
+		}
+
+		// move the parent down in to the hole
+		place(index, m_heap[parent]);
+		index = parent;
+	}
+
+	place(index, item);
+}
+
+void EventQueue::siftDown(int index) {
+	scheduling_s* item = m_heap[index];
+
+	while (true) {
+		int child = 2 * index + 1;
+		if (child >= m_size) {
+			break;
+		}
+
+		// pick the sooner of the two children
+		if (child + 1 < m_size && isBefore(m_heap[child + 1], m_heap[child])) {
+			child++;
+		}
+
+		if (!isBefore(m_heap[child], item)) {
+			break;
+		}
+
+		// move the child up in to the hole
+		place(index, m_heap[child]);
+		index = child;
+	}
+
+	place(index, item);
+}
+
+void EventQueue::removeAt(int index) {
+	m_size--;
+
+	if (index == m_size) {
+		// removed the last element, nothing to fix up
+		return;
+	}
+
+	// fill the hole with the last element, then restore heap order in whichever direction it's broken
+	place(index, m_heap[m_size]);
+	siftDown(index);
+	siftUp(index);
+}
+
 /**
- * @return true if inserted into the head of the list
+ * @return true if inserted into the head of the queue
  */
 bool EventQueue::insertTask(scheduling_s* scheduling, efitick_t timeX, action_s action) {
 	ScopePerf perf(PE::EventQueueInsertTask);
@@ -45,7 +116,7 @@ bool EventQueue::insertTask(scheduling_s* scheduling, efitick_t timeX, action_s
 		}
 	}
 
-	assertListIsSorted();
+	assertHeapIsValid();
 	efiAssert(ObdCode::CUSTOM_ERR_ASSERT, action.getCallback() != nullptr, "NULL callback", false);
 
 	if (scheduling->action) {
@@ -58,73 +129,51 @@ bool EventQueue::insertTask(scheduling_s* scheduling, efitick_t timeX, action_s
 		return false;
 	}
 
+	if (m_size >= EVENT_QUEUE_CAPACITY) {
+		firmwareError(ObdCode::CUSTOM_ERR_LOOPED_QUEUE, "EventQueue overflow %d", m_size);
+		m_schedulingPool.tryReturn(scheduling);
+		return false;
+	}
+
 	scheduling->momentX = timeX;
+	scheduling->sequence = m_sequence++;
 	scheduling->action = action;
 
-	if (!m_head || timeX < m_head->momentX) {
-		// here we insert into head of the linked list
-		LL_PREPEND2(m_head, scheduling, next);
-		assertListIsSorted();
-		return true;
-	} else {
-		// here we know we are not in the head of the list, let's find the position - linear search
-		scheduling_s* insertPosition = m_head;
-		while (insertPosition->next && insertPosition->next->momentX < timeX) {
-			insertPosition = insertPosition->next;
-		}
+	place(m_size, scheduling);
+	m_size++;
+	siftUp(m_size - 1);
 
-		scheduling->next = insertPosition->next;
-		insertPosition->next = scheduling;
-		assertListIsSorted();
-		return false;
-	}
+	assertHeapIsValid();
+	return scheduling->heapIndex == 0;
 }
 
 void EventQueue::remove(scheduling_s* scheduling) {
-	assertListIsSorted();
+	assertHeapIsValid();
 
 	// Special case: event isn't scheduled, so don't cancel it
 	if (!scheduling->action) {
 		return;
 	}
 
-	// Special case: empty list, nothing to do
-	if (!m_head) {
+	// Special case: empty queue, nothing to do
+	if (m_size == 0) {
 		return;
 	}
 
-	// Special case: is the item to remove at the head?
-	if (scheduling == m_head) {
-		m_head = m_head->next;
-		scheduling->next = nullptr;
-		scheduling->action = {};
-	} else {
-		auto prev = m_head;	// keep track of the element before the one to remove, so we can link around it
-		auto current = prev->next;
-
-		// Find our element
-		while (current && current != scheduling) {
-			prev = current;
-			current = current->next;
-		}
-
-		// Walked off the end, this is an error since this *should* have been scheduled
-		if (!current) {
-			firmwareError("EventQueue::remove didn't find element");
-			return;
-		}
+	int index = scheduling->heapIndex;
 
-		efiAssertVoid(ObdCode::OBD_PCM_Processor_Fault, current == scheduling, "current not equal to scheduling");
+	// The element should be where it says it is, otherwise it was never scheduled on this queue
+	if (index >= m_size || m_heap[index] != scheduling) {
+		firmwareError("EventQueue::remove didn't find element");
+		return;
+	}
 
-		// Link around the removed item
-		prev->next = current->next;
+	removeAt(index);
 
-		// Clean the item to remove
-		current->next = nullptr;
-		current->action = {};
-	}
+	// Clean the item to remove
+	scheduling->action = {};
 
-	assertListIsSorted();
+	assertHeapIsValid();
 }
 
 /**
@@ -134,8 +183,8 @@ void EventQueue::remove(scheduling_s* scheduling) {
  * @return Get the timestamp of the soonest pending action, skipping all the actions in the past
  */
 expected<efitick_t> EventQueue::getNextEventTime(efitick_t nowX) const {
-	if (m_head) {
-		if (m_head->momentX <= nowX) {
+	if (m_size > 0) {
+		if (m_heap[0]->momentX <= nowX) {
 			/**
 			 * We are here if action timestamp is in the past. We should rarely be here since this 'getNextEventTime()' is
 			 * always invoked by 'scheduleTimerCallback' which is always invoked right after 'executeAllPendingActions' - but still,
@@ -146,7 +195,7 @@ expected<efitick_t> EventQueue::getNextEventTime(efitick_t nowX) const {
 			 */
 			return efitick_t{nowX + m_lateDelay};
 		} else {
-			return m_head->momentX;
+			return m_heap[0]->momentX;
 		}
 	}
 
@@ -167,7 +216,7 @@ int EventQueue::executeAll(efitick_t now) {
 
 	int executionCounter = 0;
 
-	assertListIsSorted();
+	assertHeapIsValid();
 
 	bool didExecute;
 	do {
@@ -179,15 +228,15 @@ int EventQueue::executeAll(efitick_t now) {
 }
 
 bool EventQueue::executeOne(efitick_t now) {
-	// Read the head every time - a previously executed event could
-	// have inserted something new at the head
-	scheduling_s* current = m_head;
-
 	// Queue is empty - bail
-	if (!current) {
+	if (m_size == 0) {
 		return false;
 	}
 
+	// Read the head every time - a previously executed event could
+	// have inserted something new at the head
+	scheduling_s* current = m_heap[0];
+
 	// If the next event is far in the future, we'll reschedule
 	// and execute it next time.
 	// We do this when the next event is close enough that the overhead of
@@ -201,18 +250,21 @@ bool EventQueue::executeOne(efitick_t now) {
 	// near future - spin wait for the event to happen and avoid the
 	// overhead of rescheduling the timer.
 	// yes, that's a busy wait but that's what we need here
-	while (current->momentX > getTimeNowNt()) {
+	efitick_t executeNt = getTimeNowNt();
+	while (current->momentX > executeNt) {
 		UNIT_TEST_BUSY_WAIT_CALLBACK();
+		executeNt = getTimeNowNt();
 	}
 
-	// step the head forward, unlink this element, clear scheduled flag
-	m_head = current->next;
-	current->next = nullptr;
+	// pop the head, clear scheduled flag
+	removeAt(0);
 
 	// Grab the action but clear it in the event so we can reschedule from the action's execution
 	auto action = current->action;
 	current->action = {};
 
+	getEventLatencyTracker().record(action.getCallback(), executeNt - current->momentX);
+
 	m_schedulingPool.tryReturn(current);
 #if EFI_PROD_CODE
 	getTunerStudioOutputChannels()->schedulingUsedCount = m_schedulingPool.used();
@@ -220,7 +272,9 @@ bool EventQueue::executeOne(efitick_t now) {
 	current = nullptr;
 
 #if EFI_UNIT_TEST
-	printf("QUEUE: execute current=%d param=%d\r\n", (uintptr_t)current, (uintptr_t)action.getArgument());
+	if (verboseMode) {
+		printf("QUEUE: execute current=%d param=%d\r\n", (uintptr_t)current, (uintptr_t)action.getArgument());
+	}
 #endif
 
 	// Execute the current element
@@ -229,40 +283,46 @@ bool EventQueue::executeOne(efitick_t now) {
 		action.execute();
 	}
 
-	assertListIsSorted();
+	assertHeapIsValid();
 	return true;
 }
 
 int EventQueue::size() const {
-	scheduling_s* tmp;
-	int result;
-	LL_COUNT2(m_head, tmp, result, next);
-	return result;
+	return m_size;
 }
 
-void EventQueue::assertListIsSorted() const {
+void EventQueue::assertHeapIsValid() const {
 #if EFI_UNIT_TEST || EFI_SIMULATOR
-	scheduling_s* current = m_head;
-	while (current && current->next) {
-		efiAssertVoid(ObdCode::CUSTOM_ERR_6623, current->momentX <= current->next->momentX, "list order");
-		current = current->next;
+	for (int i = 0; i < m_size; i++) {
+		efiAssertVoid(ObdCode::CUSTOM_ERR_6623, m_heap[i]->heapIndex == i, "heap index");
+
+		if (i > 0) {
+			efiAssertVoid(ObdCode::CUSTOM_ERR_6623, !isBefore(m_heap[i], m_heap[(i - 1) / 2]), "heap order");
+		}
 	}
 #endif // EFI_UNIT_TEST || EFI_SIMULATOR
 }
 
 scheduling_s* EventQueue::getHead() {
-	return m_head;
+	return m_size > 0 ? m_heap[0] : nullptr;
 }
 
 // todo: reduce code duplication with another 'getElementAtIndexForUnitText'
 scheduling_s* EventQueue::getElementAtIndexForUnitText(int index) {
-	scheduling_s* current;
+	// The heap isn't sorted, so find the element with exactly 'index' elements ahead of it.
+	// O(size^2) but this is only for tests.
+	for (int i = 0; i < m_size; i++) {
+		int ahead = 0;
+
+		for (int j = 0; j < m_size; j++) {
+			if (isBefore(m_heap[j], m_heap[i])) {
+				ahead++;
+			}
+		}
 
-	LL_FOREACH2(m_head, current, next)
-	{
-		if (index == 0)
-			return current;
-		index--;
+		if (ahead == index) {
+			return m_heap[i];
+		}
 	}
 
 	return nullptr;
@@ -270,16 +330,13 @@ scheduling_s* EventQueue::getElementAtIndexForUnitText(int index) {
 
 void EventQueue::clear() {
 	// Flush the queue, resetting all scheduling_s as though we'd executed them
-	while(m_head) {
-		auto x = m_head;
-		// link next element to head
-		m_head = x->next;
+	for (int i = 0; i < m_size; i++) {
+		auto x = m_heap[i];
 
 		// Reset this element
 		x->momentX = {};
-		x->next = nullptr;
 		x->action = {};
 	}
 
-	m_head = nullptr;
+	m_size = 0;
 }
@@ -13,8 +13,13 @@
 
 #define QUEUE_LENGTH_LIMIT 1000
 
+#ifndef EVENT_QUEUE_CAPACITY
+// 64 pooled schedulings plus the statically owned ones (ignition, injection, pwm, etc)
+#define EVENT_QUEUE_CAPACITY 160
+#endif
+
 /**
- * Execution sorted linked list
+ * Execution queue, implemented as an intrusive binary min-heap ordered by (momentX, insertion order)
  */
 class EventQueue {
 public:
@@ -24,9 +29,12 @@ public:
 	explicit EventQueue(efidur_t lateDelay = {});
 
 	/**
-	 * O(size) - linear search in sorted linked list
+	 * O(log size)
 	 */
 	bool insertTask(scheduling_s *scheduling, efitick_t timeX, action_s action);
+	/**
+	 * O(log size) - the element knows its own heap position, no search required
+	 */
 	void remove(scheduling_s* scheduling);
 
 	int executeAll(efitick_t now);
@@ -41,11 +49,20 @@ public:
 	scheduling_s* getFreeScheduling();
 	void tryReturnScheduling(scheduling_s* sched);
 private:
-	void assertListIsSorted() const;
+	void assertHeapIsValid() const;
+
+	void removeAt(int index);
+	void place(int index, scheduling_s* scheduling);
+	void siftUp(int index);
+	void siftDown(int index);
+
 	/**
-	 * this list is sorted
+	 * m_heap[0] is always the soonest event
 	 */
-	scheduling_s *m_head = nullptr;
+	scheduling_s* m_heap[EVENT_QUEUE_CAPACITY];
+	int m_size = 0;
+	uint32_t m_sequence = 0;
+
 	const efidur_t m_lateDelay;
 
 	PoolAllocator<scheduling_s, 64> m_schedulingPool;
@@ -67,9 +67,15 @@ struct scheduling_s {
 	// timestamp represented as 64-bit value of ticks since MCU start
 	efitick_t momentX;
 
-	// Scheduler implementation uses a sorted linked list of these scheduling records.
+	// Used by the scheduling pool free list, not by the queue itself.
 	scheduling_s *next = nullptr;
 
+	// Insertion order, used to run events with identical momentX in FIFO order
+	uint32_t sequence = 0;
+
+	// Position of this record in the owning EventQueue heap, so that cancel does not have to search
+	uint16_t heapIndex = 0;
+
 	action_s action;
 };
 #pragma pack(pop)
@@ -4,28 +4,107 @@
 
 #include "utlist.h"
 
-bool TriggerScheduler::assertNotInList(AngleBasedEvent* head, AngleBasedEvent* element) {
-	/* this code is just to validate state, no functional load*/
-	decltype(head) current;
-	int counter = 0;
-	LL_FOREACH2(head, current, next) {
-		if (++counter > QUEUE_LENGTH_LIMIT) {
-			firmwareError(ObdCode::CUSTOM_ERR_LOOPED_QUEUE, "Looped queue?");
-			return false;
+AngleBasedEvent*& TriggerScheduler::getListLocked(uint16_t tooth) {
+	return tooth == TRIGGER_SCHEDULER_UNBUCKETED ? m_unbucketed : m_buckets[tooth];
+}
+
+uint16_t TriggerScheduler::findBucket(TrgPhase phase) const {
+	if (m_bucketCount == 0 || std::isnan(phase.angle)) {
+		return TRIGGER_SCHEDULER_UNBUCKETED;
+	}
+
+	// Tooth angles count up from the sync point, so they're in phase order
+	const auto& angles = getTriggerCentral()->triggerFormDetails.eventAngles;
+
+	// Find the last tooth at or before this angle
+	int32_t left = 0;
+	int32_t right = m_bucketCount - 1;
+	// Before the first tooth: belongs to the last tooth, whose window wraps around through zero
+	int32_t found = m_bucketCount - 1;
+
+	while (left <= right) {
+		int32_t middle = (left + right) / 2;
+
+		if (angles[middle] <= phase.angle) {
+			found = middle;
+			left = middle + 1;
+		} else {
+			right = middle - 1;
 		}
+	}
 
-		if (current == element) {
-			/**
-			 * for example, this might happen in case of sudden RPM change if event
-			 * was not scheduled by angle but was scheduled by time. In case of scheduling
-			 * by time with slow RPM the whole next fast revolution might be within the wait 
-			 */
-			warning(ObdCode::CUSTOM_RE_ADDING_INTO_EXECUTION_QUEUE, "re-adding element into event_queue");
-			return true;
+	// Teeth sharing a phase (both edges reported at the same angle) share a window, the first one keeps the list
+	while (found > 0 && angles[found - 1] == angles[found]) {
+		found--;
+	}
+
+	return found;
+}
+
+int TriggerScheduler::findTooth(const EnginePhaseInfo& phase) {
+	if (m_bucketCount == 0) {
+		return -1;
+	}
+
+	const auto& angles = getTriggerCentral()->triggerFormDetails.eventAngles;
+	float current = phase.currentTrgPhase.angle;
+
+	uint16_t tooth = m_nextTooth;
+
+	if (angles[tooth] != current) {
+		// Not the tooth we expected (first tooth after sync, a tooth went missing): look it up
+		tooth = findBucket(phase.currentTrgPhase);
+
+		if (tooth == TRIGGER_SCHEDULER_UNBUCKETED || angles[tooth] != current) {
+			return -1;
 		}
 	}
 
-	return false;
+	while (tooth > 0 && angles[tooth - 1] == current) {
+		tooth--;
+	}
+
+	uint16_t next = tooth + 1;
+	while (next < m_bucketCount && angles[next] == current) {
+		next++;
+	}
+
+	if (next == m_bucketCount) {
+		next = 0;
+	}
+
+	// The window has to end at the next tooth too, for the list to hold exactly what's due
+	if (angles[next] != phase.nextTrgPhase.angle) {
+		return -1;
+	}
+
+	m_nextTooth = next;
+
+	return tooth;
+}
+
+void TriggerScheduler::insertLocked(AngleBasedEvent* event) {
+	uint16_t tooth = findBucket(event->eventPhase);
+
+	// Use Append to retain some semblance of event ordering in case of
+	// time skew.  Thus on events are always followed by off events.
+	LL_APPEND2(getListLocked(tooth), event, next);
+	event->queuedTooth = tooth;
+}
+
+void TriggerScheduler::removeLocked(AngleBasedEvent* event) {
+	AngleBasedEvent** link = &getListLocked(event->queuedTooth);
+
+	while (*link && *link != event) {
+		link = &(*link)->next;
+	}
+
+	if (*link) {
+		*link = event->next;
+	}
+
+	event->next = nullptr;
+	event->queuedTooth = TRIGGER_SCHEDULER_NOT_QUEUED;
 }
 
 void TriggerScheduler::schedule(AngleBasedEvent* event, EngPhase angle, action_s action) {
@@ -70,74 +149,121 @@ void TriggerScheduler::schedule(AngleBasedEvent* event, action_s action) {
 	{
 		chibios_rt::CriticalSectionLocker csl;
 
-		// TODO: This is O(n), consider some other way of detecting if in a list,
-		// and consider doubly linked or other list tricks.
+		if (event->queuedTooth != TRIGGER_SCHEDULER_NOT_QUEUED) {
+			/**
+			 * for example, this might happen in case of sudden RPM change if event
+			 * was not scheduled by angle but was scheduled by time. In case of scheduling
+			 * by time with slow RPM the whole next fast revolution might be within the wait
+			 */
+			warning(ObdCode::CUSTOM_RE_ADDING_INTO_EXECUTION_QUEUE, "re-adding element into event_queue");
 
-		if (!assertNotInList(m_angleBasedEventsHead, event)) {
-			// Use Append to retain some semblance of event ordering in case of
-			// time skew.  Thus on events are always followed by off events.
-			LL_APPEND2(m_angleBasedEventsHead, event, next);
+			// Its angle may have changed, move it to the right tooth
+			removeLocked(event);
 		}
+
+		insertLocked(event);
 	}
 }
 
-void TriggerScheduler::onEnginePhase(float rpm, const EnginePhaseInfo& phase) {
-	if (rpm == 0 || !EFI_SHAFT_POSITION_INPUT) {
-		 // this might happen for instance in case of a single trigger event after a pause
-		return;
+void TriggerScheduler::onTriggerShapeChanged() {
+	chibios_rt::CriticalSectionLocker csl;
+
+	AngleBasedEvent* pending = m_unbucketed;
+	m_unbucketed = nullptr;
+
+	for (size_t i = 0; i < m_bucketCount; i++) {
+		LL_CONCAT2(pending, m_buckets[i], next);
+		m_buckets[i] = nullptr;
 	}
 
-	AngleBasedEvent* keephead = nullptr;
+	TriggerCentral* tc = getTriggerCentral();
+	size_t toothCount = tc->engineCycleEventCount;
+	bool isUsable = !tc->triggerShape.shapeDefinitionError && toothCount <= efi::size(m_buckets);
 
-	{
-		chibios_rt::CriticalSectionLocker csl;
+	m_toothCount = toothCount;
+	m_bucketCount = isUsable ? toothCount : 0;
+	m_nextTooth = 0;
+
+	AngleBasedEvent* current = nullptr;
+	AngleBasedEvent* tmp = nullptr;
 
-		keephead = m_angleBasedEventsHead;
-		m_angleBasedEventsHead = nullptr;
+	LL_FOREACH_SAFE2(pending, current, tmp, next) {
+		insertLocked(current);
 	}
+}
+
+void TriggerScheduler::fire(AngleBasedEvent* event, const EnginePhaseInfo& phase) {
+	// time to fire a spark which was scheduled previously
+	scheduling_s * sDown = &event->scheduling;
 
+	// In case this event was scheduled by overdwell protection, cancel it so
+	// we can re-schedule at the correct time
+	engine->scheduler.cancel(sDown);
+
+	scheduleByAngle(
+		sDown,
+		phase.timestamp,
+		event->getAngleFromNow(phase),
+		event->action
+	);
+}
+
+void TriggerScheduler::fireDue(AngleBasedEvent* list, const EnginePhaseInfo& phase) {
 	AngleBasedEvent* current = nullptr;
 	AngleBasedEvent* tmp = nullptr;
-	AngleBasedEvent* keeptail = nullptr;
 
-	LL_FOREACH_SAFE2(keephead, current, tmp, next)
-	{
+	LL_FOREACH_SAFE2(list, current, tmp, next) {
+		current->next = nullptr;
+
 		if (current->shouldSchedule(phase)) {
-			// time to fire a spark which was scheduled previously
-
-			// Yes this looks like O(n^2), but that's only over the entire engine
-			// cycle.  It's really O(mn + nn) where m = # of teeth and n = # events
-			// fired per cycle.  The number of teeth outweigh the number of events, at
-			// least for 60-2....  So odds are we're only firing an event or two per
-			// tooth, which means the outer loop is really only O(n).  And if we are
-			// firing many events per teeth, then it's likely the events before this
-			// one also fired and thus the call to LL_DELETE2 is closer to O(1).
-			LL_DELETE2(keephead, current, next);
-
-			scheduling_s * sDown = &current->scheduling;
-
-			// In case this event was scheduled by overdwell protection, cancel it so
-			// we can re-schedule at the correct time
-			engine->scheduler.cancel(sDown);
-
-			scheduleByAngle(
-				sDown,
-				phase.timestamp,
-				current->getAngleFromNow(phase),
-				current->action
-			);
+			// Not queued any more, firing may queue it again
+			current->queuedTooth = TRIGGER_SCHEDULER_NOT_QUEUED;
+
+			fire(current, phase);
 		} else {
-			keeptail = current; // Used for fast list concatenation
+			chibios_rt::CriticalSectionLocker csl;
+
+			insertLocked(current);
 		}
 	}
+}
+
+void TriggerScheduler::onEnginePhase(float rpm, const EnginePhaseInfo& phase) {
+	if (rpm == 0 || !EFI_SHAFT_POSITION_INPUT) {
+		 // this might happen for instance in case of a single trigger event after a pause
+		return;
+	}
+
+	if (getTriggerCentral()->engineCycleEventCount != m_toothCount) {
+		onTriggerShapeChanged();
+	}
 
-	if (keephead) {
+	int tooth = findTooth(phase);
+
+	AngleBasedEvent* due = nullptr;
+	AngleBasedEvent* unbucketed = nullptr;
+
+	{
 		chibios_rt::CriticalSectionLocker csl;
 
-		// Put any new entries onto the end of the keep list
-		keeptail->next = m_angleBasedEventsHead;
-		m_angleBasedEventsHead = keephead;
+		if (tooth >= 0) {
+			// Everything on this tooth's list is due before the next tooth
+			due = m_buckets[tooth];
+			m_buckets[tooth] = nullptr;
+		} else {
+			// Not a tooth window the lists were made for, check every pending event
+			for (size_t i = 0; i < m_bucketCount; i++) {
+				LL_CONCAT2(due, m_buckets[i], next);
+				m_buckets[i] = nullptr;
+			}
+		}
+
+		unbucketed = m_unbucketed;
+		m_unbucketed = nullptr;
 	}
+
+	fireDue(due, phase);
+	fireDue(unbucketed, phase);
 }
 
 void AngleBasedEvent::setAngle(EngPhase angle) {
@@ -162,11 +288,16 @@ float AngleBasedEvent::getAngleFromNow(const EnginePhaseInfo& phase) const {
 AngleBasedEvent* TriggerScheduler::getElementAtIndexForUnitTest(int index) {
 	AngleBasedEvent* current;
 
-	LL_FOREACH2(m_angleBasedEventsHead, current, next)
-	{
-		if (index == 0)
-			return current;
-		index--;
+	// In tooth order, then the ones without a tooth
+	for (size_t i = 0; i <= m_bucketCount; i++) {
+		AngleBasedEvent* list = i < m_bucketCount ? m_buckets[i] : m_unbucketed;
+
+		LL_FOREACH2(list, current, next)
+		{
+			if (index == 0)
+				return current;
+			index--;
+		}
 	}
 	firmwareError("getElementAtIndexForUnitText: null");
 	return nullptr;
@@ -11,19 +11,41 @@ public:
 
 	void onEnginePhase(float rpm, const EnginePhaseInfo& phase) override;
 
+	// Re-sort every pending event in to the teeth of the current trigger shape
+	void onTriggerShapeChanged();
+
 	// For unit tests
 	AngleBasedEvent* getElementAtIndexForUnitTest(int index);
 
 private:
 	void schedule(AngleBasedEvent* event, action_s action);
 
-	bool assertNotInList(AngleBasedEvent* head, AngleBasedEvent* element);
+	void insertLocked(AngleBasedEvent* event);
+	void removeLocked(AngleBasedEvent* event);
+	AngleBasedEvent*& getListLocked(uint16_t tooth);
+
+	// List of the last tooth at or before this trigger phase, or TRIGGER_SCHEDULER_UNBUCKETED
+	uint16_t findBucket(TrgPhase phase) const;
+	// First tooth of the group at this phase, -1 if the phase isn't exactly one tooth's window
+	int findTooth(const EnginePhaseInfo& phase);
+
+	void fire(AngleBasedEvent* event, const EnginePhaseInfo& phase);
+	// Fires what's due of a list taken off the scheduler, puts the rest back
+	void fireDue(AngleBasedEvent* list, const EnginePhaseInfo& phase);
 
 	/**
-	 * That's the linked list of pending events scheduled in relation to trigger
-	 * At the moment we iterate over the whole list while looking for events for specific
-	 * trigger index We can make it an array of lists per trigger index, but that would take
-	 * some RAM and probably not needed yet.
+	 * Pending events scheduled in relation to trigger, one list per tooth of the engine cycle.
+	 * An event is on the list of the last tooth before its angle, so each tooth only takes
+	 * its own list instead of checking every pending event.
 	 */
-	AngleBasedEvent* m_angleBasedEventsHead = nullptr;
+	AngleBasedEvent* m_buckets[2 * PWM_PHASE_MAX_COUNT] = {};
+	// Events queued while the trigger shape isn't known
+	AngleBasedEvent* m_unbucketed = nullptr;
+
+	// Tooth count of the trigger shape the lists were sorted for
+	uint16_t m_toothCount = 0;
+	// Same, unless the shape can't be used - then everything goes to m_unbucketed
+	uint16_t m_bucketCount = 0;
+	// Where we expect the next tooth to be
+	uint16_t m_nextTooth = 0;
 };
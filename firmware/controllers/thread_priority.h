@@ -36,6 +36,8 @@
 
 // Less important things
 #define SD_CARD_LOGGER (NORMALPRIO - 1)
+// Drains filled SD log blocks to the card, below the sampler so a slow card never delays sampling
+#define SD_CARD_WRITER (NORMALPRIO - 2)
 
 // These can get starved without too much adverse effect
 #define PRIO_AUX_SERIAL NORMALPRIO
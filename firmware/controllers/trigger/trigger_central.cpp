@@ -587,6 +587,7 @@ void TriggerCentral::handleShaftSignal(TriggerEvent signal, efitick_t timestamp)
 
 	// Decode the trigger!
 	auto decodeResult = triggerState.decodeTriggerEvent(
+			m_syncKind,
 			"trigger",
 			triggerShape,
 			engine,
@@ -857,6 +858,9 @@ void TriggerCentral::updateWaveform() {
 		}
 	}
 
+	// After the gap overrides: with gaps of their own, common wheels are decoded generically
+	m_syncKind = getTriggerSyncKind(triggerShape, primaryTriggerConfiguration.TriggerType.type);
+
 	if (!triggerShape.shapeDefinitionError) {
 		int length = triggerShape.getLength();
 		engineCycleEventCount = length;
@@ -150,6 +150,11 @@ public:
 
 	TriggerWaveform triggerShape;
 
+	// Which sync point check the primary trigger is decoded with, picked when the shape is built
+	TriggerSyncKind getSyncKind() const {
+		return m_syncKind;
+	}
+
 	VvtTriggerDecoder vvtState[BANKS_COUNT][CAMS_PER_BANK] = {
 		{
 			"VVT B1 Int",
@@ -177,6 +182,8 @@ public:
 	// Number of teeth skipped during startup (see triggerSkipPulses)
 	size_t m_skipTeethCount = 0;
 
+	TriggerSyncKind m_syncKind = TriggerSyncKind::Generic;
+
 	/**
 	 * this is based on engineSnifferRpmThreshold settings and current RPM
 	 */
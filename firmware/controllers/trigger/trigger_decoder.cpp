@@ -368,6 +368,43 @@ expected<TriggerDecodeResult> TriggerDecoderBase::decodeTriggerEvent(
 		const TriggerConfiguration& triggerConfiguration,
 		const TriggerEvent signal,
 		const efitick_t nowNt) {
+	return decodeTriggerEventFor<TriggerSyncKind::Generic>(msg, triggerShape, triggerStateListener, triggerConfiguration, signal, nowNt);
+}
+
+expected<TriggerDecodeResult> TriggerDecoderBase::decodeTriggerEvent(
+		TriggerSyncKind syncKind,
+		const char *msg,
+		const TriggerWaveform& triggerShape,
+		TriggerStateListener* triggerStateListener,
+		const TriggerConfiguration& triggerConfiguration,
+		const TriggerEvent signal,
+		const efitick_t nowNt) {
+	switch (syncKind) {
+	case TriggerSyncKind::ToothedWheel60_2:
+		return decodeTriggerEventFor<TriggerSyncKind::ToothedWheel60_2>(msg, triggerShape, triggerStateListener, triggerConfiguration, signal, nowNt);
+	case TriggerSyncKind::ToothedWheel36_1:
+		return decodeTriggerEventFor<TriggerSyncKind::ToothedWheel36_1>(msg, triggerShape, triggerStateListener, triggerConfiguration, signal, nowNt);
+	case TriggerSyncKind::Subaru36_2_2_2:
+		return decodeTriggerEventFor<TriggerSyncKind::Subaru36_2_2_2>(msg, triggerShape, triggerStateListener, triggerConfiguration, signal, nowNt);
+	case TriggerSyncKind::Gm24x:
+		return decodeTriggerEventFor<TriggerSyncKind::Gm24x>(msg, triggerShape, triggerStateListener, triggerConfiguration, signal, nowNt);
+	case TriggerSyncKind::MiataNb:
+		return decodeTriggerEventFor<TriggerSyncKind::MiataNb>(msg, triggerShape, triggerStateListener, triggerConfiguration, signal, nowNt);
+	case TriggerSyncKind::Generic:
+		break;
+	}
+
+	return decodeTriggerEventFor<TriggerSyncKind::Generic>(msg, triggerShape, triggerStateListener, triggerConfiguration, signal, nowNt);
+}
+
+template <TriggerSyncKind TKind>
+expected<TriggerDecodeResult> TriggerDecoderBase::decodeTriggerEventFor(
+		const char *msg,
+		const TriggerWaveform& triggerShape,
+		TriggerStateListener* triggerStateListener,
+		const TriggerConfiguration& triggerConfiguration,
+		const TriggerEvent signal,
+		const efitick_t nowNt) {
 	ScopePerf perf(PE::DecodeTriggerEvent);
 
 	// Timeout below approximately 12 rpm, but a maximum of 1 second timeout
@@ -449,7 +486,7 @@ expected<TriggerDecodeResult> TriggerDecoderBase::decodeTriggerEvent(
 		if (triggerShape.isSynchronizationNeeded) {
 			triggerSyncGapRatio = (float)toothDurations[0] / toothDurations[1];
 
-			isSynchronizationPoint = isSyncPoint(triggerShape, triggerConfiguration.TriggerType.type);
+			isSynchronizationPoint = isSyncPointFor<TKind>(triggerShape, triggerConfiguration.TriggerType.type);
 			if (isSynchronizationPoint) {
 				enginePins.debugTriggerSync.toggle();
 			}
@@ -693,6 +730,85 @@ bool TriggerDecoderBase::isSyncPoint(const TriggerWaveform& triggerShape, trigge
 	return true;
 }
 
+template <TriggerSyncKind TKind>
+bool TriggerDecoderBase::isSyncPointFor(const TriggerWaveform& triggerShape, trigger_type_e triggerType) {
+	if constexpr (TKind == TriggerSyncKind::Generic) {
+		return isSyncPoint(triggerShape, triggerType);
+	} else if constexpr (TKind == TriggerSyncKind::MiataNb) {
+		// Same as the Miata NB part of isSyncPoint, with the gaps known up front
+		bool useToothCounting = getShaftSynchronized() && (Sensor::getOrZero(SensorType::Rpm) < 1000);
+
+		if (useToothCounting) {
+			if (isInRange(0.4f, (float)triggerSyncGapRatio, 2.0f)) {
+				return getCurrentIndex() != 0;
+			} else {
+				setShaftSynchronized(false);
+				return false;
+			}
+		}
+
+		constexpr auto& gaps = TriggerSyncGaps<TriggerSyncKind::MiataNb>::gaps;
+
+		if (!isGapInClosedRange(toothDurations[0], toothDurations[1], gaps[0])
+			|| !isGapInClosedRange(toothDurations[1], toothDurations[2], gaps[1])) {
+			return false;
+		}
+
+		// toothDurations[0] / toothDurations[1] < toothDurations[1] / toothDurations[2]
+		return (uint64_t)toothDurations[0] * toothDurations[2] < (uint64_t)toothDurations[1] * toothDurations[1];
+	} else {
+		return areSyncGapsInRange<TKind>(toothDurations);
+	}
+}
+
+template <TriggerSyncKind TKind>
+static bool hasSyncGaps(const TriggerWaveform& shape) {
+	constexpr auto& gaps = TriggerSyncGaps<TKind>::gaps;
+
+	if (shape.gapTrackingLength != (int)efi::size(gaps)) {
+		return false;
+	}
+
+	for (size_t i = 0; i < efi::size(gaps); i++) {
+		// NaN never matches, so a gap that isn't tracked doesn't either
+		if (shape.syncronizationRatioFrom[i] != gaps[i].from || shape.syncronizationRatioTo[i] != gaps[i].to) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+TriggerSyncKind getTriggerSyncKind(const TriggerWaveform& shape, trigger_type_e type) {
+	if (!shape.isSynchronizationNeeded) {
+		return TriggerSyncKind::Generic;
+	}
+
+	// The Miata NB check is tied to the trigger type, not just its gaps
+	if (type == trigger_type_e::TT_MIATA_VVT) {
+		return hasSyncGaps<TriggerSyncKind::MiataNb>(shape) ? TriggerSyncKind::MiataNb : TriggerSyncKind::Generic;
+	}
+
+	// Anything with exactly these gaps syncs exactly the same, custom toothed wheels included
+	if (hasSyncGaps<TriggerSyncKind::ToothedWheel60_2>(shape)) {
+		return TriggerSyncKind::ToothedWheel60_2;
+	}
+
+	if (hasSyncGaps<TriggerSyncKind::ToothedWheel36_1>(shape)) {
+		return TriggerSyncKind::ToothedWheel36_1;
+	}
+
+	if (hasSyncGaps<TriggerSyncKind::Subaru36_2_2_2>(shape)) {
+		return TriggerSyncKind::Subaru36_2_2_2;
+	}
+
+	if (hasSyncGaps<TriggerSyncKind::Gm24x>(shape)) {
+		return TriggerSyncKind::Gm24x;
+	}
+
+	return TriggerSyncKind::Generic;
+}
+
 /**
  * Trigger shape is defined in a way which is convenient for trigger shape definition
  * On the other hand, trigger decoder indexing begins from synchronization event.
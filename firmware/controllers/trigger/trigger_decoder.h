@@ -8,6 +8,7 @@
 #pragma once
 
 #include "trigger_structure.h"
+#include "trigger_sync_gaps.h"
 #include "trigger_state_generated.h"
 #include "trigger_state_primary_generated.h"
 #include "timer.h"
@@ -111,6 +112,19 @@ public:
 			const TriggerEvent signal,
 			const efitick_t nowNt);
 
+	/**
+	 * Same as above, with the sync point check compiled for one wheel.
+	 * @param syncKind from getTriggerSyncKind for this shape
+	 */
+	expected<TriggerDecodeResult> decodeTriggerEvent(
+			TriggerSyncKind syncKind,
+			const char *msg,
+			const TriggerWaveform& triggerShape,
+			TriggerStateListener* triggerStateListener,
+			const TriggerConfiguration& triggerConfiguration,
+			const TriggerEvent signal,
+			const efitick_t nowNt);
+
 	void logEdgeCounters(bool isRising);
 
 	void onShaftSynchronization(
@@ -178,6 +192,18 @@ private:
 	void resetCurrentCycleState();
 	bool isSyncPoint(const TriggerWaveform& triggerShape, trigger_type_e triggerType);
 
+	template <TriggerSyncKind TKind>
+	bool isSyncPointFor(const TriggerWaveform& triggerShape, trigger_type_e triggerType);
+
+	template <TriggerSyncKind TKind>
+	expected<TriggerDecodeResult> decodeTriggerEventFor(
+			const char *msg,
+			const TriggerWaveform& triggerShape,
+			TriggerStateListener* triggerStateListener,
+			const TriggerConfiguration& triggerConfiguration,
+			const TriggerEvent signal,
+			const efitick_t nowNt);
+
 	bool validateEventCounters(const TriggerWaveform& triggerShape) const;
 
 	TriggerEvent prevSignal;
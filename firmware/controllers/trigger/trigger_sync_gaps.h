@@ -0,0 +1,144 @@
+/**
+ * @file trigger_sync_gaps.h
+ *
+ * Sync gaps of the most common wheels, known at compile time.
+ *
+ * The generic decoder walks the shape's gap list on every tooth, skipping the gaps it doesn't track
+ * and comparing float ratios. For these wheels the gap count and the thresholds are constants, so the
+ * sync point check compiles down to a few integer multiplies.
+ *
+ * A threshold is kept as the exact value of the float the trigger shape uses (an integer times a power
+ * of two), so the integer comparison only disagrees with the float one when a gap is within float
+ * rounding of a threshold.
+ */
+
+#pragma once
+
+#include "trigger_structure.h"
+
+enum class TriggerSyncKind : uint8_t {
+	// Whatever gaps the trigger shape has
+	Generic,
+	ToothedWheel60_2,
+	ToothedWheel36_1,
+	Subaru36_2_2_2,
+	Gm24x,
+	MiataNb,
+};
+
+// value == num / 2^shift, exactly
+struct GapThreshold {
+	uint32_t num;
+	uint8_t shift;
+};
+
+constexpr GapThreshold toGapThreshold(float value) {
+	// Any float is an integer times a power of two, 24 significant bits at most
+	float scaled = value;
+	uint8_t shift = 0;
+
+	while (scaled != (float)(uint32_t)scaled) {
+		scaled *= 2;
+		shift++;
+	}
+
+	return { (uint32_t)scaled, shift };
+}
+
+struct SyncGapRange {
+	// Same floats as TriggerWaveform::syncronizationRatioFrom/To
+	float from;
+	float to;
+
+	GapThreshold fromThreshold;
+	GapThreshold toThreshold;
+};
+
+constexpr SyncGapRange syncGapRange(float from, float to) {
+	return { from, to, toGapThreshold(from), toGapThreshold(to) };
+}
+
+// Same as TriggerWaveform::setTriggerSynchronizationGap
+constexpr SyncGapRange syncGapAround(float ratio) {
+	return syncGapRange(ratio * TRIGGER_GAP_DEVIATION_LOW, ratio * TRIGGER_GAP_DEVIATION_HIGH);
+}
+
+template <TriggerSyncKind TKind>
+struct TriggerSyncGaps;
+
+// initializeSkippedToothTrigger(60, 2)
+template <>
+struct TriggerSyncGaps<TriggerSyncKind::ToothedWheel60_2> {
+	static constexpr SyncGapRange gaps[] = { syncGapAround(3), syncGapAround(1) };
+};
+
+// initializeSkippedToothTrigger(36, 1)
+template <>
+struct TriggerSyncGaps<TriggerSyncKind::ToothedWheel36_1> {
+	static constexpr SyncGapRange gaps[] = { syncGapAround(2), syncGapAround(1) };
+};
+
+// initialize36_2_2_2
+template <>
+struct TriggerSyncGaps<TriggerSyncKind::Subaru36_2_2_2> {
+	static constexpr SyncGapRange gaps[] = { syncGapAround(0.333f), syncGapAround(1.0f), syncGapAround(3.0f) };
+};
+
+// initGmLS24_5deg
+template <>
+struct TriggerSyncGaps<TriggerSyncKind::Gm24x> {
+	static constexpr SyncGapRange gaps[] = { syncGapAround(2.0f), syncGapAround(0.5f), syncGapAround(2.0f) };
+};
+
+// initializeMazdaMiataNb2Crank
+template <>
+struct TriggerSyncGaps<TriggerSyncKind::MiataNb> {
+	static constexpr SyncGapRange gaps[] = { syncGapRange(0.35f, 1.15f), syncGapRange(0.8f, 1.8f) };
+};
+
+/**
+ * current / previous > threshold, without dividing.
+ * Both sides fit 64 bits: durations are at most 32 bits, numerators 24 bits, shifts below 32.
+ */
+inline bool isGapAbove(uint32_t current, uint32_t previous, GapThreshold threshold) {
+	return ((uint64_t)current << threshold.shift) > (uint64_t)previous * threshold.num;
+}
+
+inline bool isGapBelow(uint32_t current, uint32_t previous, GapThreshold threshold) {
+	return ((uint64_t)current << threshold.shift) < (uint64_t)previous * threshold.num;
+}
+
+/**
+ * Strictly between from and to, like the generic decoder checks gaps.
+ * @param toothDurations most recent first
+ */
+template <TriggerSyncKind TKind>
+bool areSyncGapsInRange(const uint32_t* toothDurations) {
+	for (const auto& gap : TriggerSyncGaps<TKind>::gaps) {
+		uint32_t current = toothDurations[0];
+		uint32_t previous = toothDurations[1];
+		toothDurations++;
+
+		if (!isGapAbove(current, previous, gap.fromThreshold) || !isGapBelow(current, previous, gap.toThreshold)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Between from and to, ends included, like isInRange on the float ratio.
+ * A zero previous duration is never in range: the float ratio would be NaN or infinity.
+ */
+inline bool isGapInClosedRange(uint32_t current, uint32_t previous, const SyncGapRange& gap) {
+	return previous != 0
+		&& !isGapBelow(current, previous, gap.fromThreshold)
+		&& !isGapAbove(current, previous, gap.toThreshold);
+}
+
+/**
+ * Picks the specialized sync check for a shape, if its gaps are exactly one of the above.
+ * Overridden gaps that don't match fall back to Generic.
+ */
+TriggerSyncKind getTriggerSyncKind(const TriggerWaveform& shape, trigger_type_e type);
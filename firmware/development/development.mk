@@ -3,6 +3,9 @@ DEVELOPMENT_DIR=$(PROJECT_DIR)/development
 DEV_SRC_CPP = \
 	$(DEVELOPMENT_DIR)/engine_emulator.cpp \
 	$(DEVELOPMENT_DIR)/engine_sniffer.cpp \
+	$(DEVELOPMENT_DIR)/engine_sniffer_binary.cpp \
 	$(DEVELOPMENT_DIR)/development/perf_trace.cpp
 	
-DEV_SIMULATOR_SRC_CPP = $(DEVELOPMENT_DIR)/engine_sniffer.cpp
\ No newline at end of file
+DEV_SIMULATOR_SRC_CPP = \
+	$(DEVELOPMENT_DIR)/engine_sniffer.cpp \
+	$(DEVELOPMENT_DIR)/engine_sniffer_binary.cpp
\ No newline at end of file
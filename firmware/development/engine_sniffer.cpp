@@ -38,6 +38,7 @@
 
 #include "eficonsole.h"
 #include "status_loop.h"
+#include "engine_sniffer_binary.h"
 
 #define CHART_DELIMETER	'!'
 extern WaveChart waveChart;
@@ -224,22 +225,54 @@ void initWaveChart(WaveChart *chart) {
 #endif // EFI_UNIT_TEST
 }
 
+/**
+ * While the binary sniffer is recording it gets the events instead of the text chart
+ * @return true if the event was taken by the binary sniffer
+ */
+static bool addBinaryEngineSnifferEvent(efitick_t timestamp, EngineSnifferChannel channel, bool isRise, uint16_t value = 0) {
+	auto& sniffer = getBinaryEngineSniffer();
+
+	if (!sniffer.isRecording()) {
+		return false;
+	}
+
+	if (getTriggerCentral()->isEngineSnifferEnabled) {
+		sniffer.add(timestamp, channel, isRise, value);
+	}
+
+	return true;
+}
+
 void addEngineSnifferOutputPinEvent(NamedOutputPin *pin, bool isRise) {
-	addEngineSnifferEvent(getTimeNowNt(), pin->getShortName(), isRise ? PROTOCOL_ES_UP : PROTOCOL_ES_DOWN);
+	efitick_t nowNt = getTimeNowNt();
+
+	if (addBinaryEngineSnifferEvent(nowNt, pin->engineSnifferChannel, isRise)) {
+		return;
+	}
+
+	addEngineSnifferEvent(nowNt, pin->getShortName(), isRise ? PROTOCOL_ES_UP : PROTOCOL_ES_DOWN);
 }
 
 void addEngineSnifferTdcEvent(efitick_t timestamp, int rpm) {
+	waveChart.startDataCollection();
+
+	if (addBinaryEngineSnifferEvent(timestamp, EngineSnifferChannel::Tdc, true, std::max(0, std::min(rpm, (int)UINT16_MAX)))) {
+		return;
+	}
+
 	static char rpmBuffer[_MAX_FILLER];
 	itoa10(rpmBuffer, rpm);
 
-	waveChart.startDataCollection();
-
 	addEngineSnifferEvent(timestamp, TOP_DEAD_CENTER_MESSAGE, rpmBuffer);
 }
 
 void addEngineSnifferCrankEvent(efitick_t timestamp, int wheelIndex, int triggerEventIndex, bool isRise) {
 	static const char *crankName[2] = { PROTOCOL_CRANK1, PROTOCOL_CRANK2 };
 
+	if (addBinaryEngineSnifferEvent(timestamp, engineSnifferChannel(EngineSnifferChannel::Crank1, wheelIndex), isRise, triggerEventIndex)) {
+		return;
+	}
+
 	shaft_signal_msg_index[0] = (isRise ? PROTOCOL_ES_UP : PROTOCOL_ES_DOWN)[0];
 	// shaft_signal_msg_index[1] is assigned once and forever in the init method below
 	itoa10(&shaft_signal_msg_index[2], triggerEventIndex);
@@ -248,6 +281,10 @@ void addEngineSnifferCrankEvent(efitick_t timestamp, int wheelIndex, int trigger
 }
 
 void addEngineSnifferVvtEvent(efitick_t timestamp, int vvtIndex, bool isRise) {
+	if (addBinaryEngineSnifferEvent(timestamp, engineSnifferChannel(EngineSnifferChannel::Vvt1, vvtIndex), isRise)) {
+		return;
+	}
+
 	extern const char *vvtNames[];
 	const char *vvtName = vvtNames[vvtIndex];
 
@@ -0,0 +1,109 @@
+/**
+ * @file	engine_sniffer_binary.cpp
+ * @brief	Binary engine sniffer, see engine_sniffer_binary.h
+ */
+
+#include "pch.h"
+
+#include "engine_sniffer_binary.h"
+
+#if EFI_ENGINE_SNIFFER
+
+#include <algorithm>
+#include <climits>
+
+static BinaryEngineSniffer binaryEngineSniffer;
+
+BinaryEngineSniffer& getBinaryEngineSniffer() {
+	return binaryEngineSniffer;
+}
+
+bool BinaryEngineSniffer::start() {
+	if (!m_buffer) {
+		m_buffer = getBigBuffer(BigBufferUser::EngineSniffer);
+	}
+
+	if (!m_buffer) {
+		return false;
+	}
+
+	restart();
+
+	return true;
+}
+
+void BinaryEngineSniffer::stop() {
+	{
+		chibios_rt::CriticalSectionLocker csl;
+		m_isRecording = false;
+	}
+
+	m_buffer = {};
+}
+
+void BinaryEngineSniffer::restart() {
+	chibios_rt::CriticalSectionLocker csl;
+
+	m_nextIdx = 0;
+	m_count = 0;
+	m_isRecording = (bool)m_buffer;
+}
+
+void BinaryEngineSniffer::add(efitick_t nowNt, EngineSnifferChannel channel, bool isRise, uint16_t value) {
+	if (!m_isRecording) {
+		return;
+	}
+
+	// Eight bytes, no formatting: short enough to simply keep interrupts off while the record is written,
+	// so a reader never sees half a record
+	chibios_rt::CriticalSectionLocker csl;
+
+	// We may have been stopped on the way here
+	if (!m_isRecording) {
+		return;
+	}
+
+	int32_t deltaNt = 0;
+	if (m_count != 0) {
+		int64_t sinceLast = nowNt - m_lastNt;
+		deltaNt = std::clamp<int64_t>(sinceLast, INT32_MIN, INT32_MAX);
+	}
+	m_lastNt = nowNt;
+
+	EngineSnifferRecord& record = m_buffer.get<EngineSnifferRecord>()[m_nextIdx];
+	record.deltaNt = deltaNt;
+	record.channel = channel;
+	record.edge = isRise ? 1 : 0;
+	record.value = value;
+
+	m_nextIdx++;
+	if (m_nextIdx == ENGINE_SNIFFER_RECORD_COUNT) {
+		m_nextIdx = 0;
+	}
+
+	if (m_count < ENGINE_SNIFFER_RECORD_COUNT) {
+		m_count++;
+	}
+}
+
+size_t BinaryEngineSniffer::freeze() {
+	{
+		chibios_rt::CriticalSectionLocker csl;
+		m_isRecording = false;
+	}
+
+	if (!m_buffer) {
+		return 0;
+	}
+
+	if (m_count == ENGINE_SNIFFER_RECORD_COUNT) {
+		// Wrapped around: the oldest record is the one that would have been overwritten next
+		auto records = m_buffer.get<EngineSnifferRecord>();
+		std::rotate(records, records + m_nextIdx, records + ENGINE_SNIFFER_RECORD_COUNT);
+		m_nextIdx = 0;
+	}
+
+	return m_count;
+}
+
+#endif /* EFI_ENGINE_SNIFFER */
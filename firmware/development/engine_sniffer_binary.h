@@ -0,0 +1,105 @@
+/**
+ * @file	engine_sniffer_binary.h
+ * @brief	Binary engine sniffer
+ *
+ * Same events as the text engine sniffer, but each one is a fixed size record in a ring in the big
+ * buffer instead of a formatted string. Nothing is formatted on the ECU: the records are read out over
+ * TunerStudio (TS_ENGINE_SNIFFER_COMMAND) and decoded on the host.
+ *
+ * While the binary sniffer is recording, the text chart gets no events.
+ */
+
+#pragma once
+
+#include "big_buffer.h"
+#include "rusefi_types.h"
+
+#include <cstddef>
+#include <cstdint>
+
+enum class EngineSnifferChannel : uint8_t {
+	Crank1 = 0,
+	Crank2 = 1,
+	// Plus the cam input index
+	Vvt1 = 2,
+	Tdc = 6,
+	// Named output pin without a channel of its own
+	OtherOutput = 7,
+
+	// Plus the cylinder index
+	Coil1 = 0x10,
+	TrailingCoil1 = 0x20,
+	Injector1 = 0x30,
+	InjectorStage2_1 = 0x40,
+};
+
+// Channel of the index-th cam input or cylinder, counting from the first one
+constexpr EngineSnifferChannel engineSnifferChannel(EngineSnifferChannel first, int index) {
+	return static_cast<EngineSnifferChannel>(static_cast<uint8_t>(first) + index);
+}
+
+struct EngineSnifferRecord {
+	// Ticks since the previous record. Crank edges are timestamped when the edge happened, so this may
+	// be a little negative when an output event made it in to the ring first.
+	int32_t deltaNt;
+	EngineSnifferChannel channel;
+	// 1 rising, 0 falling
+	uint8_t edge;
+	// Tooth index from the sync point for crank edges, rpm for TDC, zero otherwise
+	uint16_t value;
+};
+
+// Ensure that the struct is the size we think it is - the binary layout is important
+static_assert(sizeof(EngineSnifferRecord) == 8);
+
+#define ENGINE_SNIFFER_RECORD_COUNT (BIG_BUFFER_SIZE / sizeof(EngineSnifferRecord))
+
+class BinaryEngineSniffer {
+public:
+	/**
+	 * Takes the big buffer and starts recording.
+	 * @return false if somebody else (tooth logger, trigger scope...) is using the big buffer
+	 */
+	bool start();
+
+	// Stops recording and gives the big buffer back
+	void stop();
+
+	bool isRecording() const {
+		return m_isRecording;
+	}
+
+	bool isStarted() const {
+		return (bool)m_buffer;
+	}
+
+	/**
+	 * Safe to call from any context. Once the ring is full the oldest record is overwritten.
+	 */
+	void add(efitick_t nowNt, EngineSnifferChannel channel, bool isRise, uint16_t value);
+
+	/**
+	 * Stops recording and puts the records in order, oldest first, at the start of the buffer.
+	 * The delta of the first record is meaningless: whatever it was relative to is gone.
+	 * @return the number of records
+	 */
+	size_t freeze();
+
+	const EngineSnifferRecord* getRecords() const {
+		return m_buffer.get<EngineSnifferRecord>();
+	}
+
+	// Drops all records and records again, after a freeze
+	void restart();
+
+private:
+	BigBufferHandle m_buffer;
+	volatile bool m_isRecording = false;
+
+	// Slot of the next record, the oldest one once the ring is full
+	size_t m_nextIdx = 0;
+	size_t m_count = 0;
+	efitick_t m_lastNt = 0;
+};
+
+BinaryEngineSniffer& getBinaryEngineSniffer();
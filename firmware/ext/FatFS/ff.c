@@ -5214,6 +5214,7 @@ FRESULT f_expand (
 			} else {
 				scl = clst; ncl = 0;		/* Not a free cluster */
 			}
+			if (clst == 2) { scl = 2; ncl = 0; }	/* FOME fix: a block can't wrap around the end of the volume */
 			if (clst == stcl) { res = FR_DENIED; break; }	/* No contiguous cluster? */
 		}
 		if (res == FR_OK) {	/* A contiguous free area is found */
@@ -1,5 +1,7 @@
 /* CHIBIOS FIX */
+#if !EFI_UNIT_TEST
 #include "ch.h"
+#endif
 
 /*---------------------------------------------------------------------------/
 /  FatFs - Configuration file
@@ -41,7 +43,12 @@
 /  f_findnext(). (0:Disable, 1:Enable 2:Enable with matching altname[] too) */
 
 
+#if EFI_UNIT_TEST
+/* Unit tests format a RAM disk */
+#define FF_USE_MKFS		1
+#else
 #define FF_USE_MKFS		0
+#endif
 /* This option switches f_mkfs() function. (0:Disable or 1:Enable) */
 
 
@@ -49,7 +56,7 @@
 /* This option switches fast seek function. (0:Disable or 1:Enable) */
 
 
-#define FF_USE_EXPAND	0
+#define FF_USE_EXPAND	1
 /* This option switches f_expand function. (0:Disable or 1:Enable) */
 
 
@@ -241,7 +248,7 @@
 /      can be opened simultaneously under file lock control. Note that the file
 /      lock control is independent of re-entrancy. */
 
-#ifdef EFI_BOOTLOADER
+#if defined(EFI_BOOTLOADER) || EFI_UNIT_TEST
 #define FF_FS_REENTRANT   0
 #else
 #define FF_FS_REENTRANT   1
@@ -27,8 +27,10 @@ typedef unsigned short	WORD;
 typedef unsigned short	WCHAR;
 
 /* These types MUST be 32-bit */
-typedef long			LONG;
-typedef unsigned long	DWORD;
+#include <stdint.h>
+/* long on ARM, but 64 bits on the hosts unit tests run on */
+typedef int32_t			LONG;
+typedef uint32_t		DWORD;
 
 /* This type MUST be 64-bit (Remove this for ANSI C (C89) compatibility) */
 typedef unsigned long long QWORD;
@@ -19,6 +19,8 @@
 #include "can.h"
 #include "can_hw.h"
 #include "can_msg_tx.h"
+#include "can_rx_index.h"
+#include "can_rx_signals.h"
 #include "string.h"
 #include "mpu_util.h"
 
@@ -124,6 +126,12 @@ static void startCanPins() {
 
 void initCan() {
 	addConsoleAction("caninfo", canInfo);
+	addConsoleAction("canrxstats", []() {
+		getCanRxIndex().printStats();
+	});
+	addConsoleAction("canrxsignals", []() {
+		getCanRxSignals().printStats();
+	});
 
 	isCanEnabled = false;
 
@@ -11,6 +11,7 @@ HW_LAYER_DRIVERS_CORE = \
 
 HW_LAYER_DRIVERS_CORE_CPP = \
 	$(DRIVERS_DIR)/gpio/core.cpp \
+	$(DRIVERS_DIR)/gpio/gpio_spi.cpp \
 	$(DRIVERS_DIR)/i2c/i2c_bb.cpp \
 	$(DRIVERS_DIR)/can/can_msg_tx.cpp
 
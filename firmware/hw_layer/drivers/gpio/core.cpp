@@ -79,6 +79,24 @@ int gpiochips_getPinOffset(brain_pin_e pin)
 }
 
 
+/**
+ * @brief Find chip and offset of external pin
+ * @details for callers that write same pin again and again, see GpioChipPin
+ */
+
+GpioChipPin gpiochips_findPin(brain_pin_e pin)
+{
+	GpioChipPin result;
+	gpiochip *chip = gpiochip_find(pin);
+
+	if (chip) {
+		result.chip = chip->chip;
+		result.offset = pin - chip->base;
+	}
+
+	return result;
+}
+
 /**
  * @brief Get external chip name
  * @details return gpiochip name
@@ -346,6 +364,12 @@ int gpiochips_getPinOffset(brain_pin_e pin) {
 	return -1;
 }
 
+GpioChipPin gpiochips_findPin(brain_pin_e pin) {
+	(void)pin;
+
+	return {};
+}
+
 const char *gpiochips_getChipName(brain_pin_e pin) {
 	(void)pin;
 
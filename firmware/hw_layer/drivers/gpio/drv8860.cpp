@@ -15,6 +15,7 @@
 #include "pch.h"
 
 #include "gpio/gpio_ext.h"
+#include "gpio/gpio_spi.h"
 #include "gpio/drv8860.h"
 
 #if (BOARD_DRV8860_COUNT > 0)
@@ -25,8 +26,6 @@
 
 #define DRIVER_NAME				"drv8860"
 
-static bool drv_task_ready = false;
-
 typedef enum {
 	DRV8860_DISABLED = 0,
 	DRV8860_WAIT_INIT,
@@ -42,28 +41,32 @@ typedef enum {
 /* Driver local variables and types.										*/
 /*==========================================================================*/
 
-/* OS */
-SEMAPHORE_DECL(drv8860_wake, 10 /* or BOARD_DRV8860_COUNT ? */);
-static THD_WORKING_AREA(drv8860_thread_1_wa, 256);
-
 /* Driver */
-struct Drv8860 : public GpioChip {
+struct Drv8860 : public GpioChip, public SpiRefreshClient {
 	int init() override;
 
 	int writePad(size_t pin, int value) override;
 	brain_pin_diag_e getDiag(size_t pin) override;
 
+	/* outputs are refreshed by the SPI bus thread, see gpio_spi.h */
+	bool prepareRefresh(SpiBatch &batch, int stage, bool diagnosticDue) override;
+	bool finishRefresh(const SpiBatch &batch, int stage) override;
+	const SPIConfig *getSpiConfig() const override {
+		return &cfg->spi_config;
+	}
+
 	// Internal helpers
 	int chip_init();
 
 	void spi_send(uint16_t tx);
 
 	void update_outputs();
-	int wake_driver();
 
 	const drv8860_config		*cfg;
 	/* cached output state - state last send to chip */
 	uint16_t					o_state_cached;
+	/* state being sent to chip by the current refresh */
+	uint16_t					o_state_sending;
 	/* state to be sended to chip */
 	uint16_t					o_state;
 
@@ -135,48 +138,28 @@ int Drv8860::chip_init() {
 	return 0;
 }
 
-/**
- * @brief DRV8860 chip driver wakeup.
- * @details Wake up driver. Will cause output register update.
- */
-
-int Drv8860::wake_driver() {
-	/* Entering a reentrant critical zone.*/
-	chibios_rt::CriticalSectionLocker csl;
-
-	chSemSignalI(&drv8860_wake);
-
-	return 0;
-}
-
 /*==========================================================================*/
-/* Driver thread.															*/
+/* Driver SPI refresh.														*/
 /*==========================================================================*/
 
-static THD_FUNCTION(drv8860_driver_thread, p) {
-	int i;
-	msg_t msg;
-
-	(void)p;
-
-	chRegSetThreadName(DRIVER_NAME);
+bool Drv8860::prepareRefresh(SpiBatch &batch, int stage, bool /*diagnosticDue*/) {
+	if ((stage != 0) ||
+		(drv_state == DRV8860_DISABLED) ||
+		(drv_state == DRV8860_FAILED))
+		return false;
 
-	while (1) {
-		msg = chSemWaitTimeout(&drv8860_wake, TIME_MS2I(DRV8860_POLL_INTERVAL_MS));
+	/* atomic */
+	o_state_sending = o_state;
+	batch.add(o_state_sending & 0xffff);
 
-		/* should we care about msg == MSG_TIMEOUT? */
-		(void)msg;
+	return true;
+}
 
-		for (i = 0; i < BOARD_DRV8860_COUNT; i++) {
-			auto chip = &chips[i];
-			if ((chip->cfg == NULL) ||
-				(chip->drv_state == DRV8860_DISABLED) ||
-				(chip->drv_state == DRV8860_FAILED))
-				continue;
+bool Drv8860::finishRefresh(const SpiBatch &/*batch*/, int /*stage*/) {
+	/* atomic */
+	o_state_cached = o_state_sending;
 
-			chip->update_outputs();
-		}
-	}
+	return false;
 }
 
 /*==========================================================================*/
@@ -199,7 +182,7 @@ int Drv8860::writePad(size_t pin, int value) {
 	else
 		o_state &= ~(1 << pin);
 	/* TODO: unlock */
-	wake_driver();
+	gpio_spi_request_refresh(*this);
 	
 	return 0;
 }
@@ -218,13 +201,7 @@ int Drv8860::init() {
 
 	drv_state = DRV8860_READY;
 
-	if (!drv_task_ready) {
-		chThdCreateStatic(drv8860_thread_1_wa, sizeof(drv8860_thread_1_wa),
-						  PRIO_GPIOCHIP, drv8860_driver_thread, NULL);
-		drv_task_ready = true;
-	}
-
-	return 0;
+	return gpio_spi_add(cfg->spi_bus, *this, DRIVER_NAME, DRV8860_POLL_INTERVAL_MS);
 }
 
 /**
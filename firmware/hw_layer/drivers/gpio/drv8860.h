@@ -17,6 +17,7 @@
 #define DRV8860_OUTPUTS				16
 
 /* TODO: add irq support */
+/* diagnostic interval of the SPI refresh thread, see gpio_spi.h */
 #define DRV8860_POLL_INTERVAL_MS	500
 
 struct drv8860_config {
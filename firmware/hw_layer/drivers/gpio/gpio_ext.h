@@ -31,12 +31,33 @@ struct GpioChip {
 	virtual int deinit() { return 0; }
 };
 
+/**
+ * External pin with its chip looked up once, so that writes from the hot paths
+ * (injectors, coils) go straight to the driver instead of searching for the chip
+ */
+struct GpioChipPin {
+	GpioChip	*chip = nullptr;
+	size_t		offset = 0;
+
+	int writePad(int value) const {
+		if (!chip)
+			return -1;
+
+		return chip->writePad(offset, value);
+	}
+};
+
+/* chip is nullptr if pin does not belong to any registered chip */
+GpioChipPin gpiochips_findPin(brain_pin_e pin);
+
 int gpiochips_getPinOffset(brain_pin_e pin);
 const char *gpiochips_getChipName(brain_pin_e pin);
 const char *gpiochips_getPinName(brain_pin_e pin);
 
 /* register/unregister GPIO chip */
 int gpiochip_register(brain_pin_e base, const char *name, GpioChip& chip, size_t size);
+/* pins found by gpiochips_findPin() keep pointing to the chip, deinit them first */
+int gpiochip_unregister(brain_pin_e base);
 
 /* Set individual names for pins */
 int gpiochips_setPinNames(brain_pin_e base, const char **names);
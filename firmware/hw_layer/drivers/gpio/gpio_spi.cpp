@@ -0,0 +1,330 @@
+/*
+ * @file gpio_spi.cpp
+ *
+ * Shared SPI refresh of smart gpio chips, see gpio_spi.h
+ */
+
+#include "pch.h"
+
+#include "gpio/gpio_spi.h"
+
+#include <algorithm>
+#include <climits>
+
+/*==========================================================================*/
+/* Batch and scheduler.														*/
+/*==========================================================================*/
+
+int SpiBatch::add(uint16_t tx)
+{
+	return add(&tx, 1);
+}
+
+int SpiBatch::add(const uint16_t *tx, size_t count)
+{
+	if ((count == 0) || (m_words + count > SPI_BATCH_MAX_WORDS) || (m_frames == SPI_BATCH_MAX_FRAMES)) {
+		m_overflow = true;
+		return -1;
+	}
+
+	int index = m_words;
+
+	for (size_t i = 0; i < count; i++) {
+		m_tx[m_words] = tx[i];
+		m_rx[m_words] = 0;
+		m_words++;
+	}
+
+	m_frameEnd[m_frames++] = m_words;
+
+	return index;
+}
+
+void SpiRefreshClient::requestRefresh(efitick_t nowNt)
+{
+	chibios_rt::CriticalSectionLocker csl;
+
+	if (!m_refreshRequested) {
+		m_requestedNt = nowNt;
+		m_refreshRequested = true;
+	}
+}
+
+bool SpiRefreshScheduler::add(SpiRefreshClient &client, const char *name, int diagIntervalMs)
+{
+	if (m_clientCount == SPI_REFRESH_MAX_CLIENTS)
+		return false;
+
+	client.m_name = name;
+	client.m_diagIntervalNt = MS2NT(diagIntervalMs);
+	client.m_nextDiagNt = 0;
+	m_clients[m_clientCount++] = &client;
+
+	return true;
+}
+
+int SpiRefreshScheduler::refresh(efitick_t nowNt)
+{
+	bool acquired = false;
+	int refreshed = 0;
+
+	for (size_t i = 0; i < m_clientCount; i++) {
+		SpiRefreshClient &client = *m_clients[i];
+
+		bool requested;
+		efitick_t requestedNt;
+		{
+			chibios_rt::CriticalSectionLocker csl;
+
+			requested = client.m_refreshRequested;
+			requestedNt = client.m_requestedNt;
+			/* anything requested from now on goes out with the next pass */
+			client.m_refreshRequested = false;
+		}
+
+		bool diagnosticDue = client.m_nextDiagNt <= nowNt;
+		if (diagnosticDue) {
+			client.m_nextDiagNt = nowNt + client.m_diagIntervalNt;
+		}
+
+		efitick_t deadlineNt = client.getDeadlineNt();
+		bool deadlineReached = (deadlineNt != 0) && (deadlineNt <= nowNt);
+
+		if (!requested && !diagnosticDue && !deadlineReached)
+			continue;
+
+		bool exchanged = false;
+
+		for (int stage = 0; stage < SPI_REFRESH_MAX_STAGES; stage++) {
+			m_batch.clear();
+
+			if (!client.prepareRefresh(m_batch, stage, diagnosticDue))
+				break;
+
+			if (m_batch.isOverflow()) {
+				m_overflowCount++;
+				break;
+			}
+
+			if (!acquired) {
+				m_bus.acquire();
+				m_transactionCount++;
+				acquired = true;
+			}
+
+			m_bus.exchange(client, m_batch);
+			client.m_wordCount += m_batch.getWordCount();
+			exchanged = true;
+
+			if (!client.finishRefresh(m_batch, stage))
+				break;
+		}
+
+		if (!exchanged)
+			continue;
+
+		client.m_refreshCount++;
+		refreshed++;
+
+		if (requested) {
+			int64_t latencyNt = getTimeNowNt() - requestedNt;
+			client.m_lastLatencyNt = std::min<int64_t>(latencyNt, INT32_MAX);
+			client.m_maxLatencyNt = std::max(client.m_maxLatencyNt, client.m_lastLatencyNt);
+		}
+	}
+
+	if (acquired)
+		m_bus.release();
+
+	return refreshed;
+}
+
+efitick_t SpiRefreshScheduler::getNextWakeupNt() const
+{
+	efitick_t wakeupNt = INT64_MAX;
+
+	for (size_t i = 0; i < m_clientCount; i++) {
+		const SpiRefreshClient &client = *m_clients[i];
+
+		wakeupNt = std::min<int64_t>(wakeupNt, client.m_nextDiagNt);
+
+		efitick_t deadlineNt = client.getDeadlineNt();
+		if (deadlineNt != 0) {
+			wakeupNt = std::min<int64_t>(wakeupNt, deadlineNt);
+		}
+	}
+
+	return wakeupNt;
+}
+
+#if BOARD_SPI_REFRESH_CHIPS > 0
+
+/*==========================================================================*/
+/* ChibiOS SPI bus and the refresh thread.									*/
+/*==========================================================================*/
+
+#define GPIO_SPI_MAX_BUSES		3
+#define GPIO_SPI_MAX_SLEEP_MS	500
+
+class ChibiosSpiBus final : public SpiBus {
+public:
+	void acquire() override
+	{
+		spiAcquireBus(spi);
+	}
+
+	void release() override
+	{
+		spiReleaseBus(spi);
+	}
+
+	void exchange(const SpiRefreshClient &client, SpiBatch &batch) override
+	{
+		/* chips on one bus may use different modes and CS pins */
+		spiStart(spi, client.getSpiConfig());
+
+		for (size_t frame = 0; frame < batch.getFrameCount(); frame++) {
+			size_t start = batch.getFrameStart(frame);
+			size_t end = start + batch.getFrameLength(frame);
+
+			spiSelect(spi);
+			for (size_t i = start; i < end; i++) {
+				batch.getRx()[i] = spiPolledExchange(spi, batch.getTx()[i]);
+			}
+			spiUnselect(spi);
+		}
+	}
+
+	SPIDriver *spi = nullptr;
+};
+
+struct GpioSpiBus {
+	ChibiosSpiBus bus;
+	SpiRefreshScheduler scheduler{bus};
+};
+
+static GpioSpiBus buses[GPIO_SPI_MAX_BUSES];
+
+static bool refresh_task_ready = false;
+
+SEMAPHORE_DECL(gpio_spi_wake, 10);
+static THD_WORKING_AREA(gpio_spi_thread_wa, 256);
+
+static THD_FUNCTION(gpio_spi_thread, p)
+{
+	(void)p;
+
+	chRegSetThreadName("gpio spi");
+
+	while (1) {
+		efitick_t wakeupNt = INT64_MAX;
+
+		for (int i = 0; i < GPIO_SPI_MAX_BUSES; i++) {
+			if (buses[i].bus.spi) {
+				wakeupNt = std::min<int64_t>(wakeupNt, buses[i].scheduler.getNextWakeupNt());
+			}
+		}
+
+		int64_t sleepUs = NT2US(wakeupNt - getTimeNowNt());
+		/* at least a tick, a chip that keeps its deadline in the past must not starve everybody else */
+		sysinterval_t sleep = TIME_US2I(std::clamp<int64_t>(sleepUs, 1, MS2US(GPIO_SPI_MAX_SLEEP_MS)));
+
+		msg_t msg = chSemWaitTimeout(&gpio_spi_wake, sleep);
+
+		/* should we care about msg == MSG_TIMEOUT? */
+		(void)msg;
+
+		for (int i = 0; i < GPIO_SPI_MAX_BUSES; i++) {
+			if (buses[i].bus.spi) {
+				buses[i].scheduler.refresh(getTimeNowNt());
+			}
+		}
+	}
+}
+
+int gpio_spi_add(SPIDriver *spi, SpiRefreshClient &client, const char *name, int diagIntervalMs)
+{
+	GpioSpiBus *slot = nullptr;
+
+	for (int i = 0; i < GPIO_SPI_MAX_BUSES; i++) {
+		if ((buses[i].bus.spi == spi) || (buses[i].bus.spi == nullptr)) {
+			slot = &buses[i];
+			break;
+		}
+	}
+
+	if (!slot)
+		return -1;
+
+	{
+		/* the thread may be going over the chips right now */
+		chibios_rt::CriticalSectionLocker csl;
+
+		if (!slot->scheduler.add(client, name, diagIntervalMs))
+			return -1;
+		slot->bus.spi = spi;
+	}
+
+	if (!refresh_task_ready) {
+		chThdCreateStatic(gpio_spi_thread_wa, sizeof(gpio_spi_thread_wa),
+						  PRIO_GPIOCHIP, gpio_spi_thread, nullptr);
+		refresh_task_ready = true;
+	}
+
+	return 0;
+}
+
+int gpio_spi_exchange(SPIDriver *spi, const SpiRefreshClient &client, SpiBatch &batch)
+{
+	for (int i = 0; i < GPIO_SPI_MAX_BUSES; i++) {
+		if (buses[i].bus.spi == spi) {
+			buses[i].bus.acquire();
+			buses[i].bus.exchange(client, batch);
+			buses[i].bus.release();
+
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+void gpio_spi_request_refresh(SpiRefreshClient &client)
+{
+	client.requestRefresh(getTimeNowNt());
+
+	/* Entering a reentrant critical zone.*/
+	chibios_rt::CriticalSectionLocker csl;
+
+	chSemSignalI(&gpio_spi_wake);
+	if (!port_is_isr_context()) {
+		/**
+		 * chSemSignalI above requires rescheduling
+		 * interrupt handlers have implicit rescheduling
+		 */
+		chSchRescheduleS();
+	}
+}
+
+void gpio_spi_show_info()
+{
+	for (int i = 0; i < GPIO_SPI_MAX_BUSES; i++) {
+		const SpiRefreshScheduler &scheduler = buses[i].scheduler;
+
+		if (!buses[i].bus.spi)
+			continue;
+
+		efiPrintf("SPI bus %d: %d transactions, %d overflows", i,
+				  scheduler.getTransactionCount(), scheduler.getOverflowCount());
+
+		for (size_t c = 0; c < scheduler.getClientCount(); c++) {
+			const SpiRefreshClient *client = scheduler.getClient(c);
+
+			efiPrintf("  %s: %d refreshes, %d words, latency %d us, max %d us", client->getName(),
+					  client->getRefreshCount(), client->getWordCount(),
+					  (int)NT2US(client->getLastLatencyNt()), (int)NT2US(client->getMaxLatencyNt()));
+		}
+	}
+}
+
+#endif /* BOARD_SPI_REFRESH_CHIPS > 0 */
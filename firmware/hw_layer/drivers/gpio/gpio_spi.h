@@ -0,0 +1,255 @@
+/*
+ * @file gpio_spi.h
+ *
+ * Shared SPI refresh of smart gpio chips
+ *
+ * Instead of each driver thread taking the bus for every 16-bit word, chips register as clients of
+ * the refresh scheduler of their SPI bus. On each pass the bus is acquired once, and every chip with
+ * something to do - outputs changed, diagnostic due or a deadline of its own reached - gets its whole
+ * batch of words exchanged, one chip after another, before the bus is released.
+ *
+ * Each chip has its own diagnostic interval, and may ask for a refresh at a given time on top of that
+ * (TLE8888 watchdog). The thread sleeps until the earliest of those, or until a pin write wakes it up.
+ *
+ * All words are clocked out polled: these chips latch a command when CS goes high, so a batch is a
+ * train of one-word frames, and setting up DMA for a single word takes longer than sending it.
+ *
+ * The scheduler does not know about ChibiOS SPI: the bus is behind SpiBus, so it is mocked in unit tests.
+ */
+
+#pragma once
+
+#include "rusefi_types.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/* TLE8888 re-init and output update */
+#define SPI_BATCH_MAX_WORDS			32
+#define SPI_BATCH_MAX_FRAMES		SPI_BATCH_MAX_WORDS
+#define SPI_REFRESH_MAX_CLIENTS		8
+/* a chip may look at the responses and ask for more words: status first, then fault registers */
+#define SPI_REFRESH_MAX_STAGES		4
+
+#if EFI_PROD_CODE && HAL_USE_SPI
+#define BOARD_SPI_REFRESH_CHIPS (BOARD_TLE6240_COUNT + BOARD_MC33810_COUNT + BOARD_DRV8860_COUNT + BOARD_TLE8888_COUNT)
+#else
+#define BOARD_SPI_REFRESH_CHIPS 0
+#endif
+
+/**
+ * Words one chip exchanges on a refresh. Most of these chips latch a command when CS goes high, so
+ * the words are split in frames with CS asserted around each one.
+ */
+class SpiBatch {
+public:
+	void clear() {
+		m_words = 0;
+		m_frames = 0;
+		m_overflow = false;
+	}
+
+	/**
+	 * Adds a frame of one word.
+	 * @return index of the word for getRx(), -1 if the batch is full
+	 */
+	int add(uint16_t tx);
+
+	/**
+	 * Adds a frame of several words clocked out under one CS
+	 * @return index of the first word, -1 if the batch is full
+	 */
+	int add(const uint16_t *tx, size_t count);
+
+	uint16_t getRx(int index) const {
+		return m_rx[index];
+	}
+
+	size_t getWordCount() const {
+		return m_words;
+	}
+
+	size_t getFrameCount() const {
+		return m_frames;
+	}
+
+	bool isOverflow() const {
+		return m_overflow;
+	}
+
+	/* for SpiBus implementations */
+	size_t getFrameStart(size_t frame) const {
+		return frame == 0 ? 0 : m_frameEnd[frame - 1];
+	}
+
+	size_t getFrameLength(size_t frame) const {
+		return m_frameEnd[frame] - getFrameStart(frame);
+	}
+
+	const uint16_t *getTx() const {
+		return m_tx;
+	}
+
+	uint16_t *getRx() {
+		return m_rx;
+	}
+
+private:
+	uint16_t m_tx[SPI_BATCH_MAX_WORDS];
+	uint16_t m_rx[SPI_BATCH_MAX_WORDS];
+	uint8_t m_frameEnd[SPI_BATCH_MAX_FRAMES];
+	size_t m_words = 0;
+	size_t m_frames = 0;
+	bool m_overflow = false;
+};
+
+/**
+ * A chip on a shared SPI bus, implemented by GpioChip drivers
+ */
+class SpiRefreshClient {
+public:
+	/**
+	 * Called with the bus held. Stage 0 adds the output update and, if diagnosticDue, the diagnostic reads.
+	 * Further stages only happen if finishRefresh() asks for them.
+	 * @return false if there is nothing to exchange
+	 */
+	virtual bool prepareRefresh(SpiBatch &batch, int stage, bool diagnosticDue) = 0;
+
+	/**
+	 * Called with the responses, the bus is still held.
+	 * @return true to get another stage
+	 */
+	virtual bool finishRefresh(const SpiBatch &batch, int stage) = 0;
+
+	/**
+	 * Time by which the chip needs a refresh, whatever happens to its outputs and diagnostic.
+	 * @return 0 for none
+	 */
+	virtual efitick_t getDeadlineNt() const {
+		return 0;
+	}
+
+#if HAL_USE_SPI
+	virtual const SPIConfig *getSpiConfig() const = 0;
+#endif
+
+	/**
+	 * Outputs changed, safe to call from any context. Requests are coalesced until the next refresh,
+	 * latency is counted from the first one.
+	 */
+	void requestRefresh(efitick_t nowNt);
+
+	const char *getName() const {
+		return m_name;
+	}
+
+	uint32_t getRefreshCount() const {
+		return m_refreshCount;
+	}
+
+	uint32_t getWordCount() const {
+		return m_wordCount;
+	}
+
+	/* time from the first requestRefresh() to the outputs being sent */
+	int32_t getLastLatencyNt() const {
+		return m_lastLatencyNt;
+	}
+
+	int32_t getMaxLatencyNt() const {
+		return m_maxLatencyNt;
+	}
+
+private:
+	friend class SpiRefreshScheduler;
+
+	const char *m_name = nullptr;
+
+	efidur_t m_diagIntervalNt;
+	efitick_t m_nextDiagNt = 0;
+
+	volatile bool m_refreshRequested = false;
+	efitick_t m_requestedNt = 0;
+
+	uint32_t m_refreshCount = 0;
+	uint32_t m_wordCount = 0;
+	int32_t m_lastLatencyNt = 0;
+	int32_t m_maxLatencyNt = 0;
+};
+
+class SpiBus {
+public:
+	/* held while all chips of one pass are refreshed */
+	virtual void acquire() = 0;
+	virtual void release() = 0;
+
+	/* exchanges all frames of the batch with one chip, responses go to batch.getRx() */
+	virtual void exchange(const SpiRefreshClient &client, SpiBatch &batch) = 0;
+};
+
+class SpiRefreshScheduler {
+public:
+	explicit SpiRefreshScheduler(SpiBus &bus) : m_bus(bus) { }
+
+	/**
+	 * The first diagnostic is due right away.
+	 * @return false if there is no room for one more chip
+	 */
+	bool add(SpiRefreshClient &client, const char *name, int diagIntervalMs);
+
+	/**
+	 * One pass over the chips: the ones with a refresh requested, diagnostic due or deadline reached.
+	 * The bus is acquired once for the whole pass, and not at all if there is nothing to do.
+	 * @return number of chips refreshed
+	 */
+	int refresh(efitick_t nowNt);
+
+	/* earliest diagnostic or deadline of any chip, when the next pass is due without a pin write */
+	efitick_t getNextWakeupNt() const;
+
+	size_t getClientCount() const {
+		return m_clientCount;
+	}
+
+	SpiRefreshClient *getClient(size_t index) const {
+		return m_clients[index];
+	}
+
+	/* bus acquisitions */
+	uint32_t getTransactionCount() const {
+		return m_transactionCount;
+	}
+
+	/* batches dropped for not fitting in SPI_BATCH_MAX_WORDS */
+	uint32_t getOverflowCount() const {
+		return m_overflowCount;
+	}
+
+private:
+	SpiBus &m_bus;
+
+	SpiRefreshClient *m_clients[SPI_REFRESH_MAX_CLIENTS];
+	size_t m_clientCount = 0;
+
+	SpiBatch m_batch;
+
+	uint32_t m_transactionCount = 0;
+	uint32_t m_overflowCount = 0;
+};
+
+#if BOARD_SPI_REFRESH_CHIPS > 0
+/* register an initialized chip with the scheduler of its bus, starts the refresh thread */
+int gpio_spi_add(SPIDriver *spi, SpiRefreshClient &client, const char *name, int diagIntervalMs);
+
+/**
+ * Exchanges a batch with a registered chip outside of the refresh passes: chip reset, register dump.
+ * Not from the refresh thread, the bus may be held by the pass.
+ */
+int gpio_spi_exchange(SPIDriver *spi, const SpiRefreshClient &client, SpiBatch &batch);
+
+/* requestRefresh() and wake up the refresh thread */
+void gpio_spi_request_refresh(SpiRefreshClient &client);
+
+/* debug */
+void gpio_spi_show_info();
+#endif /* BOARD_SPI_REFRESH_CHIPS > 0 */
@@ -15,6 +15,7 @@
 
 #include "pch.h"
 #include "gpio/gpio_ext.h"
+#include "gpio/gpio_spi.h"
 #include "gpio/mc33810.h"
 
 #if (BOARD_MC33810_COUNT > 0)
@@ -30,8 +31,6 @@
 
 #define DRIVER_NAME				"mc33810"
 
-static bool drv_task_ready = false;
-
 typedef enum {
 	MC33810_DISABLED = 0,
 	MC33810_WAIT_INIT,
@@ -85,30 +84,31 @@ typedef enum {
 /* Driver local variables and types.										*/
 /*==========================================================================*/
 
-/* OS */
-SEMAPHORE_DECL(mc33810_wake, 10 /* or BOARD_MC33810_COUNT ? */);
-static THD_WORKING_AREA(mc33810_thread_1_wa, 256);
-
 /* Driver */
-struct Mc33810 : public GpioChip {
+struct Mc33810 : public GpioChip, public SpiRefreshClient {
 	int init() override;
 
 	int writePad(size_t pin, int value) override;
 	brain_pin_diag_e getDiag(size_t pin) override;
 
-
+	/* outputs and diagnostic are refreshed by the SPI bus thread, see gpio_spi.h */
+	bool prepareRefresh(SpiBatch &batch, int stage, bool diagnosticDue) override;
+	bool finishRefresh(const SpiBatch &batch, int stage) override;
+	const SPIConfig *getSpiConfig() const override {
+		return &cfg->spi_config;
+	}
 
 	// internal functions
 	int spi_rw(uint16_t tx, uint16_t* rx);
-	int update_output_and_diag();
 
 	int chip_init();
-	void wake_driver();
 
 
 	const mc33810_config	*cfg;
 	/* cached output state - state last send to chip */
 	uint8_t					o_state_cached;
+	/* state being sent to chip by the current refresh */
+	uint8_t					o_state_sending;
 	/* state to be sended to chip */
 	uint8_t					o_state;
 	/* direct driven output mask */
@@ -126,6 +126,12 @@ struct Mc33810 : public GpioChip {
 	/* IGN mode fault register */
 	uint16_t				ign_fault;
 
+	/* batch index of the word whose response is the register, -1 if not read by this refresh */
+	int						all_status_idx;
+	int						out_fault_idx[2];
+	int						gpgd_fault_idx;
+	int						ign_fault_idx;
+
 	mc33810_drv_state		drv_state;
 };
 
@@ -185,85 +191,99 @@ int Mc33810::spi_rw(uint16_t tx, uint16_t *rx)
 }
 
 /**
- * @brief MC33810 send output state data.
- * @details Sends ORed data to register, also receive diagnostic.
+ * @brief MC33810 output and diagnostic refresh.
+ * @details Stage 0 sends the output state and, when diagnostic is due, reads ALL STATUS.
+ * Reply on every command 0x1..0xa and on ALL STATUS read is ALL STATUS RESPONSE,
+ * reply on other register read is that register, in both cases with the next transfer.
+ * If ALL STATUS shows a fault, stage 1 reads the fault registers.
  */
 
-int Mc33810::update_output_and_diag()
+bool Mc33810::prepareRefresh(SpiBatch &batch, int stage, bool diagnosticDue)
 {
-	int ret = 0;
+	if ((drv_state == MC33810_DISABLED) ||
+		(drv_state == MC33810_FAILED))
+		return false;
+
+	if (stage == 0) {
+		all_status_idx = -1;
+
+		/* if any pin is driven over SPI */
+		if (o_direct_mask != 0xff) {
+			/* atomic */
+			o_state_sending = o_state;
+			batch.add(MC_CMD_DRIVER_EN(o_state_sending & (~o_direct_mask)));
+		}
 
-	/* TODO: lock? */
+		if (diagnosticDue) {
+			if (batch.getWordCount() == 0) {
+				batch.add(MC_CMD_READ_REG(REG_ALL_STAT));
+			}
+			all_status_idx = batch.add(MC_CMD_READ_REG(REG_ALL_STAT));
+		}
 
-	/* we need to get updates status */
-	all_status_updated = false;
+		return batch.getWordCount() != 0;
+	}
 
-	/* if any pin is driven over SPI */
-	if (o_direct_mask != 0xff) {
-		uint16_t out_data;
+	if (stage == 1) {
+		out_fault_idx[0] = out_fault_idx[1] = gpgd_fault_idx = ign_fault_idx = -1;
+
+		/* check OUT (injectors) first */
+		if (all_status_value & 0x000f) {
+			/* request diagnostic of OUT0 and OUT1 */
+			batch.add(MC_CMD_READ_REG(REG_OUT10_FAULT));
+			/* get diagnostic for OUT0 and OUT1 and request diagnostic for OUT2 and OUT3 */
+			out_fault_idx[0] = batch.add(MC_CMD_READ_REG(REG_OUT32_FAULT));
+			/* get diagnostic for OUT2 and OUT2 and requset ALL STATUS */
+			out_fault_idx[1] = batch.add(MC_CMD_READ_REG(REG_ALL_STAT));
+		}
+		/* check GPGD - mode not supported yet */
+		if (all_status_value & 0x00f0) {
+			batch.add(MC_CMD_READ_REG(REG_GPGD_FAULT));
+			gpgd_fault_idx = batch.add(MC_CMD_READ_REG(REG_ALL_STAT));
+		}
+		/* check IGN */
+		if (all_status_value & 0x0f00) {
+			batch.add(MC_CMD_READ_REG(REG_IGN_FAULT));
+			ign_fault_idx = batch.add(MC_CMD_READ_REG(REG_ALL_STAT));
+		}
 
-		out_data = o_state & (~o_direct_mask);
-		ret = spi_rw(MC_CMD_DRIVER_EN(out_data), NULL);
-		if (ret)
-			return ret;
-		o_state_cached = o_state;
+		return batch.getWordCount() != 0;
 	}
 
-	/* this comlicated logic to save few spi transfers in case we will receive status as reply on other command */
-	if (!all_status_requested) {
-		ret = spi_rw(MC_CMD_READ_REG(REG_ALL_STAT), NULL);
-		if (ret)
-			return ret;
-	}
-	/* get reply */
-	if (!all_status_updated) {
-		ret = spi_rw(MC_CMD_READ_REG(REG_ALL_STAT), NULL);
-		if (ret)
-			return ret;
-	}
-	/* now we have updated ALL STATUS register in chip data */
-
-	/* check OUT (injectors) first */
-	if (all_status_value & 0x000f) {
-		/* request diagnostic of OUT0 and OUT1 */
-		ret = spi_rw(MC_CMD_READ_REG(REG_OUT10_FAULT), NULL);
-		if (ret)
-			return ret;
-		/* get diagnostic for OUT0 and OUT1 and request diagnostic for OUT2 and OUT3 */
-		ret = spi_rw(MC_CMD_READ_REG(REG_OUT32_FAULT), &out_fault[0]);
-		if (ret)
-			return ret;
-		/* get diagnostic for OUT2 and OUT2 and requset ALL STATUS */
-		ret = spi_rw(MC_CMD_READ_REG(REG_ALL_STAT), &out_fault[1]);
-		if (ret)
-			return ret;
-	}
-	/* check GPGD - mode not supported yet */
-	if (all_status_value & 0x00f0) {
-		/* request diagnostic of GPGD */
-		ret = spi_rw(MC_CMD_READ_REG(REG_GPGD_FAULT), NULL);
-		if (ret)
-			return ret;
-		/* get diagnostic for GPGD and requset ALL STATUS */
-		ret = spi_rw(MC_CMD_READ_REG(REG_ALL_STAT), &gpgd_fault);
-		if (ret)
-			return ret;
-	}
-	/* check IGN  */
-	if (all_status_value & 0x0f00) {
-		/* request diagnostic of IGN */
-		ret = spi_rw(MC_CMD_READ_REG(REG_IGN_FAULT), NULL);
-		if (ret)
-			return ret;
-		/* get diagnostic for IGN and requset ALL STATUS */
-		ret = spi_rw(MC_CMD_READ_REG(REG_ALL_STAT), &ign_fault);
-		if (ret)
-			return ret;
+	return false;
+}
+
+bool Mc33810::finishRefresh(const SpiBatch &batch, int stage)
+{
+	/* last word of every batch is ALL STATUS read or a command with ALL STATUS reply */
+	all_status_requested = true;
+
+	if (stage == 0) {
+		if (o_direct_mask != 0xff) {
+			/* atomic */
+			o_state_cached = o_state_sending;
+		}
+
+		if (all_status_idx < 0)
+			return false;
+
+		/* now we have updated ALL STATUS register in chip data */
+		all_status_value = batch.getRx(all_status_idx);
+		all_status_updated = true;
+
+		return (all_status_value & 0x0fff) != 0;
 	}
 
-	/* TODO: unlock? */
+	if (out_fault_idx[0] >= 0) {
+		out_fault[0] = batch.getRx(out_fault_idx[0]);
+		out_fault[1] = batch.getRx(out_fault_idx[1]);
+	}
+	if (gpgd_fault_idx >= 0)
+		gpgd_fault = batch.getRx(gpgd_fault_idx);
+	if (ign_fault_idx >= 0)
+		ign_fault = batch.getRx(ign_fault_idx);
 
-	return ret;
+	return false;
 }
 
 /**
@@ -376,62 +396,6 @@ err_gpios:
 	return ret;
 }
 
-/**
- * @brief MC33810 chip driver wakeup.
- * @details Wake up driver. Will cause output register and
- * diagnostic update.
- */
-
-void Mc33810::wake_driver()
-{
-	/* Entering a reentrant critical zone.*/
-	chibios_rt::CriticalSectionLocker csl;
-	chSemSignalI(&mc33810_wake);
-	if (!port_is_isr_context()) {
-		/**
-		 * chSemSignalI above requires rescheduling
-		 * interrupt handlers have implicit rescheduling
-		 */
-		chSchRescheduleS();
-	}
-}
-
-/*==========================================================================*/
-/* Driver thread.															*/
-/*==========================================================================*/
-
-static THD_FUNCTION(mc33810_driver_thread, p)
-{
-	int i;
-	msg_t msg;
-
-	(void)p;
-
-	chRegSetThreadName(DRIVER_NAME);
-
-	while(1) {
-		msg = chSemWaitTimeout(&mc33810_wake, TIME_MS2I(MC33810_POLL_INTERVAL_MS));
-
-		/* should we care about msg == MSG_TIMEOUT? */
-		(void)msg;
-
-		for (i = 0; i < BOARD_MC33810_COUNT; i++) {
-			auto chip = &chips[i];
-
-			if ((chip->cfg == NULL) ||
-				(chip->drv_state == MC33810_DISABLED) ||
-				(chip->drv_state == MC33810_FAILED))
-				continue;
-
-			/* TODO: implemet indirect driven gpios */
-			int ret = chip->update_output_and_diag();
-			if (ret) {
-				/* set state to MC33810_FAILED? */
-			}
-		}
-	}
-}
-
 /*==========================================================================*/
 /* Driver interrupt handlers.												*/
 /*==========================================================================*/
@@ -468,7 +432,7 @@ int Mc33810::writePad(size_t pin, int value)
 			palClearPort(cfg->direct_io[pin].port,
 					   PAL_PORT_BIT(cfg->direct_io[pin].pad));
 	} else {
-		wake_driver();
+		gpio_spi_request_refresh(*this);
 	}
 
 	return 0;
@@ -524,13 +488,7 @@ int Mc33810::init()
 
 	drv_state = MC33810_READY;
 
-	if (!drv_task_ready) {
-		chThdCreateStatic(mc33810_thread_1_wa, sizeof(mc33810_thread_1_wa),
-						  PRIO_GPIOCHIP, mc33810_driver_thread, nullptr);
-		drv_task_ready = true;
-	}
-
-	return 0;
+	return gpio_spi_add(cfg->spi_bus, *this, DRIVER_NAME, MC33810_POLL_INTERVAL_MS);
 }
 
 /**
@@ -20,6 +20,7 @@
 #define MC33810_DIRECT_OUTPUTS		8
 
 /* DOTO: add irq support */
+/* diagnostic interval of the SPI refresh thread, see gpio_spi.h */
 #define MC33810_POLL_INTERVAL_MS	100
 
 struct mc33810_config {
@@ -23,6 +23,7 @@
 #include "pch.h"
 
 #include "gpio/gpio_ext.h"
+#include "gpio/gpio_spi.h"
 #include "gpio/tle6240.h"
 
 #if (BOARD_TLE6240_COUNT > 0)
@@ -37,7 +38,6 @@
  * - fill deinit function with some code?
  * - support emergency shutdown using reset pin
  * - convert diagnostic to some enum
- * - use DMA (currently there is issue (?) with SPI+DMA on STM32F7xx)
  */
 
 /*==========================================================================*/
@@ -46,8 +46,6 @@
 
 #define DRIVER_NAME				"tle6240"
 
-static bool drv_task_ready = false;
-
 typedef enum {
 	TLE6240_DISABLED = 0,
 	TLE6240_WAIT_INIT,
@@ -76,17 +74,19 @@ typedef enum {
 /* Driver local variables and types.										*/
 /*==========================================================================*/
 
-/* OS */
-SEMAPHORE_DECL(tle6240_wake, 10 /* or BOARD_TLE6240_COUNT ? */);
-static THD_WORKING_AREA(tle6240_thread_1_wa, 256);
-
 /* Driver */
-struct Tle6240 : public GpioChip {
+struct Tle6240 : public GpioChip, public SpiRefreshClient {
 	int init() override;
 
 	int writePad(size_t pin, int value) override;
 	brain_pin_diag_e getDiag(size_t pin) override;
 
+	/* outputs and diagnostic are refreshed by the SPI bus thread, see gpio_spi.h */
+	bool prepareRefresh(SpiBatch &batch, int stage, bool diagnosticDue) override;
+	bool finishRefresh(const SpiBatch &batch, int stage) override;
+	const SPIConfig *getSpiConfig() const override {
+		return &cfg->spi_config;
+	}
 
 	// internal functions
 	int spi_rw(uint16_t tx, uint16_t *rx);
@@ -97,6 +97,8 @@ struct Tle6240 : public GpioChip {
 	const tle6240_config	*cfg;
 	/* cached output state - state last send to chip */
 	uint16_t					o_state_cached;
+	/* state being sent to chip by the current refresh */
+	uint16_t					o_state_sending;
 	/* state to be sended to chip */
 	uint16_t					o_state;
 	/* direct driven output mask */
@@ -302,63 +304,53 @@ err_gpios:
 	return ret;
 }
 
+/*==========================================================================*/
+/* Driver SPI refresh.														*/
+/*==========================================================================*/
+
 /**
- * @brief TLE6240 chip driver wakeup.
- * @details Wake up driver. Will cause output register and
- * diagnostic update.
+ * @brief TLE6240 output and diagnostic refresh.
+ * @details Same exchange as update_output_and_diag(), but as one batch
+ * on the shared SPI bus. Diagnostic comes with every output update anyway.
  */
 
-static int tle6240_wake_driver()
+bool Tle6240::prepareRefresh(SpiBatch &batch, int stage, bool /*diagnosticDue*/)
 {
-	/* Entering a reentrant critical zone.*/
-	chibios_rt::CriticalSectionLocker csl;
-
-	chSemSignalI(&tle6240_wake);
-	if (!port_is_isr_context()) {
-		/**
-		 * chSemSignalI above requires rescheduling
-		 * interrupt handlers have implicit rescheduling
-		 */
-		chSchRescheduleS();
+	if ((stage != 0) ||
+		(drv_state == TLE6240_DISABLED) ||
+		(drv_state == TLE6240_FAILED))
+		return false;
+
+	/* atomic */
+	/* set value only for non-direct driven pins */
+	o_state_sending = o_state & (~o_direct_mask);
+
+	batch.add(CMD_OR_DIAG(0, (o_state_sending >> 0) & 0xff));
+	batch.add(CMD_OR_DIAG(8, (o_state_sending >> 8) & 0xff));
+	if (!diag_8_reguested) {
+		/* send same one more time to receive OUT8..15 diagnostic */
+		batch.add(CMD_OR_DIAG(8, (o_state_sending >> 8) & 0xff));
 	}
 
-	return 0;
+	return true;
 }
 
-/*==========================================================================*/
-/* Driver thread.															*/
-/*==========================================================================*/
-
-static THD_FUNCTION(tle6240_driver_thread, p)
+bool Tle6240::finishRefresh(const SpiBatch &batch, int /*stage*/)
 {
-	int i;
-	msg_t msg;
-
-	(void)p;
-
-	chRegSetThreadName(DRIVER_NAME);
-
-	while(1) {
-		msg = chSemWaitTimeout(&tle6240_wake, TIME_MS2I(TLE6240_POLL_INTERVAL_MS));
-
-		/* should we care about msg == MSG_TIMEOUT? */
-		(void)msg;
-
-		for (i = 0; i < BOARD_TLE6240_COUNT; i++) {
-			int ret;
-			Tle6240& chip = chips[i];
+	if (diag_8_reguested) {
+		/* diagnostic for OUT8..15 was requested on prev access */
+		diag[1] = batch.getRx(0);
+		diag[0] = batch.getRx(1);
+	} else {
+		diag[0] = batch.getRx(1);
+		diag[1] = batch.getRx(2);
+	}
 
-			if (!chip.cfg ||
-				(chip.drv_state == TLE6240_DISABLED) ||
-				(chip.drv_state == TLE6240_FAILED))
-				continue;
+	/* atomic */
+	o_state_cached = o_state_sending;
+	diag_8_reguested = true;
 
-			ret = chip.update_output_and_diag();
-			if (ret) {
-				/* set state to TLE6240_FAILED? */
-			}
-		}
-	}
+	return false;
 }
 
 /*==========================================================================*/
@@ -397,7 +389,7 @@ int Tle6240::writePad(unsigned int pin, int value)
 			palClearPort(cfg->direct_io[n].port,
 					   PAL_PORT_BIT(cfg->direct_io[n].pad));
 	} else {
-		tle6240_wake_driver();
+		gpio_spi_request_refresh(*this);
 	}
 
 	return 0;
@@ -433,13 +425,7 @@ int Tle6240::init()
 
 	drv_state = TLE6240_READY;
 
-	if (!drv_task_ready) {
-		chThdCreateStatic(tle6240_thread_1_wa, sizeof(tle6240_thread_1_wa),
-						  PRIO_GPIOCHIP, tle6240_driver_thread, nullptr);
-		drv_task_ready = true;
-	}
-
-	return 0;
+	return gpio_spi_add(cfg->spi_bus, *this, DRIVER_NAME, TLE6240_POLL_INTERVAL_MS);
 }
 
 /**
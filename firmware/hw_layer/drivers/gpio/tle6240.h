@@ -16,6 +16,7 @@
 #define TLE6240_DIRECT_OUTPUTS		8
 
 /* DOTO: add irq support */
+/* diagnostic interval of the SPI refresh thread, see gpio_spi.h */
 #define TLE6240_POLL_INTERVAL_MS	100
 
 struct tle6240_config {
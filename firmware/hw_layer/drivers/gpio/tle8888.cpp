@@ -38,6 +38,9 @@
 #include "persistent_configuration.h"
 #include "hardware.h"
 #include "gpio/gpio_ext.h"
+#include "gpio/gpio_spi.h"
+
+#include <algorithm>
 
 static Timer diagResponse;
 
@@ -58,6 +61,12 @@ typedef enum {
 	TLE8888_FAILED
 } tle8888_drv_state;
 
+/* what the refresh stages after the first one do */
+typedef enum {
+	TLE8888_STEP_STATUS = 0,
+	TLE8888_STEP_INIT
+} tle8888_refresh_step;
+
 /* SPI communication helpers */
 /* C0 */
 #define CMD_READ			(0 << 0)
@@ -165,7 +174,7 @@ const uint8_t tle8888_fwd_responses[16][4] = {
 /*==========================================================================*/
 
 /* Driver private data */
-struct Tle8888 : public GpioChip {
+struct Tle8888 : public GpioChip, public SpiRefreshClient {
 	int init() override;
 	int deinit() override;
 
@@ -174,26 +183,29 @@ struct Tle8888 : public GpioChip {
 	int readPad(size_t pin) override;
 	brain_pin_diag_e getDiag(size_t pin) override;
 
+	/* outputs, watchdog and diagnostic are refreshed by the SPI bus thread, see gpio_spi.h */
+	bool prepareRefresh(SpiBatch &batch, int stage, bool diagnosticDue) override;
+	bool finishRefresh(const SpiBatch &batch, int stage) override;
+	/* watchdog service */
+	efitick_t getDeadlineNt() const override;
+	const SPIConfig *getSpiConfig() const override {
+		return &cfg->spi_config;
+	}
+
 	// internal functions
 	void read_reg(uint16_t reg, uint16_t* val);
 	int spi_rw(uint16_t tx, uint16_t *rx_ptr);
 	int spi_validate(uint16_t rx);
-	int spi_rw_array(const uint16_t *tx, uint16_t *rx, int n);
-	int update_status_and_diag();
+	int spi_validate_batch(const SpiBatch &batch);
 
-	int update_output();
+	void add_output(SpiBatch &batch);
+	void add_status_and_diag(SpiBatch &batch);
+	int finish_status_and_diag(const SpiBatch &batch, bool valid);
 	int update_direct_output(size_t pin, int value);
-	int wake_driver();
 
 	int chip_reset();
 
-	int chip_init();
-
-	int wwd_feed();
-	int fwd_feed();
-	int wd_get_status();
-	int wd_feed();
-	int calc_sleep_interval();
+	void add_chip_init(SpiBatch &batch);
 
 	brain_pin_diag_e getOutputDiag(size_t pin);
 	brain_pin_diag_e getInputDiag(size_t pin);
@@ -202,11 +214,6 @@ struct Tle8888 : public GpioChip {
 
 	const tle8888_config	*cfg;
 
-	/* thread stuff */
-	thread_t 					*thread;
-	THD_WORKING_AREA(thread_wa, 256);
-	semaphore_t					wake;
-
 	/* state to be sent to chip */
 	uint32_t					o_state;
 	/* direct driven output mask */
@@ -219,6 +226,8 @@ struct Tle8888 : public GpioChip {
 	uint32_t					o_pp_mask;
 	/* cached output registers state - value last send to chip */
 	uint32_t					o_data_cached;
+	/* output registers state being sent to chip by the current refresh */
+	uint32_t					o_data_sending;
 
 	tle8888_drv_state			drv_state;
 
@@ -236,17 +245,25 @@ struct Tle8888 : public GpioChip {
 	/* status registers */
 	uint8_t						OpStat[2];
 
-	/* last diagnostic was read */
-	systime_t					diag_ts;
-
 	/* WD stuff */
 	uint8_t						wwd_err_cnt;
 	uint8_t						fwd_err_cnt;
 	uint8_t						tot_err_cnt;
 	uint8_t						wd_diag;
 	bool						wd_happy;
-	systime_t					wwd_ts;
-	systime_t					fwd_ts;
+	/* next service due */
+	efitick_t					wwd_ts;
+	efitick_t					fwd_ts;
+
+	/* current refresh */
+	tle8888_refresh_step		refresh_step;
+	bool						diag_due;
+	bool						wwd_fed;
+	bool						fwd_fed;
+	int							fwd_quest_idx;
+	uint16_t					fwd_response_cmd;
+	int							wd_stat_idx;
+	int							diag_idx;
 
 	/* chip needs reintialization due to some critical issue */
 	bool						need_init;
@@ -340,11 +357,9 @@ int Tle8888::spi_validate(uint16_t rx)
 /**
  * @returns -1 in case of communication error
  */
-int Tle8888::spi_rw(uint16_t tx, uint16_t *rx_ptr)
+int Tle8888::spi_validate_batch(const SpiBatch &batch)
 {
-	int ret;
-	uint16_t rx;
-	SPIDriver *spi = cfg->spi_bus;
+	int ret = 0;
 
 	/**
 	 * 15.1 SPI Protocol
@@ -353,100 +368,51 @@ int Tle8888::spi_rw(uint16_t tx, uint16_t *rx_ptr)
 	 * is transmitted with the next SPI transmission (for not existing addresses or
 	 * wrong access mode the data is always 0)
 	 */
+	for (size_t i = 0; i < batch.getWordCount(); i++) {
+		uint16_t tx = batch.getTx()[i];
+		uint16_t rx = batch.getRx(i);
 
-	/* Acquire ownership of the bus. */
-	spiAcquireBus(spi);
-	/* Setup transfer parameters. */
-	spiStart(spi, &cfg->spi_config);
-	/* Slave Select assertion. */
-	spiSelect(spi);
-	/* Atomic transfer operations. */
-	rx = spiPolledExchange(spi, tx);
-	/* Slave Select de-assertion. */
-	spiUnselect(spi);
-	/* Ownership release. */
-	spiReleaseBus(spi);
-
-	/* statisctic and debug */
-	recentTx = tx;
-	recentRx = rx;
-	this->spi_cnt++;
-
-	if (rx_ptr)
-		*rx_ptr = rx;
+		/* statistic and debug */
+		recentTx = tx;
+		recentRx = rx;
+		this->spi_cnt++;
 
-	/* validate reply and save last accessed register */
-	ret = spi_validate(rx);
-	last_reg = getRegisterFromResponse(tx);
+		/* validate reply and save last accessed register */
+		if (ret == 0)
+			ret = spi_validate(rx);
+		last_reg = getRegisterFromResponse(tx);
+	}
 
-	/* no errors for now */
 	return ret;
 }
 
 /**
- * @return -1 in case of communication error
+ * @brief Single word exchange outside of the refresh passes: reset and register dump.
+ * @returns -1 in case of communication error
  */
-int Tle8888::spi_rw_array(const uint16_t *tx, uint16_t *rx, int n)
+int Tle8888::spi_rw(uint16_t tx, uint16_t *rx_ptr)
 {
-	int ret = 0;
-	SPIDriver *spi = cfg->spi_bus;
+	SpiBatch batch;
 
-	if (n <= 0) {
-		return -2;
-	}
+	batch.add(tx);
 
-	/**
-	 * 15.1 SPI Protocol
-	 *
-	 * after a read or write command: the address and content of the selected register
-	 * is transmitted with the next SPI transmission (for not existing addresses or
-	 * wrong access mode the data is always 0)
-	 */
-
-	/* Acquire ownership of the bus. */
-	spiAcquireBus(spi);
-	/* Setup transfer parameters. */
-	spiStart(spi, &cfg->spi_config);
-
-	for (int i = 0; i < n; i++) {
-		/* Slave Select assertion. */
-		spiSelect(spi);
-		/* data transfer */
-		uint16_t rxdata = spiPolledExchange(spi, tx[i]);
-
-		if (rx)
-			rx[i] = rxdata;
-		/* Slave Select de-assertion. */
-		spiUnselect(spi);
-
-		/* statistic and debug */
-		recentTx = tx[i];
-		recentRx = rxdata;
-		this->spi_cnt++;
-
-		/* validate reply and save last accessed register */
-		ret = spi_validate(rxdata);
-		last_reg = getRegisterFromResponse(tx[i]);
+	if (gpio_spi_exchange(cfg->spi_bus, *this, batch) < 0)
+		return -1;
 
-		if (ret < 0)
-			break;
-	}
-	/* Ownership release. */
-	spiReleaseBus(spi);
+	if (rx_ptr)
+		*rx_ptr = batch.getRx(0);
 
-	/* no errors for now */
-	return ret;
+	return spi_validate_batch(batch);
 }
 
 /**
- * @brief TLE8888 send output registers data.
+ * @brief TLE8888 output registers data.
  * @details Sends ORed data to register.
  */
 
-int Tle8888::update_output()
+void Tle8888::add_output(SpiBatch &batch)
 {
 	int i;
-	int ret;
 
 	uint8_t briconfig0 = 0;
 
@@ -471,70 +437,113 @@ int Tle8888::update_output()
 	 * (at least until we start supporting hi-Z state) */
 	o_data |= o_pp_mask;
 
-	uint16_t tx[] = {
-		/* bridge config */
-		CMD_BRICONFIG(0, briconfig0),
-		/* output enables */
-		CMD_CONT(0, o_data >>  0),
-		CMD_CONT(1, o_data >>  8),
-		CMD_CONT(2, o_data >> 16),
-		CMD_CONT(3, o_data >> 24),
-		/* Main Relay output: manual vs auto-mode */
-		CMD_CMD0((mr_manual ? REG_CMD0_MRSE : 0x0) |
-				 ((o_data & BIT(TLE8888_OUTPUT_MR)) ? REG_CMD0_MRON : 0x0))
-	};
-	ret = spi_rw_array(tx, NULL, efi::size(tx));
+	/* atomic */
+	o_data_sending = o_data;
+
+	/* bridge config */
+	batch.add(CMD_BRICONFIG(0, briconfig0));
+	/* output enables */
+	batch.add(CMD_CONT(0, o_data >>  0));
+	batch.add(CMD_CONT(1, o_data >>  8));
+	batch.add(CMD_CONT(2, o_data >> 16));
+	batch.add(CMD_CONT(3, o_data >> 24));
+	/* Main Relay output: manual vs auto-mode */
+	batch.add(CMD_CMD0((mr_manual ? REG_CMD0_MRSE : 0x0) |
+					   ((o_data & BIT(TLE8888_OUTPUT_MR)) ? REG_CMD0_MRON : 0x0)));
+}
 
-	if (ret == 0) {
-		/* atomic */
-		o_data_cached = o_data;
+/**
+ * @brief TLE8888 watchdog status and diagnostic registers.
+ * @details Chained read of several registers, the address and content of the selected
+ * register is transmitted with the next SPI transmission
+ */
+void Tle8888::add_status_and_diag(SpiBatch &batch)
+{
+	wd_stat_idx = -1;
+	if (wwd_fed || fwd_fed) {
+		batch.add(CMD_WWDSTAT);
+		/* WWDSTAT, FWDSTAT0, TECSTAT */
+		wd_stat_idx = batch.add(CMD_FWDSTAT(0));
+		batch.add(CMD_TECSTAT);
+		batch.add(CMD_TECSTAT);
+		/* WDDIAG */
+		batch.add(CMD_WDDIAG);
+		batch.add(CMD_WDDIAG);
 	}
 
-	return ret;
+	diag_idx = -1;
+	if (diag_due) {
+		diag_idx = batch.add(CMD_OUTDIAG(0));
+		batch.add(CMD_OUTDIAG(1));
+		batch.add(CMD_OUTDIAG(2));
+		batch.add(CMD_OUTDIAG(3));
+		batch.add(CMD_OUTDIAG(4));
+		batch.add(CMD_PPOVDIAG);
+		batch.add(CMD_BRIDIAG(0));
+		batch.add(CMD_BRIDIAG(1));
+		batch.add(CMD_IGNDIAG);
+		batch.add(CMD_OPSTAT(0));
+		batch.add(CMD_OPSTAT(1));
+		batch.add(CMD_OPSTAT(1));
+	}
 }
 
 /**
- * @brief read TLE8888 diagnostic registers data.
- * @details Chained read of several registers
+ * @return -1 if the watchdog caused a reset
  */
-int Tle8888::update_status_and_diag()
+int Tle8888::finish_status_and_diag(const SpiBatch &batch, bool valid)
 {
-	int ret = 0;
-	const uint16_t tx[] = {
-		CMD_OUTDIAG(0),
-		CMD_OUTDIAG(1),
-		CMD_OUTDIAG(2),
-		CMD_OUTDIAG(3),
-		CMD_OUTDIAG(4),
-		CMD_PPOVDIAG,
-		CMD_BRIDIAG(0),
-		CMD_BRIDIAG(1),
-		CMD_IGNDIAG,
-		CMD_OPSTAT(0),
-		CMD_OPSTAT(1),
-		CMD_OPSTAT(1)
-	};
-	uint16_t rx[efi::size(tx)];
+	if (wd_stat_idx >= 0) {
+		wwd_err_cnt = getDataFromResponse(batch.getRx(wd_stat_idx + 0)) & 0x7f;
+		fwd_err_cnt = getDataFromResponse(batch.getRx(wd_stat_idx + 1)) & 0x7f;
+		tot_err_cnt = getDataFromResponse(batch.getRx(wd_stat_idx + 2)) & 0x7f;
+		wd_diag = getDataFromResponse(batch.getRx(wd_stat_idx + 4));
 
-	ret = spi_rw_array(tx, rx, efi::size(tx));
+		bool was_happy = wd_happy;
+		wd_happy = ((wwd_err_cnt == 0) &&
+					(fwd_err_cnt == 0));
 
-	if (ret == 0) {
-		/* the address and content of the selected register is transmitted with the
-		 * next SPI transmission */
-		OutDiag[0] = getDataFromResponse(rx[0 + 1]);
-		OutDiag[1] = getDataFromResponse(rx[1 + 1]);
-		OutDiag[2] = getDataFromResponse(rx[2 + 1]);
-		OutDiag[3] = getDataFromResponse(rx[3 + 1]);
-		OutDiag[4] = getDataFromResponse(rx[4 + 1]);
-		PPOVDiag   = getDataFromResponse(rx[5 + 1]);
-		BriDiag[0] = getDataFromResponse(rx[6 + 1]);
-		BriDiag[1] = getDataFromResponse(rx[7 + 1]);
-		IgnDiag    = getDataFromResponse(rx[8 + 1]);
-		OpStat[0]  = getDataFromResponse(rx[9 + 1]);
-		OpStat[1]  = getDataFromResponse(rx[10 + 1]);
+		if (wd_diag & 0x70) {
+			/* Reset caused by TEC
+			 * Reset caused by FWD
+			 * Reset caused by WWD */
+			return -1;
+		}
+		/* wd_diag & 0x0f: some error in WD handling */
+
+		/* happiness state has changed! */
+		if ((wd_happy != was_happy) && (wd_happy)) {
+			need_init = true;
+		}
 	}
 
-	return ret;
+	if ((diag_idx >= 0) && (valid)) {
+		const int i = diag_idx + 1;
+
+		OutDiag[0] = getDataFromResponse(batch.getRx(i + 0));
+		OutDiag[1] = getDataFromResponse(batch.getRx(i + 1));
+		OutDiag[2] = getDataFromResponse(batch.getRx(i + 2));
+		OutDiag[3] = getDataFromResponse(batch.getRx(i + 3));
+		OutDiag[4] = getDataFromResponse(batch.getRx(i + 4));
+		PPOVDiag   = getDataFromResponse(batch.getRx(i + 5));
+		BriDiag[0] = getDataFromResponse(batch.getRx(i + 6));
+		BriDiag[1] = getDataFromResponse(batch.getRx(i + 7));
+		IgnDiag    = getDataFromResponse(batch.getRx(i + 8));
+		OpStat[0]  = getDataFromResponse(batch.getRx(i + 9));
+		OpStat[1]  = getDataFromResponse(batch.getRx(i + 10));
+
+		diagResponse.reset();
+		/* TODO:
+		 * Procedure to switch on after failure condition occurred:
+		 *  - Read out of diagnosis bits
+		 *  - Second read out to verify that the failure conditions are not
+		 *    remaining
+		 *  - Set of the dedicated output enable bit of the affected channel
+		 *    if the diagnosis bit is not active anymore
+		 *  - Switch on of the channel */
+	}
+
+	return 0;
 }
 
 /**
@@ -576,27 +585,6 @@ int Tle8888::update_direct_output(size_t pin, int value)
 	return 0;
 }
 
-/**
- * @brief TLE8888 chip driver wakeup.
- * @details Wake up driver. Will cause output register update
- */
-
-int Tle8888::wake_driver()
-{
-	/* Entering a reentrant critical zone.*/
-	chibios_rt::CriticalSectionLocker csl;
-	chSemSignalI(&wake);
-	if (!port_is_isr_context()) {
-		/**
-		 * chSemSignalI above requires rescheduling
-		 * interrupt handlers have implicit rescheduling
-		 */
-		chSchRescheduleS();
-	}
-
-	return 0;
-}
-
 static brain_pin_diag_e tle8888_2b_to_diag_no_temp(unsigned int bits)
 {
 	if (bits == 0x01)
@@ -632,14 +620,12 @@ int Tle8888::chip_reset() {
 	return ret;
 }
 
-int Tle8888::chip_init()
+void Tle8888::add_chip_init(SpiBatch &batch)
 {
-	int ret;
-
 	/* statistic */
 	init_cnt++;
 
-	uint16_t tx[] = {
+	const uint16_t tx[] = {
 		/* unlock */
 		CMD_CHIP_UNLOCK,
 		/* set INCONFIG - aux input mapping */
@@ -695,201 +681,151 @@ int Tle8888::chip_init()
 		CMD_OE_SET
 	};
 
-	ret = spi_rw_array(tx, NULL, efi::size(tx));
-
-	if (ret == 0) {
-		/* enable pins */
-		if (cfg->ign_en.port)
-			palSetPort(cfg->ign_en.port, PAL_PORT_BIT(cfg->ign_en.pad));
-		if (cfg->inj_en.port)
-			palSetPort(cfg->inj_en.port, PAL_PORT_BIT(cfg->inj_en.pad));
-	}
-
-	if (engineConfiguration->verboseTLE8888) {
-		tle8888_dump_regs();
+	/* pins are enabled once the chip took it, see finishRefresh() */
+	for (size_t i = 0; i < efi::size(tx); i++) {
+		batch.add(tx[i]);
 	}
-
-	return ret;
 }
 
-int Tle8888::wwd_feed() {
-	spi_rw(CMD_WWDSERVICECMD, NULL);
-
-	return 0;
-}
-
-int Tle8888::fwd_feed() {
-	uint16_t reg;
-
-	spi_rw(CMD_FWDSTAT(1), NULL);
-	/* here we get response of the 'FWDStat1' above */
-	spi_rw(CMD_WDDIAG, &reg);
-
-	uint8_t data = getDataFromResponse(reg);
-	uint8_t fwdquest = data & 0xF;
-	uint8_t fwdrespc = (data >> 4) & 3;
-	/* Table lines are filled in reverse order (like in DS) */
-	uint8_t response = tle8888_fwd_responses[fwdquest][3 - fwdrespc];
-	if (fwdrespc != 0) {
-		spi_rw(CMD_FWDRESPCMD(response), NULL);
-	} else {
-		/* to restart heartbeat timer, sync command should be used for response 0 */
-		spi_rw(CMD_FWDRESPSYNCCMD(response), NULL);
-	}
-
-	return 0;
-}
-
-int Tle8888::wd_get_status() {
-	uint16_t reg;
+/*==========================================================================*/
+/* Driver SPI refresh.														*/
+/*==========================================================================*/
 
-	spi_rw(CMD_WDDIAG, NULL);
-	spi_rw(CMD_WDDIAG, &reg);
+/**
+ * @brief TLE8888 outputs, watchdog and diagnostic refresh.
+ * @details Every pass starts with the outputs, the window watchdog service and the functional
+ * watchdog question when they are due. The next stage answers the question and reads the watchdog
+ * status and, if due, the diagnostic registers. The chip is re-initialized in a last stage when
+ * needed, the bus is held all along.
+ */
 
-	wd_diag = getDataFromResponse(reg);
+bool Tle8888::prepareRefresh(SpiBatch &batch, int stage, bool diagnosticDue)
+{
+	if ((cfg == NULL) ||
+		(drv_state != TLE8888_READY))
+		return false;
 
-	if (wd_diag & 0x70) {
-		/* Reset caused by TEC
-		 * Reset caused by FWD
-		 * Reset caused by WWD */
-		 return -1;
-	}
-	if (wd_diag & 0x0f) {
-		/* Some error in WD handling */
-		return 1;
-	}
+	if (stage == 0) {
+		efitick_t nowNt = getTimeNowNt();
 
-	return 0;
-}
+		diag_due = diagnosticDue;
 
-int Tle8888::wd_feed() {
-	bool update_status;
+		/* update outputs even if WD is not happy */
+		add_output(batch);
 
-	if (wwd_ts <= chVTGetSystemTimeX()) {
-		update_status = true;
-		if (wwd_feed() == 0) {
-			wwd_ts = chTimeAddX(chVTGetSystemTimeX(), TIME_MS2I(WWD_PERIOD_MS));
+		wwd_fed = wwd_ts <= nowNt;
+		if (wwd_fed) {
+			batch.add(CMD_WWDSERVICECMD);
 		}
-	}
 
-	if (fwd_ts <= chVTGetSystemTimeX()) {
-		update_status = true;
-		if (fwd_feed() == 0) {
-			fwd_ts = chTimeAddX(chVTGetSystemTimeX(), TIME_MS2I(FWD_PERIOD_MS));
+		fwd_fed = fwd_ts <= nowNt;
+		if (fwd_fed) {
+			batch.add(CMD_FWDSTAT(1));
+			/* here we get response of the 'FWDStat1' above */
+			fwd_quest_idx = batch.add(CMD_WDDIAG);
 		}
-	}
 
-	if (update_status) {
-		uint16_t wwd_reg, fwd_reg, tec_reg;
+		refresh_step = TLE8888_STEP_STATUS;
+		return true;
+	}
 
-		spi_rw(CMD_WWDSTAT, NULL);
-		spi_rw(CMD_FWDSTAT(0), &wwd_reg);
-		spi_rw(CMD_TECSTAT, &fwd_reg);
-		spi_rw(CMD_TECSTAT, &tec_reg);
+	if (refresh_step == TLE8888_STEP_STATUS) {
+		if (fwd_fed) {
+			batch.add(fwd_response_cmd);
+			fwd_ts = getTimeNowNt() + MS2NT(FWD_PERIOD_MS);
+		}
 
-		wwd_err_cnt = getDataFromResponse(wwd_reg) & 0x7f;
-		fwd_err_cnt = getDataFromResponse(fwd_reg) & 0x7f;
-		tot_err_cnt = getDataFromResponse(tec_reg) & 0x7f;
+		add_status_and_diag(batch);
 
-		wd_happy = ((wwd_err_cnt == 0) &&
-						  (fwd_err_cnt == 0));
+		if (batch.getWordCount() != 0)
+			return true;
 
-		return wd_get_status();
-	} else {
-		return 0;
+		/* nothing to read, straight to init if needed */
+		if (!need_init)
+			return false;
+		refresh_step = TLE8888_STEP_INIT;
 	}
-}
-
-int Tle8888::calc_sleep_interval() {
-	systime_t now = chVTGetSystemTimeX();
 
-	sysinterval_t wwd_delay = chTimeDiffX(now, wwd_ts);
-	sysinterval_t fwd_delay = chTimeDiffX(now, fwd_ts);
-	sysinterval_t diag_delay = chTimeDiffX(now, diag_ts);
+	/* clear first, as flag can be raised again during init */
+	need_init = false;
+	/* re-init chip! */
+	add_chip_init(batch);
+	/* sync pins state */
+	add_output(batch);
 
-	if ((diag_delay <= wwd_delay) && (diag_delay <= fwd_delay))
-		return diag_delay;
-	if (fwd_delay <= wwd_delay)
-		return fwd_delay;
-	return wwd_delay;
+	return true;
 }
 
-/*==========================================================================*/
-/* Driver thread.															*/
-/*==========================================================================*/
-
-static THD_FUNCTION(tle8888_driver_thread, p) {
-	Tle8888 *chip = reinterpret_cast<Tle8888*>(p);
-	sysinterval_t poll_interval = 0;
-
-	chRegSetThreadName(DRIVER_NAME);
-
-	while (1) {
-		int ret;
-		msg_t msg = chSemWaitTimeout(&chip->wake, poll_interval);
-
-		/* should we care about msg == MSG_TIMEOUT? */
-		(void)msg;
-
-		/* default polling interval */
-		poll_interval = TIME_MS2I(DIAG_PERIOD_MS);
+bool Tle8888::finishRefresh(const SpiBatch &batch, int stage)
+{
+	int ret = spi_validate_batch(batch);
 
-		if ((chip->cfg == NULL) ||
-			(chip->drv_state == TLE8888_DISABLED) ||
-			(chip->drv_state == TLE8888_FAILED))
-			continue;
+	if (stage == 0) {
+		if (ret == 0) {
+			/* atomic */
+			o_data_cached = o_data_sending;
+		}
 
-		bool wd_happy = chip->wd_happy;
+		if (wwd_fed) {
+			wwd_ts = getTimeNowNt() + MS2NT(WWD_PERIOD_MS);
+		}
 
-		/* update outputs only if WD is happy */
-		if ((wd_happy) || (1)) {
-			ret = chip->update_output();
-			if (ret) {
-				/* set state to TLE8888_FAILED? */
+		if (fwd_fed) {
+			uint8_t data = getDataFromResponse(batch.getRx(fwd_quest_idx));
+			uint8_t fwdquest = data & 0xF;
+			uint8_t fwdrespc = (data >> 4) & 3;
+			/* Table lines are filled in reverse order (like in DS) */
+			uint8_t response = tle8888_fwd_responses[fwdquest][3 - fwdrespc];
+			if (fwdrespc != 0) {
+				fwd_response_cmd = CMD_FWDRESPCMD(response);
+			} else {
+				/* to restart heartbeat timer, sync command should be used for response 0 */
+				fwd_response_cmd = CMD_FWDRESPSYNCCMD(response);
 			}
 		}
 
-		ret = chip->wd_feed();
-		if (ret < 0) {
+		return true;
+	}
+
+	if (refresh_step == TLE8888_STEP_STATUS) {
+		if (finish_status_and_diag(batch, ret == 0) < 0) {
 			/* WD is not happy */
-			continue;
-		}
-		/* happiness state has changed! */
-		if ((chip->wd_happy != wd_happy) && (chip->wd_happy)) {
-			chip->need_init = true;
+			return false;
 		}
 
-		if (chip->need_init) {
-			/* clear first, as flag can be raised again during init */
-			chip->need_init = false;
-			/* re-init chip! */
-			chip->chip_init();
-			/* sync pins state */
-			chip->update_output();
-		}
+		if (!need_init)
+			return false;
 
-		if (chip->diag_ts <= chVTGetSystemTimeX()) {
-			/* this is expensive call, will do a lot of spi transfers... */
-			ret = chip->update_status_and_diag();
-			if (ret) {
-				/* set state to TLE8888_FAILED or force reinit? */
-			} else {
-				diagResponse.reset();
-			}
-			/* TODO:
-			 * Procedure to switch on after failure condition occurred:
-			 *  - Read out of diagnosis bits
-			 *  - Second read out to verify that the failure conditions are not
-			 *    remaining
-			 *  - Set of the dedicated output enable bit of the affected channel
-			 *    if the diagnosis bit is not active anymore
-			 *  - Switch on of the channel */
-
-			chip->diag_ts = chTimeAddX(chVTGetSystemTimeX(), TIME_MS2I(DIAG_PERIOD_MS));
-		}
+		refresh_step = TLE8888_STEP_INIT;
+		return true;
+	}
+
+	/* init */
+	if (ret == 0) {
+		/* enable pins */
+		if (cfg->ign_en.port)
+			palSetPort(cfg->ign_en.port, PAL_PORT_BIT(cfg->ign_en.pad));
+		if (cfg->inj_en.port)
+			palSetPort(cfg->inj_en.port, PAL_PORT_BIT(cfg->inj_en.pad));
 
-		poll_interval = chip->calc_sleep_interval();
+		/* atomic */
+		o_data_cached = o_data_sending;
 	}
+
+	if (engineConfiguration->verboseTLE8888) {
+		/* the bus is held here, registers are dumped by the "tle8888" command */
+		efiPrintf(DRIVER_NAME ": init #%d %s", init_cnt, ret == 0 ? "done" : "failed");
+	}
+
+	return false;
+}
+
+efitick_t Tle8888::getDeadlineNt() const
+{
+	if (drv_state != TLE8888_READY)
+		return 0;
+
+	return std::min<int64_t>(wwd_ts, fwd_ts);
 }
 
 /*==========================================================================*/
@@ -949,7 +885,7 @@ int Tle8888::writePad(unsigned int pin, int value) {
 	if (o_direct_mask & BIT(pin)) {
 		return update_direct_output(pin, value);
 	} else {
-		return wake_driver();
+		gpio_spi_request_refresh(*this);
 	}
 	return 0;
 }
@@ -1189,6 +1125,11 @@ int Tle8888::init()
 	if (drv_state != TLE8888_WAIT_INIT)
 		return -1;
 
+	/* the reset goes over the shared bus too, refreshes start once ready */
+	ret = gpio_spi_add(cfg->spi_bus, *this, DRIVER_NAME, DIAG_PERIOD_MS);
+	if (ret)
+		return ret;
+
 	ret = chip_reset();
 	if (ret)
 		return ret;
@@ -1197,18 +1138,14 @@ int Tle8888::init()
 	if (ret)
 		return ret;
 
-	/* force init from driver thread */
+	/* force init from the refresh, watchdogs are served right away */
 	need_init = true;
+	wwd_ts = fwd_ts = getTimeNowNt();
 
 	/* instance is ready */
 	drv_state = TLE8888_READY;
 
-	/* init semaphore */
-	chSemObjectInit(&wake, 10);
-
-	/* start thread */
-	thread = chThdCreateStatic(thread_wa, sizeof(thread_wa),
-									 PRIO_GPIOCHIP, tle8888_driver_thread, this);
+	gpio_spi_request_refresh(*this);
 
 	return 0;
 }
@@ -1221,8 +1158,8 @@ int Tle8888::deinit()
 	if (cfg->inj_en.port)
 		palClearPort(cfg->inj_en.port, PAL_PORT_BIT(cfg->inj_en.pad));
 
-	/* stop thread */
-	chThdTerminate(thread);
+	/* no more refreshes */
+	drv_state = TLE8888_DISABLED;
 
 	return 0;
 }
@@ -1282,6 +1219,8 @@ void tle8888_req_init() {
 
 	tle.need_init = true;
 	tle.init_req_cnt++;
+
+	gpio_spi_request_refresh(tle);
 }
 
 void tle8888_dump_regs() {
@@ -30,13 +30,13 @@ SPIDriver* getSdCardSpiDevice();
 Gpio getSdCardCsPin();
 #endif // HAL_USE_SPI
 
-#if EFI_PROD_CODE
-	struct SdLogBufferWriter final : public BufferedWriter<512> {
-		bool failed = false;
-
-		size_t writeInternal(const char* buffer, size_t count) override;
-	};
+// Log records get packed in to blocks of this size, which are written to the card whole.
+// A multiple of the sector size, so FatFs can send them straight to the card.
+#define SD_LOG_BLOCK_SIZE 1024
+// One block filling while the other one is being written
+#define SD_LOG_BLOCK_COUNT 2
 
+#if EFI_PROD_CODE
 	#include "ff.h"
 
 	// These are to get objects that need to be in memory safe
@@ -44,6 +44,7 @@ Gpio getSdCardCsPin();
 	namespace sd_mem {
 		FATFS* getFs();
 		FIL* getLogFileFd();
-		SdLogBufferWriter& getLogBuffer();
+		FIL* getCaptureFileFd();
+		uint8_t* getLogBlock(size_t index);
 	}
 #endif // EFI_PROD_CODE
@@ -35,14 +35,15 @@ struct {
 	struct {
 		FATFS fs;
 		FIL file;
-		SdLogBufferWriter logBuffer;
+		FIL captureFile;
+		alignas(4) uint8_t logBlocks[SD_LOG_BLOCK_COUNT][SD_LOG_BLOCK_SIZE];
 	} usedPart;
 
-	static_assert(sizeof(usedPart) <= 2048);
+	static_assert(sizeof(usedPart) <= 4096);
 
 	// Fill the struct out to a full MPU region
-	uint8_t padding[2048 - sizeof(usedPart)];
-} mmcCardCacheControlledStorage SDMMC_MEMORY(2048);
+	uint8_t padding[4096 - sizeof(usedPart)];
+} mmcCardCacheControlledStorage SDMMC_MEMORY(4096);
 
 namespace sd_mem {
 FATFS* getFs() {
@@ -53,8 +54,12 @@ FIL* getLogFileFd() {
 	return &mmcCardCacheControlledStorage.usedPart.file;
 }
 
-SdLogBufferWriter& getLogBuffer() {
-	return mmcCardCacheControlledStorage.usedPart.logBuffer;
+FIL* getCaptureFileFd() {
+	return &mmcCardCacheControlledStorage.usedPart.captureFile;
+}
+
+uint8_t* getLogBlock(size_t index) {
+	return mmcCardCacheControlledStorage.usedPart.logBlocks[index];
 }
 } // namespace sd_mem
 
@@ -134,8 +139,8 @@ BaseBlockDevice* initializeMmcBlockDevice() {
 	#if defined(STM32H7XX) && !EFI_BOOTLOADER
 	{
 		void* base = &mmcCardCacheControlledStorage;
-		static_assert(sizeof(mmcCardCacheControlledStorage) == 2048);
-		uint32_t size = MPU_RASR_SIZE_2K;
+		static_assert(sizeof(mmcCardCacheControlledStorage) == 4096);
+		uint32_t size = MPU_RASR_SIZE_4K;
 
 		mpuConfigureRegion(MPU_REGION_5,
 						base,
@@ -95,6 +95,7 @@ PinRepository::PinRepository() {
 
 #include "eficonsole.h"
 #include "drivers/gpio/gpio_ext.h"
+#include "drivers/gpio/gpio_spi.h"
 #include "smart_gpio.h"
 #include "hardware.h"
 
@@ -229,6 +230,10 @@ void initPinRepository() {
 	addConsoleAction("tle8888", tle8888_dump_regs);
 	addConsoleAction("tle8888init", tle8888_req_init);
 #endif
+
+#if (BOARD_SPI_REFRESH_CHIPS > 0)
+	addConsoleAction("spirefresh", gpio_spi_show_info);
+#endif
 }
 
 bool brain_pin_is_onchip(brain_pin_e brainPin)
@@ -9,6 +9,7 @@
 #include "pch.h"
 
 #include "AdcConfiguration.h"
+#include "software_knock.h"
 
 #if HAL_USE_ADC
 
@@ -418,7 +419,7 @@ static const ADCConversionGroup adcConvGroupCh2 = {
 };
 #endif // KNOCK_HAS_CH2
 
-NO_CACHE adcsample_t knockSampleBuffer[2048];
+NO_CACHE adcsample_t knockSampleBuffer[KNOCK_WINDOW_COUNT][KNOCK_WINDOW_SIZE];
 
 const ADCConversionGroup* getKnockConversionGroup(uint8_t channelIdx) {
 #if KNOCK_HAS_CH2
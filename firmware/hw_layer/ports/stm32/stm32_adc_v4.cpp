@@ -9,6 +9,7 @@
 #include "pch.h"
 
 #include "AdcConfiguration.h"
+#include "software_knock.h"
 
 #if HAL_USE_ADC
 
@@ -47,13 +48,13 @@ static constexpr int H7_ADC_SHIFT_BITS = log2_int(H7_ADC_OVERSAMPLE);
 
 // ADC3 is in the AHB4 domain, which is only accessible by the BDMA controller
 // BDMA can only access AHB4, which means we have to put the buffers in SRAM4
-__attribute__((section(".ram4"))) __attribute__ ((aligned (8192))) adcsample_t knockSampleBuffer[2048];
+__attribute__((section(".ram4"))) __attribute__ ((aligned (16384))) adcsample_t knockSampleBuffer[KNOCK_WINDOW_COUNT][KNOCK_WINDOW_SIZE];
 
 void portInitAdc() {
 	{
 		void* base = &knockSampleBuffer;
-		static_assert(sizeof(knockSampleBuffer) == 8192);
-		uint32_t size = MPU_RASR_SIZE_8K;
+		static_assert(sizeof(knockSampleBuffer) == 16384);
+		uint32_t size = MPU_RASR_SIZE_16K;
 
 		mpuConfigureRegion(MPU_REGION_3,
 						base,
@@ -217,6 +217,11 @@
 #define DL_OUTPUT_BUFFER 6500
 #endif
 
+// Text log lines waiting for TS to read them, a power of two
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 16384
+#endif
+
 #define EFI_ELECTRONIC_THROTTLE_BODY TRUE
 
 #ifndef EFI_MALFUNCTION_INDICATOR
@@ -41,3 +41,6 @@
 
 #undef LUA_USER_HEAP
 #define LUA_USER_HEAP 200000
+
+// Sensor conversion tables (16KB): all nine sensors at 256 points, or the MAF and three thermistors at 1024
+#define SENSOR_LUT_POOL_SIZE 4096
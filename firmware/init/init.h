@@ -20,6 +20,7 @@ void reconfigureSensors();
 // Sensor init/config
 void initVbatt();
 void initMaf();
+void configureMafCurve();
 void initMap();
 void initTps();
 void initFluidPressure();
@@ -40,6 +41,7 @@ void deinitTps();
 void deinitThermistors();
 void deinitFluidPressure();
 void deinitLambda();
+void deinitCanSensors();
 void deInitFlexSensor();
 void deinitAuxSensors();
 void deInitVehicleSpeedSensor();
@@ -0,0 +1,26 @@
+/**
+ * @file init_can_sensors.cpp
+ *
+ * Sensors read from user configured CAN signals
+ */
+
+#include "pch.h"
+
+#include "init.h"
+#include "can_rx_signals.h"
+
+void initCanSensors() {
+#if EFI_CAN_SUPPORT || EFI_UNIT_TEST
+	if (!engineConfiguration->canReadEnabled) {
+		return;
+	}
+
+	getCanRxSignals().configure(config->canRxSignals, efi::size(config->canRxSignals));
+#endif
+}
+
+void deinitCanSensors() {
+#if EFI_CAN_SUPPORT || EFI_UNIT_TEST
+	getCanRxSignals().reset();
+#endif
+}
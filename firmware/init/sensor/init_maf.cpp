@@ -5,6 +5,7 @@
 #include "functional_sensor.h"
 #include "table_func.h"
 #include "func_chain.h"
+#include "compiled_func.h"
 
 static FunctionalSensor maf (SensorType::Maf , /* timeout = */ MS2NT(50));
 static FunctionalSensor maf2(SensorType::Maf2, /* timeout = */ MS2NT(50));
@@ -34,6 +35,20 @@ struct MafTable : public SensorConverter {
 	}
 };
 
+// Voltage check and curve are stateless, so they can be sampled in to a lookup table
+static FuncChain<MafVoltageCheck, MafTable> mafCurveChain;
+static CompiledFunc mafCurveCompiled;
+
+struct MafCurve : public SensorConverter {
+	SensorResult convert(float input) const override {
+		return mafCurveCompiled.convert(input);
+	}
+
+	void showInfo(float testInputValue) const override {
+		mafCurveCompiled.showInfo(testInputValue);
+	}
+};
+
 struct MafFilter final : public SensorConverter {
 	SensorResult convert(float input) const override {
 		engine->outputChannels.mafMeasured_preFilter = input;
@@ -71,7 +86,13 @@ struct MafFilter final : public SensorConverter {
 	mutable float m_lastValue = 0;
 };
 
-static FuncChain<MafVoltageCheck, MafTable, MafFilter> mafFunction;
+static FuncChain<MafCurve, MafFilter> mafFunction;
+
+// The curve is sampled when settings are burned, edits in between don't make it in to the table
+void configureMafCurve() {
+	// With a size of 0 everything goes straight to the chain
+	mafCurveCompiled.compile(mafCurveChain, 0, 5.0f, getSensorLutSize(engineConfiguration->sensorConverterLut), getSensorLutPool());
+}
 
 static void initMaf(adc_channel_e channel, FunctionalSensor& m) {
 	if (!isAdcChannelValid(channel)) {
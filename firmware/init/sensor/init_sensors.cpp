@@ -7,8 +7,10 @@
 #include "init.h"
 #include "cli_registry.h"
 #include "io_pins.h"
+#include "compiled_func.h"
 
 static void initSensorCli();
+static void initConfiguredSensors();
 
 static void initAuxDigital() {
 #if EFI_PROD_CODE
@@ -28,7 +30,7 @@ void initNewSensors() {
 	// First (optionally) init any sensors built in to the board that don't need config
 	initBoardSensors();
 
-	reconfigureSensors();
+	initConfiguredSensors();
 
 	initBaro();
 	initAuxSpeedSensors();
@@ -38,6 +40,9 @@ void initNewSensors() {
 
 	initAuxDigital();
 
+	// Last, so that a CAN signal doesn't take the place of a sensor registered above
+	initCanSensors();
+
 	// Init CLI functionality for sensors (mocking)
 	initSensorCli();
 
@@ -59,6 +64,7 @@ void stopSensors() {
 	deinitVbatt();
 	deinitThermistors();
 	deinitLambda();
+	deinitCanSensors();
 	deInitFlexSensor();
 	deinitAuxSensors();
 	deInitVehicleSpeedSensor();
@@ -68,6 +74,18 @@ void stopSensors() {
 }
 
 void reconfigureSensors() {
+	initConfiguredSensors();
+
+	// Baro, fuel level and MAF are never stopped, they're still registered
+	initCanSensors();
+}
+
+static void initConfiguredSensors() {
+	// All the lookup tables are compiled again below. MAF first: it's never stopped, so it keeps
+	// its place in the pool as long as its size doesn't change
+	getSensorLutPool().reset();
+	configureMafCurve();
+
 	initVbatt();
 	initMap();
 	initTps();
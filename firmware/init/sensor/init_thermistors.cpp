@@ -6,14 +6,20 @@
 #include "linear_func.h"
 #include "resistance_func.h"
 #include "thermistor_func.h"
+#include "compiled_func.h"
 
 using resist = ResistanceFunc;
 using therm = ThermistorFunc;
 
+// Voltage the thermistor divider is supplied with
+static constexpr float thermistorSupplyVoltage = 5.0f;
+
 // Each one could be either linear or thermistor
 struct FuncPair {
 	LinearFunc linear;
 	FuncChain<resist, therm> thermistor;
+	// The thermistor chain sampled over the ADC range, if configured
+	CompiledFunc compiled;
 };
 
 static FunctionalSensor clt(SensorType::Clt, MS2NT(10));
@@ -48,10 +54,18 @@ static SensorConverter& configureTempSensorFunction(const char *msg,
 	} else /* sensor is thermistor */ {
 		validateThermistorConfig(msg, cfg);
 
-		p.thermistor.get<resist>().configure(5.0f, cfg.bias_resistor, isPulldown);
+		p.thermistor.get<resist>().configure(thermistorSupplyVoltage, cfg.bias_resistor, isPulldown);
 		p.thermistor.get<therm>().configure(cfg);
 
-		return p.thermistor;
+		size_t lutSize = getSensorLutSize(engineConfiguration->sensorConverterLut);
+		if (lutSize == 0) {
+			return p.thermistor;
+		}
+
+		// Above the supply voltage the divider is open circuit anyway, the chain handles it
+		p.compiled.compile(p.thermistor, 0, thermistorSupplyVoltage, lutSize, getSensorLutPool());
+
+		return p.compiled;
 	}
 }
 
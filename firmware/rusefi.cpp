@@ -153,11 +153,6 @@ __NO_RETURN void runMainLoop();
 void runRusEfi() {
 	engine->setConfig();
 
-#if EFI_TEXT_LOGGING
-	// Initialize logging system early - we can't log until this is called
-	startLoggingProcessor();
-#endif
-
 #if EFI_PROD_CODE
 	checkLastBootError();
 #endif
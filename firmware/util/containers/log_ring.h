@@ -0,0 +1,209 @@
+/**
+ * @file	log_ring.h
+ * @brief	Lock-free ring of text lines, many writers and one reader
+ *
+ * Each line is a record: a 32 bit header (committed flag, record size, text length), then the text,
+ * padded to 4 bytes. A record never wraps around the end of the ring, a writer that would wrap
+ * fills the rest of the ring with an empty record instead.
+ *
+ * A writer claims room for the longest line it may write by moving the write position with a
+ * compare-and-swap, formats straight in to the ring, then gives back what it didn't use if nobody
+ * claimed after it in the meantime. It commits by setting the header. When there is no room the
+ * line is dropped and counted, writers never wait.
+ *
+ * The reader gets the committed lines oldest first as spans pointing in to the ring, and releases
+ * them once it's done with them. A line that is claimed but not yet committed holds up the lines
+ * after it. Released room is zeroed, so a header nobody wrote yet reads as not committed.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+struct LogSpan {
+	const char* data;
+	size_t length;
+};
+
+struct LogRingClaim {
+	uint32_t position = 0;
+	// End of what was claimed
+	uint32_t end = 0;
+};
+
+template <size_t TSize>
+class LogRing {
+	static_assert(TSize % 4 == 0 && (TSize & (TSize - 1)) == 0, "ring size must be a power of two");
+	// Record size has 15 bits in the header
+	static_assert(TSize <= 32768, "ring too big");
+
+	static constexpr uint32_t headerSize = 4;
+	static constexpr uint32_t committedFlag = 0x80000000;
+
+public:
+	// Longest line a single record can take
+	static constexpr size_t maxLineLength = TSize / 2 - headerSize - 4;
+
+	/**
+	 * Claims room for a line of up to maxLength characters, and the terminating zero formatting
+	 * code writes after them.
+	 * @return where to write the text, or nullptr if the line has to be dropped
+	 */
+	char* claim(LogRingClaim& claim, size_t maxLength) {
+		if (maxLength > maxLineLength) {
+			maxLength = maxLineLength;
+		}
+
+		uint32_t size = recordSize(maxLength + 1);
+		uint32_t position = m_write.load(std::memory_order_relaxed);
+		uint32_t start;
+		uint32_t end;
+
+		do {
+			uint32_t offset = position & (TSize - 1);
+
+			// Doesn't fit before the end of the ring: skip to the start
+			start = (offset + size > TSize) ? position + (TSize - offset) : position;
+			end = start + size;
+
+			if (end - m_read.load(std::memory_order_acquire) > TSize) {
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+				return nullptr;
+			}
+		} while (!m_write.compare_exchange_weak(position, end, std::memory_order_acquire, std::memory_order_relaxed));
+
+		if (start != position) {
+			// Empty record up to the end of the ring
+			storeHeader(position, start - position, 0);
+		}
+
+		claim.position = start;
+		claim.end = end;
+
+		return text(start);
+	}
+
+	/**
+	 * Publishes the claimed line, with the length the formatting code actually wrote.
+	 */
+	void commit(LogRingClaim& claim, size_t length) {
+		uint32_t size = recordSize(length);
+		uint32_t expected = claim.end;
+
+		// Give back the room we didn't use. Too late if somebody claimed after us: then it stays in this record.
+		if (m_write.compare_exchange_strong(expected, claim.position + size, std::memory_order_relaxed)) {
+			claim.end = claim.position + size;
+		}
+
+		storeHeader(claim.position, claim.end - claim.position, length);
+	}
+
+	/**
+	 * Lines ready for reading, oldest first, up to maxLength characters in total.
+	 * They stay in the ring until release().
+	 * @return number of spans
+	 */
+	size_t peek(LogSpan* spans, size_t maxSpans, size_t maxLength) {
+		uint32_t position = m_read.load(std::memory_order_relaxed);
+		uint32_t write = m_write.load(std::memory_order_acquire);
+		size_t count = 0;
+		size_t total = 0;
+
+		while (position != write && count < maxSpans) {
+			uint32_t header = loadHeader(position);
+
+			// Claimed, but not written yet
+			if (!(header & committedFlag)) {
+				break;
+			}
+
+			size_t length = header & 0xFFFF;
+
+			if (length) {
+				if (total + length > maxLength) {
+					if (count) {
+						break;
+					}
+
+					// A single line longer than the reader takes at once: the rest of it is lost
+					length = maxLength;
+				}
+
+				spans[count++] = { text(position), length };
+				total += length;
+			}
+
+			position += (header & ~committedFlag) >> 16;
+		}
+
+		m_peekEnd = position;
+
+		return count;
+	}
+
+	/**
+	 * Gives the room of the lines returned by the last peek() back to writers
+	 */
+	void release() {
+		uint32_t position = m_read.load(std::memory_order_relaxed);
+
+		while (position != m_peekEnd) {
+			uint32_t offset = position & (TSize - 1);
+			uint32_t chunk = m_peekEnd - position;
+
+			if (offset + chunk > TSize) {
+				chunk = TSize - offset;
+			}
+
+			memset(&m_buffer[offset], 0, chunk);
+			position += chunk;
+		}
+
+		m_read.store(position, std::memory_order_release);
+	}
+
+	uint32_t getDroppedCount() const {
+		return m_dropped.load(std::memory_order_relaxed);
+	}
+
+	// Claimed and not yet released, including what is still being written
+	size_t getUsed() const {
+		return m_write.load(std::memory_order_relaxed) - m_read.load(std::memory_order_relaxed);
+	}
+
+private:
+	static uint32_t recordSize(size_t length) {
+		return (headerSize + length + 3) & ~3u;
+	}
+
+	char* text(uint32_t position) {
+		return reinterpret_cast<char*>(&m_buffer[(position & (TSize - 1)) + headerSize]);
+	}
+
+	uint32_t* headerAt(uint32_t position) {
+		return reinterpret_cast<uint32_t*>(&m_buffer[position & (TSize - 1)]);
+	}
+
+	void storeHeader(uint32_t position, uint32_t size, size_t length) {
+		// Record size fits in 15 bits, and the text length in 16
+		uint32_t header = committedFlag | (size << 16) | length;
+		__atomic_store_n(headerAt(position), header, __ATOMIC_RELEASE);
+	}
+
+	uint32_t loadHeader(uint32_t position) {
+		return __atomic_load_n(headerAt(position), __ATOMIC_ACQUIRE);
+	}
+
+	alignas(4) uint8_t m_buffer[TSize] = {};
+
+	// Free running positions, the ring offset is the low bits
+	std::atomic<uint32_t> m_write{0};
+	std::atomic<uint32_t> m_read{0};
+	std::atomic<uint32_t> m_dropped{0};
+
+	// Only touched by the reader
+	uint32_t m_peekEnd = 0;
+};
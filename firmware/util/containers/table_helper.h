@@ -17,6 +17,14 @@
 // popular left edge of CLT-based correction curves
 #define CLT_CURVE_RANGE_FROM -40
 
+/**
+ * Bumped on every change to the configuration: live writes from TunerStudio, burns and anything
+ * else going through incrementGlobalConfigurationVersion(), console set commands, Lua
+ * setCalibration() and loading from flash, so that anything caching a copy of it can tell when
+ * to refresh.
+ */
+extern uint32_t configurationWriteCounter;
+
 class ValueProvider3D {
 public:
 	virtual float getValue(float xColumn, float yRow) const = 0;
@@ -24,10 +32,10 @@ public:
 
 
 /**
- * this helper class brings together 3D table with two 2D axis curves
+ * Table and axis storage shared by Map3D and CachedMap3D, which only differ in how they look values up
  */
 template<int TColNum, int TRowNum, typename TValue, typename TColumn, typename TRow>
-class Map3D : public ValueProvider3D {
+class Map3DBase : public ValueProvider3D {
 public:
 	template <typename TValueInit, typename TRowInit, typename TColumnInit>
 	void init(TValueInit (&table)[TRowNum][TColNum],
@@ -39,18 +47,6 @@ public:
 		initCols(columnBins);
 	}
 
-	float getValue(float xColumn, float yRow) const final {
-		if (!m_values) {
-			// not initialized, return 0
-			return 0;
-		}
-
-		return interpolate3d(*m_values,
-								*m_rowBins, yRow * m_rowMult,
-								*m_columnBins, xColumn * m_colMult) *
-			m_valueMult;
-	}
-
 	void setAll(TValue value) {
 		efiAssertVoid(ObdCode::CUSTOM_ERR_6573, m_values, "map not initialized");
 
@@ -61,7 +57,7 @@ public:
 		}
 	}
 
-private:
+protected:
 	template <int TMult, int TDiv>
 	void initValues(scaled_channel<TValue, TMult, TDiv> (&table)[TRowNum][TColNum]) {
 		m_values = reinterpret_cast<TValue (*)[TRowNum][TColNum]>(&table);
@@ -118,8 +114,155 @@ private:
 	float m_valueMult = 1;
 };
 
-typedef Map3D<PEDAL_TO_TPS_SIZE, PEDAL_TO_TPS_SIZE, uint8_t, uint8_t, uint8_t> pedal2tps_t;
+/**
+ * this helper class brings together 3D table with two 2D axis curves
+ */
+template<int TColNum, int TRowNum, typename TValue, typename TColumn, typename TRow>
+class Map3D : public Map3DBase<TColNum, TRowNum, TValue, TColumn, TRow> {
+public:
+	float getValue(float xColumn, float yRow) const final {
+		if (!this->m_values) {
+			// not initialized, return 0
+			return 0;
+		}
+
+		return interpolate3d(*this->m_values,
+								*this->m_rowBins, yRow * this->m_rowMult,
+								*this->m_columnBins, xColumn * this->m_colMult) *
+			this->m_valueMult;
+	}
+};
+
+/**
+ * Same result as Map3D, for tables that are looked up often with slowly changing inputs.
+ *
+ * Axis bins are converted to float once by init()/refreshBins() instead of on every lookup,
+ * the bin search is a fixed length compare-and-count the compiler can unroll without branches,
+ * and the cell found last time is checked first since rpm/load rarely move a whole cell between lookups.
+ *
+ * Table values are still read live. The float bins are refreshed on the first lookup after
+ * configurationWriteCounter moves, so bin edits apply as soon as they're written, burnt or not.
+ */
+template<int TColNum, int TRowNum, typename TValue, typename TColumn, typename TRow>
+class CachedMap3D : public Map3DBase<TColNum, TRowNum, TValue, TColumn, TRow> {
+	using Base = Map3DBase<TColNum, TRowNum, TValue, TColumn, TRow>;
+
+public:
+	template <typename TValueInit, typename TRowInit, typename TColumnInit>
+	void init(TValueInit (&table)[TRowNum][TColNum],
+				  const TRowInit (&rowBins)[TRowNum], const TColumnInit (&columnBins)[TColNum]) {
+		Base::init(table, rowBins, columnBins);
+		refreshBins();
+	}
+
+	void refreshBins() const {
+		if (!this->m_values) {
+			return;
+		}
+
+		// Taken first, so a write while converting causes another refresh
+		m_binsVersion = configurationWriteCounter;
+
+		// Raw (unscaled) bin values, the inputs get multiplied the same way Map3D does it
+		for (size_t i = 0; i < TRowNum; i++) {
+			m_rowBinsF[i] = (*this->m_rowBins)[i];
+		}
+
+		for (size_t i = 0; i < TColNum; i++) {
+			m_colBinsF[i] = (*this->m_columnBins)[i];
+		}
+
+		m_lastRow = 0;
+		m_lastCol = 0;
+	}
+
+	float getValue(float xColumn, float yRow) const final {
+		if (!this->m_values) {
+			// not initialized, return 0
+			return 0;
+		}
+
+		if (m_binsVersion != configurationWriteCounter) {
+			refreshBins();
+		}
+
+		auto row = getBin(m_rowBinsF, m_lastRow, yRow * this->m_rowMult);
+		auto col = getBin(m_colBinsF, m_lastCol, xColumn * this->m_colMult);
+
+		const auto& table = *this->m_values;
+
+		// Orient the table such that (0, 0) is the bottom left corner, same as interpolate3d
+		float lowerLeft  = table[row.Idx    ][col.Idx    ];
+		float upperLeft  = table[row.Idx + 1][col.Idx    ];
+		float lowerRight = table[row.Idx    ][col.Idx + 1];
+		float upperRight = table[row.Idx + 1][col.Idx + 1];
+
+		float left  = linterp(lowerLeft, upperLeft, row.Frac);
+		float right = linterp(lowerRight, upperRight, row.Frac);
+
+		return linterp(left, right, col.Frac) * this->m_valueMult;
+	}
+
+private:
+	struct Bin {
+		size_t Idx;
+		float Frac;
+	};
+
+	static float linterp(float low, float high, float frac) {
+		return low + (high - low) * frac;
+	}
+
+	/**
+	 * Returns the same bin and fraction as interpolate3d's search, including the
+	 * clamping of NaN/off-scale inputs and the handling of repeated bin values.
+	 */
+	template <int TSize>
+	static Bin getBin(const float (&bins)[TSize], uint8_t& lastIdx, float value) {
+		static_assert(TSize >= 2);
+
+		// Off-scale low (or NaN) and off-scale high
+		if (!(value > bins[0])) {
+			return { 0, 0 };
+		}
+
+		if (value >= bins[TSize - 1]) {
+			return { TSize - 2, 1 };
+		}
+
+		size_t idx = lastIdx;
+
+		// Hot cell miss: count the bins at or below the value. With sorted bins that's the index
+		// of the lower edge, and the fixed trip count lets the compiler unroll it into compares and adds.
+		if (!(bins[idx] <= value && value < bins[idx + 1])) {
+			idx = 0;
+			for (size_t i = 1; i < TSize - 1; i++) {
+				idx += bins[i] <= value;
+			}
+
+			lastIdx = idx;
+		}
+
+		float low = bins[idx];
+		float high = bins[idx + 1];
+
+		return { idx, (value - low) / (high - low) };
+	}
+
+	mutable float m_rowBinsF[TRowNum];
+	mutable float m_colBinsF[TColNum];
+	mutable uint32_t m_binsVersion = 0;
+
+	// Cell of the previous lookup, a stale value from a concurrent lookup just misses
+	mutable uint8_t m_lastRow = 0;
+	mutable uint8_t m_lastCol = 0;
+};
+
+typedef CachedMap3D<PEDAL_TO_TPS_SIZE, PEDAL_TO_TPS_SIZE, uint8_t, uint8_t, uint8_t> pedal2tps_t;
 typedef Map3D<FUEL_RPM_COUNT, FUEL_LOAD_COUNT, uint16_t, uint16_t, uint16_t> mapEstimate_Map3D_t;
+typedef CachedMap3D<FUEL_RPM_COUNT, FUEL_LOAD_COUNT, uint16_t, uint16_t, uint16_t> ve_Map3D_t;
+typedef CachedMap3D<FUEL_RPM_COUNT, FUEL_LOAD_COUNT, uint8_t, uint16_t, uint16_t> lambda_Map3D_t;
+typedef CachedMap3D<IGN_RPM_COUNT, IGN_LOAD_COUNT, int16_t, uint16_t, uint16_t> ign_Map3D_t;
 
 /**
  * @param precision for example '0.1' for one digit fractional part. Default to 0.01, two digits.
@@ -84,6 +84,11 @@ struct type_list {
 		return decltype(first)::template has<has_t>() ||
 			decltype(others)::template has<has_t>();
 	}
+
+	// Number of types in the list
+	static constexpr size_t count() {
+		return decltype(first)::count() + decltype(others)::count();
+	}
 };
 
 /*
@@ -110,6 +115,10 @@ public:
 		return std::is_same_v<has_t, base_t>;
 	}
 
+	static constexpr size_t count() {
+		return 1;
+	}
+
 	template<typename get_t, typename = std::enable_if_t<has<get_t>()>>
 	constexpr auto & get() {
 		return *this;
@@ -169,6 +178,10 @@ public:
 		return std::is_same_v<has_t, base_t>;
 	}
 
+	static constexpr size_t count() {
+		return 1;
+	}
+
 	template<typename get_t, typename = std::enable_if_t<has<get_t>()>>
 	constexpr auto & get() {
 		return *this;
@@ -3,18 +3,15 @@
  *
  * This file implements text logging.
  * 
- * Uses a queue of buffers so that the expensive printf operation doesn't require exclusive access
- * (ie, global system lock) to log.  In the past there have been serious performance problems caused
- * by heavy logging on a low priority thread that blocks the rest of the system running (trigger errors, etc).
+ * Lines go in to a lock-free ring (see log_ring.h) so that the expensive printf operation doesn't require
+ * exclusive access (ie, global system lock) to log.  In the past there have been serious performance problems
+ * caused by heavy logging on a low priority thread that blocks the rest of the system running (trigger errors, etc).
  * 
- * Uses ChibiOS message queues to maintain one queue of free buffers, and one queue of used buffers.
- * When a thread wants to write, it acquires a free buffer, prints to it, and pushes it in to the
- * used queue. A dedicated thread then dequeues and writes lines from the used buffer in to the
- * large output buffer.
+ * A thread that wants to log claims room in the ring, prints straight in to it and commits the line. Nothing
+ * blocks and nothing is copied: if the ring is full the line is dropped, and the drops are reported later.
  * 
- * Later, the binary TS thread will request access to the output log buffer for reading, so a lock is taken,
- * buffers, swapped, and the back buffer returned.  This blocks neither output nor logging in any case, as
- * each operation operates on a different buffer.
+ * The binary TS thread reads the committed lines as spans pointing in to the ring, sends them, and only then
+ * releases their room to writers.
  *
  * @date Mar 8, 2015, heavily revised April 2021
  * @author Andrey Belomutskiy, (c) 2012-2021
@@ -23,144 +20,38 @@
 
 #include "pch.h"
 
-
-#include "thread_controller.h"
-
 /* for isprint() */
 #include <ctype.h>
 
-template <size_t TBufferSize>
-void LogBuffer<TBufferSize>::writeLine(LogLineBuffer* line) {
-	writeInternal(line->buffer);
-}
-
-template <size_t TBufferSize>
-void LogBuffer<TBufferSize>::writeLogger(Logging* logging) {
-	writeInternal(logging->m_buffer);
-}
-
-template <size_t TBufferSize>
-size_t LogBuffer<TBufferSize>::length() const {
-	return m_writePtr - m_buffer;
-}
-
-template <size_t TBufferSize>
-void LogBuffer<TBufferSize>::reset() {
-	m_writePtr = m_buffer;
-	*m_writePtr = '\0';
-}
-
-template <size_t TBufferSize>
-const char* LogBuffer<TBufferSize>::get() const {
-	return m_buffer;
-}
-
-template <size_t TBufferSize>
-void LogBuffer<TBufferSize>::writeInternal(const char* buffer) {
-	size_t len = std::strlen(buffer);
-	// leave one byte extra at the end to guarantee room for a null terminator
-	size_t available = TBufferSize - length() - 1;
-
-	// If we can't fit the whole thing, write as much as we can
-	len = minI(available, len);
-	// Ensure the output buffer is always null terminated (in case we did a partial write)
-	*(m_writePtr + len) = '\0';
-	memcpy(m_writePtr, buffer, len);
-	m_writePtr += len;
-}
-
-// for unit tests
-template class LogBuffer<10>;
-
 #if (EFI_PROD_CODE || EFI_SIMULATOR) && EFI_TEXT_LOGGING
 
-// This mutex protects the LogBuffer instances below
-chibios_rt::Mutex logBufferMutex;
-
-// Two buffers:
-//  - we copy line buffers to writeBuffer in LoggingBufferFlusher
-//  - and read from readBuffer via TunerStudio protocol commands
-using LB = LogBuffer<DL_OUTPUT_BUFFER>;
-LB buffers[2];
-LB* writeBuffer = &buffers[0];
-LB* readBuffer = &buffers[1];
-
-/**
- * Actual communication layer invokes this method when it's ready to send some data out
- *
- * @return pointer to the buffer which should be print to console
- */
-const char* swapOutputBuffers(size_t* actualOutputBufferSize) {
-	{
-		chibios_rt::MutexLocker lock(logBufferMutex);
-
-		// Swap buffers under lock
-		std::swap(writeBuffer, readBuffer);
+// Longest line efiPrintf writes, longer ones are cut
+#define LOG_LINE_LENGTH 255
 
-		// Reset the front buffer - it's now empty
-		writeBuffer->reset();
-	}
+// Lines a single TS text request may carry
+#define LOG_SPAN_COUNT 128
 
-	*actualOutputBufferSize = readBuffer->length();
+static LogRing<LOG_RING_SIZE> logRing;
 
-	// Check that the actual length of the buffer matches the expected length of how much we thought we wrote
-	size_t expectedOutputSize = std::strlen(readBuffer->get());
-	if (*actualOutputBufferSize != expectedOutputSize) {
-		firmwareError(ObdCode::ERROR_LOGGING_SIZE_CALC, "lsize mismatch %d vs strlen %d", *actualOutputBufferSize, expectedOutputSize);
+// Only the TS thread reads
+static LogSpan logSpans[LOG_SPAN_COUNT];
+static uint32_t reportedDropCount = 0;
 
-		return nullptr;
-	}
-
-	return readBuffer->get();
-}
+size_t getLogLines(const LogSpan** lines) {
+	uint32_t dropCount = logRing.getDroppedCount();
 
-// These buffers store lines queued to be written to the writeBuffer
-constexpr size_t lineBufferCount = 24;
-static LogLineBuffer lineBuffers[lineBufferCount];
-
-// freeBuffers contains a queue of buffers that are not in use
-static chibios_rt::Mailbox<LogLineBuffer*, lineBufferCount> freeBuffers;
-// filledBuffers contains a queue of buffers currently waiting to be written to the output buffer
-static chibios_rt::Mailbox<LogLineBuffer*, lineBufferCount> filledBuffers;
-
-class LoggingBufferFlusher : public ThreadController<256> {
-public:
-	LoggingBufferFlusher() : ThreadController("log flush", PRIO_TEXT_LOG) { }
-
-	void ThreadTask() override {
-		while (true) {
-			// Fetch a queued message
-			LogLineBuffer* line;
-			msg_t msg = filledBuffers.fetch(&line, TIME_INFINITE);
-
-			if (msg != MSG_OK) {
-				// This should be impossible - neither timeout or reset should happen
-			} else {
-				{
-					// Lock the buffer mutex - inhibit buffer swaps while writing
-					chibios_rt::MutexLocker lock(logBufferMutex);
-
-					// Write the line out to the output buffer
-					writeBuffer->writeLine(line);
-				}
-
-				// Return this line buffer to the free list
-				freeBuffers.post(line, TIME_INFINITE);
-			}
-		}
+	if (dropCount != reportedDropCount) {
+		efiPrintf("%d log lines dropped, ring full", dropCount - reportedDropCount);
+		reportedDropCount = dropCount;
 	}
-};
 
-static LoggingBufferFlusher lbf;
+	*lines = logSpans;
 
-void startLoggingProcessor() {
-	// Push all buffers in to the free queue
-	for (size_t i = 0; i < lineBufferCount; i++) {
-		freeBuffers.post(&lineBuffers[i], TIME_INFINITE);
-	}
+	return logRing.peek(logSpans, efi::size(logSpans), DL_OUTPUT_BUFFER);
+}
 
-	// Start processing used buffers
-	lbf.start();
+void releaseLogLines() {
+	logRing.release();
 }
 
 #endif // EFI_PROD_CODE
@@ -179,46 +70,36 @@ void efiPrintfInternal(const char *format, ...) {
 	}
 #endif
 #if (EFI_PROD_CODE || EFI_SIMULATOR) && EFI_TEXT_LOGGING
-	LogLineBuffer* lineBuffer;
-	msg_t msg;
-
-	{
-		// Acquire a buffer we can write to
-		chibios_rt::CriticalSectionLocker csl;
-		msg = freeBuffers.fetchI(&lineBuffer);
-	}
+	LogRingClaim claim;
+	char* line = logRing.claim(claim, LOG_LINE_LENGTH);
 
-	// No free buffers available, so we can't log
-	if (msg != MSG_OK) {
+	// No room, the line is dropped
+	if (!line) {
 		return;
 	}
 
-	// Write the formatted string to the output buffer
+	// Write the formatted string straight in to the ring, one byte short so that a cut line
+	// still has room for its marker
 	va_list ap;
 	va_start(ap, format);
-	size_t len = chvsnprintf(lineBuffer->buffer, sizeof(lineBuffer->buffer), format, ap);
+	size_t len = chvsnprintf(line, LOG_LINE_LENGTH, format, ap);
 	va_end(ap);
 
-	// Ensure that the string is comma-terminated in case it overflowed
-	lineBuffer->buffer[sizeof(lineBuffer->buffer) - 1] = LOG_DELIMITER[0];
-
-	if (len > sizeof(lineBuffer->buffer) - 1) {
-		len = sizeof(lineBuffer->buffer) - 1;
+	if (len >= LOG_LINE_LENGTH) {
+		// Ensure that the string is comma-terminated in case it overflowed, in place of the terminator
+		line[LOG_LINE_LENGTH - 1] = LOG_DELIMITER[0];
+		len = LOG_LINE_LENGTH;
 	}
 
 	for (size_t i = 0; i < len; i++) {
 		/* just replace all non-printable chars with space
 		 * TODO: is there any other "prohibited" chars? */
-		if (isprint(lineBuffer->buffer[i]) == 0) {
-			lineBuffer->buffer[i] = ' ';
+		if (isprint(line[i]) == 0) {
+			line[i] = ' ';
 		}
 	}
 
-	{
-		// Push the buffer in to the written list so it can be written back
-		chibios_rt::CriticalSectionLocker csl;
-		filledBuffers.postI(lineBuffer);
-	}
+	logRing.commit(claim, len);
 #endif
 }
 } // namespace priv
@@ -231,11 +112,12 @@ void efiPrintfInternal(const char *format, ...) {
  */
 void scheduleLogging(Logging *logging) {
 #if (EFI_PROD_CODE || EFI_SIMULATOR) && EFI_TEXT_LOGGING
-	// Lock the buffer mutex - inhibit buffer swaps while writing
-	{
-		chibios_rt::MutexLocker lock(logBufferMutex);
+	size_t length = std::min<size_t>(logging->loggingSize(), decltype(logRing)::maxLineLength);
 
-		writeBuffer->writeLogger(logging);
+	LogRingClaim claim;
+	if (char* text = logRing.claim(claim, length)) {
+		memcpy(text, logging->m_buffer, length);
+		logRing.commit(claim, length);
 	}
 
 	// Reset the logging now that it's been written out
@@ -8,12 +8,17 @@
 
 #include <cstddef>
 #include "rusefi_generated.h"
+#include "log_ring.h"
 
 class Logging;
 
-void startLoggingProcessor();
-
-const char* swapOutputBuffers(size_t *actualOutputBufferSize);
+/**
+ * Text logged since the last call, for the TS text channel: up to DL_OUTPUT_BUFFER characters, as
+ * spans pointing in to the log ring. They stay valid until releaseLogLines().
+ * @return number of spans
+ */
+size_t getLogLines(const LogSpan** lines);
+void releaseLogLines();
 
 namespace priv
 {
@@ -34,27 +39,3 @@ namespace priv
  * This is the legacy function to copy the contents of a local Logging object in to the output buffer
  */
 void scheduleLogging(Logging *logging);
-
-// Stores the result of one call to efiPrintfInternal in the queue to be copied out to the output buffer
-struct LogLineBuffer {
-	char buffer[256];
-};
-
-template <size_t TBufferSize>
-class LogBuffer {
-public:
-	void writeLine(LogLineBuffer* line);
-	void writeLogger(Logging* logging);
-
-	size_t length() const;
-	void reset();
-	const char* get() const;
-
-#if !EFI_UNIT_TEST
-private:
-#endif
-	void writeInternal(const char* buffer);
-
-	char m_buffer[TBufferSize];
-	char* m_writePtr = m_buffer;
-};
@@ -32,6 +32,7 @@
 #define MY_US2ST(x) ((x) / 10)
 
 #define DL_OUTPUT_BUFFER 9000
+#define LOG_RING_SIZE 16384
 
 #define CCM_OPTIONAL
 #define NO_CACHE
@@ -104,8 +104,6 @@ void rusEfiFunctionalTest(void) {
 
 	startStatusThreads();
 
-	startLoggingProcessor();
-
 #if EFI_FILE_LOGGING
 	initSdCardLogger();
 #endif // EFI_FILE_LOGGING
@@ -23,6 +23,8 @@
 
 #define ENABLE_PERF_TRACE FALSE
 
+#define SENSOR_LUT_POOL_SIZE 4096
+
 #define EFI_TOOTH_LOGGER TRUE
 
 #define EFI_LAUNCH_CONTROL TRUE
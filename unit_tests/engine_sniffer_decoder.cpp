@@ -0,0 +1,93 @@
+/*
+ * @file engine_sniffer_decoder.cpp
+ */
+
+#include "pch.h"
+#include "engine_sniffer_decoder.h"
+
+#include <algorithm>
+
+// Same as the tooth logger's TDC pulse
+#define PULSE_WIDTH_US 10
+
+std::vector<EngineSnifferEvent> decodeEngineSnifferRecords(const uint8_t* data, size_t size) {
+	std::vector<EngineSnifferEvent> events;
+
+	int64_t timeNt = 0;
+
+	for (size_t offset = 0; offset + sizeof(EngineSnifferRecord) <= size; offset += sizeof(EngineSnifferRecord)) {
+		EngineSnifferRecord record;
+		memcpy(&record, data + offset, sizeof(record));
+
+		// The first delta is relative to a record we don't have
+		if (!events.empty()) {
+			timeNt += record.deltaNt;
+		}
+
+		events.push_back({ timeNt, record.channel, record.edge != 0, record.value });
+	}
+
+	return events;
+}
+
+std::vector<CompositeEvent> toCompositeEvents(const std::vector<EngineSnifferEvent>& events, int ticksPerUs) {
+	std::vector<CompositeEvent> result;
+
+	bool hasCrank2 = std::any_of(events.begin(), events.end(), [](const EngineSnifferEvent& event) {
+		return event.channel == EngineSnifferChannel::Crank2;
+	});
+	EngineSnifferChannel secondary = hasCrank2 ? EngineSnifferChannel::Crank2 : EngineSnifferChannel::Vvt1;
+
+	CompositeEvent state = {};
+	uint32_t pulseEndUs = 0;
+
+	auto push = [&](uint32_t timestamp) {
+		state.timestamp = timestamp;
+		result.push_back(state);
+	};
+
+	// A pulse ends after PULSE_WIDTH_US, or right at the next event if that one comes first
+	auto endPulses = [&](uint32_t untilUs) {
+		if (state.isTDC || state.sync) {
+			state.isTDC = false;
+			state.sync = false;
+			push(std::min(pulseEndUs, untilUs));
+		}
+	};
+
+	uint32_t lastUs = 0;
+	int lastCrankIndex = -1;
+
+	for (const auto& event : events) {
+		// Records are in the order they made it in to the ring, which isn't always the order of their timestamps
+		uint32_t us = std::max<int64_t>(lastUs, event.timeNt / ticksPerUs);
+		lastUs = us;
+
+		if (event.channel == EngineSnifferChannel::Crank1) {
+			endPulses(us);
+			state.primaryTrigger = event.isRise;
+
+			// Both edges of the sync tooth come with index 0 when the opposite edge is made up
+			if (event.value == 0 && lastCrankIndex != 0) {
+				state.sync = true;
+				pulseEndUs = us + PULSE_WIDTH_US;
+			}
+			lastCrankIndex = event.value;
+
+			push(us);
+		} else if (event.channel == secondary) {
+			endPulses(us);
+			state.secondaryTrigger = event.isRise;
+			push(us);
+		} else if (event.channel == EngineSnifferChannel::Tdc) {
+			endPulses(us);
+			state.isTDC = true;
+			pulseEndUs = us + PULSE_WIDTH_US;
+			push(us);
+		}
+	}
+
+	endPulses(pulseEndUs);
+
+	return result;
+}
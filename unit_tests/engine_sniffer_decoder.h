@@ -0,0 +1,35 @@
+/*
+ * @file engine_sniffer_decoder.h
+ *
+ * Host side of the binary engine sniffer: turns what TS_ENGINE_SNIFFER_READ responds with back in to
+ * timestamped events, and those in to the logicdata composite events.
+ */
+
+#pragma once
+
+#include "engine_sniffer_binary.h"
+#include "logicdata.h"
+
+#include <vector>
+
+struct EngineSnifferEvent {
+	// From the first record
+	int64_t timeNt;
+	EngineSnifferChannel channel;
+	bool isRise;
+	uint16_t value;
+};
+
+/**
+ * @param data records as sent by the ECU, a trailing partial record is ignored
+ */
+std::vector<EngineSnifferEvent> decodeEngineSnifferRecords(const uint8_t* data, size_t size);
+
+/**
+ * Crank 1 is the primary channel. Crank 2 is the secondary one, or the first cam if there is no crank 2,
+ * same as the tooth logger. TDC and the crank sync point (tooth 0) are short pulses.
+ * logicdata only has these four channels, output pins are dropped.
+ *
+ * @param ticksPerUs of the ECU the records came from, timestamps are in microseconds
+ */
+std::vector<CompositeEvent> toCompositeEvents(const std::vector<EngineSnifferEvent>& events, int ticksPerUs = US_TO_NT_MULTIPLIER);
@@ -0,0 +1,876 @@
+/**
+ * @file isolated_test_runner.cpp
+ *
+ * The parent only lists the tests and forks: a child runs exactly one test, then reports back over
+ * a pipe what it left behind. Whatever the test printed goes to a temporary file, which is only
+ * shown if the test failed.
+ *
+ * Two kinds of leftovers are looked for:
+ *  - global and file-static objects (activeConfiguration, enginePins, the sensor registry, and all
+ *    the others) that differ from how the child found them. On Linux every writable object with a
+ *    symbol is compared, found in the executable's own symbol table. Elsewhere only the few globals
+ *    named below are.
+ *  - what the next test would see: the engine and persistent_config of an EngineTestHelper built
+ *    after the test, compared to one built in a process that never ran a test.
+ */
+
+#include "pch.h"
+
+#include "isolated_test_runner.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+
+int runIsolatedTests(const IsolatedRunOptions&) {
+	printf("Isolated test runs need fork(), running everything in one process instead\n");
+	return RUN_ALL_TESTS();
+}
+
+#else // _WIN32
+
+#include <cxxabi.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <elf.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif // __linux__
+
+using Clock = std::chrono::steady_clock;
+
+// Changed objects a child reports by index, the count goes on past this
+#define MAX_REPORTED_STATICS 128
+
+struct ByteDiff {
+	uint32_t changedBytes;
+	int32_t firstChange;
+};
+
+// What a child sends back once its test is done
+struct ChildReport {
+	int result;
+
+	// Should have been cleared by EngineTestHelper
+	bool engineLeft;
+	bool configLeft;
+
+	// Objects that differ from a copy taken right before the test, by index in staticObjects
+	uint32_t changedStaticCount;
+	uint32_t changedStatics[MAX_REPORTED_STATICS];
+
+	// EngineTestHelper built after the test, compared to freshReference
+	bool freshChecked;
+	bool freshFailed;
+	ByteDiff freshConfig;
+	ByteDiff freshOutputChannels;
+};
+
+struct TestRun {
+	std::string name;
+
+	pid_t pid = -1;
+	int reportFd = -1;
+	std::string outputPath;
+	Clock::time_point start;
+
+	bool passed = false;
+	int64_t wallUs = 0;
+	ChildReport report = {};
+	bool hasReport = false;
+	std::string failure;
+};
+
+static bool globMatches(const char* pattern, const char* patternEnd, const char* name) {
+	while (pattern != patternEnd) {
+		if (*pattern == '*') {
+			pattern++;
+
+			for (const char* rest = name; ; rest++) {
+				if (globMatches(pattern, patternEnd, rest)) {
+					return true;
+				}
+
+				if (!*rest) {
+					return false;
+				}
+			}
+		}
+
+		if (!*name || (*pattern != '?' && *pattern != *name)) {
+			return false;
+		}
+
+		pattern++;
+		name++;
+	}
+
+	return !*name;
+}
+
+// Any of the ':' separated patterns
+static bool anyPatternMatches(const std::string& patterns, const std::string& name) {
+	size_t begin = 0;
+
+	while (begin <= patterns.size()) {
+		size_t end = patterns.find(':', begin);
+		if (end == std::string::npos) {
+			end = patterns.size();
+		}
+
+		if (end != begin && globMatches(patterns.data() + begin, patterns.data() + end, name.c_str())) {
+			return true;
+		}
+
+		begin = end + 1;
+	}
+
+	return false;
+}
+
+// Same rules as --gtest_filter: "positive patterns[-negative patterns]"
+static bool filterMatches(const std::string& filter, const std::string& name) {
+	size_t dash = filter.find('-');
+	std::string positive = filter.substr(0, dash);
+	std::string negative = dash == std::string::npos ? "" : filter.substr(dash + 1);
+
+	if (positive.empty()) {
+		positive = "*";
+	}
+
+	return anyPatternMatches(positive, name) && !anyPatternMatches(negative, name);
+}
+
+static std::vector<TestRun> listTests() {
+	std::vector<TestRun> tests;
+
+	auto unitTest = ::testing::UnitTest::GetInstance();
+	std::string filter = ::testing::GTEST_FLAG(filter);
+	bool runDisabled = ::testing::GTEST_FLAG(also_run_disabled_tests);
+
+	for (int i = 0; i < unitTest->total_test_suite_count(); i++) {
+		auto suite = unitTest->GetTestSuite(i);
+
+		for (int j = 0; j < suite->total_test_count(); j++) {
+			auto info = suite->GetTestInfo(j);
+
+			std::string suiteName = info->test_suite_name();
+			std::string testName = info->name();
+
+			bool disabled = suiteName.rfind("DISABLED_", 0) == 0 || testName.rfind("DISABLED_", 0) == 0;
+			if (disabled && !runDisabled) {
+				continue;
+			}
+
+			TestRun run;
+			run.name = suiteName + "." + testName;
+
+			if (filterMatches(filter, run.name)) {
+				tests.push_back(run);
+			}
+		}
+	}
+
+	return tests;
+}
+
+static void writeAll(int fd, const void* data, size_t size) {
+	auto p = static_cast<const char*>(data);
+
+	while (size) {
+		ssize_t written = write(fd, p, size);
+		if (written <= 0) {
+			return;
+		}
+
+		p += written;
+		size -= written;
+	}
+}
+
+static bool readAll(int fd, void* data, size_t size) {
+	auto p = static_cast<char*>(data);
+
+	while (size) {
+		ssize_t count = read(fd, p, size);
+		if (count < 0 && errno == EINTR) {
+			continue;
+		}
+
+		if (count <= 0) {
+			return false;
+		}
+
+		p += count;
+		size -= count;
+	}
+
+	return true;
+}
+
+static std::string demangle(const char* name) {
+	int status;
+	char* demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+
+	if (!demangled) {
+		return name;
+	}
+
+	std::string result = demangled;
+	free(demangled);
+	return result;
+}
+
+struct StaticObject {
+	const uint8_t* address;
+	size_t size;
+	std::string name;
+};
+
+// Found once by the parent, so that the children agree on the indices
+static std::vector<StaticObject> staticObjects;
+
+static void addStaticObject(const void* address, size_t size, const char* name) {
+	staticObjects.push_back({ static_cast<const uint8_t*>(address), size, demangle(name) });
+}
+
+// Googletest keeps its own state in globals, and so do the C++ library and the sanitizers if linked in
+static bool isFrameworkObject(const char* name) {
+	return strstr(name, "7testing") || strstr(name, "gtest") || strstr(name, "gmock")
+		|| strncmp(name, "_ZSt", 4) == 0 || strncmp(name, "_ZNSt", 5) == 0 || strncmp(name, "_ZN9__gnu_cxx", 13) == 0
+		|| strstr(name, "__sanitizer") || strstr(name, "__asan") || strstr(name, "__lsan") || strstr(name, "__ubsan")
+		|| strstr(name, "__interception")
+		// Guard variables of function statics, the statics themselves are compared
+		|| strncmp(name, "_ZGV", 4) == 0
+		// vtables and typeinfo never change
+		|| strncmp(name, "_ZTV", 4) == 0 || strncmp(name, "_ZTI", 4) == 0;
+}
+
+#if defined(__linux__)
+
+static bool findStaticObjectsInSymbolTable() {
+	int fd = open("/proc/self/exe", O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		return false;
+	}
+
+	void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (mapped == MAP_FAILED) {
+		return false;
+	}
+
+	auto file = static_cast<const uint8_t*>(mapped);
+	auto header = reinterpret_cast<const Elf64_Ehdr*>(file);
+
+	if ((size_t)st.st_size < sizeof(Elf64_Ehdr) || memcmp(header->e_ident, ELFMAG, SELFMAG) != 0
+			|| header->e_ident[EI_CLASS] != ELFCLASS64) {
+		munmap(mapped, st.st_size);
+		return false;
+	}
+
+	auto sections = reinterpret_cast<const Elf64_Shdr*>(file + header->e_shoff);
+
+	for (size_t i = 0; i < header->e_shnum; i++) {
+		if (sections[i].sh_type != SHT_SYMTAB) {
+			continue;
+		}
+
+		auto symbols = reinterpret_cast<const Elf64_Sym*>(file + sections[i].sh_offset);
+		size_t symbolCount = sections[i].sh_size / sizeof(Elf64_Sym);
+		auto names = reinterpret_cast<const char*>(file + sections[sections[i].sh_link].sh_offset);
+
+		// Where the executable was loaded, for a PIE: worked out from a symbol we know the address of
+		intptr_t loadOffset = 0;
+		bool found = false;
+		for (size_t j = 0; j < symbolCount && !found; j++) {
+			if (0 == strcmp(names + symbols[j].st_name, "activeConfiguration")) {
+				loadOffset = reinterpret_cast<intptr_t>(&activeConfiguration) - symbols[j].st_value;
+				found = true;
+			}
+		}
+
+		if (!found) {
+			continue;
+		}
+
+		for (size_t j = 0; j < symbolCount; j++) {
+			const auto& symbol = symbols[j];
+
+			if (ELF64_ST_TYPE(symbol.st_info) != STT_OBJECT || symbol.st_size == 0
+					|| symbol.st_shndx == SHN_UNDEF || symbol.st_shndx >= header->e_shnum) {
+				continue;
+			}
+
+			auto flags = sections[symbol.st_shndx].sh_flags;
+			if (!(flags & SHF_ALLOC) || !(flags & SHF_WRITE) || (flags & SHF_TLS)) {
+				continue;
+			}
+
+			const char* name = names + symbol.st_name;
+			if (isFrameworkObject(name)) {
+				continue;
+			}
+
+			addStaticObject(reinterpret_cast<const void*>(symbol.st_value + loadOffset), symbol.st_size, name);
+		}
+	}
+
+	munmap(mapped, st.st_size);
+
+	// Aliases would be reported twice
+	std::sort(staticObjects.begin(), staticObjects.end(), [](const StaticObject& a, const StaticObject& b) {
+		return a.address < b.address;
+	});
+	staticObjects.erase(std::unique(staticObjects.begin(), staticObjects.end(), [](const StaticObject& a, const StaticObject& b) {
+		return a.address == b.address;
+	}), staticObjects.end());
+
+	return !staticObjects.empty();
+}
+
+#endif // __linux__
+
+static void findStaticObjects() {
+#if defined(__linux__)
+	if (findStaticObjectsInSymbolTable()) {
+		return;
+	}
+#endif // __linux__
+
+	// No symbol table to go by, only the ones the tests are known to share
+	staticObjects.clear();
+	addStaticObject(&activeConfiguration, sizeof(activeConfiguration), "activeConfiguration");
+	addStaticObject(&enginePins, sizeof(enginePins), "enginePins");
+}
+
+/**
+ * Byte by byte rather than memcpy/memcmp: with the address sanitizer, a symbol's size includes
+ * the redzone after the object, which the sanitizer's own memcpy would report.
+ */
+__attribute__((no_sanitize_address))
+static std::vector<uint8_t> copyStatics() {
+	size_t total = 0;
+	for (const auto& object : staticObjects) {
+		total += object.size;
+	}
+
+	std::vector<uint8_t> copy(total);
+	uint8_t* p = copy.data();
+
+	for (const auto& object : staticObjects) {
+		for (size_t i = 0; i < object.size; i++) {
+			*p++ = object.address[i];
+		}
+	}
+
+	return copy;
+}
+
+__attribute__((no_sanitize_address))
+static void compareStatics(const std::vector<uint8_t>& before, ChildReport& report) {
+	const uint8_t* p = before.data();
+
+	for (size_t index = 0; index < staticObjects.size(); index++) {
+		const auto& object = staticObjects[index];
+		bool changed = false;
+
+		for (size_t i = 0; i < object.size; i++) {
+			changed |= object.address[i] != p[i];
+		}
+
+		p += object.size;
+
+		if (changed) {
+			if (report.changedStaticCount < MAX_REPORTED_STATICS) {
+				report.changedStatics[report.changedStaticCount] = index;
+			}
+
+			report.changedStaticCount++;
+		}
+	}
+}
+
+static ByteDiff compareBytes(const void* before, const void* after, size_t size) {
+	auto a = static_cast<const uint8_t*>(before);
+	auto b = static_cast<const uint8_t*>(after);
+
+	ByteDiff diff = { 0, -1 };
+
+	for (size_t i = 0; i < size; i++) {
+		if (a[i] != b[i]) {
+			if (diff.firstChange < 0) {
+				diff.firstChange = i;
+			}
+
+			diff.changedBytes++;
+		}
+	}
+
+	return diff;
+}
+
+// What the engine and configuration of a new EngineTestHelper start out as
+struct FreshHelperState {
+	bool failed;
+	persistent_config_s config;
+	TunerStudioOutputChannels outputChannels;
+};
+
+static FreshHelperState freshReference;
+static bool hasFreshReference = false;
+
+static void buildFreshHelper(FreshHelperState& state) {
+	// Outside of a test there's no test name to write the event log under
+	extern bool hasInitGtest;
+	bool hadInitGtest = hasInitGtest;
+	hasInitGtest = false;
+
+	state.failed = false;
+
+	try {
+		EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+
+		state.config = *config;
+		state.outputChannels = engine->outputChannels;
+	} catch (...) {
+		state.failed = true;
+	}
+
+	hasInitGtest = hadInitGtest;
+}
+
+/**
+ * Built in a child of its own, the parent has to stay as it was for the tests. The children
+ * inherit the result.
+ */
+static void buildFreshReference() {
+	int fds[2];
+	if (pipe(fds) != 0) {
+		perror("pipe");
+		return;
+	}
+
+	fflush(stdout);
+	fflush(stderr);
+
+	pid_t pid = fork();
+
+	if (pid < 0) {
+		perror("fork");
+		close(fds[0]);
+		close(fds[1]);
+		return;
+	}
+
+	if (pid == 0) {
+		close(fds[0]);
+
+		int devNull = open("/dev/null", O_WRONLY);
+		dup2(devNull, STDOUT_FILENO);
+		dup2(devNull, STDERR_FILENO);
+
+		static FreshHelperState state;
+		buildFreshHelper(state);
+		writeAll(fds[1], &state, sizeof(state));
+
+		_exit(0);
+	}
+
+	close(fds[1]);
+
+	hasFreshReference = readAll(fds[0], &freshReference, sizeof(freshReference)) && !freshReference.failed;
+	close(fds[0]);
+
+	int status;
+	while (waitpid(pid, &status, 0) < 0 && errno == EINTR) { }
+}
+
+[[noreturn]] static void runChild(const TestRun& run, int reportFd, int outputFd) {
+	dup2(outputFd, STDOUT_FILENO);
+	dup2(outputFd, STDERR_FILENO);
+	close(outputFd);
+
+	::testing::GTEST_FLAG(filter) = run.name;
+	// The test itself runs once, the parent deals with repeats
+	::testing::GTEST_FLAG(repeat) = 1;
+	// Children would all write the same report file
+	::testing::GTEST_FLAG(output) = "";
+
+	std::vector<uint8_t> staticsBefore = copyStatics();
+
+	ChildReport report = {};
+	report.result = RUN_ALL_TESTS();
+
+	compareStatics(staticsBefore, report);
+
+	report.engineLeft = engine != nullptr;
+	report.configLeft = engineConfiguration != nullptr || config != nullptr;
+
+	// A helper can't be built over pointers that were left set
+	if (hasFreshReference && !report.engineLeft && !report.configLeft) {
+		static FreshHelperState fresh;
+		buildFreshHelper(fresh);
+
+		report.freshChecked = true;
+		report.freshFailed = fresh.failed;
+
+		if (!fresh.failed) {
+			report.freshConfig = compareBytes(&freshReference.config, &fresh.config, sizeof(fresh.config));
+			report.freshOutputChannels = compareBytes(&freshReference.outputChannels, &fresh.outputChannels, sizeof(fresh.outputChannels));
+		}
+	}
+
+	fflush(stdout);
+	fflush(stderr);
+	writeAll(reportFd, &report, sizeof(report));
+
+	// Skip static destructors and atexit handlers, they belong to the parent
+	_exit(0);
+}
+
+static bool startChild(TestRun& run) {
+	char outputPath[] = "/tmp/fome_test_XXXXXX";
+	int outputFd = mkstemp(outputPath);
+	if (outputFd < 0) {
+		perror("mkstemp");
+		return false;
+	}
+
+	int fds[2];
+	if (pipe(fds) != 0) {
+		perror("pipe");
+		close(outputFd);
+		unlink(outputPath);
+		return false;
+	}
+
+	// Anything buffered now would be printed by the child as well
+	fflush(stdout);
+	fflush(stderr);
+
+	run.start = Clock::now();
+	pid_t pid = fork();
+
+	if (pid < 0) {
+		perror("fork");
+		close(fds[0]);
+		close(fds[1]);
+		close(outputFd);
+		unlink(outputPath);
+		return false;
+	}
+
+	if (pid == 0) {
+		close(fds[0]);
+		runChild(run, fds[1], outputFd);
+	}
+
+	close(fds[1]);
+	close(outputFd);
+
+	run.pid = pid;
+	run.reportFd = fds[0];
+	run.outputPath = outputPath;
+
+	return true;
+}
+
+static void printOutput(const TestRun& run) {
+	FILE* f = fopen(run.outputPath.c_str(), "r");
+	if (!f) {
+		return;
+	}
+
+	char buffer[4096];
+	size_t count;
+	while ((count = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+		fwrite(buffer, 1, count, stdout);
+	}
+
+	fclose(f);
+}
+
+static bool freshHelperDiffers(const ChildReport& report) {
+	return report.freshChecked
+		&& (report.freshFailed || report.freshConfig.changedBytes || report.freshOutputChannels.changedBytes);
+}
+
+static bool hasLeak(const TestRun& run) {
+	return run.hasReport
+		&& (run.report.changedStaticCount || run.report.engineLeft || run.report.configLeft
+			|| freshHelperDiffers(run.report));
+}
+
+static void finishChild(TestRun& run, int status) {
+	run.wallUs = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - run.start).count();
+
+	// The child wrote it all before exiting, and it is much smaller than a pipe buffer
+	run.hasReport = read(run.reportFd, &run.report, sizeof(run.report)) == sizeof(run.report);
+	close(run.reportFd);
+	run.reportFd = -1;
+
+	if (WIFSIGNALED(status)) {
+		run.failure = std::string("killed by signal ") + std::to_string(WTERMSIG(status));
+	} else if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || !run.hasReport) {
+		run.failure = "exited with status " + std::to_string(WEXITSTATUS(status));
+	} else if (run.report.result != 0) {
+		run.failure = "failed";
+	} else {
+		run.passed = true;
+	}
+
+	if (!run.passed) {
+		printf("[  FAILED  ] %s (%s), its output:\n", run.name.c_str(), run.failure.c_str());
+		printOutput(run);
+	}
+
+	unlink(run.outputPath.c_str());
+}
+
+static void printChangedStatics(const std::vector<TestRun>& tests, bool verbose) {
+	// Which tests changed each object
+	std::vector<std::vector<const TestRun*>> changedBy(staticObjects.size());
+
+	for (const auto& run : tests) {
+		if (!run.hasReport) {
+			continue;
+		}
+
+		size_t count = std::min<size_t>(run.report.changedStaticCount, MAX_REPORTED_STATICS);
+		for (size_t i = 0; i < count; i++) {
+			changedBy[run.report.changedStatics[i]].push_back(&run);
+		}
+	}
+
+	std::vector<size_t> changed;
+	for (size_t i = 0; i < changedBy.size(); i++) {
+		if (!changedBy[i].empty()) {
+			changed.push_back(i);
+		}
+	}
+
+	if (changed.empty()) {
+		return;
+	}
+
+	// The ones only a few tests touch are the likely leftovers, the rest is what every test goes through
+	std::stable_sort(changed.begin(), changed.end(), [&](size_t a, size_t b) {
+		return changedBy[a].size() < changedBy[b].size();
+	});
+
+	size_t shown = verbose ? changed.size() : std::min<size_t>(changed.size(), 40);
+
+	printf("\nGlobal and file-static objects left changed, fewest tests first:\n");
+	for (size_t i = 0; i < shown; i++) {
+		const auto& runs = changedBy[changed[i]];
+
+		printf("  %s (%d bytes): %d tests,", staticObjects[changed[i]].name.c_str(),
+			(int)staticObjects[changed[i]].size, (int)runs.size());
+
+		size_t names = verbose ? runs.size() : std::min<size_t>(runs.size(), 3);
+		for (size_t j = 0; j < names; j++) {
+			printf(" %s", runs[j]->name.c_str());
+		}
+
+		printf("%s\n", names < runs.size() ? " ..." : "");
+	}
+
+	if (shown < changed.size()) {
+		printf("  ... %d more, --isolated-verbose lists them all\n", (int)(changed.size() - shown));
+	}
+}
+
+static void printSummary(const std::vector<TestRun>& tests, int workerCount, int64_t totalUs, bool verbose) {
+	std::vector<const TestRun*> failed;
+	std::vector<const TestRun*> leaked;
+	std::vector<const TestRun*> slowest;
+
+	int64_t testUs = 0;
+
+	for (const auto& run : tests) {
+		if (!run.passed) {
+			failed.push_back(&run);
+		}
+
+		if (hasLeak(run)) {
+			leaked.push_back(&run);
+		}
+
+		slowest.push_back(&run);
+		testUs += run.wallUs;
+	}
+
+	std::sort(slowest.begin(), slowest.end(), [](const TestRun* a, const TestRun* b) {
+		return a->wallUs > b->wallUs;
+	});
+
+	printf("\nSlowest tests:\n");
+	for (size_t i = 0; i < std::min<size_t>(10, slowest.size()); i++) {
+		printf("  %8.1f ms  %s\n", slowest[i]->wallUs / 1000.0, slowest[i]->name.c_str());
+	}
+
+	printChangedStatics(tests, verbose);
+
+	bool anyAffectsNextTest = false;
+	for (auto run : leaked) {
+		const auto& report = run->report;
+
+		if (!report.engineLeft && !report.configLeft && !freshHelperDiffers(report)) {
+			continue;
+		}
+
+		if (!anyAffectsNextTest) {
+			printf("\nTests after which a new EngineTestHelper starts out differently:\n");
+			anyAffectsNextTest = true;
+		}
+
+		std::vector<std::string> what;
+
+		if (report.engineLeft) {
+			what.push_back("engine pointer still set");
+		}
+
+		if (report.configLeft) {
+			what.push_back("config pointers still set");
+		}
+
+		if (report.freshFailed) {
+			what.push_back("EngineTestHelper construction failed");
+		}
+
+		char line[128];
+
+		if (report.freshConfig.changedBytes) {
+			snprintf(line, sizeof(line), "persistent_config %d bytes changed, first at offset %d",
+				(int)report.freshConfig.changedBytes, (int)report.freshConfig.firstChange);
+			what.push_back(line);
+		}
+
+		if (report.freshOutputChannels.changedBytes) {
+			snprintf(line, sizeof(line), "engine output channels %d bytes changed, first at offset %d",
+				(int)report.freshOutputChannels.changedBytes, (int)report.freshOutputChannels.firstChange);
+			what.push_back(line);
+		}
+
+		printf("  %s:", run->name.c_str());
+		for (size_t i = 0; i < what.size(); i++) {
+			printf("%s %s", i ? ";" : "", what[i].c_str());
+		}
+		printf("\n");
+	}
+
+	if (!hasFreshReference) {
+		printf("\nCould not build a reference EngineTestHelper, the engine and persistent_config were not compared\n");
+	}
+
+	printf("\n%d tests, %d workers, %.2f s wall, %.2f s in tests, %d left state behind\n",
+		(int)tests.size(), workerCount, totalUs / 1e6, testUs / 1e6, (int)leaked.size());
+
+	if (failed.empty()) {
+		printf("[  PASSED  ] all %d tests\n", (int)tests.size());
+	} else {
+		printf("[  FAILED  ] %d tests, listed below:\n", (int)failed.size());
+
+		for (auto run : failed) {
+			printf("[  FAILED  ] %s (%s)\n", run->name.c_str(), run->failure.c_str());
+		}
+	}
+}
+
+int runIsolatedTests(const IsolatedRunOptions& options) {
+	int workerCount = options.workerCount;
+	if (workerCount <= 0) {
+		workerCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	std::vector<TestRun> tests = listTests();
+
+	findStaticObjects();
+	buildFreshReference();
+
+	printf("Running %d tests, each in its own process, %d at a time\n", (int)tests.size(), workerCount);
+
+	auto start = Clock::now();
+
+	size_t next = 0;
+	int running = 0;
+	bool startFailed = false;
+
+	while (next < tests.size() || running > 0) {
+		while (!startFailed && running < workerCount && next < tests.size()) {
+			if (!startChild(tests[next])) {
+				startFailed = true;
+				break;
+			}
+
+			next++;
+			running++;
+		}
+
+		if (running == 0) {
+			break;
+		}
+
+		int status;
+		pid_t pid = waitpid(-1, &status, 0);
+
+		if (pid < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			perror("waitpid");
+			return -1;
+		}
+
+		for (auto& run : tests) {
+			if (run.pid == pid && run.reportFd >= 0) {
+				finishChild(run, status);
+				running--;
+
+				if (options.verbose && run.passed) {
+					printf("[       OK ] %s (%.1f ms)\n", run.name.c_str(), run.wallUs / 1000.0);
+				}
+
+				break;
+			}
+		}
+	}
+
+	if (startFailed) {
+		printf("Could not start a test process, %d tests were not run\n", (int)(tests.size() - next));
+		return -1;
+	}
+
+	int64_t totalUs = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+	printSummary(tests, workerCount, totalUs, options.verbose);
+
+	for (const auto& run : tests) {
+		if (!run.passed) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+#endif // _WIN32
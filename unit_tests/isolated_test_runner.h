@@ -0,0 +1,24 @@
+/**
+ * @file isolated_test_runner.h
+ *
+ * Runs every test in its own forked copy of this process, a number of them at a time.
+ *
+ * Each test starts from the state the process had before any test ran, so a test that only passes
+ * (or only fails) because of what an earlier test left behind shows up. The children are forked
+ * from an already initialized process, which is much cheaper than starting the executable once per test.
+ */
+
+#pragma once
+
+struct IsolatedRunOptions {
+	// 0 for one worker per core
+	int workerCount = 0;
+	// Print every test as it finishes, not just the failures and the summary
+	bool verbose = false;
+};
+
+/**
+ * Call after testing::InitGoogleTest, instead of RUN_ALL_TESTS. Honors --gtest_filter.
+ * @return 0 if every test passed
+ */
+int runIsolatedTests(const IsolatedRunOptions& options);
@@ -5,6 +5,8 @@
  * @author Andrey Belomutskiy, (c) 2012-2021
  */
 
+#pragma once
+
 const int NORMAL_ORDER[2] = {0, 1};
 
 const int REVERSE_ORDER[2] = {1, 0};
@@ -8,6 +8,10 @@
 
 #include "pch.h"
 #include <stdlib.h>
+#include <string.h>
+
+#include "isolated_test_runner.h"
+#include "trigger_replay.h"
 
 bool hasInitGtest = false;
 
@@ -21,7 +25,32 @@ GTEST_API_ int main(int argc, char **argv) {
 	 */
 //	setVerboseTrigger(true);
 //	::testing::GTEST_FLAG(filter) = "*integrated*";
-	int result = RUN_ALL_TESTS();
+
+	/**
+	 * --isolated[=workers] runs each test in its own process, see isolated_test_runner.h
+	 * --isolated-verbose also lists the tests that passed
+	 * --replay-baseline=check|update for TriggerReplay.DISABLED_Benchmark, see test_trigger_replay.cpp
+	 */
+	bool isolated = false;
+	IsolatedRunOptions isolatedOptions;
+
+	for (int i = 1; i < argc; i++) {
+		if (0 == strcmp(argv[i], "--isolated")) {
+			isolated = true;
+		} else if (0 == strncmp(argv[i], "--isolated=", 11)) {
+			isolated = true;
+			isolatedOptions.workerCount = atoi(argv[i] + 11);
+		} else if (0 == strcmp(argv[i], "--isolated-verbose")) {
+			isolated = true;
+			isolatedOptions.verbose = true;
+		} else if (0 == strcmp(argv[i], "--replay-baseline=check")) {
+			triggerReplayBaselineMode = TriggerReplayBaselineMode::Check;
+		} else if (0 == strcmp(argv[i], "--replay-baseline=update")) {
+			triggerReplayBaselineMode = TriggerReplayBaselineMode::Update;
+		}
+	}
+
+	int result = isolated ? runIsolatedTests(isolatedOptions) : RUN_ALL_TESTS();
 	// windows ERRORLEVEL in Jenkins batch file seems to want negative value to detect failure
 	return result == 0 ? 0 : -1;
 }
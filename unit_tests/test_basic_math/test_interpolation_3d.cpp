@@ -8,6 +8,7 @@
 #include "pch.h"
 
 #include <stdlib.h>
+#include <chrono>
 
 #include "efi_interpolation.h"
 
@@ -67,6 +68,14 @@ static float getValue(float rpm, float maf) {
 	float result6 = x6.getValue(rpm, maf);
 	EXPECT_NEAR(result1, result6, 1e-3);
 
+	CachedMap3D<5, 4, float, float, float> x7;
+	x7.init(map, mafBins, rpmBins);
+	EXPECT_NEAR_M4(result1, x7.getValue(rpm, maf));
+
+	CachedMap3D<5, 4, float, uint8_t, int> x8;
+	x8.init(map, mafBinsScaledInt, rpmBinsScaledByte);
+	EXPECT_NEAR_M4(result1, x8.getValue(rpm, maf));
+
 	return result1;
 }
 
@@ -153,3 +162,98 @@ TEST(misc, testInterpolate3d) {
 
 	newTestToComfirmInterpolation();
 }
+
+TEST(misc, cachedMap3dEdges) {
+	// repeated bins at both ends, the flat spots must resolve to the same cell as interpolate3d
+	float rows[4] = { 1, 1, 3, 3 };
+	float cols[5] = { 100, 100, 300, 400, 400 };
+
+	Map3D<5, 4, float, float, float> reference;
+	reference.init(map, rows, cols);
+
+	CachedMap3D<5, 4, float, float, float> cached;
+	cached.init(map, rows, cols);
+
+	for (float rpm : { 0.0f, 100.0f, 150.0f, 300.0f, 399.0f, 400.0f, 500.0f, NAN }) {
+		for (float load : { 0.0f, 1.0f, 2.0f, 2.5f, 3.0f, 4.0f, NAN }) {
+			EXPECT_NEAR_M4(reference.getValue(rpm, load), cached.getValue(rpm, load)) << rpm << " @ " << load;
+		}
+	}
+
+	// Bins are only picked up on refresh
+	cols[2] = 200;
+	EXPECT_NEAR_M4(2.75, cached.getValue(250, 1));
+	cached.refreshBins();
+	EXPECT_NEAR_M4(3.25, cached.getValue(250, 1));
+	EXPECT_NEAR_M4(reference.getValue(250, 1), cached.getValue(250, 1));
+
+	// ...which any write to the configuration causes, burnt or live
+	cols[2] = 300;
+	configurationWriteCounter++;
+	EXPECT_NEAR_M4(2.75, cached.getValue(250, 1));
+	EXPECT_NEAR_M4(reference.getValue(250, 1), cached.getValue(250, 1));
+}
+
+template <int N>
+static void benchmarkTableSize() {
+	static float table[N][N];
+	static uint16_t rpmBins[N];
+	static scaled_channel<uint16_t, 10> loadBins[N];
+
+	for (int i = 0; i < N; i++) {
+		rpmBins[i] = 500 + 7000 * i / (N - 1);
+		loadBins[i] = 10 + 240 * i / (N - 1);
+
+		for (int j = 0; j < N; j++) {
+			table[i][j] = i * N + j;
+		}
+	}
+
+	Map3D<N, N, float, uint16_t, uint16_t> reference;
+	reference.init(table, loadBins, rpmBins);
+
+	CachedMap3D<N, N, float, uint16_t, uint16_t> cached;
+	cached.init(table, loadBins, rpmBins);
+
+	constexpr int iterations = 200000;
+
+	// Slowly sweep rpm/load like a running engine would, crossing a cell every so often
+	auto rpmAt = [](int i) { return 400 + (i % 8000); };
+	auto loadAt = [](int i) { return 5 + (i % 2600) * 0.1f; };
+
+	float sum1 = 0;
+	float sum2 = 0;
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < iterations; i++) {
+		sum1 += interpolate3d(table, loadBins, loadAt(i), rpmBins, rpmAt(i));
+	}
+
+	auto mid = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < iterations; i++) {
+		sum2 += cached.getValue(rpmAt(i), loadAt(i));
+	}
+
+	auto end = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < iterations; i += 997) {
+		ASSERT_NEAR(reference.getValue(rpmAt(i), loadAt(i)), cached.getValue(rpmAt(i), loadAt(i)), 1e-3);
+	}
+
+	EXPECT_NEAR(sum1, sum2, 1e-4 * std::abs(sum1));
+
+	auto interpolateNs = std::chrono::duration_cast<std::chrono::nanoseconds>(mid - start).count() * 1000 / iterations;
+	auto cachedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - mid).count() * 1000 / iterations;
+	printf("Map3D %2dx%2d interpolate3d=%5dps cached=%5dps\n", N, N, (int)interpolateNs, (int)cachedNs);
+}
+
+TEST(misc, benchmarkCachedMap3d) {
+	// Every square table size in persistent_config_s
+	benchmarkTableSize<4>();
+	benchmarkTableSize<6>();
+	benchmarkTableSize<8>();
+	benchmarkTableSize<10>();
+	benchmarkTableSize<16>();
+}
@@ -190,8 +190,8 @@ TEST(ignition, oddCylinderWastedSpark) {
 	engineConfiguration->minimumIgnitionTiming = -25;
 
 	// expect to schedule the on-phase dwell and spark (not the wasted spark copy)
-	onTriggerEventSparkLogic({nowNt1, 10, 30, 10, 30});
+	onTriggerEventSparkLogic(0, {nowNt1, 10, 30, 10, 30});
 
 	// expect to schedule second events, the out-of-phase dwell and spark (the wasted spark copy)
-	onTriggerEventSparkLogic({nowNt2, 360 + 10, 360 + 30, 360 + 10, 360 + 30});
+	onTriggerEventSparkLogic(0, {nowNt2, 360 + 10, 360 + 30, 360 + 10, 360 + 30});
 }
@@ -0,0 +1,94 @@
+/*
+ * @file test_tooth_event_index.cpp
+ */
+
+#include "pch.h"
+
+// Same tooth window as TriggerCentral::handleShaftSignal would hand to mainTriggerCallback
+static EnginePhaseInfo getToothPhase(size_t toothIndex) {
+	TriggerCentral* tc = getTriggerCentral();
+
+	TrgPhase current{ tc->triggerFormDetails.eventAngles[toothIndex] };
+	TrgPhase next;
+
+	size_t nextToothIndex = toothIndex;
+	do {
+		nextToothIndex = (nextToothIndex + 1) % tc->engineCycleEventCount;
+		next = { tc->triggerFormDetails.eventAngles[nextToothIndex] };
+	} while (next == current);
+
+	return {
+		.timestamp = 0,
+		.currentTrgPhase = current,
+		.nextTrgPhase = next,
+		.currentEngPhase = tc->toEngPhase(current),
+		.nextEngPhase = tc->toEngPhase(next),
+	};
+}
+
+static void checkIndexMatchesRangeCheck(trigger_type_e trigger, float triggerOffset) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+	engineConfiguration->globalTriggerAngleOffset = triggerOffset;
+	eth.setTriggerType(trigger);
+
+	auto& index = engine->toothEventIndex;
+	index.rebuild();
+
+	size_t toothCount = getTriggerCentral()->engineCycleEventCount;
+	ASSERT_GT(toothCount, 0u);
+
+	for (float angle = 0; angle < 720; angle += 0.25f) {
+		index.setFuelAngle(0, angle);
+		index.setSparkAngle(3, angle);
+
+		int hits = 0;
+
+		for (size_t tooth = 0; tooth < toothCount; tooth++) {
+			auto phase = getToothPhase(tooth);
+			auto events = index.get(tooth, phase);
+			ASSERT_TRUE(events.Valid) << "tooth " << tooth;
+
+			bool expected = isPhaseInRange(EngPhase{angle}, phase);
+			EXPECT_EQ(expected, (events.Value.fuelMask & (1 << 0)) != 0) << "angle " << angle << " tooth " << tooth;
+			EXPECT_EQ(expected, (events.Value.sparkMask & (1 << 3)) != 0) << "angle " << angle << " tooth " << tooth;
+
+			hits += expected;
+		}
+
+		// Every angle is due after exactly one tooth (or one group of teeth at the same angle)
+		EXPECT_GE(hits, 1) << "angle " << angle;
+	}
+}
+
+TEST(ToothEventIndex, MatchesRangeCheck60_2) {
+	checkIndexMatchesRangeCheck(trigger_type_e::TT_TOOTHED_WHEEL_60_2, 0);
+}
+
+TEST(ToothEventIndex, MatchesRangeCheck60_2WithOffset) {
+	checkIndexMatchesRangeCheck(trigger_type_e::TT_TOOTHED_WHEEL_60_2, 117.5f);
+}
+
+TEST(ToothEventIndex, MatchesRangeCheck36_1) {
+	checkIndexMatchesRangeCheck(trigger_type_e::TT_TOOTHED_WHEEL_36_1, 0);
+}
+
+TEST(ToothEventIndex, StalePhaseFallsBack) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+	eth.setTriggerType(trigger_type_e::TT_TOOTHED_WHEEL_60_2);
+
+	auto& index = engine->toothEventIndex;
+	index.rebuild();
+
+	auto phase = getToothPhase(5);
+	EXPECT_TRUE(index.get(5, phase).Valid);
+
+	// Engine phase doesn't match what the index was built for, caller has to check everything
+	phase.currentEngPhase.angle += 1;
+	EXPECT_FALSE(index.get(5, phase).Valid);
+
+	// Out of range tooth
+	EXPECT_FALSE(index.get(10000, getToothPhase(5)).Valid);
+
+	index.invalidate();
+	EXPECT_FALSE(index.get(5, getToothPhase(5)).Valid);
+}
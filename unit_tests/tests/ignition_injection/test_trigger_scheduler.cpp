@@ -0,0 +1,188 @@
+/*
+ * @file test_trigger_scheduler.cpp
+ */
+
+#include "pch.h"
+
+#include <chrono>
+#include <vector>
+
+// Same tooth window as TriggerCentral::handleShaftSignal would hand to the engine modules
+static EnginePhaseInfo getToothPhase(size_t toothIndex) {
+	TriggerCentral* tc = getTriggerCentral();
+
+	TrgPhase current{ tc->triggerFormDetails.eventAngles[toothIndex] };
+	TrgPhase next;
+
+	size_t nextToothIndex = toothIndex;
+	do {
+		nextToothIndex = (nextToothIndex + 1) % tc->engineCycleEventCount;
+		next = { tc->triggerFormDetails.eventAngles[nextToothIndex] };
+	} while (next == current);
+
+	return {
+		.timestamp = 0,
+		.currentTrgPhase = current,
+		.nextTrgPhase = next,
+		.currentEngPhase = tc->toEngPhase(current),
+		.nextEngPhase = tc->toEngPhase(next),
+	};
+}
+
+static void noopAction(void*) { }
+
+static bool isQueued(const AngleBasedEvent& event) {
+	return event.queuedTooth != TRIGGER_SCHEDULER_NOT_QUEUED;
+}
+
+static void checkFiresOnRangeCheckTooth(trigger_type_e trigger) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+	eth.setTriggerType(trigger);
+	engine->rpmCalculator.setRpmValue(1000);
+
+	auto& scheduler = *engine->module<TriggerScheduler>();
+	size_t toothCount = getTriggerCentral()->engineCycleEventCount;
+	ASSERT_GT(toothCount, 0u);
+
+	// Every 0.75 degrees, including right on the teeth
+	std::vector<AngleBasedEvent> events(960);
+	for (size_t i = 0; i < events.size(); i++) {
+		scheduler.schedule(&events[i], EngPhase{ i * 0.75f }, noopAction);
+	}
+
+	// Two engine cycles: the first one also sorts the events queued before the shape was known
+	for (size_t cycle = 0; cycle < 2; cycle++) {
+		for (size_t tooth = 0; tooth < toothCount; tooth++) {
+			auto phase = getToothPhase(tooth);
+
+			std::vector<bool> expected(events.size());
+			for (size_t i = 0; i < events.size(); i++) {
+				expected[i] = isQueued(events[i]) && isPhaseInRange(events[i].eventPhase, phase);
+			}
+
+			scheduler.onEnginePhase(1000, phase);
+
+			for (size_t i = 0; i < events.size(); i++) {
+				EXPECT_EQ(expected[i], !isQueued(events[i])) << "event " << i << " tooth " << tooth;
+
+				// Queue it again for the next cycle, the executor doesn't have room for all of them
+				if (!isQueued(events[i])) {
+					engine->scheduler.cancel(&events[i].scheduling);
+					scheduler.schedule(&events[i], EngPhase{ i * 0.75f }, noopAction);
+				}
+			}
+		}
+	}
+
+	for (auto& event : events) {
+		engine->scheduler.cancel(&event.scheduling);
+	}
+}
+
+TEST(TriggerScheduler, FiresOnRangeCheckTooth60_2) {
+	checkFiresOnRangeCheckTooth(trigger_type_e::TT_TOOTHED_WHEEL_60_2);
+}
+
+TEST(TriggerScheduler, FiresOnRangeCheckTooth36_1) {
+	checkFiresOnRangeCheckTooth(trigger_type_e::TT_TOOTHED_WHEEL_36_1);
+}
+
+TEST(TriggerScheduler, RequeueMovesEvent) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+	eth.setTriggerType(trigger_type_e::TT_TOOTHED_WHEEL_60_2);
+
+	auto& scheduler = *engine->module<TriggerScheduler>();
+	scheduler.onTriggerShapeChanged();
+
+	AngleBasedEvent event;
+	scheduler.schedule(&event, EngPhase{ 100 }, noopAction);
+	uint16_t before = event.queuedTooth;
+
+	// Queued again before it fired: it has to move to its new tooth, not stay on the old one
+	scheduler.schedule(&event, EngPhase{ 400 }, noopAction);
+	EXPECT_NE(before, event.queuedTooth);
+	EXPECT_EQ(&event, scheduler.getElementAtIndexForUnitTest(0));
+	EXPECT_NEAR(getTriggerCentral()->toTrgPhase(EngPhase{ 400 }).angle, event.eventPhase.angle, 1e-3);
+
+	scheduler.onEnginePhase(1000, getToothPhase(event.queuedTooth));
+	EXPECT_FALSE(isQueued(event));
+
+	engine->scheduler.cancel(&event.scheduling);
+}
+
+TEST(TriggerScheduler, V8MultisparkPerTooth) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+	eth.setTriggerType(trigger_type_e::TT_TOOTHED_WHEEL_60_2);
+	engineConfiguration->cylindersCount = 8;
+	engineConfiguration->multisparkEnable = true;
+	engineConfiguration->multisparkMaxRpm = 3000;
+	engineConfiguration->multisparkMaxSparkingAngle = 45;
+	engineConfiguration->multisparkMaxExtraSparkCount = 4;
+	engineConfiguration->multisparkDwell = 1;
+	engineConfiguration->multisparkSparkDuration = 1;
+	engine->rpmCalculator.setRpmValue(800);
+
+	auto& scheduler = *engine->module<TriggerScheduler>();
+	scheduler.onTriggerShapeChanged();
+
+	size_t toothCount = getTriggerCentral()->engineCycleEventCount;
+
+	// Per cylinder, the spark and its repeats, plus one more event (injector, HPFP...)
+	int sparksPerCylinder = 1 + getMultiSparkCount(800);
+	ASSERT_GT(sparksPerCylinder, 1);
+
+	AngleBasedEvent events[8 * 6];
+	size_t eventCount = 8 * (sparksPerCylinder + 1);
+	ASSERT_LE(eventCount, efi::size(events));
+
+	auto angleOf = [&](size_t i) {
+		size_t cylinder = i / (sparksPerCylinder + 1);
+		size_t n = i % (sparksPerCylinder + 1);
+		return EngPhase{ cylinder * 90.0f + n * 9.0f + 3 };
+	};
+
+	auto replay = [&](int cycles, bool matchTeeth) {
+		for (size_t i = 0; i < eventCount; i++) {
+			if (!isQueued(events[i])) {
+				scheduler.schedule(&events[i], angleOf(i), noopAction);
+			}
+		}
+
+		auto start = std::chrono::steady_clock::now();
+
+		for (int cycle = 0; cycle < cycles; cycle++) {
+			for (size_t tooth = 0; tooth < toothCount; tooth++) {
+				auto phase = getToothPhase(tooth);
+
+				if (!matchTeeth) {
+					// Same window, but a phase the tooth lists weren't made for: every pending event is checked
+					phase.currentTrgPhase.angle += 1e-3f;
+				}
+
+				scheduler.onEnginePhase(800, phase);
+
+				// Fired events get queued again for the next cycle, like the spark logic does
+				for (size_t i = 0; i < eventCount; i++) {
+					if (!isQueued(events[i])) {
+						scheduler.schedule(&events[i], angleOf(i), noopAction);
+					}
+				}
+			}
+		}
+
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / (cycles * toothCount);
+	};
+
+	constexpr int cycles = 500;
+	auto bucketedNs = replay(cycles, true);
+	auto scanNs = replay(cycles, false);
+
+	// In firmware the lock is held only to take the tooth's list, the rest runs unlocked
+	printf("TriggerScheduler %d events, 60-2 V8 multispark, per tooth: tooth lists=%5dns unmatched phase, checking all=%5dns\n",
+		(int)eventCount, (int)bucketedNs, (int)scanNs);
+
+	for (size_t i = 0; i < eventCount; i++) {
+		engine->scheduler.cancel(&events[i].scheduling);
+	}
+}
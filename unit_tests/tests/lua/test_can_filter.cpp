@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "can_filter.h"
+#include "can_rx_index.h"
 
 TEST(CanFilterTest, acceptAny) {
 	CanFilter filterAny;
@@ -48,3 +49,18 @@ TEST(CanFilterTest, orderOfBusinessTwo) {
 	ASSERT_EQ(CALLBACK_ALL, getFilterForId(CanBusIndex::Bus0, /*id*/ 0)->Callback);
 	ASSERT_EQ(CALLBACK_239, getFilterForId(CanBusIndex::Bus0, /*id*/ 239)->Callback);
 }
+
+TEST(CanFilterTest, reloadForgetsOldIds) {
+	resetLuaCanRx();
+	addLuaCanRxFilter(/*eid*/239, FILTER_SPECIFIC, CanBusIndex::Any, CALLBACK_239);
+	ASSERT_NE(nullptr, getFilterForId(CanBusIndex::Bus0, /*id*/ 239));
+
+	// The reloaded script listens for something else
+	resetLuaCanRx();
+	addLuaCanRxFilter(/*eid*/240, FILTER_SPECIFIC, CanBusIndex::Any, CALLBACK_ALL);
+
+	EXPECT_EQ(nullptr, getFilterForId(CanBusIndex::Bus0, /*id*/ 239));
+	EXPECT_EQ(nullptr, getCanRxIndex().find(239));
+	ASSERT_NE(nullptr, getFilterForId(CanBusIndex::Bus0, /*id*/ 240));
+	EXPECT_EQ(CALLBACK_ALL, getFilterForId(CanBusIndex::Bus0, /*id*/ 240)->Callback);
+}
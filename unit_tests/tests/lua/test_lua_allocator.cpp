@@ -0,0 +1,164 @@
+#include "pch.h"
+
+#include "lua_allocator.h"
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+// Hands out the slabs of a region in a scrambled order, like a heap that's seen some use would
+struct SlabRegion {
+	alignas(8) char region[8 * LuaSmallObjectPool::slabSize];
+	size_t slabsGiven = 0;
+	size_t limit = 8;
+
+	static void* take(void* context) {
+		auto self = static_cast<SlabRegion*>(context);
+
+		if (self->slabsGiven >= self->limit) {
+			return nullptr;
+		}
+
+		static constexpr size_t order[] = { 5, 1, 7, 0, 3, 6, 2, 4 };
+		return self->region + order[self->slabsGiven++] * LuaSmallObjectPool::slabSize;
+	}
+};
+
+TEST(LuaAllocator, SizeClasses) {
+	SlabRegion slabs;
+
+	LuaSmallObjectPool pool;
+	pool.init(SlabRegion::take, &slabs);
+
+	// Nothing taken until something is allocated
+	EXPECT_EQ(0u, pool.getSlabsUsed());
+	EXPECT_EQ(0u, slabs.slabsGiven);
+
+	void* a = pool.alloc(1);
+	void* b = pool.alloc(8);
+	void* c = pool.alloc(9);
+	void* d = pool.alloc(64);
+
+	ASSERT_NE(nullptr, a);
+	ASSERT_NE(nullptr, b);
+	ASSERT_NE(nullptr, c);
+	ASSERT_NE(nullptr, d);
+
+	EXPECT_EQ(8u, pool.getBlockSize(a));
+	EXPECT_EQ(8u, pool.getBlockSize(b));
+	EXPECT_EQ(16u, pool.getBlockSize(c));
+	EXPECT_EQ(64u, pool.getBlockSize(d));
+
+	// Three classes touched
+	EXPECT_EQ(3u, pool.getSlabsUsed());
+	EXPECT_EQ(3u, slabs.slabsGiven);
+	EXPECT_EQ(3 * LuaSmallObjectPool::slabSize, pool.getSize());
+
+	for (void* p : { a, b, c, d }) {
+		EXPECT_TRUE(pool.owns(p));
+		EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(p) % LuaSmallObjectPool::granularity);
+	}
+
+	// Too big, or nothing at all
+	EXPECT_EQ(nullptr, pool.alloc(65));
+	EXPECT_EQ(nullptr, pool.alloc(0));
+
+	// Not ours: elsewhere, or in the part of the region no slab was taken from
+	int other;
+	EXPECT_FALSE(pool.owns(&other));
+	EXPECT_FALSE(pool.owns(slabs.region + 4 * LuaSmallObjectPool::slabSize));
+	EXPECT_FALSE(pool.owns(slabs.region + 8 * LuaSmallObjectPool::slabSize));
+}
+
+TEST(LuaAllocator, FreedBlocksAreReused) {
+	SlabRegion slabs;
+
+	LuaSmallObjectPool pool;
+	pool.init(SlabRegion::take, &slabs);
+
+	void* a = pool.alloc(24);
+	pool.free(a);
+
+	// Last freed, first out
+	EXPECT_EQ(a, pool.alloc(20));
+	EXPECT_EQ(1u, pool.getSlabsUsed());
+}
+
+TEST(LuaAllocator, FindsBlocksInEverySlab) {
+	SlabRegion slabs;
+
+	LuaSmallObjectPool pool;
+	pool.init(SlabRegion::take, &slabs);
+
+	// Every slab a different size class, taken out of address order
+	std::vector<void*> blocks;
+	for (size_t size = 8; size <= LuaSmallObjectPool::maxBlockSize; size += 8) {
+		for (size_t i = 0; i < LuaSmallObjectPool::slabSize / size; i++) {
+			blocks.push_back(pool.alloc(size));
+		}
+	}
+
+	ASSERT_EQ(8u, pool.getSlabsUsed());
+
+	for (void* p : blocks) {
+		ASSERT_TRUE(pool.owns(p));
+		size_t slabIndex = (static_cast<char*>(p) - slabs.region) / LuaSmallObjectPool::slabSize;
+
+		// Each slab got the size class it was taken for
+		static constexpr size_t order[] = { 5, 1, 7, 0, 3, 6, 2, 4 };
+		size_t expectedClass = std::find(std::begin(order), std::end(order), slabIndex) - std::begin(order);
+		EXPECT_EQ((expectedClass + 1) * 8, pool.getBlockSize(p));
+	}
+
+	for (void* p : blocks) {
+		pool.free(p);
+	}
+
+	// All back on their free lists, no new slabs needed
+	for (size_t size = 8; size <= LuaSmallObjectPool::maxBlockSize; size += 8) {
+		EXPECT_NE(nullptr, pool.alloc(size));
+	}
+	EXPECT_EQ(8u, pool.getSlabsUsed());
+}
+
+TEST(LuaAllocator, RunsOutOfSlabs) {
+	SlabRegion slabs;
+	slabs.limit = 2;
+
+	LuaSmallObjectPool pool;
+	pool.init(SlabRegion::take, &slabs);
+
+	// A whole slab of 32 byte blocks, all different
+	std::set<void*> blocks;
+	for (size_t i = 0; i < LuaSmallObjectPool::slabSize / 32; i++) {
+		void* p = pool.alloc(32);
+		ASSERT_NE(nullptr, p);
+		blocks.insert(p);
+	}
+
+	EXPECT_EQ(LuaSmallObjectPool::slabSize / 32, blocks.size());
+	EXPECT_EQ(1u, pool.getSlabsUsed());
+
+	// Next one takes the last slab
+	EXPECT_NE(nullptr, pool.alloc(32));
+	EXPECT_EQ(2u, pool.getSlabsUsed());
+
+	// Another size class has nowhere to go
+	EXPECT_EQ(nullptr, pool.alloc(8));
+
+	// ...until it starts over
+	slabs.slabsGiven = 0;
+	pool.init(SlabRegion::take, &slabs);
+	EXPECT_EQ(0u, pool.getSlabsUsed());
+	EXPECT_NE(nullptr, pool.alloc(8));
+}
+
+TEST(LuaAllocator, NoSource) {
+	LuaSmallObjectPool pool;
+	pool.init(nullptr, nullptr);
+
+	EXPECT_EQ(nullptr, pool.alloc(8));
+
+	int other;
+	EXPECT_FALSE(pool.owns(&other));
+}
@@ -47,6 +47,18 @@ TEST(LuaHooks, TestSetCalibration) {
 		EXPECT_EQ(testLuaReturnsNumber(sourceCode), 900);
 }
 
+TEST(LuaHooks, SetCalibrationRefreshesCaches) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+
+	uint32_t before = configurationWriteCounter;
+	EXPECT_NO_THROW(testLuaExecString("setCalibration(\"cranking.rpm\", 900, false)"));
+	EXPECT_NE(before, configurationWriteCounter);
+
+	before = configurationWriteCounter;
+	EXPECT_NO_THROW(testLuaExecString("setCalibration(\"cranking.rpm\", 800, true)"));
+	EXPECT_NE(before, configurationWriteCounter);
+}
+
 TEST(LuaHooks, TestGetSensorByName) {
 	const char* getSensorTestByName = R"(
 
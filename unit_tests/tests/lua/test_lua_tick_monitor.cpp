@@ -0,0 +1,116 @@
+#include "pch.h"
+
+#include "lua_tick_monitor.h"
+#include "rusefi_lua.h"
+
+static LuaHandle makeState(LuaTickMonitor& monitor) {
+	LuaHandle ls = luaL_newstate();
+	monitor.install(ls);
+	return ls;
+}
+
+static int runChunk(lua_State* l, const char* script) {
+	int status = luaL_dostring(l, script);
+	lua_settop(l, 0);
+	return status;
+}
+
+TEST(LuaTickMonitor, BudgetAbortsRunawayScript) {
+	LuaTickMonitor monitor;
+	auto ls = makeState(monitor);
+
+	// 50k instructions
+	monitor.beginTick(50);
+
+	EXPECT_NE(0, luaL_dostring(ls, "while true do end"));
+	EXPECT_NE(nullptr, strstr(lua_tostring(ls, -1), "instruction budget"));
+	lua_settop(ls, 0);
+
+	EXPECT_EQ(1u, monitor.getBudgetExceededCount());
+	EXPECT_EQ(51u, monitor.getTickInstructions());
+
+	// Next tick starts from zero
+	monitor.beginTick(50);
+	EXPECT_EQ(0, runChunk(ls, "local x = 0 for i = 1, 100 do x = x + i end"));
+	EXPECT_EQ(1u, monitor.getBudgetExceededCount());
+}
+
+TEST(LuaTickMonitor, NoBudgetNoLimit) {
+	LuaTickMonitor monitor;
+	auto ls = makeState(monitor);
+
+	monitor.beginTick(0);
+
+	EXPECT_EQ(0, runChunk(ls, "local x = 0 for i = 1, 100000 do x = x + i end"));
+	EXPECT_EQ(0u, monitor.getBudgetExceededCount());
+	EXPECT_GT(monitor.getTickInstructions(), 100u);
+}
+
+static int slowHook(lua_State*) {
+	advanceTimeUs(100);
+	return 0;
+}
+
+TEST(LuaTickMonitor, ProfilesLuaAndC) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+
+	LuaTickMonitor monitor;
+	auto ls = makeState(monitor);
+	lua_register(ls, "slowHook", slowHook);
+
+	ASSERT_EQ(0, runChunk(ls, R"(
+		function busy()
+			local x = 0
+			for i = 1, 5000 do x = x + i end
+			return x
+		end
+
+		function onTick()
+			busy()
+			for i = 1, 10 do slowHook() end
+		end
+	)"));
+
+	monitor.setProfiling(true);
+	monitor.beginTick(0);
+
+	lua_getglobal(ls, "onTick");
+	ASSERT_EQ(0, lua_pcall(ls, 0, 0, 0));
+
+	const LuaTickMonitor::Entry* busy = nullptr;
+	const LuaTickMonitor::Entry* hook = nullptr;
+
+	for (size_t i = 0; i < monitor.getEntryCount(); i++) {
+		const auto& entry = monitor.getEntry(i);
+
+		if (0 == strcmp(entry.name, "busy")) {
+			busy = &entry;
+		} else if (0 == strcmp(entry.name, "slowHook")) {
+			hook = &entry;
+		}
+	}
+
+	ASSERT_NE(nullptr, busy);
+	EXPECT_FALSE(busy->isC);
+	EXPECT_GT(busy->count, 10u);
+
+	// C hooks are timed call by call
+	ASSERT_NE(nullptr, hook);
+	EXPECT_TRUE(hook->isC);
+	EXPECT_EQ(10u, hook->count);
+	EXPECT_EQ(1000u, hook->timeUs);
+
+	// ...and that time isn't charged to the Lua function that called it
+	uint8_t shares[4];
+	monitor.getTopShares(shares, efi::size(shares));
+	EXPECT_EQ(100, shares[0]);
+	EXPECT_EQ(0, shares[1]);
+
+	monitor.printProfile();
+
+	// Stopping keeps the results, starting again clears them
+	monitor.setProfiling(false);
+	EXPECT_GT(monitor.getEntryCount(), 0u);
+	monitor.setProfiling(true);
+	EXPECT_EQ(0u, monitor.getEntryCount());
+}
@@ -0,0 +1,190 @@
+#include "pch.h"
+
+#include "compiled_func.h"
+#include "func_chain.h"
+#include "resistance_func.h"
+#include "thermistor_func.h"
+#include "table_func.h"
+
+#include <chrono>
+
+using ThermistorChain = FuncChain<ResistanceFunc, ThermistorFunc>;
+
+static float lutStorage[1024];
+
+// Room for one table of the biggest size, taken again by every compile
+static SensorLutPool& emptyPool() {
+	static SensorLutPool pool(lutStorage, efi::size(lutStorage));
+	pool.reset();
+	return pool;
+}
+
+static void configureGmClt(ThermistorChain& chain) {
+	// GM CLT on a 2.7k pullup
+	thermistor_conf_s tc = {0, 40, 100, 9240, 1459, 177, 2700};
+	chain.get<ResistanceFunc>().configure(5.0f, tc.bias_resistor, false);
+	chain.get<ThermistorFunc>().configure(tc);
+}
+
+static void expectSameAsChain(const CompiledFunc& dut, const SensorConverter& chain, float maxError) {
+	for (float volts = -0.5f; volts < 5.5f; volts += 0.0013f) {
+		auto table = dut.convert(volts);
+		auto exact = chain.convert(volts);
+
+		ASSERT_EQ(exact.Valid, table.Valid) << volts;
+
+		if (exact.Valid) {
+			EXPECT_NEAR(exact.Value, table.Value, maxError) << volts;
+		} else {
+			EXPECT_EQ(exact.Code, table.Code) << volts;
+		}
+	}
+}
+
+TEST(CompiledFunc, Thermistor) {
+	ThermistorChain chain;
+	configureGmClt(chain);
+
+	CompiledFunc dut;
+
+	for (size_t size : { 256, 1024 }) {
+		dut.compile(chain, 0, 5, size, emptyPool());
+		ASSERT_EQ(size, dut.getSize());
+
+		auto& accuracy = dut.getAccuracy();
+		printf("GM CLT %4d points: max error %.4f deg C at %.3f volts, mean %.5f, %d validity mismatches\n",
+			(int)size, accuracy.maxError, accuracy.maxErrorInput, accuracy.meanError, (int)accuracy.validityMismatchCount);
+
+		EXPECT_EQ(0u, accuracy.validityMismatchCount);
+		EXPECT_GT(accuracy.checkedCount, 0u);
+
+		// Worst at the hot end, where the curve is steepest
+		expectSameAsChain(dut, chain, size == 1024 ? 0.1f : 1.0f);
+	}
+}
+
+TEST(CompiledFunc, Table) {
+	float bins[] = { 0, 1, 2.5f, 3, 5 };
+	float values[] = { 0, 10, 100, 400, 1000 };
+	TableFunc table(bins, values);
+
+	CompiledFunc dut;
+	dut.compile(table, 0, 5, 1024, emptyPool());
+
+	// Breakpoints between samples get cut, by less than a step's worth of the steepest segment
+	float step = 5.0f / 1023;
+	expectSameAsChain(dut, table, step * 600);
+
+	EXPECT_LT(dut.getAccuracy().maxError, step * 600);
+}
+
+struct Doubler final : public SensorConverter {
+	SensorResult convert(float input) const override {
+		if (input > 10) {
+			return UnexpectedCode::High;
+		}
+
+		return input * 2;
+	}
+};
+
+TEST(CompiledFunc, PassesToSource) {
+	Doubler doubler;
+	CompiledFunc dut;
+
+	// Never compiled
+	EXPECT_EQ(UnexpectedCode::Configuration, dut.convert(1).Code);
+
+	// Off
+	dut.compile(doubler, 0, 5, 0, emptyPool());
+	EXPECT_EQ(0u, dut.getSize());
+	EXPECT_FLOAT_EQ(3, dut.convert(1.5f).value_or(0));
+
+	dut.compile(doubler, 0, 20, 256, emptyPool());
+
+	// Outside the table
+	EXPECT_FLOAT_EQ(-2, dut.convert(-1).value_or(0));
+	EXPECT_EQ(UnexpectedCode::High, dut.convert(25).Code);
+
+	// Right below the edge of the valid range, the step spans it
+	EXPECT_FLOAT_EQ(19.99f, dut.convert(9.995f).value_or(0));
+	EXPECT_EQ(UnexpectedCode::High, dut.convert(10.01f).Code);
+
+	// No room left, back to the source
+	SensorLutPool& pool = emptyPool();
+	ASSERT_NE(nullptr, pool.take(1000));
+	dut.compile(doubler, 0, 5, 256, pool);
+	EXPECT_EQ(0u, dut.getSize());
+	EXPECT_FLOAT_EQ(3, dut.convert(1.5f).value_or(0));
+	EXPECT_EQ(24u, pool.getFree());
+}
+
+TEST(CompiledFunc, SharedPool) {
+	Doubler doubler;
+	CompiledFunc first, second, third;
+
+	float storage[600];
+	SensorLutPool pool(storage, efi::size(storage));
+
+	first.compile(doubler, 0, 5, 256, pool);
+	second.compile(doubler, 0, 10, 256, pool);
+	third.compile(doubler, 0, 5, 256, pool);
+
+	EXPECT_EQ(256u, first.getSize());
+	EXPECT_EQ(256u, second.getSize());
+	EXPECT_EQ(0u, third.getSize());
+	EXPECT_EQ(88u, pool.getFree());
+
+	// Tables don't overlap, the steps are different
+	EXPECT_FLOAT_EQ(3, first.convert(1.5f).value_or(0));
+	EXPECT_FLOAT_EQ(3, second.convert(1.5f).value_or(0));
+	EXPECT_FLOAT_EQ(9, second.convert(4.5f).value_or(0));
+
+	// Compiled again from scratch
+	pool.reset();
+	first.compile(doubler, 0, 5, 256, pool);
+	EXPECT_EQ(256u, first.getSize());
+	EXPECT_EQ(344u, pool.getFree());
+
+	// The firmware's pool is only there if the board asks for one
+	getSensorLutPool().reset();
+	EXPECT_EQ((size_t)SENSOR_LUT_POOL_SIZE, getSensorLutPool().getFree());
+}
+
+TEST(CompiledFunc, Benchmark) {
+	ThermistorChain chain;
+	configureGmClt(chain);
+
+	CompiledFunc dut;
+
+	constexpr int samples = 1000000;
+
+	auto run = [&](const SensorConverter& func) {
+		float sum = 0;
+
+		auto start = std::chrono::steady_clock::now();
+
+		for (int i = 0; i < samples; i++) {
+			// Sweep the valid range
+			sum += func.convert(0.1f + (i % 4800) * 0.001f).value_or(0);
+		}
+
+		auto end = std::chrono::steady_clock::now();
+
+		// So that the loop can't be optimized away
+		EXPECT_NE(0, sum);
+
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / (float)samples;
+	};
+
+	float chainNs = run(chain);
+
+	dut.compile(chain, 0, 5, 256, emptyPool());
+	float table256Ns = run(dut);
+
+	dut.compile(chain, 0, 5, 1024, emptyPool());
+	float table1024Ns = run(dut);
+
+	printf("Thermistor conversion per sample: chain %.1fns, 256 point table %.1fns, 1024 point table %.1fns\n",
+		chainNs, table256Ns, table1024Ns);
+}
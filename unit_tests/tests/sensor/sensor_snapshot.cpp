@@ -0,0 +1,159 @@
+#include "pch.h"
+
+#include "stored_value_sensor.h"
+#include "sensor_snapshot.h"
+
+class SensorSnapshotTest : public ::testing::Test {
+protected:
+	void SetUp() override {
+		Sensor::resetRegistry();
+		getSensorSnapshot().setEnabled(true);
+	}
+
+	void TearDown() override {
+		Sensor::resetRegistry();
+		getSensorSnapshot().setEnabled(true);
+		getSensorSnapshot().setIsrContextForTest(false);
+	}
+};
+
+TEST_F(SensorSnapshotTest, SameValueForWholeTick) {
+	StoredValueSensor clt(SensorType::Clt, efidur_t{0});
+	ASSERT_TRUE(clt.Register());
+	clt.setValidValue(80, getTimeNowNt());
+
+	auto& snapshot = getSensorSnapshot();
+	snapshot.capture();
+
+	{
+		SensorSnapshotScope scope;
+
+		// Sensor changes during the tick, the tick doesn't see it
+		clt.setValidValue(90, getTimeNowNt());
+		EXPECT_EQ(80, Sensor::get(SensorType::Clt).value_or(-1));
+		EXPECT_EQ(90, Sensor::getLive(SensorType::Clt).value_or(-1));
+	}
+
+	// Tick's over
+	EXPECT_EQ(90, Sensor::get(SensorType::Clt).value_or(-1));
+
+	// Last published capture is still there for whoever reads it directly
+	EXPECT_EQ(80, snapshot.get(SensorType::Clt).value_or(-1));
+
+	snapshot.capture();
+	EXPECT_EQ(90, snapshot.get(SensorType::Clt).value_or(-1));
+}
+
+TEST_F(SensorSnapshotTest, KeepsInvalidCode) {
+	StoredValueSensor iat(SensorType::Iat, efidur_t{0});
+	ASSERT_TRUE(iat.Register());
+	iat.invalidate(UnexpectedCode::High);
+
+	Sensor::setMockValue(SensorType::Map, 101.3f);
+
+	auto& snapshot = getSensorSnapshot();
+	snapshot.capture();
+
+	SensorSnapshotScope scope;
+
+	auto result = Sensor::get(SensorType::Iat);
+	EXPECT_FALSE(result.Valid);
+	EXPECT_EQ(UnexpectedCode::High, result.Code);
+
+	EXPECT_FLOAT_EQ(101.3f, Sensor::get(SensorType::Map).value_or(-1));
+
+	auto missing = Sensor::get(SensorType::Tps1);
+	EXPECT_FALSE(missing.Valid);
+	EXPECT_EQ(UnexpectedCode::Configuration, missing.Code);
+
+	// Out of range
+	EXPECT_FALSE(snapshot.get(SensorType::PlaceholderLast).Valid);
+
+	Sensor::resetMockValue(SensorType::Map);
+}
+
+TEST_F(SensorSnapshotTest, Disabled) {
+	StoredValueSensor clt(SensorType::Clt, efidur_t{0});
+	ASSERT_TRUE(clt.Register());
+	clt.setValidValue(80, getTimeNowNt());
+
+	auto& snapshot = getSensorSnapshot();
+	snapshot.setEnabled(false);
+	uint32_t captures = snapshot.getCaptureCount();
+	snapshot.capture();
+	EXPECT_EQ(captures, snapshot.getCaptureCount());
+
+	SensorSnapshotScope scope;
+	EXPECT_FALSE(snapshot.isInScope());
+
+	clt.setValidValue(90, getTimeNowNt());
+	EXPECT_EQ(90, Sensor::get(SensorType::Clt).value_or(-1));
+}
+
+TEST_F(SensorSnapshotTest, InterruptReadsLastCapture) {
+	StoredValueSensor clt(SensorType::Clt, efidur_t{0});
+	ASSERT_TRUE(clt.Register());
+	clt.setValidValue(80, getTimeNowNt());
+
+	auto& snapshot = getSensorSnapshot();
+	// Forget the captures of earlier tests
+	snapshot.setEnabled(false);
+	snapshot.setEnabled(true);
+	snapshot.setIsrContextForTest(true);
+
+	// Nothing captured yet
+	EXPECT_EQ(80, Sensor::get(SensorType::Clt).value_or(-1));
+
+	snapshot.capture();
+	clt.setValidValue(90, getTimeNowNt());
+
+	// Outside of the tick, and of the thread that ran it
+	EXPECT_EQ(80, Sensor::get(SensorType::Clt).value_or(-1));
+
+	snapshot.setIsrContextForTest(false);
+	EXPECT_EQ(90, Sensor::get(SensorType::Clt).value_or(-1));
+}
+
+TEST(SensorSnapshot, ReadsPerTick) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+
+	Sensor::setMockValue(SensorType::Clt, 85);
+	Sensor::setMockValue(SensorType::Iat, 30);
+	Sensor::setMockValue(SensorType::Map, 60);
+	Sensor::setMockValue(SensorType::Tps1, 15);
+	Sensor::setMockValue(SensorType::AcceleratorPedal, 15);
+	Sensor::setMockValue(SensorType::BatteryVoltage, 13.8f);
+	Sensor::setMockValue(SensorType::Lambda1, 1);
+	engine->rpmCalculator.setRpmValue(2500);
+
+	auto& snapshot = getSensorSnapshot();
+
+	constexpr int ticks = 100;
+
+	auto run = [&](uint32_t& gets, uint32_t& reads) {
+		// Warm up, so that both runs start from the same state
+		engine->periodicFastCallback();
+
+		Sensor::s_getCallCount = 0;
+		Sensor::s_sensorReadCount = 0;
+
+		for (int i = 0; i < ticks; i++) {
+			engine->periodicFastCallback();
+		}
+
+		gets = Sensor::s_getCallCount / ticks;
+		reads = Sensor::s_sensorReadCount / ticks;
+	};
+
+	uint32_t getsBefore, readsBefore;
+	snapshot.setEnabled(false);
+	run(getsBefore, readsBefore);
+
+	uint32_t getsAfter, readsAfter;
+	snapshot.setEnabled(true);
+	run(getsAfter, readsAfter);
+
+	// With the snapshot, sensors are read once each per tick, at the capture
+	EXPECT_LT(readsAfter, readsBefore) << "Per fast callback: without snapshot " << getsBefore << " Sensor::get, "
+		<< readsBefore << " sensor reads; with snapshot " << getsAfter << " Sensor::get, " << readsAfter << " sensor reads";
+}
@@ -3,6 +3,9 @@
 #include "unit_test_framework.h"
 #include "init.h"
 #include "functional_sensor.h"
+#include "cli_registry.h"
+#include "can_rx_signals.h"
+#include "compiled_func.h"
 
 static void postToFuncSensor(Sensor* s, float value) {
 	static_cast<FunctionalSensor*>(s)->postRawValue(value, getTimeNowNt());
@@ -211,6 +214,36 @@ TEST(SensorInit, Clt) {
 	EXPECT_POINT_INVALID(s, 5.0f);
 }
 
+TEST(SensorInit, CltLookupTable) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+
+	engineConfiguration->clt.config = {0, 30, 100, 32500, 7550, 700, 2700};
+	engineConfiguration->clt.adcChannel = EFI_ADC_6;
+	engineConfiguration->sensorConverterLut = SensorLutMode::Points256;
+
+	auto& pool = getSensorLutPool();
+	pool.reset();
+
+	initThermistors();
+
+	// Sampled in to a table from the pool
+	EXPECT_EQ((size_t)SENSOR_LUT_POOL_SIZE - 256, pool.getFree());
+
+	auto s = const_cast<Sensor*>(Sensor::getSensorOfType(SensorType::Clt));
+	ASSERT_NE(nullptr, s);
+
+	// Same points as the exact curve
+	EXPECT_POINT_VALID(s, 4.61648f, 0.0f);
+	EXPECT_POINT_VALID(s, 3.6829f, 30.0f);
+	EXPECT_POINT_VALID(s, 1.0294f, 100.0f)
+
+	// Out of range is still out of range
+	EXPECT_POINT_INVALID(s, 0.0f);
+	EXPECT_POINT_INVALID(s, 5.0f);
+
+	pool.reset();
+}
+
 TEST(SensorInit, Lambda) {
 	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
 
@@ -251,3 +284,37 @@ TEST(SensorInit, Map) {
 	Sensor::resetMockValue(SensorType::MapFast);
 	EXPECT_FLOAT_EQ(75, Sensor::getOrZero(SensorType::Map));
 }
+
+TEST(SensorInit, CanSignalsDontTakeConfiguredSensors) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+	// The sensor console commands are added again below
+	resetConsoleActions();
+
+	engineConfiguration->fuelLevelSensor = EFI_ADC_0;
+	engineConfiguration->canReadEnabled = true;
+
+	auto& fuelLevel = config->canRxSignals[0];
+	fuelLevel.id = 0x300;
+	fuelLevel.target = CanRxSignalTarget::FuelLevel;
+	fuelLevel.length = 8;
+	fuelLevel.factor = 1;
+
+	auto& aux = config->canRxSignals[1];
+	aux = fuelLevel;
+	aux.target = CanRxSignalTarget::AuxLinear4;
+
+	// The analog fuel level is registered after the configurable sensors, the CAN signal must wait for it
+	EXPECT_NO_FATAL_ERROR(initNewSensors());
+	EXPECT_EQ(1u, getCanRxSignals().getSignalCount());
+	EXPECT_TRUE(Sensor::hasSensor(SensorType::FuelLevel));
+	EXPECT_TRUE(Sensor::hasSensor(SensorType::AuxLinear4));
+
+	// Same when the settings are burned
+	EXPECT_NO_FATAL_ERROR(stopSensors());
+	EXPECT_NO_FATAL_ERROR(reconfigureSensors());
+	EXPECT_EQ(1u, getCanRxSignals().getSignalCount());
+
+	// Don't leave the decoder running for the next test
+	deinitCanSensors();
+	resetConsoleActions();
+}
@@ -1,4 +1,5 @@
 #include "log_field.h"
+#include "log_record.h"
 #include "buffered_writer.h"
 
 #include <gmock/gmock.h>
@@ -60,3 +61,96 @@ TEST(BinaryLogField, Value) {
 	// Check that big endian data was written, and bytes after weren't touched
 	EXPECT_THAT(buffer, ElementsAre(0x00, 0xbc, 0x61, 0x4e, 0xAA, 0xAA));
 }
+
+TEST(BinaryLogRecord, PlanOrder) {
+	scaled_channel<uint8_t, 1> a = 0;
+	scaled_channel<uint32_t, 1> b = 0;
+	scaled_channel<int16_t, 1> c = 0;
+	float d = 0;
+
+	LogField fields[] = {
+		{ a, "a", "", 0 },
+		{ b, "b", "", 0 },
+		{ c, "c", "", 0 },
+		{ d, "d", "", 0 },
+	};
+
+	auto plan = makeLogRecordPlan(fields);
+
+	EXPECT_EQ(2, plan.wordCount);
+	EXPECT_EQ(1, plan.halfCount);
+	EXPECT_EQ(1, plan.byteCount);
+	EXPECT_EQ(11, plan.dataSize);
+
+	// Copied largest first, but each lands where it would in file order
+	EXPECT_EQ(b.getFirstByteAddr(), plan.copies[0].src);
+	EXPECT_EQ(4 + 1, plan.copies[0].offset);
+	EXPECT_EQ(&d, plan.copies[1].src);
+	EXPECT_EQ(4 + 7, plan.copies[1].offset);
+	EXPECT_EQ(c.getFirstByteAddr(), plan.copies[2].src);
+	EXPECT_EQ(4 + 5, plan.copies[2].offset);
+	EXPECT_EQ(a.getFirstByteAddr(), plan.copies[3].src);
+	EXPECT_EQ(4 + 0, plan.copies[3].offset);
+}
+
+TEST(BinaryLogRecord, Checksum) {
+	uint32_t words[300];
+
+	for (size_t i = 0; i < efi::size(words); i++) {
+		words[i] = 0xFFFFFFFF - i * 0x01010101;
+	}
+
+	// Short, and long enough to need more than one pass
+	for (size_t count : { 0, 1, 5, 127, 128, 129, 300 }) {
+		uint8_t expected = 0;
+		auto bytes = reinterpret_cast<const uint8_t*>(words);
+		for (size_t i = 0; i < 4 * count; i++) {
+			expected += bytes[i];
+		}
+
+		EXPECT_EQ(expected, logRecordChecksum(words, count)) << count;
+	}
+}
+
+TEST(BinaryLogRecord, MatchesFieldByField) {
+	scaled_channel<uint8_t, 1> a = 0xAB;
+	scaled_channel<uint32_t, 1> b = 0x12345678;
+	scaled_channel<int16_t, 1> c = -2;
+	float d = 1.5f;
+	scaled_channel<int8_t, 1> e = -100;
+
+	LogField fields[] = {
+		{ a, "a", "", 0 },
+		{ b, "b", "", 0 },
+		{ c, "c", "", 0 },
+		{ d, "d", "", 0 },
+		{ e, "e", "", 0 },
+	};
+
+	auto plan = makeLogRecordPlan(fields);
+	ASSERT_EQ(12, plan.dataSize);
+
+	LogRecordBuilder<12> builder;
+
+	for (uint8_t roll = 0; roll < 3; roll++) {
+		d = d * 3;
+		b = b + 0x01010101;
+
+		const uint8_t* record = builder.build(plan, 0x1234);
+
+		// What writing field by field produces
+		char expected[LogRecordBuilder<12>::size] = { 0, (char)roll, 0x12, 0x34 };
+		size_t offset = 4;
+		uint8_t sum = 0;
+		for (const auto& field : fields) {
+			size_t size = field.writeData(expected + offset);
+			for (size_t i = 0; i < size; i++) {
+				sum += expected[offset + i];
+			}
+			offset += size;
+		}
+		expected[offset] = sum;
+
+		EXPECT_EQ(0, memcmp(expected, record, sizeof(expected))) << (int)roll;
+	}
+}
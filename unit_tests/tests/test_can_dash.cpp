@@ -0,0 +1,254 @@
+#include "pch.h"
+
+#include "can_dash_table.h"
+#include "can_msg_tx.h"
+#include "fuel_math.h"
+
+#include <vector>
+
+namespace {
+struct DashFrame {
+	uint32_t id;
+	uint8_t dlc;
+	std::vector<uint8_t> data;
+};
+
+struct RecordingCanTx final : public ICanTransmitMock {
+	RecordingCanTx() {
+		setCanTxMockHandler(this);
+	}
+
+	~RecordingCanTx() {
+		setCanTxMockHandler(nullptr);
+	}
+
+	void onTx(uint32_t id, uint8_t dlc, uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3, uint8_t d4, uint8_t d5, uint8_t d6, uint8_t d7) override {
+		uint8_t data[] = { d0, d1, d2, d3, d4, d5, d6, d7 };
+		// Bytes past the DLC don't go out on the wire
+		frames.push_back({ id, dlc, std::vector<uint8_t>(data, data + dlc) });
+	}
+
+	std::vector<DashFrame> frames;
+};
+
+constexpr CanInterval allIntervals = CI::_5ms | CI::_10ms | CI::_20ms | CI::_50ms | CI::_100ms | CI::_200ms | CI::_250ms | CI::_500ms | CI::_1000ms;
+
+void setDashSensors() {
+	Sensor::setMockValue(SensorType::Rpm, 3456.7f);
+	Sensor::setMockValue(SensorType::Map, 87);
+	Sensor::setMockValue(SensorType::Tps1, 23.4f);
+	Sensor::setMockValue(SensorType::FuelPressureLow, 300.5f);
+	Sensor::setMockValue(SensorType::OilPressure, 250.25f);
+	Sensor::setMockValue(SensorType::Lambda1, 0.95f);
+	Sensor::setMockValue(SensorType::Lambda2, 1.02f);
+	Sensor::setMockValue(SensorType::VehicleSpeed, 88.8f);
+	Sensor::setMockValue(SensorType::BatteryVoltage, 13.8f);
+	Sensor::setMockValue(SensorType::BarometricPressure, 101.3f);
+	Sensor::setMockValue(SensorType::Clt, 85.6f);
+	Sensor::setMockValue(SensorType::Iat, 31.2f);
+	Sensor::setMockValue(SensorType::FuelLevel, 40.5f);
+}
+
+std::vector<DashFrame> sendDash(can_nbc_e type, CanInterval intervals = allIntervals) {
+	RecordingCanTx tx;
+
+	const DashTable* table = getDashTable(type);
+	EXPECT_NE(nullptr, table);
+	if (table) {
+		size_t sent = sendDashFrames(*table, intervals);
+		EXPECT_EQ(sent, tx.frames.size());
+	}
+
+	return tx.frames;
+}
+
+void expectFrames(const std::vector<DashFrame>& expected, const std::vector<DashFrame>& actual) {
+	ASSERT_EQ(expected.size(), actual.size());
+
+	for (size_t i = 0; i < expected.size(); i++) {
+		EXPECT_EQ(expected[i].id, actual[i].id) << i;
+		EXPECT_EQ(expected[i].dlc, actual[i].dlc) << std::hex << expected[i].id;
+		EXPECT_EQ(expected[i].data, actual[i].data) << std::hex << expected[i].id;
+	}
+}
+}
+
+// Expected frames are what the hand written encoders sent with the same sensor values
+
+TEST(CanDash, BmwE46) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+	setDashSensors();
+
+	expectFrames({
+		{ 0x153, 8, { 0x00, 0x50, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x316, 8, { 0x00, 0x00, 0x6a, 0x56, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x329, 8, { 0x00, 0xb2, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+	}, sendDash(CAN_BUS_NBC_BMW));
+}
+
+TEST(CanDash, FiatVagMqbGenesis) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+	setDashSensors();
+
+	expectFrames({
+		{ 0x561, 8, { 0x00, 0x00, 0x00, 0x2d, 0x00, 0x00, 0x6c, 0x00 } },
+	}, sendDash(CAN_BUS_NBC_FIAT));
+
+	expectFrames({
+		{ 0x280, 8, { 0x00, 0x00, 0x02, 0x36, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x288, 8, { 0x00, 0xb2, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x420, 8, { 0x00, 0x00, 0x00, 0x00, 0xb2, 0x00, 0x00, 0x00 } },
+		{ 0x3D0, 8, { 0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+	}, sendDash(CAN_BUS_NBC_VAG));
+
+	expectFrames({
+		{ 0x3C0, 4, { 0x00, 0x00, 0x03, 0x00 } },
+		{ 0x107, 8, { 0x00, 0x00, 0x00, 0xdb, 0x03, 0x00, 0x00, 0x00 } },
+	}, sendDash(CAN_BUS_MQB));
+
+	expectFrames({
+		{ 0x316, 8, { 0x00, 0x00, 0x00, 0x36, 0x02, 0x00, 0x00, 0x00 } },
+		{ 0x329, 8, { 0x00, 0xab, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+	}, sendDash(CAN_BUS_GENESIS_COUPE));
+}
+
+TEST(CanDash, W202) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+	setDashSensors();
+
+	expectFrames({
+		{ 0x308, 8, { 0x08, 0x0d, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x608, 8, { 0x7d, 0x3d, 0x63, 0x41, 0x00, 0x05, 0x50, 0x00 } },
+		{ 0x210, 8, { 0x0a, 0x18, 0x00, 0x00, 0xc0, 0x00, 0x00, 0x00 } },
+		{ 0x310, 8, { 0x00, 0x00, 0x6d, 0x7b, 0x21, 0x07, 0x33, 0x05 } },
+	}, sendDash(CAN_BUS_W202_C180));
+
+	// Only the frames that are due
+	auto frames = sendDash(CAN_BUS_W202_C180, CI::_10ms | CI::_20ms);
+	ASSERT_EQ(1u, frames.size());
+	EXPECT_EQ(0x308u, frames[0].id);
+
+	EXPECT_TRUE(sendDash(CAN_BUS_W202_C180, CI::_5ms).empty());
+}
+
+TEST(CanDash, Haltech) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+	setDashSensors();
+	// Wraps to -7.5
+	engine->cylinders[0].setIgnitionTimingBtdc(712.5);
+
+	uint16_t duty = getInjectorDutyCycle(3456) * 10;
+	uint8_t dutyHigh = duty >> 8;
+	uint8_t dutyLow = duty & 0xff;
+
+	expectFrames({
+		{ 0x360, 8, { 0x0d, 0x80, 0x03, 0x66, 0x00, 0xea, 0x00, 0x00 } },
+		{ 0x361, 8, { 0x0f, 0xb2, 0x0d, 0xbb, 0x00, 0x57, 0x00, 0x00 } },
+		{ 0x362, 6, { dutyHigh, dutyLow, 0x00, 0x00, 0xff, 0xb5 } },
+		{ 0x3E5, 8, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x3EA, 8, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x3EB, 8, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x3EC, 8, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x3ED, 2, { 0x00, 0x00 } },
+		{ 0x471, 2, { 0x00, 0x00 } },
+		{ 0x363, 4, { 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x368, 8, { 0x36, 0x8d, 0x03, 0xfc, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x369, 8, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x36A, 4, { 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x36B, 8, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x36C, 8, { 0x03, 0x78, 0x03, 0x78, 0x03, 0x78, 0x03, 0x78 } },
+		{ 0x36D, 8, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x36E, 8, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x36F, 4, { 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x370, 8, { 0x03, 0x78, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x3E6, 8, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x3E7, 8, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x3E8, 8, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x3E9, 8, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x3EE, 8, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x3EF, 8, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x470, 8, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x472, 8, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x371, 4, { 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x372, 8, { 0x00, 0x8a, 0x00, 0x00, 0x00, 0x00, 0x03, 0xf5 } },
+		{ 0x373, 8, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x374, 8, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x375, 8, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x376, 8, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x3E0, 8, { 0x0e, 0x03, 0x0b, 0xe3, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x3E1, 6, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x3E2, 2, { 0x01, 0x95 } },
+		{ 0x3E3, 8, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+		{ 0x3E4, 8, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+	}, sendDash(CAN_BUS_Haltech));
+}
+
+static DashFrame findFrame(const std::vector<DashFrame>& frames, uint32_t id) {
+	for (const auto& frame : frames) {
+		if (frame.id == id) {
+			return frame;
+		}
+	}
+
+	ADD_FAILURE() << "no frame " << std::hex << id;
+	return {};
+}
+
+TEST(CanDash, HaltechMapKeepsTenths) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+	setDashSensors();
+	Sensor::setMockValue(SensorType::Map, 87.6f);
+
+	// 876, this used to be truncated to whole kPa first and sent as 870
+	DashFrame frame = findFrame(sendDash(CAN_BUS_Haltech, CI::_20ms), 0x360);
+	EXPECT_EQ(std::vector<uint8_t>({ 0x0d, 0x80, 0x03, 0x6c, 0x00, 0xea, 0x00, 0x00 }), frame.data);
+}
+
+TEST(CanDash, HaltechKnockLevel) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+	setDashSensors();
+	engine->module<KnockController>()->m_knockLevel = 3;
+
+	// 300 in both levels, the low byte of the second used to be sent as (300 * 0xff) & 0xff = 0xd4
+	DashFrame frame = findFrame(sendDash(CAN_BUS_Haltech, CI::_50ms), 0x36A);
+	EXPECT_EQ(std::vector<uint8_t>({ 0x01, 0x2c, 0x01, 0x2c }), frame.data);
+}
+
+TEST(CanDash, EncodeSignal) {
+	uint8_t data[8] = {};
+
+	// Negative values go out as two's complement, as the casts did
+	encodeDashSignal(dashLittleEndian16(0x100, CI::_50ms, 8, 3, DashSource::Clt, 1, -40), 20, data);
+	EXPECT_EQ(0xec, data[3]);
+	EXPECT_EQ(0xff, data[4]);
+
+	encodeDashSignal(dashBigEndian16(0x100, CI::_50ms, 8, 0, DashSource::Rpm, 10), 123.45f, data);
+	EXPECT_EQ(0x04, data[0]);
+	EXPECT_EQ(0xd2, data[1]);
+
+	// A byte keeps the low bits
+	encodeDashSignal(dashByte(0x100, CI::_50ms, 8, 7, DashSource::Rpm), 0x1ff, data);
+	EXPECT_EQ(0xff, data[7]);
+
+	encodeDashSignal(dashConstByte(0x100, CI::_50ms, 8, 2, 0xa5), 1000, data);
+	EXPECT_EQ(0xa5, data[2]);
+
+	// Rows of a frame have to be together, and fit in its DLC
+	constexpr DashSignal split[] = {
+		dashConstByte(0x100, CI::_50ms, 8, 0, 1),
+		dashConstByte(0x101, CI::_50ms, 8, 0, 1),
+		dashConstByte(0x100, CI::_50ms, 8, 1, 1),
+	};
+	static_assert(!isValidDashTable(split));
+
+	constexpr DashSignal tooLong[] = {
+		dashBigEndian16(0x100, CI::_50ms, 2, 1, DashSource::Rpm),
+	};
+	static_assert(!isValidDashTable(tooLong));
+
+	constexpr DashSignal mixedPeriod[] = {
+		dashConstByte(0x100, CI::_50ms, 8, 0, 1),
+		dashConstByte(0x100, CI::_20ms, 8, 1, 1),
+	};
+	static_assert(!isValidDashTable(mixedPeriod));
+}
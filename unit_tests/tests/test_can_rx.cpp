@@ -65,3 +65,389 @@ TEST(CanListener, FrameNotAcceptedChecksId) {
 
 	EXPECT_FALSE(dut.acceptFrame(CanBusIndex::Bus0, frame));
 }
+
+#include "can_rx_index.h"
+
+#include <set>
+
+static CANRxFrame makeFrame(uint32_t id) {
+	CANRxFrame frame{};
+	frame.SID = id;
+	frame.IDE = false;
+	return frame;
+}
+
+struct CanFallbackListener : public MockCanListener {
+	CanFallbackListener() : MockCanListener(0) { }
+
+	bool isIdIndexed() const override {
+		return false;
+	}
+};
+
+TEST(CanRxIndex, OnlyListenersForTheIdSeeTheFrame) {
+	CanRxIndex index;
+
+	StrictMock<MockCanListener> listener1(0x123);
+	StrictMock<MockCanListener> listener2(0x456);
+	index.addListener(listener1);
+	index.addListener(listener2);
+
+	auto frame = makeFrame(0x123);
+	auto entry = index.find(0x123);
+	ASSERT_NE(nullptr, entry);
+
+	// listener2 is never even asked
+	EXPECT_CALL(listener1, acceptFrame(_, _)).WillOnce(Return(true));
+	EXPECT_CALL(listener1, decodeFrame(_, efitick_t{1234}));
+
+	EXPECT_TRUE(index.dispatch(entry, CanBusIndex::Bus0, frame, 1234));
+
+	// Nobody registered for this one
+	auto otherFrame = makeFrame(0x789);
+	EXPECT_EQ(nullptr, index.find(0x789));
+	EXPECT_FALSE(index.dispatch(nullptr, CanBusIndex::Bus0, otherFrame, 1234));
+}
+
+TEST(CanRxIndex, FallbackListenerSeesEverything) {
+	CanRxIndex index;
+
+	StrictMock<CanFallbackListener> fallback;
+	index.addListener(fallback);
+
+	EXPECT_CALL(fallback, acceptFrame(_, _)).Times(2).WillRepeatedly(Return(false));
+
+	auto frame1 = makeFrame(0x100);
+	auto frame2 = makeFrame(0x200);
+	EXPECT_FALSE(index.dispatch(index.find(0x100), CanBusIndex::Bus0, frame1, 0));
+	EXPECT_FALSE(index.dispatch(index.find(0x200), CanBusIndex::Bus1, frame2, 0));
+
+	// Can't filter in hardware with a listener that wants to see everything
+	uint32_t ids[8];
+	EXPECT_EQ(-1, index.getSubscribedIds(CanBusIndex::Bus0, ids, efi::size(ids)));
+}
+
+TEST(CanRxIndex, Counters) {
+	CanRxIndex index;
+
+	auto entry = index.findOrAdd(0x321);
+	ASSERT_NE(nullptr, entry);
+	EXPECT_EQ(entry, index.findOrAdd(0x321));
+
+	index.countFrame(entry, CanBusIndex::Bus0, true);
+	index.countFrame(entry, CanBusIndex::Bus0, false);
+	index.countFrame(entry, CanBusIndex::Bus1, false);
+	index.countFrame(entry, CanBusIndex::Bus1, false);
+
+	EXPECT_EQ(1u, entry->hits[0]);
+	EXPECT_EQ(1u, entry->drops[0]);
+	EXPECT_EQ(0u, entry->hits[1]);
+	EXPECT_EQ(2u, entry->drops[1]);
+
+	// Frames for IDs nobody registered for are counted, but don't get an entry
+	index.countFrame(index.find(0x654), CanBusIndex::Bus0, false);
+	EXPECT_EQ(nullptr, index.find(0x654));
+	EXPECT_EQ(1u, entry->drops[0]);
+}
+
+TEST(CanRxIndex, LuaFilters) {
+	CanRxIndex index;
+
+	index.addLuaFilter(0x100, CanBusIndex::Bus1, 3);
+	index.addLuaFilter(0x200, CanBusIndex::Any, 4);
+	// Later filter for the same ID doesn't win
+	index.addLuaFilter(0x200, CanBusIndex::Bus0, 5);
+
+	EXPECT_EQ(-1, index.getLuaFilter(0x100, CanBusIndex::Bus0));
+	EXPECT_EQ(3, index.getLuaFilter(0x100, CanBusIndex::Bus1));
+	EXPECT_EQ(4, index.getLuaFilter(0x200, CanBusIndex::Bus0));
+	EXPECT_EQ(4, index.getLuaFilter(0x200, CanBusIndex::Bus1));
+	EXPECT_EQ(-1, index.getLuaFilter(0x300, CanBusIndex::Bus0));
+
+	uint32_t ids[8];
+	ASSERT_EQ(1, index.getSubscribedIds(CanBusIndex::Bus0, ids, efi::size(ids)));
+	EXPECT_EQ(0x200u, ids[0]);
+	ASSERT_EQ(2, index.getSubscribedIds(CanBusIndex::Bus1, ids, efi::size(ids)));
+	EXPECT_EQ((std::set<uint32_t>{ 0x100, 0x200 }), (std::set<uint32_t>{ ids[0], ids[1] }));
+
+	index.clearLuaFilters();
+	EXPECT_EQ(-1, index.getLuaFilter(0x200, CanBusIndex::Bus0));
+	EXPECT_EQ(0, index.getSubscribedIds(CanBusIndex::Bus1, ids, efi::size(ids)));
+}
+
+TEST(CanRxIndex, LuaReload) {
+	CanRxIndex index;
+
+	StrictMock<MockCanListener> listener(0x100);
+	index.addListener(listener);
+	index.addLuaFilter(0x100, CanBusIndex::Any, 0);
+
+	// Every reload of the script asks for other IDs, the old ones don't pile up
+	for (uint32_t script = 0; script < 10; script++) {
+		index.clearLuaFilters();
+
+		for (uint32_t i = 0; i < CAN_RX_INDEX_SIZE / 2; i++) {
+			uint32_t id = 0x1000 * (script + 1) + i;
+			ASSERT_TRUE(index.addLuaFilter(id, CanBusIndex::Any, i)) << script << " " << i;
+			EXPECT_EQ((int)i, index.getLuaFilter(id, CanBusIndex::Bus0));
+		}
+	}
+
+	index.clearLuaFilters();
+
+	// The IDs only Lua wanted are gone, the listener's stays
+	for (uint32_t i = 0; i < CAN_RX_INDEX_SIZE / 2; i++) {
+		EXPECT_EQ(nullptr, index.find(0xa000 + i));
+	}
+
+	auto entry = index.find(0x100);
+	ASSERT_NE(nullptr, entry);
+	EXPECT_EQ(&listener, entry->listeners);
+	EXPECT_EQ(-1, index.getLuaFilter(0x100, CanBusIndex::Bus0));
+
+	uint32_t ids[8];
+	ASSERT_EQ(1, index.getSubscribedIds(CanBusIndex::Bus0, ids, efi::size(ids)));
+	EXPECT_EQ(0x100u, ids[0]);
+}
+
+TEST(CanRxIndex, Full) {
+	CanRxIndex index;
+
+	size_t added = 0;
+	for (uint32_t id = 0; id < CAN_RX_INDEX_SIZE; id++) {
+		if (index.findOrAdd(id)) {
+			added++;
+		}
+	}
+
+	EXPECT_EQ(CAN_RX_INDEX_SIZE * 3 / 4, added);
+
+	// Everything that made it in can still be found
+	for (uint32_t id = 0; id < added; id++) {
+		auto entry = index.find(id);
+		ASSERT_NE(nullptr, entry);
+		EXPECT_EQ(id, entry->id);
+	}
+
+	// A listener that doesn't fit any more still gets its frames, through the fallback list
+	StrictMock<MockCanListener> late(0x7ff);
+	index.addListener(late);
+
+	EXPECT_CALL(late, acceptFrame(_, _)).WillOnce(Return(true));
+	EXPECT_CALL(late, decodeFrame(_, _));
+
+	auto frame = makeFrame(0x7ff);
+	EXPECT_TRUE(index.dispatch(index.find(0x7ff), CanBusIndex::Bus0, frame, 0));
+
+	// A Lua filter that doesn't fit is left for Lua to check, instead of being an error
+	EXPECT_FALSE(index.addLuaFilter(0x7fe, CanBusIndex::Any, 0));
+	EXPECT_EQ(-1, index.getLuaFilter(0x7fe, CanBusIndex::Bus0));
+	EXPECT_TRUE(index.addLuaFilter(0, CanBusIndex::Any, 1));
+}
+
+#include "can_rx_signals.h"
+
+#include <chrono>
+
+static can_rx_signal_s makeSignal(uint32_t id, CanRxSignalTarget target, uint8_t startBit, uint8_t length, bool bigEndian, bool isSigned = false, float factor = 1, float offset = 0) {
+	can_rx_signal_s signal{};
+	signal.id = id;
+	signal.target = target;
+	signal.startBit = startBit;
+	signal.length = length;
+	signal.bigEndian = bigEndian;
+	signal.isSigned = isSigned;
+	signal.factor = factor;
+	signal.offset = offset;
+	return signal;
+}
+
+static CANRxFrame makeFrame(uint32_t id, std::initializer_list<uint8_t> data) {
+	CANRxFrame frame = makeFrame(id);
+	frame.DLC = data.size();
+
+	size_t i = 0;
+	for (uint8_t byte : data) {
+		frame.data8[i++] = byte;
+	}
+
+	return frame;
+}
+
+static float extract(const can_rx_signal_s& signal, const CANRxFrame& frame) {
+	CanRxExtractor extractor;
+	EXPECT_TRUE(compileCanRxSignal(signal, extractor));
+	return extractCanRxSignal(extractor, frame);
+}
+
+TEST(CanRxSignals, Extract) {
+	auto frame = makeFrame(0x100, { 0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0 });
+
+	// Little endian, start bit is the LSB
+	EXPECT_EQ(0x3412, extract(makeSignal(0x100, CanRxSignalTarget::AuxLinear1, 0, 16, false), frame));
+	EXPECT_EQ(0x63, extract(makeSignal(0x100, CanRxSignalTarget::AuxLinear1, 12, 8, false), frame));
+	EXPECT_EQ(0xf0debc9a, extract(makeSignal(0x100, CanRxSignalTarget::AuxLinear1, 32, 32, false), frame));
+	EXPECT_EQ(1, extract(makeSignal(0x100, CanRxSignalTarget::AuxLinear1, 4, 1, false), frame));
+
+	// Big endian, start bit is the MSB in DBC numbering
+	EXPECT_EQ(0x1234, extract(makeSignal(0x100, CanRxSignalTarget::AuxLinear1, 7, 16, true), frame));
+	EXPECT_EQ(0x234, extract(makeSignal(0x100, CanRxSignalTarget::AuxLinear1, 3, 12, true), frame));
+	EXPECT_EQ(0xbcdef0, extract(makeSignal(0x100, CanRxSignalTarget::AuxLinear1, 47, 24, true), frame));
+
+	// Signed, scaled
+	EXPECT_EQ(-0x10, extract(makeSignal(0x100, CanRxSignalTarget::AuxLinear1, 56, 8, false, true), frame));
+	EXPECT_NEAR(-0x6544 * 0.1f - 40, extract(makeSignal(0x100, CanRxSignalTarget::AuxLinear1, 39, 16, true, true, 0.1f, -40), frame), 1e-3);
+	EXPECT_EQ(0x1234 * 0.5f, extract(makeSignal(0x100, CanRxSignalTarget::AuxLinear1, 7, 16, true, true, 0.5f), frame));
+
+	// Doesn't fit in a frame
+	CanRxExtractor extractor;
+	EXPECT_FALSE(compileCanRxSignal(makeSignal(0x100, CanRxSignalTarget::AuxLinear1, 60, 8, false), extractor));
+	EXPECT_FALSE(compileCanRxSignal(makeSignal(0x100, CanRxSignalTarget::AuxLinear1, 47, 25, true), extractor));
+	EXPECT_FALSE(compileCanRxSignal(makeSignal(0x100, CanRxSignalTarget::AuxLinear1, 0, 33, false), extractor));
+	EXPECT_FALSE(compileCanRxSignal(makeSignal(0x100, CanRxSignalTarget::AuxLinear1, 0, 0, false), extractor));
+
+	// Frames shorter than that don't carry the signal
+	EXPECT_TRUE(compileCanRxSignal(makeSignal(0x100, CanRxSignalTarget::AuxLinear1, 12, 8, false), extractor));
+	EXPECT_EQ(3, extractor.minDlc);
+	EXPECT_TRUE(compileCanRxSignal(makeSignal(0x100, CanRxSignalTarget::AuxLinear1, 47, 24, true), extractor));
+	EXPECT_EQ(8, extractor.minDlc);
+}
+
+TEST(CanRxSignals, PublishAsSensors) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+
+	// Somebody already has it
+	Sensor::setMockValue(SensorType::AuxTemp1, 20);
+
+	can_rx_signal_s signals[] = {
+		makeSignal(0x300, CanRxSignalTarget::AuxLinear2, 7, 16, true),
+		makeSignal(0x200, CanRxSignalTarget::AuxLinear1, 0, 16, false, false, 0.01f),
+		makeSignal(0x200, CanRxSignalTarget::OilTemperature, 16, 8, false),
+		makeSignal(0x300, CanRxSignalTarget::None, 0, 8, false),
+		makeSignal(0x300, CanRxSignalTarget::AuxTemp1, 0, 8, false),
+		// Same sensor twice, only the first one counts
+		makeSignal(0x400, CanRxSignalTarget::AuxLinear1, 0, 8, false),
+		// Doesn't fit
+		makeSignal(0x400, CanRxSignalTarget::AuxLinear3, 63, 8, false),
+		makeSignal(0x500, CanRxSignalTarget::AuxLinear4, 0, 8, false),
+	};
+	signals[2].timeout = 100;
+	signals[7].bus = 2;
+
+	CanRxSignalDecoder decoder;
+	EXPECT_EQ(4u, decoder.configure(signals, efi::size(signals)));
+
+	// Registered, but nothing received yet
+	EXPECT_TRUE(Sensor::hasSensor(SensorType::AuxLinear1));
+	EXPECT_FALSE(Sensor::get(SensorType::AuxLinear1).Valid);
+	EXPECT_FALSE(Sensor::hasSensor(SensorType::AuxLinear3));
+	EXPECT_EQ(20, Sensor::getOrZero(SensorType::AuxTemp1));
+
+	setTimeNowUs(1000);
+	EXPECT_TRUE(decoder.decode(CanBusIndex::Bus0, makeFrame(0x200, { 0x10, 0x27, 88 }), getTimeNowNt()));
+	EXPECT_FLOAT_EQ(100, Sensor::getOrZero(SensorType::AuxLinear1));
+	EXPECT_EQ(88, Sensor::getOrZero(SensorType::OilTemperature));
+
+	// Too short for the oil temperature
+	EXPECT_TRUE(decoder.decode(CanBusIndex::Bus1, makeFrame(0x200, { 0x20, 0x4e }), getTimeNowNt()));
+	EXPECT_FLOAT_EQ(200, Sensor::getOrZero(SensorType::AuxLinear1));
+	EXPECT_EQ(88, Sensor::getOrZero(SensorType::OilTemperature));
+
+	EXPECT_TRUE(decoder.decode(CanBusIndex::Bus0, makeFrame(0x300, { 0x01, 0x02 }), getTimeNowNt()));
+	EXPECT_EQ(0x0102, Sensor::getOrZero(SensorType::AuxLinear2));
+
+	// Not configured, nothing in it for us
+	EXPECT_FALSE(decoder.decode(CanBusIndex::Bus0, makeFrame(0x400, { 0x01 }), getTimeNowNt()));
+	EXPECT_FALSE(decoder.decode(CanBusIndex::Bus0, makeFrame(0x123, { 0x01 }), getTimeNowNt()));
+
+	// Only from the second bus
+	EXPECT_FALSE(decoder.decode(CanBusIndex::Bus0, makeFrame(0x500, { 0x05 }), getTimeNowNt()));
+	EXPECT_FALSE(Sensor::get(SensorType::AuxLinear4).Valid);
+	EXPECT_TRUE(decoder.decode(CanBusIndex::Bus1, makeFrame(0x500, { 0x05 }), getTimeNowNt()));
+	EXPECT_EQ(5, Sensor::getOrZero(SensorType::AuxLinear4));
+
+	EXPECT_EQ(4u, decoder.getFrameCount());
+
+	// Only the oil temperature has a timeout
+	advanceTimeUs(150000);
+	EXPECT_FALSE(Sensor::get(SensorType::OilTemperature).Valid);
+	EXPECT_TRUE(Sensor::get(SensorType::AuxLinear1).Valid);
+
+	// Reconfigured: what's gone is unregistered
+	EXPECT_EQ(1u, decoder.configure(signals + 4, 2));
+	EXPECT_EQ(1u, decoder.getSignalCount());
+	EXPECT_FALSE(Sensor::hasSensor(SensorType::AuxLinear2));
+	EXPECT_TRUE(Sensor::hasSensor(SensorType::AuxLinear1));
+	EXPECT_FALSE(decoder.decode(CanBusIndex::Bus0, makeFrame(0x200, { 0x10, 0x27, 88 }), getTimeNowNt()));
+	EXPECT_TRUE(decoder.decode(CanBusIndex::Bus0, makeFrame(0x400, { 0x07 }), getTimeNowNt()));
+	EXPECT_EQ(7, Sensor::getOrZero(SensorType::AuxLinear1));
+
+	decoder.reset();
+	EXPECT_FALSE(Sensor::hasSensor(SensorType::AuxLinear1));
+	EXPECT_FALSE(decoder.decode(CanBusIndex::Bus0, makeFrame(0x400, { 0x07 }), getTimeNowNt()));
+}
+
+class CanRxSignalsBench : public ::testing::Test {
+protected:
+	CanRxSignalDecoder decoder;
+
+	void SetUp() override {
+		Sensor::resetRegistry();
+	}
+
+	void TearDown() override {
+		// The target sensors are static, they'd stay registered for whatever test runs next
+		decoder.reset();
+		Sensor::resetRegistry();
+	}
+};
+
+TEST_F(CanRxSignalsBench, DISABLED_Throughput) {
+	// A typical vehicle integration: a handful of IDs, a few signals in each
+	const CanRxSignalTarget targets[] = {
+		CanRxSignalTarget::VehicleSpeed, CanRxSignalTarget::WheelSpeedLF, CanRxSignalTarget::WheelSpeedRF,
+		CanRxSignalTarget::WheelSpeedLR, CanRxSignalTarget::WheelSpeedRR, CanRxSignalTarget::AmbientTemperature,
+		CanRxSignalTarget::FuelLevel, CanRxSignalTarget::AcceleratorPedal, CanRxSignalTarget::AuxTemp1,
+		CanRxSignalTarget::AuxTemp2, CanRxSignalTarget::AuxLinear1, CanRxSignalTarget::AuxLinear2,
+		CanRxSignalTarget::AuxLinear3, CanRxSignalTarget::AuxLinear4, CanRxSignalTarget::OilPressure,
+		CanRxSignalTarget::OilTemperature,
+	};
+	static_assert(efi::size(targets) == CAN_RX_SIGNAL_COUNT);
+
+	can_rx_signal_s signals[CAN_RX_SIGNAL_COUNT];
+	for (size_t i = 0; i < efi::size(signals); i++) {
+		// Four 16 bit signals per ID, alternating byte order
+		bool bigEndian = i % 2;
+		uint8_t startBit = (i % 4) * 16 + (bigEndian ? 7 : 0);
+		signals[i] = makeSignal(0x100 + i / 4 * 0x10, targets[i], startBit, 16, bigEndian, i % 3 == 0, 0.1f, 1);
+	}
+
+	ASSERT_EQ(efi::size(signals), decoder.configure(signals, efi::size(signals)));
+
+	// Configured IDs, and bus traffic nobody asked for
+	CANRxFrame frames[8];
+	for (size_t i = 0; i < efi::size(frames); i++) {
+		frames[i] = makeFrame(i < 4 ? 0x100 + i * 0x10 : 0x500 + i, { 1, 2, 3, 4, 5, 6, 7, (uint8_t)i });
+	}
+
+	constexpr int iterations = 1000000;
+
+	auto start = std::chrono::steady_clock::now();
+
+	int taken = 0;
+	for (int i = 0; i < iterations; i++) {
+		auto& frame = frames[i % efi::size(frames)];
+		frame.data8[0] = i;
+		taken += decoder.decode(CanBusIndex::Bus0, frame, i);
+	}
+
+	auto end = std::chrono::steady_clock::now();
+
+	EXPECT_EQ(iterations / 2, taken);
+	EXPECT_EQ(iterations / 2, (int)decoder.getFrameCount());
+	// Second signal of 0x110, big endian in bytes 2 and 3
+	EXPECT_FLOAT_EQ(0x0304 * 0.1f + 1, Sensor::getOrZero(SensorType::AmbientTemperature));
+
+	auto frameNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / iterations;
+	printf("CAN RX signals: %d signals in %d IDs, %d ns per frame\n", CAN_RX_SIGNAL_COUNT, CAN_RX_SIGNAL_COUNT / 4, (int)frameNs);
+}
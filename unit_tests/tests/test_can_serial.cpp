@@ -12,9 +12,12 @@
 #include "engine_test_helper.h"
 #include "serial_can.h"
 
+#include <algorithm>
 #include <array>
+#include <deque>
 #include <list>
 #include <string>
+#include <vector>
 
 using namespace std::string_literals;
 
@@ -26,6 +29,15 @@ public:
 		CANTxFrame localCopy = *frame;
 		localCopy.DLC = 8;
 		ctfList.emplace_back(localCopy);
+
+		// the receiver lets us send the whole message at once
+		if ((frame->data8[0] >> 4) == ISO_TP_FRAME_FIRST) {
+			CANRxFrame fc = {};
+			fc.DLC = 8;
+			fc.data8[0] = ISO_TP_FRAME_FLOW_CONTROL << 4;
+			crfList.push_back(fc);
+		}
+
 		return CAN_MSG_OK;
 	}
 
@@ -37,6 +49,9 @@ public:
 		return CAN_MSG_OK;
 	}
 
+	void sleepUs(int /*us*/) override {
+	}
+
 	template<typename T>
 	void checkFrame(const T & frame, const std::string & bytes, int frameIndex) {
 		EXPECT_EQ(bytes.size(), frame.DLC);
@@ -241,3 +256,319 @@ TEST(testCanSerial, test3_64_4Message) {
 	}, 71, { 64 + 7 });
 }
 
+
+/**
+ * Both ends of the bus between the ECU and a TS host, on a simulated clock: frames take as long as they would
+ * on the wire, the ECU has three TX mailboxes, and the host answers with flow control after a delay.
+ */
+class LoopbackCanBus : public ICanStreamer {
+public:
+	LoopbackCanBus(int frameSize, int nominalBitrate, int dataBitrate)
+		: m_frameSize(frameSize)
+		, m_nominalBitrate(nominalBitrate)
+		, m_dataBitrate(dataBitrate)
+	{
+	}
+
+	// frame level I/O goes through transmitPayload()/receivePayload()
+	can_msg_t transmit(canmbx_t /*mailbox*/, const CanTxMessage * /*ctfp*/, can_sysinterval_t /*timeout*/) override {
+		return CAN_MSG_OK;
+	}
+
+	can_msg_t receive(canmbx_t /*mailbox*/, CANRxFrame * /*crfp*/, can_sysinterval_t /*timeout*/) override {
+		return CAN_MSG_TIMEOUT;
+	}
+
+	size_t getFrameSize() const override {
+		return m_frameSize;
+	}
+
+	can_msg_t transmitPayload(const uint8_t *data, size_t size, can_sysinterval_t /*timeout*/) override {
+		// mailboxes are free once their frame is on the wire, if all are busy we wait for the oldest one
+		while (!m_mailboxes.empty() && m_mailboxes.front() <= nowUs) {
+			m_mailboxes.pop_front();
+		}
+		if (m_mailboxes.size() == 3) {
+			nowUs = m_mailboxes.front();
+			m_mailboxes.pop_front();
+		}
+
+		double doneUs = std::max(nowUs, busFreeUs) + getFrameTimeUs(size);
+		busFreeUs = doneUs;
+		m_mailboxes.push_back(doneUs);
+
+		std::vector<uint8_t> frame(data, data + size);
+		if ((frame[0] >> 4) == ISO_TP_FRAME_CONSECUTIVE) {
+			consecutiveFrameQueuedUs.push_back(nowUs);
+		}
+		onHostReceive(frame, doneUs);
+		return CAN_MSG_OK;
+	}
+
+	can_msg_t receivePayload(uint8_t *data, size_t &size, can_sysinterval_t /*timeout*/) override {
+		if (m_toEcu.empty()) {
+			sendNextHostBlock();
+		}
+		if (m_toEcu.empty()) {
+			return CAN_MSG_TIMEOUT;
+		}
+
+		auto& next = m_toEcu.front();
+		nowUs = std::max(nowUs, next.first);
+		size = std::min(size, next.second.size());
+		memcpy(data, next.second.data(), size);
+		m_toEcu.pop_front();
+		return CAN_MSG_OK;
+	}
+
+	void sleepUs(int us) override {
+		nowUs += us;
+	}
+
+	// the host sends data to the ECU, honouring the flow control of the ECU
+	void hostSend(const std::vector<uint8_t>& data) {
+		m_hostTx = data;
+		m_hostTxOffset = 0;
+		m_hostTxIndex = 1;
+
+		std::vector<uint8_t> frame(m_frameSize, 0);
+		int length = data.size();
+		frame[0] = (ISO_TP_FRAME_FIRST << 4) | ((length >> 8) & 0xf);
+		frame[1] = length & 0xff;
+		m_hostTxOffset = std::min<int>(length, m_frameSize - 2);
+		std::copy(data.begin(), data.begin() + m_hostTxOffset, frame.begin() + 2);
+		queueToEcu(frame, nowUs);
+	}
+
+	double getBytesPerSecond() const {
+		return hostRx.size() * 1e6 / busFreeUs;
+	}
+
+	// flow control of the host
+	int hostBlockSize = 0;
+	uint8_t hostSeparationTime = 0;
+	// 'wait' FC frames before the first 'continue to send' one
+	int hostWaitCount = 0;
+	double hostLatencyUs = 200;
+
+	double nowUs = 0;
+	double busFreeUs = 0;
+
+	std::vector<uint8_t> hostRx;
+	std::vector<double> consecutiveFrameQueuedUs;
+	int hostFlowControlCount = 0;
+	int ecuFlowControlCount = 0;
+	int ecuFlowControlBlockSize = -1;
+
+private:
+	// standard ID, bit stuffing taken as 10%. CAN-FD frames switch to the data bitrate after arbitration.
+	double getFrameTimeUs(size_t size) const {
+		if (m_frameSize <= ISO_TP_CLASSIC_FRAME_SIZE) {
+			return (47 + 8 * size) * 1.1 * 1e6 / m_nominalBitrate;
+		}
+		return (30 * 1.1 * 1e6 / m_nominalBitrate) + (8 * size + 50) * 1.1 * 1e6 / m_dataBitrate;
+	}
+
+	void queueToEcu(const std::vector<uint8_t>& frame, double atUs) {
+		double doneUs = std::max(atUs, busFreeUs) + getFrameTimeUs(frame.size());
+		busFreeUs = doneUs;
+		m_toEcu.emplace_back(doneUs, frame);
+	}
+
+	void sendHostFlowControl(double atUs, int flowStatus = CAN_FLOW_STATUS_OK) {
+		hostFlowControlCount++;
+		std::vector<uint8_t> fc(ISO_TP_CLASSIC_FRAME_SIZE, 0);
+		fc[0] = (ISO_TP_FRAME_FLOW_CONTROL << 4) | flowStatus;
+		fc[1] = hostBlockSize;
+		fc[2] = hostSeparationTime;
+		queueToEcu(fc, atUs + hostLatencyUs);
+	}
+
+	void onHostReceive(const std::vector<uint8_t>& frame, double doneUs) {
+		switch (frame[0] >> 4) {
+		case ISO_TP_FRAME_SINGLE:
+			hostRx.insert(hostRx.end(), frame.begin() + 1, frame.begin() + 1 + (frame[0] & 0xf));
+			break;
+		case ISO_TP_FRAME_FIRST:
+			m_hostRxRemaining = ((frame[0] & 0xf) << 8) | frame[1];
+			m_hostRxRemaining -= m_frameSize - 2;
+			hostRx.insert(hostRx.end(), frame.begin() + 2, frame.end());
+			m_framesUntilHostFlowControl = hostBlockSize;
+			for (int i = 0; i < hostWaitCount; i++) {
+				sendHostFlowControl(doneUs, CAN_FLOW_STATUS_WAIT_MORE);
+			}
+			sendHostFlowControl(doneUs);
+			break;
+		case ISO_TP_FRAME_CONSECUTIVE: {
+			int numBytes = std::min<int>(m_hostRxRemaining, frame.size() - 1);
+			hostRx.insert(hostRx.end(), frame.begin() + 1, frame.begin() + 1 + numBytes);
+			m_hostRxRemaining -= numBytes;
+			if (m_hostRxRemaining > 0 && hostBlockSize != 0 && --m_framesUntilHostFlowControl == 0) {
+				m_framesUntilHostFlowControl = hostBlockSize;
+				sendHostFlowControl(doneUs);
+			}
+			break;
+		}
+		case ISO_TP_FRAME_FLOW_CONTROL:
+			ecuFlowControlCount++;
+			ecuFlowControlBlockSize = frame[1];
+			m_hostFlowControlUs = doneUs;
+			break;
+		}
+	}
+
+	// once the ECU lets us, the next block of consecutive frames of hostSend()
+	void sendNextHostBlock() {
+		if (m_hostTxOffset >= (int)m_hostTx.size() || m_hostBlocksSent == ecuFlowControlCount) {
+			return;
+		}
+		m_hostBlocksSent = ecuFlowControlCount;
+
+		for (int i = 0; m_hostTxOffset < (int)m_hostTx.size() && (ecuFlowControlBlockSize == 0 || i < ecuFlowControlBlockSize); i++) {
+			std::vector<uint8_t> frame(m_frameSize, 0);
+			frame[0] = (ISO_TP_FRAME_CONSECUTIVE << 4) | ((m_hostTxIndex++) & 0xf);
+			int numBytes = std::min<int>(m_hostTx.size() - m_hostTxOffset, m_frameSize - 1);
+			std::copy(m_hostTx.begin() + m_hostTxOffset, m_hostTx.begin() + m_hostTxOffset + numBytes, frame.begin() + 1);
+			m_hostTxOffset += numBytes;
+			queueToEcu(frame, m_hostFlowControlUs + hostLatencyUs);
+		}
+	}
+
+	const int m_frameSize;
+	const int m_nominalBitrate;
+	const int m_dataBitrate;
+
+	std::deque<double> m_mailboxes;
+	std::deque<std::pair<double, std::vector<uint8_t>>> m_toEcu;
+
+	int m_hostRxRemaining = 0;
+	int m_framesUntilHostFlowControl = 0;
+
+	std::vector<uint8_t> m_hostTx;
+	int m_hostTxOffset = 0;
+	int m_hostTxIndex = 1;
+	int m_hostBlocksSent = 0;
+	double m_hostFlowControlUs = 0;
+};
+
+static std::vector<uint8_t> makeTestData(size_t size) {
+	std::vector<uint8_t> data(size);
+	for (size_t i = 0; i < size; i++) {
+		data[i] = (uint8_t)(i * 7 + (i >> 8));
+	}
+	return data;
+}
+
+// a few full size TS packets from the ECU to the host
+static double measureEcuToHost(LoopbackCanBus& bus) {
+	CanStreamerState state(&bus);
+
+	auto data = makeTestData(4 * BLOCKING_FACTOR);
+	for (size_t offset = 0; offset < data.size(); offset += BLOCKING_FACTOR) {
+		size_t np = BLOCKING_FACTOR;
+		state.streamAddToTxTimeout(&np, data.data() + offset, 0);
+		state.streamFlushTx(0);
+	}
+
+	EXPECT_EQ(data, bus.hostRx);
+	EXPECT_EQ(4u, state.counters.txMessages);
+	EXPECT_EQ(data.size(), state.counters.txBytes);
+	EXPECT_EQ(0u, state.counters.txAborts);
+
+	return bus.getBytesPerSecond();
+}
+
+TEST(testCanSerial, loopbackThroughput) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+
+	LoopbackCanBus classic(ISO_TP_CLASSIC_FRAME_SIZE, 500000, 500000);
+	double classicBytesPerSecond = measureEcuToHost(classic);
+
+	LoopbackCanBus fd(ISO_TP_MAX_FRAME_SIZE, 500000, 2000000);
+	double fdBytesPerSecond = measureEcuToHost(fd);
+
+	printf("ISO-TP loopback: classic 500k %.0f bytes/s, CAN-FD 500k/2M %.0f bytes/s\n", classicBytesPerSecond, fdBytesPerSecond);
+
+	// 7 bytes per 8 byte frame, one FC round trip per TS packet: close to what the wire allows
+	EXPECT_GT(classicBytesPerSecond, 24000);
+	EXPECT_GT(fdBytesPerSecond, 4 * classicBytesPerSecond);
+}
+
+TEST(testCanSerial, loopbackHonoursFlowControl) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+
+	LoopbackCanBus bus(ISO_TP_CLASSIC_FRAME_SIZE, 500000, 500000);
+	bus.hostBlockSize = 4;
+	// 500us
+	bus.hostSeparationTime = 0xF5;
+	CanStreamerState state(&bus);
+
+	auto data = makeTestData(200);
+	size_t np = data.size();
+	state.streamAddToTxTimeout(&np, data.data(), 0);
+	state.streamFlushTx(0);
+
+	EXPECT_EQ(data, bus.hostRx);
+
+	// FF and 28 CFs, an FC for every block of 4 CFs
+	ASSERT_EQ(28u, bus.consecutiveFrameQueuedUs.size());
+	EXPECT_EQ(7, bus.hostFlowControlCount);
+
+	for (size_t i = 1; i < bus.consecutiveFrameQueuedUs.size(); i++) {
+		// the first frame of a block goes as soon as the FC is in
+		if (i % 4 != 0) {
+			EXPECT_GE(bus.consecutiveFrameQueuedUs[i] - bus.consecutiveFrameQueuedUs[i - 1], 499.999) << i;
+		}
+	}
+}
+
+TEST(testCanSerial, loopbackFlowControlWait) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+	auto data = makeTestData(100);
+
+	{
+		LoopbackCanBus bus(ISO_TP_CLASSIC_FRAME_SIZE, 500000, 500000);
+		bus.hostWaitCount = 2;
+		CanStreamerState state(&bus);
+
+		EXPECT_EQ((int)data.size(), state.sendDataTimeout(data.data(), data.size(), 0));
+		EXPECT_EQ(data, bus.hostRx);
+		EXPECT_EQ(2u, state.counters.flowControlWaits);
+		EXPECT_EQ(0u, state.counters.txAborts);
+	}
+
+	{
+		// the receiver may make us wait, but not forever: only the FF goes out
+		LoopbackCanBus bus(ISO_TP_CLASSIC_FRAME_SIZE, 500000, 500000);
+		bus.hostWaitCount = 10;
+		CanStreamerState state(&bus);
+
+		EXPECT_EQ(6, state.sendDataTimeout(data.data(), data.size(), 0));
+		EXPECT_EQ((uint32_t)ISO_TP_MAX_FLOW_CONTROL_WAITS, state.counters.flowControlWaits);
+		EXPECT_EQ(1u, state.counters.txAborts);
+		EXPECT_EQ(0u, state.counters.txMessages);
+	}
+}
+
+TEST(testCanSerial, loopbackHostToEcu) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+
+	LoopbackCanBus bus(ISO_TP_CLASSIC_FRAME_SIZE, 500000, 500000);
+	CanStreamerState state(&bus);
+
+	auto data = makeTestData(500);
+	bus.hostSend(data);
+
+	std::vector<uint8_t> received(data.size());
+	size_t np = received.size();
+	state.streamReceiveTimeout(&np, received.data(), 0);
+
+	EXPECT_EQ(data.size(), np);
+	EXPECT_EQ(data, received);
+	EXPECT_EQ(1u, state.counters.rxMessages);
+	EXPECT_EQ(0u, state.counters.rxSequenceErrors);
+
+	// 6 bytes in the FF, 71 CFs: an FC after the FF and after every block the listener FIFO can hold
+	EXPECT_EQ(CAN_FIFO_FRAME_SIZE, bus.ecuFlowControlBlockSize);
+	EXPECT_EQ(1 + (71 - 1) / CAN_FIFO_FRAME_SIZE, bus.ecuFlowControlCount);
+}
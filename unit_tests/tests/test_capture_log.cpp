@@ -0,0 +1,162 @@
+#include "pch.h"
+
+#include "capture_log.h"
+#include "buffered_writer.h"
+#include "big_buffer.h"
+
+#include <vector>
+
+BigBufferUser getBigBufferCurrentUser();
+
+struct VectorWriter final : public Writer {
+	size_t write(const char* buffer, size_t count) override {
+		data.insert(data.end(), buffer, buffer + count);
+		return count;
+	}
+
+	size_t flush() override {
+		return 0;
+	}
+
+	std::vector<uint8_t> data;
+};
+
+static uint16_t readU16(const std::vector<uint8_t>& data, size_t offset) {
+	return data[offset] << 8 | data[offset + 1];
+}
+
+TEST(CaptureLog, DisabledByDefault) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+
+	CaptureLog capture;
+	capture.sample(getTimeNowNt());
+
+	EXPECT_EQ(CaptureLog::State::Disarmed, capture.getState());
+}
+
+TEST(CaptureLog, PreAndPostTrigger) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+	engineConfiguration->captureLogOnKnock = true;
+	engineConfiguration->captureLogPostTrigger = 25;
+
+	CaptureLog capture;
+
+	// Events before arming go nowhere
+	capture.trigger(CaptureReason::Knock);
+	capture.sample(getTimeNowNt());
+	ASSERT_EQ(CaptureLog::State::PreTrigger, capture.getState());
+
+	// Fill the ring a few times over
+	for (int i = 0; i < 1000; i++) {
+		capture.sample(getTimeNowNt());
+	}
+
+	size_t capacity = capture.getRecordCount();
+	ASSERT_GT(capacity, 100u);
+	EXPECT_EQ(0u, capture.getFileSize());
+
+	capture.trigger(CaptureReason::Knock);
+	// Only the first event counts
+	capture.trigger(CaptureReason::SyncLoss);
+
+	size_t postTrigger = capacity * 25 / 100;
+	for (size_t i = 0; i < postTrigger; i++) {
+		EXPECT_NE(CaptureLog::State::Ready, capture.getState());
+		capture.sample(getTimeNowNt());
+	}
+
+	ASSERT_EQ(CaptureLog::State::Ready, capture.getState());
+	EXPECT_EQ(CaptureReason::Knock, capture.getReason());
+
+	// Frozen: sampling doesn't touch it anymore
+	capture.sample(getTimeNowNt());
+
+	VectorWriter file;
+	capture.writeTo(file);
+	ASSERT_EQ(capture.getFileSize(), file.data.size());
+	EXPECT_EQ(0, memcmp("MLVLG", file.data.data(), 6));
+
+	size_t dataStart = readU16(file.data, 18);
+	size_t recordSize = readU16(file.data, 20) + 5;
+	ASSERT_EQ(dataStart + capacity * recordSize, file.data.size());
+
+	// Oldest first: rolling counters count up without a gap
+	for (size_t i = 1; i < capacity; i++) {
+		uint8_t previous = file.data[dataStart + (i - 1) * recordSize + 1];
+		uint8_t current = file.data[dataStart + i * recordSize + 1];
+		EXPECT_EQ((uint8_t)(previous + 1), current) << i;
+	}
+
+	// Last field in the record is the capture reason, only set where the event happened
+	size_t eventRecord = capacity - postTrigger;
+	for (size_t i = 0; i < capacity; i++) {
+		uint8_t reason = file.data[dataStart + i * recordSize + recordSize - 2];
+		EXPECT_EQ(i == eventRecord ? (uint8_t)CaptureReason::Knock : 0, reason) << i;
+	}
+
+	// Reading in pieces gives the same file
+	std::vector<uint8_t> pieces(file.data.size());
+	for (size_t offset = 0; offset < pieces.size(); offset += 100) {
+		size_t count = std::min<size_t>(100, pieces.size() - offset);
+		EXPECT_EQ(count, capture.read(offset, pieces.data() + offset, count));
+	}
+	EXPECT_EQ(file.data, pieces);
+
+	capture.rearm();
+	EXPECT_EQ(CaptureLog::State::PreTrigger, capture.getState());
+	EXPECT_EQ(0u, capture.getFileSize());
+}
+
+TEST(CaptureLog, LeavesBigBufferAlone) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+	engineConfiguration->captureLogOnSyncLoss = true;
+
+	CaptureLog capture;
+
+	// Recording while the tooth logger has the big buffer
+	auto toothLogger = getBigBuffer(BigBufferUser::ToothLogger);
+	capture.sample(getTimeNowNt());
+	EXPECT_EQ(CaptureLog::State::PreTrigger, capture.getState());
+	EXPECT_EQ(BigBufferUser::ToothLogger, getBigBufferCurrentUser());
+
+	engineConfiguration->captureLogOnSyncLoss = false;
+	capture.sample(getTimeNowNt());
+	EXPECT_EQ(CaptureLog::State::Disarmed, capture.getState());
+}
+
+TEST(CaptureLog, TunerStudioRead) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+	engineConfiguration->captureLogOnLean = true;
+	engineConfiguration->captureLogPostTrigger = 0;
+
+	CaptureLog capture;
+	capture.sample(getTimeNowNt());
+	capture.trigger(CaptureReason::Lean);
+	capture.sample(getTimeNowNt());
+	ASSERT_EQ(CaptureLog::State::Ready, capture.getState());
+	EXPECT_FALSE(capture.isBeingRead());
+
+	size_t fileSize = capture.getFileSize();
+	uint8_t buffer[100];
+
+	// Part way through the file
+	EXPECT_EQ(100u, capture.readForTunerStudio(0, buffer, sizeof(buffer)));
+	EXPECT_TRUE(capture.isBeingRead());
+
+	// Read to the end: done
+	EXPECT_EQ(100u, capture.readForTunerStudio(fileSize - 100, buffer, sizeof(buffer)));
+	EXPECT_FALSE(capture.isBeingRead());
+
+	// Started again, then abandoned
+	capture.readForTunerStudio(100, buffer, sizeof(buffer));
+	EXPECT_TRUE(capture.isBeingRead());
+	advanceTimeUs(CAPTURE_LOG_READ_TIMEOUT_SEC * 1000000 + 1000);
+	EXPECT_FALSE(capture.isBeingRead());
+
+	// Rearming starts over
+	capture.readForTunerStudio(100, buffer, sizeof(buffer));
+	uint32_t sequence = capture.getSequence();
+	capture.rearm();
+	EXPECT_FALSE(capture.isBeingRead());
+	EXPECT_NE(sequence, capture.getSequence());
+}
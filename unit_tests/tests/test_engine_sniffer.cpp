@@ -0,0 +1,210 @@
+#include "pch.h"
+
+#include "engine_sniffer.h"
+#include "engine_sniffer_binary.h"
+#include "engine_sniffer_decoder.h"
+#include "tunerstudio_impl.h"
+#include "tunerstudio_io.h"
+
+#include <vector>
+
+BigBufferUser getBigBufferCurrentUser();
+extern WaveChart waveChart;
+
+namespace {
+struct VectorTsChannel final : public TsChannelBase {
+	VectorTsChannel() : TsChannelBase("Test") { }
+
+	void write(const uint8_t* buffer, size_t size, bool /*isEndOfPacket*/) override {
+		data.insert(data.end(), buffer, buffer + size);
+	}
+
+	size_t readTimeout(uint8_t* /*buffer*/, size_t size, int /*timeout*/) override {
+		return size;
+	}
+
+	uint8_t getResponseCode() const {
+		return data.size() >= 3 ? data[2] : 0xFF;
+	}
+
+	// Payload of the response, without size, response code and CRC
+	std::vector<uint8_t> takePayload() {
+		std::vector<uint8_t> payload;
+
+		if (data.size() >= 7) {
+			payload.assign(data.begin() + 3, data.end() - 4);
+		}
+
+		data.clear();
+		return payload;
+	}
+
+	std::vector<uint8_t> data;
+};
+
+// The sniffer is global, don't leave it recording for the next test
+struct StopSnifferOnExit {
+	~StopSnifferOnExit() {
+		getBinaryEngineSniffer().stop();
+	}
+};
+}
+
+TEST(EngineSnifferBinary, Ring) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+
+	BinaryEngineSniffer sniffer;
+	sniffer.add(getTimeNowNt(), EngineSnifferChannel::Crank1, true, 0);
+	EXPECT_FALSE(sniffer.isRecording());
+
+	ASSERT_TRUE(sniffer.start());
+	EXPECT_EQ(BigBufferUser::EngineSniffer, getBigBufferCurrentUser());
+
+	// Nobody else gets the big buffer meanwhile
+	BinaryEngineSniffer other;
+	EXPECT_FALSE(other.start());
+
+	sniffer.add(US2NT(1000).count(), EngineSnifferChannel::Crank1, true, 5);
+	sniffer.add(US2NT(1250).count(), EngineSnifferChannel::Injector1, false, 0);
+	// Timestamped before the previous one
+	sniffer.add(US2NT(1200).count(), EngineSnifferChannel::Crank2, false, 6);
+
+	ASSERT_EQ(3u, sniffer.freeze());
+	EXPECT_FALSE(sniffer.isRecording());
+
+	auto records = sniffer.getRecords();
+	EXPECT_EQ(0, records[0].deltaNt);
+	EXPECT_EQ(EngineSnifferChannel::Crank1, records[0].channel);
+	EXPECT_EQ(1, records[0].edge);
+	EXPECT_EQ(5, records[0].value);
+	EXPECT_EQ(US2NT(250).count(), records[1].deltaNt);
+	EXPECT_EQ(EngineSnifferChannel::Injector1, records[1].channel);
+	EXPECT_EQ(0, records[1].edge);
+	EXPECT_EQ(-US2NT(50).count(), records[2].deltaNt);
+
+	// Wrap around a few times, oldest first after the freeze
+	sniffer.restart();
+	size_t total = 3 * ENGINE_SNIFFER_RECORD_COUNT + 17;
+	for (size_t i = 0; i < total; i++) {
+		sniffer.add(US2NT(10 * (int)i).count(), EngineSnifferChannel::Crank1, i % 2, (uint16_t)i);
+	}
+
+	ASSERT_EQ(ENGINE_SNIFFER_RECORD_COUNT, sniffer.freeze());
+	records = sniffer.getRecords();
+	for (size_t i = 0; i < ENGINE_SNIFFER_RECORD_COUNT; i++) {
+		ASSERT_EQ((uint16_t)(total - ENGINE_SNIFFER_RECORD_COUNT + i), records[i].value) << i;
+	}
+
+	sniffer.stop();
+	EXPECT_EQ(BigBufferUser::None, getBigBufferCurrentUser());
+}
+
+TEST(EngineSnifferBinary, DecodeRecords) {
+	const EngineSnifferRecord records[] = {
+		// Whatever this was relative to is gone
+		{ 12345, EngineSnifferChannel::Vvt1, 1, 0 },
+		{ 100, EngineSnifferChannel::Crank1, 1, 7 },
+		{ -20, EngineSnifferChannel::Coil1, 1, 0 },
+		{ 300, EngineSnifferChannel::Tdc, 1, 1200 },
+		{ 5000, EngineSnifferChannel::Crank1, 1, 0 },
+	};
+
+	auto events = decodeEngineSnifferRecords(reinterpret_cast<const uint8_t*>(records), sizeof(records) + 3);
+	ASSERT_EQ(5u, events.size());
+	EXPECT_EQ(0, events[0].timeNt);
+	EXPECT_EQ(100, events[1].timeNt);
+	EXPECT_EQ(80, events[2].timeNt);
+	EXPECT_EQ(380, events[3].timeNt);
+	EXPECT_EQ(1200, events[3].value);
+	EXPECT_EQ(5380, events[4].timeNt);
+
+	auto composite = toCompositeEvents(events, /* ticksPerUs */ 10);
+
+	// No crank 2, so the cam is the secondary channel. The coil has no logicdata channel.
+	ASSERT_EQ(6u, composite.size());
+
+	EXPECT_EQ(0u, composite[0].timestamp);
+	EXPECT_TRUE(composite[0].secondaryTrigger);
+	EXPECT_FALSE(composite[0].primaryTrigger);
+
+	EXPECT_EQ(10u, composite[1].timestamp);
+	EXPECT_TRUE(composite[1].primaryTrigger);
+	EXPECT_FALSE(composite[1].sync);
+
+	// TDC pulse
+	EXPECT_EQ(38u, composite[2].timestamp);
+	EXPECT_TRUE(composite[2].isTDC);
+	EXPECT_EQ(48u, composite[3].timestamp);
+	EXPECT_FALSE(composite[3].isTDC);
+
+	// Sync tooth pulse
+	EXPECT_EQ(538u, composite[4].timestamp);
+	EXPECT_TRUE(composite[4].sync);
+	EXPECT_EQ(548u, composite[5].timestamp);
+	EXPECT_FALSE(composite[5].sync);
+	EXPECT_TRUE(composite[5].primaryTrigger);
+	EXPECT_TRUE(composite[5].secondaryTrigger);
+}
+
+TEST(EngineSnifferBinary, TakesOverFromTextChart) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+	setupSimpleTestEngineWithMafAndTT_ONE_trigger(&eth);
+	engine->triggerCentral.isEngineSnifferEnabled = true;
+
+	StopSnifferOnExit stopSniffer;
+	VectorTsChannel channel;
+	TunerStudio instance;
+
+	uint8_t start = TS_ENGINE_SNIFFER_START;
+	instance.handleEngineSnifferCommand(&channel, &start, 1);
+	EXPECT_EQ(TS_RESPONSE_OK, channel.getResponseCode());
+	EXPECT_TRUE(channel.takePayload().empty());
+	ASSERT_TRUE(getBinaryEngineSniffer().isRecording());
+
+	eth.smartFireTriggerEvents2(/*count*/ 20, /*delayMs*/ 40);
+
+	// Nothing was formatted
+	EXPECT_EQ(0, waveChart.getSize());
+
+	uint8_t read = TS_ENGINE_SNIFFER_READ;
+	instance.handleEngineSnifferCommand(&channel, &read, 1);
+	EXPECT_EQ(TS_RESPONSE_OK, channel.getResponseCode());
+	auto payload = channel.takePayload();
+	ASSERT_EQ(0u, payload.size() % sizeof(EngineSnifferRecord));
+
+	auto events = decodeEngineSnifferRecords(payload.data(), payload.size());
+
+	int crankEdges = 0;
+	int tdcCount = 0;
+	for (const auto& event : events) {
+		if (event.channel == EngineSnifferChannel::Crank1) {
+			crankEdges++;
+		} else if (event.channel == EngineSnifferChannel::Tdc) {
+			tdcCount++;
+		}
+	}
+
+	EXPECT_GT(crankEdges, 20);
+	EXPECT_GT(tdcCount, 0);
+
+	// Records are in order, TT_ONE edges are 40ms apart
+	ASSERT_FALSE(events.empty());
+	EXPECT_NEAR(US2NT(MS2US(40 * 2 * 20)).count(), events.back().timeNt - events.front().timeNt, US2NT(MS2US(100)).count());
+
+	auto composite = toCompositeEvents(events);
+	ASSERT_GT(composite.size(), 2u);
+	writeFile("unittest_engine_sniffer.logicdata", composite);
+
+	// Reading starts over
+	EXPECT_TRUE(getBinaryEngineSniffer().isRecording());
+	instance.handleEngineSnifferCommand(&channel, &read, 1);
+	EXPECT_TRUE(channel.takePayload().empty());
+
+	// Once stopped the text chart gets the events again
+	uint8_t stop = TS_ENGINE_SNIFFER_STOP;
+	instance.handleEngineSnifferCommand(&channel, &stop, 1);
+	EXPECT_EQ(BigBufferUser::None, getBigBufferCurrentUser());
+
+	eth.smartFireTriggerEvents2(/*count*/ 2, /*delayMs*/ 40);
+	EXPECT_GT(waveChart.getSize(), 0);
+}
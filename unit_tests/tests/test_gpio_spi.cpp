@@ -0,0 +1,325 @@
+/**
+ * @file	test_gpio_spi.cpp
+ *
+ * Shared SPI refresh of smart gpio chips, with the bus mocked
+ */
+
+#include "pch.h"
+
+#include "gpio/gpio_spi.h"
+
+#include <vector>
+
+namespace {
+struct MockSpiBus final : public SpiBus {
+	void acquire() override {
+		EXPECT_FALSE(held);
+		held = true;
+		acquireCount++;
+	}
+
+	void release() override {
+		EXPECT_TRUE(held);
+		held = false;
+	}
+
+	void exchange(const SpiRefreshClient &client, SpiBatch &batch) override {
+		EXPECT_TRUE(held);
+		exchanges.push_back(client.getName());
+
+		for (size_t frame = 0; frame < batch.getFrameCount(); frame++) {
+			size_t start = batch.getFrameStart(frame);
+
+			for (size_t i = 0; i < batch.getFrameLength(frame); i++) {
+				// The chip answers with what it got on the previous word, as TLE6240 and MC33810 do
+				batch.getRx()[start + i] = lastTx;
+				lastTx = batch.getTx()[start + i];
+				words++;
+			}
+			frames++;
+		}
+	}
+
+	bool held = false;
+	int acquireCount = 0;
+	int frames = 0;
+	int words = 0;
+	uint16_t lastTx = 0;
+	std::vector<const char*> exchanges;
+};
+
+// Sends the output state, and on diagnostic reads a status word; if that says fault, reads one more register
+struct FakeChip final : public SpiRefreshClient {
+	bool prepareRefresh(SpiBatch &batch, int stage, bool diagnosticDue) override {
+		if (stage == 0) {
+			batch.add(0x1000 | output);
+			sent = output;
+			if (diagnosticDue) {
+				statusIdx = batch.add(0x2000);
+			} else {
+				statusIdx = -1;
+			}
+			return true;
+		}
+
+		batch.add(0x3000);
+		faultIdx = batch.add(0x2000);
+		return true;
+	}
+
+	bool finishRefresh(const SpiBatch &batch, int stage) override {
+		if (stage == 0) {
+			outputCached = sent;
+			if (statusIdx >= 0) {
+				status = batch.getRx(statusIdx);
+				return fault;
+			}
+			return false;
+		}
+
+		faultRegister = batch.getRx(faultIdx);
+		return false;
+	}
+
+	void write(uint8_t value) {
+		output = value;
+		requestRefresh(getTimeNowNt());
+	}
+
+	uint8_t output = 0;
+	uint8_t sent = 0;
+	uint8_t outputCached = 0;
+	bool fault = false;
+	int statusIdx = -1;
+	int faultIdx = -1;
+	uint16_t status = 0;
+	uint16_t faultRegister = 0;
+};
+
+// Has to be served by a given time, like the TLE8888 watchdog
+struct DeadlineChip final : public SpiRefreshClient {
+	bool prepareRefresh(SpiBatch &batch, int, bool) override {
+		batch.add(0x4000);
+		return true;
+	}
+
+	bool finishRefresh(const SpiBatch&, int) override {
+		deadlineNt = getTimeNowNt() + MS2NT(10);
+		return false;
+	}
+
+	efitick_t getDeadlineNt() const override {
+		return deadlineNt;
+	}
+
+	efitick_t deadlineNt = 0;
+};
+
+static constexpr int diagIntervalMs = 100;
+
+static efitick_t atMs(int ms) {
+	return MS2NT(ms).count();
+}
+}
+
+TEST(GpioSpi, CoalescesRequests) {
+	MockSpiBus bus;
+	SpiRefreshScheduler scheduler(bus);
+	FakeChip chip;
+	ASSERT_TRUE(scheduler.add(chip, "chip", diagIntervalMs));
+
+	// First diagnostic is right away
+	EXPECT_EQ(1, scheduler.refresh(0));
+	EXPECT_EQ(1, bus.acquireCount);
+
+	// Nothing to do: bus is not touched
+	EXPECT_EQ(0, scheduler.refresh(atMs(10)));
+	EXPECT_EQ(1, bus.acquireCount);
+
+	// A burst of pin writes between two passes goes out as one word with the final state
+	chip.write(0x01);
+	chip.write(0x03);
+	chip.write(0x07);
+
+	EXPECT_EQ(1, scheduler.refresh(atMs(20)));
+	EXPECT_EQ(2, bus.acquireCount);
+	EXPECT_EQ(2 + 1, bus.words);
+	EXPECT_EQ(0x1007, bus.lastTx);
+	EXPECT_EQ(0x07, chip.outputCached);
+	EXPECT_EQ(2u, scheduler.getTransactionCount());
+	EXPECT_EQ(2u, chip.getRefreshCount());
+
+	// Request was consumed
+	EXPECT_EQ(0, scheduler.refresh(atMs(30)));
+	EXPECT_EQ(2, bus.acquireCount);
+}
+
+TEST(GpioSpi, OneBusTransactionForAllChips) {
+	MockSpiBus bus;
+	SpiRefreshScheduler scheduler(bus);
+	FakeChip chips[3];
+	ASSERT_TRUE(scheduler.add(chips[0], "a", diagIntervalMs));
+	ASSERT_TRUE(scheduler.add(chips[1], "b", diagIntervalMs));
+	ASSERT_TRUE(scheduler.add(chips[2], "c", diagIntervalMs));
+
+	// Diagnostic pass: all chips, still one transaction, output and status read in one batch each
+	EXPECT_EQ(3, scheduler.refresh(0));
+	EXPECT_EQ(1, bus.acquireCount);
+	EXPECT_EQ(3u, bus.exchanges.size());
+	EXPECT_EQ(3 * 2, bus.words);
+
+	// Only the chips that changed are refreshed
+	bus.exchanges.clear();
+	chips[0].write(1);
+	chips[2].write(2);
+
+	EXPECT_EQ(2, scheduler.refresh(atMs(10)));
+	EXPECT_EQ(2, bus.acquireCount);
+	ASSERT_EQ(2u, bus.exchanges.size());
+	EXPECT_STREQ("a", bus.exchanges[0]);
+	EXPECT_STREQ("c", bus.exchanges[1]);
+	EXPECT_EQ(1u, chips[1].getRefreshCount());
+
+	// Next diagnostic pass, status read got the reply to the output word
+	bus.exchanges.clear();
+	EXPECT_EQ(3, scheduler.refresh(atMs(diagIntervalMs)));
+	EXPECT_EQ(3, bus.acquireCount);
+	EXPECT_EQ(3u, bus.exchanges.size());
+	EXPECT_EQ(0x1002, chips[2].status);
+	EXPECT_FALSE(bus.held);
+}
+
+TEST(GpioSpi, DiagnosticIntervalPerChip) {
+	MockSpiBus bus;
+	SpiRefreshScheduler scheduler(bus);
+	FakeChip fast;
+	FakeChip slow;
+	ASSERT_TRUE(scheduler.add(fast, "fast", 100));
+	ASSERT_TRUE(scheduler.add(slow, "slow", 500));
+
+	for (int ms = 0; ms < 1000; ms += 100) {
+		EXPECT_EQ(ms == 0 || ms == 500 ? 2 : 1, scheduler.refresh(atMs(ms)));
+	}
+
+	EXPECT_EQ(10u, fast.getRefreshCount());
+	EXPECT_EQ(2u, slow.getRefreshCount());
+	EXPECT_EQ(atMs(1000), scheduler.getNextWakeupNt());
+}
+
+TEST(GpioSpi, Deadline) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+
+	MockSpiBus bus;
+	SpiRefreshScheduler scheduler(bus);
+	FakeChip chip;
+	DeadlineChip watchdog;
+	ASSERT_TRUE(scheduler.add(chip, "chip", diagIntervalMs));
+	ASSERT_TRUE(scheduler.add(watchdog, "watchdog", diagIntervalMs));
+
+	setTimeNowUs(0);
+	EXPECT_EQ(2, scheduler.refresh(getTimeNowNt()));
+
+	// The thread has to wake up for the deadline, well before the next diagnostic
+	EXPECT_EQ(atMs(10), scheduler.getNextWakeupNt());
+
+	advanceTimeUs(MS2US(5));
+	EXPECT_EQ(0, scheduler.refresh(getTimeNowNt()));
+
+	advanceTimeUs(MS2US(5));
+	EXPECT_EQ(1, scheduler.refresh(getTimeNowNt()));
+	EXPECT_EQ(2u, watchdog.getRefreshCount());
+	EXPECT_EQ(1u, chip.getRefreshCount());
+	EXPECT_EQ(atMs(20), scheduler.getNextWakeupNt());
+}
+
+TEST(GpioSpi, FaultReadInSameTransaction) {
+	MockSpiBus bus;
+	SpiRefreshScheduler scheduler(bus);
+	FakeChip chip;
+	FakeChip other;
+	ASSERT_TRUE(scheduler.add(chip, "chip", diagIntervalMs));
+	ASSERT_TRUE(scheduler.add(other, "other", diagIntervalMs));
+
+	chip.fault = true;
+
+	EXPECT_EQ(2, scheduler.refresh(0));
+	EXPECT_EQ(1, bus.acquireCount);
+	// Stage 0 and stage 1 of the first chip, then the second one
+	ASSERT_EQ(3u, bus.exchanges.size());
+	EXPECT_STREQ("chip", bus.exchanges[0]);
+	EXPECT_STREQ("chip", bus.exchanges[1]);
+	EXPECT_STREQ("other", bus.exchanges[2]);
+	EXPECT_EQ(0x3000, chip.faultRegister);
+	EXPECT_EQ(1u, chip.getRefreshCount());
+	EXPECT_EQ(4u, chip.getWordCount());
+}
+
+TEST(GpioSpi, RefreshLatency) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+
+	MockSpiBus bus;
+	SpiRefreshScheduler scheduler(bus);
+	FakeChip chip;
+	ASSERT_TRUE(scheduler.add(chip, "chip", diagIntervalMs));
+
+	setTimeNowUs(1000);
+	scheduler.refresh(getTimeNowNt());
+
+	// Counted from the first of the coalesced requests
+	chip.write(1);
+	advanceTimeUs(150);
+	chip.write(2);
+	advanceTimeUs(100);
+
+	scheduler.refresh(getTimeNowNt());
+	EXPECT_EQ(US2NT(250).count(), chip.getLastLatencyNt());
+	EXPECT_EQ(US2NT(250).count(), chip.getMaxLatencyNt());
+
+	chip.write(3);
+	advanceTimeUs(40);
+	scheduler.refresh(getTimeNowNt());
+	EXPECT_EQ(US2NT(40).count(), chip.getLastLatencyNt());
+	EXPECT_EQ(US2NT(250).count(), chip.getMaxLatencyNt());
+
+	// Diagnostic only pass: nothing was waiting, latency stays
+	advanceTimeUs(MS2US(diagIntervalMs));
+	EXPECT_EQ(1, scheduler.refresh(getTimeNowNt()));
+	EXPECT_EQ(US2NT(40).count(), chip.getLastLatencyNt());
+}
+
+TEST(GpioSpi, BatchOverflow) {
+	SpiBatch batch;
+	batch.clear();
+
+	uint16_t words[SPI_BATCH_MAX_WORDS] = {};
+	EXPECT_EQ(0, batch.add(words, 4));
+	EXPECT_EQ(4, batch.add(0x1234));
+	EXPECT_EQ(2u, batch.getFrameCount());
+	EXPECT_EQ(4u, batch.getFrameStart(1));
+	EXPECT_EQ(1u, batch.getFrameLength(1));
+
+	EXPECT_EQ(-1, batch.add(words, SPI_BATCH_MAX_WORDS));
+	EXPECT_TRUE(batch.isOverflow());
+	EXPECT_EQ(5u, batch.getWordCount());
+
+	// Scheduler drops a batch that did not fit, bus is not touched
+	struct GreedyChip final : public SpiRefreshClient {
+		bool prepareRefresh(SpiBatch &b, int, bool) override {
+			for (int i = 0; i <= SPI_BATCH_MAX_WORDS; i++) {
+				b.add(0);
+			}
+			return true;
+		}
+
+		bool finishRefresh(const SpiBatch&, int) override {
+			return false;
+		}
+	} greedy;
+
+	MockSpiBus bus;
+	SpiRefreshScheduler scheduler(bus);
+	ASSERT_TRUE(scheduler.add(greedy, "greedy", diagIntervalMs));
+	EXPECT_EQ(0, scheduler.refresh(0));
+	EXPECT_EQ(0, bus.acquireCount);
+	EXPECT_EQ(1u, scheduler.getOverflowCount());
+}
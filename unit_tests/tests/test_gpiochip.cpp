@@ -8,6 +8,8 @@
 
 #include "gpio/gpio_ext.h"
 
+#include <chrono>
+
 using ::testing::_;
 
 static int io_state = 0;
@@ -115,4 +117,93 @@ TEST(gpioext, testGpioExt) {
 	EXPECT_TRUE(gpiochips_readPad((Gpio)(chip3_base + 16)) < 0);
 	EXPECT_TRUE(gpiochips_writePad((Gpio)(chip3_base + 16), 1) < 0);
 
+	/* free the slots for other tests */
+	EXPECT_EQ(0, gpiochip_unregister((brain_pin_e)chip1_base));
+	EXPECT_EQ(0, gpiochip_unregister((brain_pin_e)chip2_base));
+	/* failed chip was removed by gpiochips_init */
+	EXPECT_EQ(-1, gpiochip_unregister((brain_pin_e)chip3_base));
+	EXPECT_EQ(0, gpiochips_get_total_pins());
+}
+
+namespace {
+struct CountingChip : public GpioChip {
+	int init() override {
+		return 0;
+	}
+
+	int writePad(size_t pin, int value) override {
+		writes++;
+		lastPin = pin;
+		lastValue = value;
+		return 0;
+	}
+
+	int writes = 0;
+	size_t lastPin = 0;
+	int lastValue = -1;
+};
+
+int64_t nowNs() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}
+
+TEST(gpioext, outputPinThroughChip) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+
+	CountingChip other1, other2, chip;
+	brain_pin_e base = (brain_pin_e)(BRAIN_PIN_ONCHIP_LAST + 1);
+
+	/* the pin is on the last chip, so a lookup has to go over all of them */
+	ASSERT_TRUE(gpiochip_register(base, "other1", other1, 16) > 0);
+	ASSERT_TRUE(gpiochip_register((brain_pin_e)(base + 16), "other2", other2, 16) > 0);
+	ASSERT_TRUE(gpiochip_register((brain_pin_e)(base + 32), "chip", chip, 16) > 0);
+
+	brain_pin_e injectorPin = (brain_pin_e)(base + 32 + 5);
+
+	GpioChipPin found = gpiochips_findPin(injectorPin);
+	EXPECT_EQ(&chip, found.chip);
+	EXPECT_EQ(5u, found.offset);
+	EXPECT_EQ(nullptr, gpiochips_findPin((brain_pin_e)(base + 48)).chip);
+
+	OutputPin pin;
+	pin.initPin("injector", injectorPin);
+	EXPECT_EQ(&chip, pin.m_extPin.chip);
+	/* initial state */
+	EXPECT_EQ(1, chip.writes);
+	EXPECT_EQ(0, chip.lastValue);
+
+	pin.setValue(1);
+	EXPECT_EQ(2, chip.writes);
+	EXPECT_EQ(5u, chip.lastPin);
+	EXPECT_EQ(1, chip.lastValue);
+	EXPECT_EQ(0, other1.writes + other2.writes);
+
+	/* cost of a write: chip looked up on every call vs cached on init */
+	constexpr int count = 1000000;
+
+	int64_t startNs = nowNs();
+	for (int i = 0; i < count; i++) {
+		gpiochips_writePad(injectorPin, i & 1);
+	}
+	double lookupNs = (double)(nowNs() - startNs) / count;
+
+	startNs = nowNs();
+	for (int i = 0; i < count; i++) {
+		pin.setValue(i & 1);
+	}
+	double setValueNs = (double)(nowNs() - startNs) / count;
+
+	printf("External pin write: gpiochips_writePad %.1f ns, OutputPin::setValue %.1f ns\n", lookupNs, setValueNs);
+	EXPECT_EQ(2 + 2 * count, chip.writes);
+
+	pin.deInit();
+	EXPECT_EQ(nullptr, pin.m_extPin.chip);
+	pin.setValue(0);
+	EXPECT_EQ(2 + 2 * count, chip.writes);
+
+	EXPECT_EQ(0, gpiochip_unregister(base));
+	EXPECT_EQ(0, gpiochip_unregister((brain_pin_e)(base + 16)));
+	EXPECT_EQ(0, gpiochip_unregister((brain_pin_e)(base + 32)));
 }
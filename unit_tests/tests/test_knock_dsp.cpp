@@ -0,0 +1,219 @@
+#include "pch.h"
+
+#include "knock_dsp.h"
+#include "knock_logic.h"
+#include "biquad.h"
+
+#include <chrono>
+#include <random>
+
+static constexpr float sampleRate = 217000;
+static constexpr float knockFrequency = 7000;
+static constexpr float vcc = 3.3f;
+static constexpr float voltsPerCount = vcc / 4095;
+static constexpr size_t windowSize = 2048;
+
+static void makeTone(adcsample_t (&samples)[windowSize], float frequency, float amplitude, float noise, float decay = 0, float center = 2048) {
+	std::mt19937 rng(1234);
+	std::normal_distribution<float> dist(0, noise);
+
+	for (size_t i = 0; i < windowSize; i++) {
+		float t = i / sampleRate;
+		float envelope = amplitude * expf(-decay * t);
+		float value = center + envelope * sinf(2 * CONST_PI * frequency * t) + dist(rng);
+		samples[i] = clampF(0, roundf(value), 4095);
+	}
+}
+
+// The way software knock used to filter a window: one sample at a time, through a Biquad
+// whose steady state was cooked at vcc/2
+static float referenceDb(const adcsample_t* samples, size_t count, float frequency, float Q) {
+	Biquad filter;
+	filter.configureBandpass(sampleRate, frequency, Q);
+	filter.cookSteadyState(vcc / 2);
+
+	float sumSq = 0;
+	for (size_t i = 0; i < count; i++) {
+		float filtered = filter.filter(voltsPerCount * samples[i]);
+		sumSq += filtered * filtered;
+	}
+
+	return clampF(-100, 10 * log10f(sumSq / count), 100);
+}
+
+TEST(KnockDsp, BandPlacement) {
+	KnockDsp dsp;
+	dsp.configure(sampleRate, knockFrequency);
+
+	ASSERT_EQ(4u, dsp.getBandCount());
+	EXPECT_FLOAT_EQ(7000, dsp.getBandFrequency(0));
+	EXPECT_NEAR(11612, dsp.getBandFrequency(1), 1);
+	EXPECT_NEAR(14570, dsp.getBandFrequency(2), 1);
+	EXPECT_NEAR(15973, dsp.getBandFrequency(3), 1);
+
+	// Slow ADC: only the modes it can resolve are used
+	dsp.configure(25000, knockFrequency);
+	EXPECT_EQ(1u, dsp.getBandCount());
+
+	adcsample_t samples[windowSize];
+	makeTone(samples, knockFrequency, 100, 5);
+
+	float bandDb[KNOCK_BAND_COUNT];
+	dsp.process(samples, windowSize, voltsPerCount, bandDb);
+	EXPECT_GT(bandDb[0], -100);
+	EXPECT_EQ(-100, bandDb[1]);
+	EXPECT_EQ(-100, bandDb[2]);
+	EXPECT_EQ(-100, bandDb[3]);
+}
+
+TEST(KnockDsp, FirstBandMatchesBiquad) {
+	KnockDsp dsp;
+	dsp.configure(sampleRate, knockFrequency);
+
+	adcsample_t samples[windowSize];
+	makeTone(samples, knockFrequency, 200, 10);
+
+	float bandDb[KNOCK_BAND_COUNT];
+	dsp.process(samples, windowSize, voltsPerCount, bandDb);
+
+	// With the signal centered on vcc/2 the only difference is the half count step from vcc/2 to
+	// the actual mean when the old filter starts, which rings out at around 1e-3 dB
+	EXPECT_NEAR(referenceDb(samples, windowSize, knockFrequency, 3), bandDb[0], 0.01f);
+
+	// Windows that aren't a whole number of chunks
+	dsp.process(samples, 1000, voltsPerCount, bandDb);
+	EXPECT_NEAR(referenceDb(samples, 1000, knockFrequency, 3), bandDb[0], 0.01f);
+}
+
+TEST(KnockDsp, OffCenterBias) {
+	KnockDsp dsp;
+	dsp.configure(sampleRate, knockFrequency);
+
+	float centeredDb[KNOCK_BAND_COUNT];
+	float biasedDb[KNOCK_BAND_COUNT];
+
+	adcsample_t samples[windowSize];
+
+	// A quiet engine on a sensor biased to vcc/2
+	makeTone(samples, knockFrequency, 20, 2, 0, 2048);
+	dsp.process(samples, windowSize, voltsPerCount, centeredDb);
+
+	// Same signal, but the bias sits well above vcc/2
+	makeTone(samples, knockFrequency, 20, 2, 0, 3000);
+	dsp.process(samples, windowSize, voltsPerCount, biasedDb);
+
+	// The measured mean is taken out, so the bias doesn't matter
+	EXPECT_NEAR(centeredDb[0], biasedDb[0], 0.01f);
+
+	// The old filter started from vcc/2 and counted the ringing from the step to the
+	// real bias as knock energy, about 5dB of it here
+	EXPECT_GT(referenceDb(samples, windowSize, knockFrequency, 3), biasedDb[0] + 4);
+}
+
+TEST(KnockDsp, BandSelectivity) {
+	KnockDsp dsp;
+	dsp.configure(sampleRate, knockFrequency);
+
+	adcsample_t samples[windowSize];
+	makeTone(samples, dsp.getBandFrequency(2), 200, 2);
+
+	float bandDb[KNOCK_BAND_COUNT];
+	dsp.process(samples, windowSize, voltsPerCount, bandDb);
+
+	EXPECT_GT(bandDb[2], bandDb[0] + 10);
+	EXPECT_GT(bandDb[2], bandDb[1]);
+	EXPECT_GT(bandDb[2], bandDb[3]);
+}
+
+TEST(KnockDsp, KnockStandsOutOfNoise) {
+	KnockDsp dsp;
+	dsp.configure(sampleRate, knockFrequency);
+
+	float quiet[KNOCK_BAND_COUNT];
+	float knock[KNOCK_BAND_COUNT];
+
+	adcsample_t samples[windowSize];
+
+	// Background engine noise
+	makeTone(samples, knockFrequency, 0, 8);
+	dsp.process(samples, windowSize, voltsPerCount, quiet);
+
+	// Knock rings at the chamber resonance and dies out over a few milliseconds
+	makeTone(samples, knockFrequency, 400, 8, 500);
+	dsp.process(samples, windowSize, voltsPerCount, knock);
+
+	EXPECT_GT(knock[0], quiet[0] + 10);
+}
+
+TEST(KnockDsp, BandsReachController) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+
+	auto& knock = *engine->module<KnockController>();
+
+	float bandDb[KNOCK_BAND_COUNT] = { 12.4f, -3, 20.6f, -40 };
+	knock.onKnockBandsSensed(2, bandDb);
+
+	EXPECT_EQ(12, knock.getBandEnergy(2, 0));
+	EXPECT_EQ(-3, knock.getBandEnergy(2, 1));
+	EXPECT_EQ(21, knock.getBandEnergy(2, 2));
+	EXPECT_EQ(-40, knock.getBandEnergy(2, 3));
+
+	// Other cylinders untouched
+	EXPECT_EQ(0, knock.getBandEnergy(1, 0));
+
+	// Out of range
+	EXPECT_EQ(-100, knock.getBandEnergy(MAX_CYLINDER_COUNT, 0));
+	EXPECT_EQ(-100, knock.getBandEnergy(2, KNOCK_BAND_COUNT));
+}
+
+TEST(KnockDsp, Benchmark) {
+	KnockDsp dsp;
+	dsp.configure(sampleRate, knockFrequency);
+
+	Biquad filters[KNOCK_BAND_COUNT];
+	for (size_t i = 0; i < KNOCK_BAND_COUNT; i++) {
+		filters[i].configureBandpass(sampleRate, dsp.getBandFrequency(i), 3);
+	}
+
+	adcsample_t samples[windowSize];
+	makeTone(samples, knockFrequency, 200, 10);
+
+	constexpr int iterations = 200;
+
+	float perSampleSum = 0;
+	float blockSum = 0;
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (int n = 0; n < iterations; n++) {
+		for (size_t b = 0; b < KNOCK_BAND_COUNT; b++) {
+			filters[b].cookSteadyState(voltsPerCount * 2048);
+
+			float sumSq = 0;
+			for (size_t i = 0; i < windowSize; i++) {
+				float filtered = filters[b].filter(voltsPerCount * samples[i]);
+				sumSq += filtered * filtered;
+			}
+
+			perSampleSum += sumSq;
+		}
+	}
+
+	auto mid = std::chrono::steady_clock::now();
+
+	for (int n = 0; n < iterations; n++) {
+		float bandDb[KNOCK_BAND_COUNT];
+		dsp.process(samples, windowSize, voltsPerCount, bandDb);
+		blockSum += bandDb[0];
+	}
+
+	auto end = std::chrono::steady_clock::now();
+
+	EXPECT_GT(perSampleSum, 0);
+	EXPECT_NE(blockSum, 0);
+
+	constexpr int samplesProcessed = iterations * windowSize;
+	auto biquadPs = std::chrono::duration_cast<std::chrono::nanoseconds>(mid - start).count() * 1000 / samplesProcessed;
+	auto blockPs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - mid).count() * 1000 / samplesProcessed;
+	printf("Knock %d bands per sample: biquad=%5dps block=%5dps\n", KNOCK_BAND_COUNT, (int)biquadPs, (int)blockPs);
+}
@@ -0,0 +1,196 @@
+#include "pch.h"
+
+#include "module_dispatcher.h"
+#include "eficonsole.h"
+
+#include <string>
+#include <vector>
+
+static std::vector<std::string> callLog;
+
+template <int N>
+struct PeriodicModule : public EngineModule {
+	ModuleRate rate = ModuleRate::Hz50;
+	uint8_t priority = 0;
+	int durationUs = 1;
+	int calls = 0;
+
+	ModuleRate getPeriodicRate() const override {
+		return rate;
+	}
+
+	uint8_t getPeriodicPriority() const override {
+		return priority;
+	}
+
+	void onPeriodicCallback() override {
+		callLog.push_back("periodic" + std::to_string(N));
+		calls++;
+		advanceTimeUs(durationUs);
+	}
+};
+
+struct FastModule : public EngineModule {
+	int calls = 0;
+
+	void onFastCallback() override {
+		callLog.push_back("fast");
+		calls++;
+		advanceTimeUs(20);
+	}
+};
+
+struct SlowModule : public EngineModule {
+	int calls = 0;
+
+	void onSlowCallback() override {
+		calls++;
+	}
+};
+
+static void runOneSecond(ModuleDispatcher& dut) {
+	for (int i = 0; i < hzForPeriod(FAST_CALLBACK_RATE); i++) {
+		dut.onFastCallback();
+	}
+}
+
+TEST(ModuleDispatcher, Rates) {
+	type_list<FastModule, SlowModule, PeriodicModule<1>, PeriodicModule<2>, EngineModule> modules;
+	modules.get<PeriodicModule<1>>()->rate = ModuleRate::Hz10;
+	modules.get<PeriodicModule<2>>()->rate = ModuleRate::Hz250;
+
+	ModuleDispatcher dut;
+	dut.setModules(modules);
+
+	runOneSecond(dut);
+	dut.onSlowCallback();
+
+	EXPECT_EQ(250, modules.get<FastModule>()->calls);
+	EXPECT_EQ(1, modules.get<SlowModule>()->calls);
+	EXPECT_EQ(10, modules.get<PeriodicModule<1>>()->calls);
+	EXPECT_EQ(250, modules.get<PeriodicModule<2>>()->calls);
+
+	EXPECT_EQ(-1, dut.getTickOffset(&modules.get<FastModule>().unmock()));
+	EXPECT_EQ(-1, dut.getTickOffset(&modules.get<SlowModule>().unmock()));
+}
+
+TEST(ModuleDispatcher, StaggerAndOrder) {
+	type_list<FastModule, PeriodicModule<1>, PeriodicModule<2>, PeriodicModule<3>, PeriodicModule<4>, EngineModule> modules;
+	auto& low = modules.get<PeriodicModule<1>>().unmock();
+	auto& high = modules.get<PeriodicModule<2>>().unmock();
+	auto& everyTick = modules.get<PeriodicModule<3>>().unmock();
+	auto& slower = modules.get<PeriodicModule<4>>().unmock();
+
+	high.priority = 10;
+	everyTick.rate = ModuleRate::Hz250;
+	slower.rate = ModuleRate::Hz25;
+
+	ModuleDispatcher dut;
+	dut.setModules(modules);
+
+	callLog.clear();
+	dut.onFastCallback();
+
+	// Higher rate placed first, then the higher priority of the 50hz ones, each in the least busy tick
+	EXPECT_EQ(0, dut.getTickOffset(&everyTick));
+	EXPECT_EQ(0, dut.getTickOffset(&high));
+	EXPECT_EQ(1, dut.getTickOffset(&low));
+	EXPECT_EQ(2, dut.getTickOffset(&slower));
+
+	// Fast callbacks first, then periodic ones in the same order
+	EXPECT_EQ(std::vector<std::string>({ "fast", "periodic3", "periodic2" }), callLog);
+
+	callLog.clear();
+	dut.onFastCallback();
+	EXPECT_EQ(std::vector<std::string>({ "fast", "periodic3", "periodic1" }), callLog);
+
+	callLog.clear();
+	dut.onFastCallback();
+	EXPECT_EQ(std::vector<std::string>({ "fast", "periodic3", "periodic4" }), callLog);
+
+	callLog.clear();
+	dut.onFastCallback();
+	EXPECT_EQ(std::vector<std::string>({ "fast", "periodic3" }), callLog);
+}
+
+TEST(ModuleDispatcher, Timing) {
+	setTimeNowUs(0);
+
+	type_list<FastModule, PeriodicModule<1>, EngineModule> modules;
+	auto& periodic = modules.get<PeriodicModule<1>>().unmock();
+	periodic.durationUs = 100;
+
+	ModuleDispatcher dut;
+	dut.setModules(modules);
+
+	runOneSecond(dut);
+
+	auto fast = dut.getModuleTime(&modules.get<FastModule>().unmock());
+	ASSERT_NE(nullptr, fast);
+	EXPECT_NEAR(20, fast->min, 0.1f);
+	EXPECT_NEAR(20, fast->avg, 0.1f);
+	EXPECT_NEAR(20, fast->max, 0.1f);
+	EXPECT_EQ(250, fast->calls);
+
+	auto slow = dut.getModuleTime(&periodic);
+	EXPECT_NEAR(100, slow->avg, 0.1f);
+	EXPECT_EQ(50, slow->calls);
+
+	// 20us every tick, 100us more every 5th
+	EXPECT_NEAR(40, dut.tickTimeAvg, 0.1f);
+	EXPECT_NEAR(120, dut.tickTimeMax, 0.1f);
+
+	// Too long saturates
+	periodic.durationUs = 10000;
+	runOneSecond(dut);
+	EXPECT_NEAR(6553.5f, slow->avg, 0.1f);
+}
+
+TEST(ModuleDispatcher, LiveDataChannels) {
+	module_timing_s timing;
+
+	EXPECT_EQ(&timing.knockTime, findModuleTimeChannel(timing, getModuleSignature<KnockController>()));
+	EXPECT_EQ(&timing.fan2Time, findModuleTimeChannel(timing, getModuleSignature<FanControl2>()));
+	EXPECT_EQ(nullptr, findModuleTimeChannel(timing, getModuleSignature<FastModule>()));
+
+	// Every module of the engine has a channel of its own
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+	engine->engineModules.apply_all([&](auto& m) {
+		using T = std::decay_t<decltype(m)>;
+
+		if constexpr (!std::is_same_v<T, EngineModule>) {
+			EXPECT_NE(nullptr, findModuleTimeChannel(timing, getModuleSignature<T>())) << getModuleSignature<T>();
+		}
+	});
+
+	// Modules the unit tests are built without, named here so that renaming one breaks this test too
+	EXPECT_EQ(&timing.alternatorTime, findModuleTimeChannel(timing, getModuleSignature<AlternatorController>()));
+	EXPECT_EQ(&timing.vvt1Time, findModuleTimeChannel(timing, getModuleSignature<VvtController1>()));
+	EXPECT_EQ(&timing.vvt2Time, findModuleTimeChannel(timing, getModuleSignature<VvtController2>()));
+	EXPECT_EQ(&timing.vvt3Time, findModuleTimeChannel(timing, getModuleSignature<VvtController3>()));
+	EXPECT_EQ(&timing.vvt4Time, findModuleTimeChannel(timing, getModuleSignature<VvtController4>()));
+	EXPECT_EQ(&timing.ethernetConsoleTime, findModuleTimeChannel(timing, getModuleSignature<EthernetConsoleModule>()));
+}
+
+TEST(ModuleDispatcher, WeighsByMeasuredTime) {
+	type_list<PeriodicModule<1>, PeriodicModule<2>, PeriodicModule<3>, PeriodicModule<4>, PeriodicModule<5>, PeriodicModule<6>, EngineModule> modules;
+	auto& heavy = modules.get<PeriodicModule<1>>().unmock();
+	auto& last = modules.get<PeriodicModule<6>>().unmock();
+
+	heavy.priority = 10;
+	heavy.durationUs = 1000;
+
+	ModuleDispatcher dut;
+	dut.setModules(modules);
+
+	// Six modules in five ticks, unmeasured they all weigh the same
+	runOneSecond(dut);
+	EXPECT_EQ(0, dut.getTickOffset(&heavy));
+	EXPECT_EQ(0, dut.getTickOffset(&last));
+
+	// Measured now: nobody joins the heavy one
+	dut.reschedule();
+	runOneSecond(dut);
+	EXPECT_EQ(0, dut.getTickOffset(&heavy));
+	EXPECT_EQ(1, dut.getTickOffset(&last));
+}
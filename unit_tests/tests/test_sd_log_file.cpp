@@ -0,0 +1,320 @@
+#include "pch.h"
+
+#include "sd_log_file.h"
+#include "diskio.h"
+
+#include <cstring>
+#include <vector>
+
+// 64MB card, formatted FAT16 with 4k clusters
+static constexpr size_t sectorSize = 512;
+static constexpr size_t sectorCount = 64 * 1024 * 1024 / sectorSize;
+static constexpr size_t clusterSize = 4096;
+
+static std::vector<uint8_t> disk;
+
+// The card model: every command costs time, and a write that doesn't continue where the last
+// one ended costs a lot more, like a card switching the unit it's writing to
+static constexpr int commandUs = 200;
+static constexpr int sectorUs = 50;
+static constexpr int seekUs = 3000;
+
+static DWORD nextWriteSector = 0;
+// Writes below the data area: FAT and root directory
+static DWORD dataStart = 0;
+static int metadataWrites = 0;
+
+DSTATUS disk_initialize(BYTE) {
+	return 0;
+}
+
+DSTATUS disk_status(BYTE) {
+	return 0;
+}
+
+DRESULT disk_read(BYTE, BYTE* buff, DWORD sector, UINT count) {
+	memcpy(buff, &disk[sector * sectorSize], count * sectorSize);
+	advanceTimeUs(commandUs + count * sectorUs);
+	return RES_OK;
+}
+
+DRESULT disk_write(BYTE, const BYTE* buff, DWORD sector, UINT count) {
+	memcpy(&disk[sector * sectorSize], buff, count * sectorSize);
+
+	advanceTimeUs(commandUs + count * sectorUs + (sector == nextWriteSector ? 0 : seekUs));
+	nextWriteSector = sector + count;
+
+	if (sector < dataStart) {
+		metadataWrites++;
+	}
+
+	return RES_OK;
+}
+
+DRESULT disk_ioctl(BYTE, BYTE cmd, void* buff) {
+	switch (cmd) {
+		case GET_SECTOR_COUNT:
+			*reinterpret_cast<DWORD*>(buff) = sectorCount;
+			return RES_OK;
+		case GET_SECTOR_SIZE:
+			*reinterpret_cast<WORD*>(buff) = sectorSize;
+			return RES_OK;
+		case GET_BLOCK_SIZE:
+			*reinterpret_cast<DWORD*>(buff) = 1;
+			return RES_OK;
+		default:
+			return RES_OK;
+	}
+}
+
+DWORD get_fattime() {
+	return 0;
+}
+
+static uint8_t patternAt(size_t offset) {
+	return (offset * 7 + offset / 1024) & 0xFF;
+}
+
+class SdLogFileTest : public ::testing::Test {
+protected:
+	void SetUp() override {
+		format(FM_FAT);
+	}
+
+	void TearDown() override {
+		f_mount(nullptr, "", 0);
+	}
+
+	void format(BYTE type) {
+		disk.assign(sectorCount * sectorSize, 0);
+
+		BYTE work[FF_MAX_SS];
+		ASSERT_EQ(FR_OK, f_mkfs("", type, clusterSize, work, sizeof(work)));
+		ASSERT_EQ(FR_OK, f_mount(&m_fs, "", 1));
+
+		dataStart = m_fs.database;
+		setTimeNowUs(0);
+	}
+
+	// Every other 128k file of the first half of the card deleted, like a card that's seen some use
+	void fragment() {
+		std::vector<uint8_t> data(128 * 1024, 0x55);
+
+		for (int i = 0; i < 256; i++) {
+			char name[16];
+			snprintf(name, sizeof(name), "f%d.bin", i);
+
+			ASSERT_EQ(FR_OK, f_open(&m_fd, name, FA_CREATE_ALWAYS | FA_WRITE));
+			UINT written;
+			ASSERT_EQ(FR_OK, f_write(&m_fd, data.data(), data.size(), &written));
+			ASSERT_EQ(FR_OK, f_close(&m_fd));
+		}
+
+		for (int i = 0; i < 256; i += 2) {
+			char name[16];
+			snprintf(name, sizeof(name), "f%d.bin", i);
+			ASSERT_EQ(FR_OK, f_unlink(name));
+		}
+	}
+
+	DWORD freeClusters() {
+		DWORD count;
+		FATFS* fs;
+		EXPECT_EQ(FR_OK, f_getfree("", &count, &fs));
+		return count;
+	}
+
+	// Logs in blocks the size the SD logger uses, syncing once a second like it does
+	void writeLog(SdLogFile& dut, size_t size, int* metadataWritesDuringWrites = nullptr) {
+		uint8_t block[1024];
+
+		for (size_t offset = 0; offset < size; offset += sizeof(block)) {
+			for (size_t i = 0; i < sizeof(block); i++) {
+				block[i] = patternAt(offset + i);
+			}
+
+			int metadataBefore = metadataWrites;
+			ASSERT_EQ(FR_OK, dut.write(block, sizeof(block)));
+
+			if (metadataWritesDuringWrites) {
+				*metadataWritesDuringWrites += metadataWrites - metadataBefore;
+			}
+
+			if (dut.needsSync(1)) {
+				ASSERT_EQ(FR_OK, dut.sync());
+			}
+		}
+	}
+
+	void checkLog(const char* name, size_t size) {
+		ASSERT_EQ(FR_OK, f_open(&m_fd, name, FA_READ));
+		EXPECT_EQ(size, f_size(&m_fd));
+
+		std::vector<uint8_t> data(size);
+		UINT bytesRead;
+		ASSERT_EQ(FR_OK, f_read(&m_fd, data.data(), size, &bytesRead));
+		ASSERT_EQ(size, bytesRead);
+		f_close(&m_fd);
+
+		for (size_t i = 0; i < size; i++) {
+			ASSERT_EQ(patternAt(i), data[i]) << i;
+		}
+	}
+
+	FATFS m_fs;
+	FIL m_fd;
+};
+
+TEST_F(SdLogFileTest, Preallocated) {
+	DWORD freeBefore = freeClusters();
+
+	SdLogFile dut;
+	ASSERT_EQ(FR_OK, dut.open(&m_fd, "log.mlg", 16 * 1024 * 1024));
+	EXPECT_EQ(16u * 1024 * 1024, dut.getPreallocated());
+	EXPECT_EQ(freeBefore - 16 * 1024 * 1024 / clusterSize, freeClusters());
+
+	// The file is only as long as what's been written
+	EXPECT_EQ(0u, f_size(&m_fd));
+
+	int metadataWritesDuringWrites = 0;
+	writeLog(dut, 1024 * 1024, &metadataWritesDuringWrites);
+	EXPECT_EQ(0, metadataWritesDuringWrites);
+
+	// Readable without closing
+	ASSERT_EQ(FR_OK, dut.sync());
+	FIL reader;
+	ASSERT_EQ(FR_OK, f_open(&reader, "log.mlg", FA_READ));
+	EXPECT_EQ(1024u * 1024, f_size(&reader));
+	f_close(&reader);
+
+	// What wasn't used is given back
+	ASSERT_EQ(FR_OK, dut.close());
+	EXPECT_EQ(freeBefore - 1024 * 1024 / clusterSize, freeClusters());
+
+	checkLog("log.mlg", 1024 * 1024);
+}
+
+TEST_F(SdLogFileTest, GrowsPastPreallocation) {
+	SdLogFile dut;
+	ASSERT_EQ(FR_OK, dut.open(&m_fd, "log.mlg", SD_LOG_PREALLOCATE_MIN));
+	EXPECT_EQ((uint32_t)SD_LOG_PREALLOCATE_MIN, dut.getPreallocated());
+
+	writeLog(dut, SD_LOG_PREALLOCATE_MIN + 100 * 1024);
+	ASSERT_EQ(FR_OK, dut.close());
+
+	checkLog("log.mlg", SD_LOG_PREALLOCATE_MIN + 100 * 1024);
+}
+
+TEST_F(SdLogFileTest, HalvesUntilItFits) {
+	fragment();
+
+	// Only the second half of the card is contiguous
+	SdLogFile first;
+	ASSERT_EQ(FR_OK, first.open(&m_fd, "log.mlg", 64 * 1024 * 1024));
+	EXPECT_EQ(16u * 1024 * 1024, first.getPreallocated());
+
+	// ...and now not even that
+	FIL secondFd;
+	SdLogFile second;
+	ASSERT_EQ(FR_OK, second.open(&secondFd, "log2.mlg", 64 * 1024 * 1024));
+	EXPECT_EQ(8u * 1024 * 1024, second.getPreallocated());
+	ASSERT_EQ(FR_OK, second.close());
+
+	// Not worth it, the file still works
+	ASSERT_EQ(FR_OK, second.open(&secondFd, "log3.mlg", SD_LOG_PREALLOCATE_MIN / 2));
+	EXPECT_EQ(0u, second.getPreallocated());
+	writeLog(second, 64 * 1024);
+	ASSERT_EQ(FR_OK, second.close());
+	ASSERT_EQ(FR_OK, first.close());
+
+	checkLog("log3.mlg", 64 * 1024);
+}
+
+TEST_F(SdLogFileTest, ReleaseAfterPowerLoss) {
+	DWORD freeBefore = freeClusters();
+
+	{
+		SdLogFile dut;
+		ASSERT_EQ(FR_OK, dut.open(&m_fd, "log.mlg", 8 * 1024 * 1024));
+
+		writeLog(dut, 256 * 1024);
+		ASSERT_EQ(FR_OK, dut.sync());
+
+		// Power cut: a few more blocks that never got synced, and the file isn't closed
+		writeLog(dut, 8 * 1024);
+	}
+
+	f_mount(nullptr, "", 0);
+	ASSERT_EQ(FR_OK, f_mount(&m_fs, "", 1));
+	EXPECT_EQ(freeBefore - 8 * 1024 * 1024 / clusterSize, freeClusters());
+
+	ASSERT_EQ(FR_OK, releasePreallocation(&m_fd, "log.mlg"));
+	EXPECT_EQ(freeBefore - 256 * 1024 / clusterSize, freeClusters());
+	checkLog("log.mlg", 256 * 1024);
+
+	// Nothing more to give back
+	ASSERT_EQ(FR_OK, releasePreallocation(&m_fd, "log.mlg"));
+	EXPECT_EQ(freeBefore - 256 * 1024 / clusterSize, freeClusters());
+	checkLog("log.mlg", 256 * 1024);
+
+	EXPECT_EQ(FR_NO_FILE, releasePreallocation(&m_fd, "missing.mlg"));
+}
+
+TEST_F(SdLogFileTest, ExFat) {
+	format(FM_EXFAT);
+	DWORD freeBefore = freeClusters();
+
+	// Only reserved
+	SdLogFile dut;
+	ASSERT_EQ(FR_OK, dut.open(&m_fd, "log.mlg", 16 * 1024 * 1024));
+	EXPECT_EQ(0u, dut.getPreallocated());
+	EXPECT_EQ(freeBefore, freeClusters());
+
+	writeLog(dut, 1024 * 1024);
+	ASSERT_EQ(FR_OK, dut.close());
+
+	EXPECT_EQ(freeBefore - 1024 * 1024 / clusterSize, freeClusters());
+	checkLog("log.mlg", 1024 * 1024);
+}
+
+struct LogRun {
+	float simulatedMbPerSec;
+	int metadataWrites;
+	SdLogFileStats stats;
+};
+
+TEST_F(SdLogFileTest, Throughput) {
+	constexpr size_t logSize = 8 * 1024 * 1024;
+
+	fragment();
+
+	auto run = [&](const char* name, uint32_t preallocate) {
+		LogRun result = {};
+
+		SdLogFile dut;
+		EXPECT_EQ(FR_OK, dut.open(&m_fd, name, preallocate));
+
+		efitick_t start = getTimeNowNt();
+		writeLog(dut, logSize, &result.metadataWrites);
+		float simulatedSec = NT2USF(getTimeNowNt() - start) / 1e6;
+		result.simulatedMbPerSec = logSize / simulatedSec / 1e6;
+		result.stats = dut.getStats();
+
+		EXPECT_EQ(FR_OK, dut.close());
+		checkLog(name, logSize);
+
+		return result;
+	};
+
+	// Fills the holes left in the first half
+	LogRun growing = run("grow.mlg", 0);
+	// Lands in the second half, in one piece
+	LogRun preallocated = run("pre.mlg", 16 * 1024 * 1024);
+
+	EXPECT_GT(growing.metadataWrites, 0);
+	EXPECT_EQ(0, preallocated.metadataWrites);
+
+	EXPECT_LT(preallocated.stats.writeTimeMaxUs, growing.stats.writeTimeMaxUs);
+	EXPECT_GT(preallocated.simulatedMbPerSec, growing.simulatedMbPerSec);
+	EXPECT_EQ(0u, preallocated.stats.slowWriteCount);
+}
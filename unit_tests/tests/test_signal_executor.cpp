@@ -8,6 +8,9 @@
 #include "pch.h"
 
 #include "event_queue.h"
+#include "event_latency.h"
+
+#include <chrono>
 
 static int callbackCounter = 0;
 
@@ -99,9 +102,9 @@ TEST(EventQueue, complex) {
 
 	ASSERT_EQ(4, eq.size());
 	ASSERT_EQ(10, eq.getHead()->momentX);
-	ASSERT_EQ(10, eq.getHead()->next->momentX);
-	ASSERT_EQ(11, eq.getHead()->next->next->momentX);
-	ASSERT_EQ(12, eq.getHead()->next->next->next->momentX);
+	ASSERT_EQ(10, eq.getElementAtIndexForUnitText(1)->momentX);
+	ASSERT_EQ(11, eq.getElementAtIndexForUnitText(2)->momentX);
+	ASSERT_EQ(12, eq.getElementAtIndexForUnitText(3)->momentX);
 
 	callbackCounter = 0;
 	eq.executeAll(10);
@@ -215,3 +218,126 @@ TEST_F(EventQueueRemoveTest, removeNotPresent) {
 	ASSERT_EQ(&s3, dut.getElementAtIndexForUnitText(2));
 	ASSERT_EQ(nullptr, dut.getElementAtIndexForUnitText(3));
 }
+
+TEST(EventQueue, sameTimeIsFifo) {
+	EventQueue eq;
+	scheduling_s s[8];
+
+	for (size_t i = 0; i < efi::size(s); i++) {
+		eq.insertTask(&s[i], 50, { orderCallback, (void*)(i + 1) });
+	}
+
+	prevValue = 0;
+	eq.executeAll(100);
+	ASSERT_EQ(0, eq.size());
+}
+
+TEST(EventQueue, removeKeepsOrder) {
+	EventQueue eq;
+	scheduling_s s[32];
+
+	// Insert in a scrambled order
+	for (size_t i = 0; i < efi::size(s); i++) {
+		eq.insertTask(&s[i], (i * 7) % efi::size(s), callback);
+	}
+
+	// Cancel every third element
+	for (size_t i = 0; i < efi::size(s); i += 3) {
+		eq.remove(&s[i]);
+	}
+
+	efitick_t prev = 0;
+	for (int i = 0; i < eq.size(); i++) {
+		efitick_t cur = eq.getElementAtIndexForUnitText(i)->momentX;
+		EXPECT_LE(prev, cur);
+		prev = cur;
+	}
+
+	int expectedLeft = eq.size();
+	callbackCounter = 0;
+	eq.executeAll(1000);
+	EXPECT_EQ(expectedLeft, callbackCounter);
+	EXPECT_EQ(0, eq.size());
+}
+
+/**
+ * Not a pass/fail test: prints the cost of insert and execute as the queue gets deeper.
+ * With the heap this should grow logarithmically, not linearly.
+ */
+TEST(EventQueue, benchmarkInsertExecuteVsDepth) {
+	constexpr int iterations = 20000;
+	static scheduling_s background[EVENT_QUEUE_CAPACITY];
+	scheduling_s probe;
+
+	for (int depth : { 0, 4, 16, 32, 64, 128 }) {
+		EventQueue eq;
+
+		// Park 'depth' events far in the future, spread out so the probe lands in the middle
+		for (int i = 0; i < depth; i++) {
+			eq.insertTask(&background[i], 1'000'000 + 2 * i, callback);
+		}
+
+		auto start = std::chrono::steady_clock::now();
+
+		for (int i = 0; i < iterations; i++) {
+			eq.insertTask(&probe, 1'000'000 + depth, callback);
+			eq.remove(&probe);
+		}
+
+		auto mid = std::chrono::steady_clock::now();
+
+		for (int i = 0; i < iterations; i++) {
+			// scheduled at zero so executeOne never has to spin-wait on mocked time
+			eq.insertTask(&probe, 0, callback);
+			eq.executeOne(0);
+		}
+
+		auto end = std::chrono::steady_clock::now();
+
+		ASSERT_EQ(depth, eq.size());
+		eq.clear();
+
+		auto insertNs = std::chrono::duration_cast<std::chrono::nanoseconds>(mid - start).count() / iterations;
+		auto executeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - mid).count() / iterations;
+		printf("EventQueue depth=%3d insert+cancel=%4dns insert+execute=%4dns\n", depth, (int)insertNs, (int)executeNs);
+	}
+}
+
+TEST(EventLatency, buckets) {
+	EXPECT_EQ(0, getEventLatencyBucket(0));
+	EXPECT_EQ(1, getEventLatencyBucket(1));
+	EXPECT_EQ(2, getEventLatencyBucket(2));
+	EXPECT_EQ(2, getEventLatencyBucket(3));
+	EXPECT_EQ(3, getEventLatencyBucket(4));
+	EXPECT_EQ(6, getEventLatencyBucket(63));
+	EXPECT_EQ(7, getEventLatencyBucket(64));
+	EXPECT_EQ(7, getEventLatencyBucket(1'000'000));
+}
+
+TEST(EventLatency, recordedByQueue) {
+	auto& tracker = getEventLatencyTracker();
+	tracker.reset();
+
+	EventQueue eq;
+	scheduling_s s1, s2;
+
+	// We're running at 1000us, the injector was meant to open 10us ago, the other one 40us ago
+	setTimeNowUs(1000);
+	eq.insertTask(&s1, US2NT(990).count(), { startInjection, InjectorContext{} });
+	eq.insertTask(&s2, US2NT(960).count(), callback);
+	eq.executeAll(getTimeNowNt());
+
+	auto& injector = tracker.get(EventLatencyType::InjectorOpen);
+	EXPECT_EQ(1u, injector.total);
+	EXPECT_EQ(10u, injector.maxUs);
+	EXPECT_EQ(1u, injector.counts[getEventLatencyBucket(10)]);
+
+	auto& other = tracker.get(EventLatencyType::Other);
+	EXPECT_EQ(1u, other.total);
+	EXPECT_EQ(40u, other.maxUs);
+
+	EXPECT_EQ(0u, tracker.get(EventLatencyType::SparkFire).total);
+
+	tracker.reset();
+	EXPECT_EQ(0u, tracker.get(EventLatencyType::InjectorOpen).total);
+}
@@ -0,0 +1,243 @@
+#include "pch.h"
+
+#include "ts_output_stream.h"
+#include "tunerstudio.h"
+#include "live_data.h"
+
+#include <optional>
+#include <random>
+
+/**
+ * Reference implementation of the host side of the output channel stream, see ts_output_stream.h
+ */
+template <size_t TSize>
+class OutputStreamDecoder {
+	using Encoder = OutputChannelDeltaEncoder<TSize>;
+
+public:
+	// Returns false if the frame is relative to a state we don't have, host has to ask for a resync
+	bool decode(const uint8_t* frame, size_t size) {
+		uint16_t sequence;
+		uint16_t baseSequence;
+		memcpy(&sequence, frame, sizeof(sequence));
+		memcpy(&baseSequence, frame + 2, sizeof(baseSequence));
+		uint8_t flags = frame[4];
+
+		ack.reset();
+
+		if (baseSequence == TS_OUTPUT_STREAM_NO_BASE) {
+			EXPECT_EQ(size, Encoder::maxFrameSize);
+			memcpy(current, frame + Encoder::headerSize, sizeof(current));
+		} else {
+			if (m_hasAcked && baseSequence == m_ackedSequence) {
+				// ECU got our ack and moved its base
+				memcpy(m_base, m_acked, sizeof(m_base));
+				m_baseSequence = m_ackedSequence;
+				m_hasBase = true;
+				m_hasAcked = false;
+			}
+
+			if (!m_hasBase || baseSequence != m_baseSequence) {
+				return false;
+			}
+
+			memcpy(current, m_base, sizeof(current));
+
+			const uint8_t* bitmap = frame + Encoder::headerSize;
+			const uint8_t* payload = bitmap + Encoder::bitmapSize;
+
+			for (size_t i = 0; i < Encoder::wordCount; i++) {
+				if (bitmap[i / 8] & (1 << (i % 8))) {
+					memcpy(current + 4 * i, payload, 4);
+					payload += 4;
+				}
+			}
+
+			EXPECT_EQ(size, payload - frame);
+		}
+
+		if (flags & TS_OUTPUT_STREAM_ACK_REQUEST) {
+			memcpy(m_acked, current, sizeof(m_acked));
+			m_ackedSequence = sequence;
+			m_hasAcked = true;
+			ack = sequence;
+		}
+
+		return true;
+	}
+
+	void reset() {
+		m_hasBase = false;
+		m_hasAcked = false;
+	}
+
+	uint8_t current[4 * Encoder::wordCount];
+	// Sequence the host should acknowledge after the last decode
+	std::optional<uint16_t> ack;
+
+private:
+	uint8_t m_base[4 * Encoder::wordCount];
+	uint16_t m_baseSequence = 0;
+	bool m_hasBase = false;
+
+	uint8_t m_acked[4 * Encoder::wordCount];
+	uint16_t m_ackedSequence = 0;
+	bool m_hasAcked = false;
+};
+
+using TestEncoder = OutputChannelDeltaEncoder<40>;
+
+TEST(OutputChannelStream, fullFrameUntilAcked) {
+	TestEncoder encoder;
+	OutputStreamDecoder<40> decoder;
+
+	uint8_t data[40] = { 1, 2, 3 };
+	uint8_t frame[TestEncoder::maxFrameSize];
+
+	// Nothing acknowledged yet, full frames only
+	for (int i = 0; i < 3; i++) {
+		EXPECT_EQ(TestEncoder::maxFrameSize, encoder.encode(data, frame));
+		ASSERT_TRUE(decoder.decode(frame, TestEncoder::maxFrameSize));
+		EXPECT_EQ(0, memcmp(data, decoder.current, sizeof(data)));
+	}
+
+	// Only the first frame was flagged for ack
+	EXPECT_FALSE(decoder.ack.has_value());
+	encoder.acknowledge(0);
+
+	// Nothing changed: header and bitmap only
+	size_t size = encoder.encode(data, frame);
+	EXPECT_EQ(TestEncoder::headerSize + TestEncoder::bitmapSize, size);
+	ASSERT_TRUE(decoder.decode(frame, size));
+
+	// One word changed
+	data[21] = 50;
+	size = encoder.encode(data, frame);
+	EXPECT_EQ(TestEncoder::headerSize + TestEncoder::bitmapSize + 4, size);
+	ASSERT_TRUE(decoder.decode(frame, size));
+	EXPECT_EQ(0, memcmp(data, decoder.current, sizeof(data)));
+}
+
+TEST(OutputChannelStream, staleAckIgnored) {
+	TestEncoder encoder;
+	uint8_t data[40] = {};
+	uint8_t frame[TestEncoder::maxFrameSize];
+
+	encoder.encode(data, frame);
+	encoder.encode(data, frame);
+
+	// Frame 1 was never flagged, its ack means nothing
+	encoder.acknowledge(1);
+	EXPECT_EQ(TestEncoder::maxFrameSize, encoder.encode(data, frame));
+}
+
+TEST(OutputChannelStream, resync) {
+	TestEncoder encoder;
+	OutputStreamDecoder<40> decoder;
+	uint8_t data[40] = {};
+	uint8_t frame[TestEncoder::maxFrameSize];
+
+	decoder.decode(frame, encoder.encode(data, frame));
+	encoder.acknowledge(*decoder.ack);
+
+	// Host restarted and lost its state
+	decoder.reset();
+	size_t size = encoder.encode(data, frame);
+	EXPECT_FALSE(decoder.decode(frame, size));
+
+	encoder.resync();
+	size = encoder.encode(data, frame);
+	EXPECT_EQ(TestEncoder::maxFrameSize, size);
+	EXPECT_TRUE(decoder.decode(frame, size));
+}
+
+TEST(OutputChannelStream, lossyLink) {
+	OutputChannelDeltaEncoder<1000> encoder;
+	OutputStreamDecoder<1000> decoder;
+
+	uint8_t data[1000] = {};
+	uint8_t frame[OutputChannelDeltaEncoder<1000>::maxFrameSize];
+
+	std::mt19937 rand(12345);
+
+	int resyncs = 0;
+
+	for (int i = 0; i < 5000; i++) {
+		// A handful of channels change every frame
+		for (int j = rand() % 10; j > 0; j--) {
+			data[rand() % sizeof(data)] = rand();
+		}
+
+		size_t size = encoder.encode(data, frame);
+
+		// 10% of frames and 10% of acks get lost
+		if (rand() % 10 == 0) {
+			continue;
+		}
+
+		if (!decoder.decode(frame, size)) {
+			resyncs++;
+			encoder.resync();
+			continue;
+		}
+
+		ASSERT_EQ(0, memcmp(data, decoder.current, sizeof(data))) << "frame " << i;
+
+		if (decoder.ack && rand() % 10 != 0) {
+			encoder.acknowledge(*decoder.ack);
+		}
+	}
+
+	// Lost frames and acks never need a resync, the host keeps everything it can still be sent deltas against
+	EXPECT_EQ(0, resyncs);
+}
+
+TEST(OutputChannelStream, bandwidthVsPolling) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+
+	using Encoder = OutputChannelDeltaEncoder<TS_TOTAL_OUTPUT_SIZE>;
+	static uint8_t snapshot[4 * Encoder::wordCount];
+	static uint8_t frame[Encoder::maxFrameSize];
+
+	Encoder encoder;
+	OutputStreamDecoder<TS_TOTAL_OUTPUT_SIZE> decoder;
+
+	// 2 byte size, 1 byte command/response code, 4 byte crc
+	constexpr size_t packetOverhead = 7;
+	// 'O' with offset and count
+	constexpr size_t pollRequest = packetOverhead + 4;
+	// 'o', TS_OUTPUT_STREAM_ACK, sequence
+	constexpr size_t ackRequest = packetOverhead + 3;
+
+	size_t polledBytes = 0;
+	size_t streamedBytes = 0;
+	constexpr int frames = 200;
+
+	for (int i = 0; i < frames; i++) {
+		// Engine running at 20ms per frame, a slowly moving throttle
+		Sensor::setMockValue(SensorType::Tps1, 10 + i * 0.2f);
+		Sensor::setMockValue(SensorType::Map, 40 + i * 0.1f);
+		eth.fireTriggerEvents2(2, 10);
+
+		updateTunerStudioState();
+		copyRange(snapshot, getLiveDataFragments(), 0, TS_TOTAL_OUTPUT_SIZE);
+
+		polledBytes += pollRequest + packetOverhead + TS_TOTAL_OUTPUT_SIZE;
+
+		size_t size = encoder.encode(snapshot, frame);
+		streamedBytes += packetOverhead + size;
+
+		ASSERT_TRUE(decoder.decode(frame, size));
+		ASSERT_EQ(0, memcmp(snapshot, decoder.current, TS_TOTAL_OUTPUT_SIZE));
+
+		if (decoder.ack) {
+			encoder.acknowledge(*decoder.ack);
+			streamedBytes += ackRequest;
+		}
+	}
+
+	printf("Output channels, %d frames of %d bytes: polled %d bytes, streamed %d bytes (%.1f%%)\n",
+		frames, TS_TOTAL_OUTPUT_SIZE, (int)polledBytes, (int)streamedBytes, 100.0f * streamedBytes / polledBytes);
+
+	EXPECT_LT(streamedBytes, polledBytes / 2);
+}
@@ -78,3 +78,29 @@ TEST(TunerstudioCommands, writeChunkEngineConfig) {
 
 	EXPECT_EQ(configBytes[100], 50);
 }
+
+TEST(TunerstudioCommands, writeChunkAxisBinsApplyLive) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+	::testing::NiceMock<MockTsChannel> channel;
+
+	for (size_t row = 0; row < FUEL_LOAD_COUNT; row++) {
+		for (size_t col = 0; col < FUEL_RPM_COUNT; col++) {
+			config->lambdaTable[row][col] = 0.7f + 0.02f * col;
+		}
+	}
+
+	float before = engine->fuelComputer.getTargetLambda(3000, 50);
+
+	// Twice the rpm on every bin moves 3000rpm down the table, without a burn
+	uint16_t rpmBins[FUEL_RPM_COUNT];
+	for (size_t i = 0; i < FUEL_RPM_COUNT; i++) {
+		rpmBins[i] = config->lambdaRpmBins[i] * 2;
+	}
+
+	TunerStudio instance;
+	instance.handleWriteChunkCommand(&channel, offsetof(persistent_config_s, lambdaRpmBins), sizeof(rpmBins), rpmBins);
+
+	float after = engine->fuelComputer.getTargetLambda(3000, 50);
+	EXPECT_LT(after, before);
+	EXPECT_NEAR(interpolate3d(config->lambdaTable, config->lambdaLoadBins, 50, config->lambdaRpmBins, 3000), after, 1e-4);
+}
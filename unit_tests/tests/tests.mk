@@ -21,6 +21,8 @@ TESTS_SRC_CPP = \
 	tests/trigger/test_real_k20.cpp \
 	tests/trigger/test_toyota_3_tooth_cam.cpp \
 	tests/trigger/test_real_noisy_trigger.cpp \
+	tests/trigger/test_trigger_replay.cpp \
+	tests/trigger/test_trigger_sync_kind.cpp \
 	tests/trigger/test_map_cam.cpp \
 	tests/trigger/test_rpm_multiplier.cpp \
 	tests/trigger/test_quad_cam.cpp \
@@ -35,6 +37,8 @@ TESTS_SRC_CPP = \
 	tests/ignition_injection/test_fuel_computer.cpp \
 	tests/ignition_injection/test_injector_model.cpp \
 	tests/ignition_injection/test_odd_firing_engine.cpp \
+	tests/ignition_injection/test_tooth_event_index.cpp \
+	tests/ignition_injection/test_trigger_scheduler.cpp \
 	tests/lua/test_lua_basic.cpp \
 	tests/lua/test_lookup.cpp \
 	tests/lua/test_lua_e38.cpp \
@@ -46,6 +50,8 @@ TESTS_SRC_CPP = \
 	tests/lua/test_lua_hooks.cpp \
 	tests/lua/test_lua_Leiderman_Khlystov.cpp \
 	tests/lua/test_can_filter.cpp \
+	tests/lua/test_lua_allocator.cpp \
+	tests/lua/test_lua_tick_monitor.cpp \
 	tests/util/test_scaled_channel.cpp \
 	tests/util/test_timer.cpp \
 	tests/system/test_periodic_thread_controller.cpp \
@@ -63,16 +69,19 @@ TESTS_SRC_CPP = \
 	tests/ignition_injection/test_fuel_wall_wetting.cpp \
 	tests/test_one_cylinder_logic.cpp \
 	tests/test_tunerstudio.cpp \
+	tests/test_ts_output_stream.cpp \
 	tests/test_pwm_generator.cpp \
-	tests/test_log_buffer.cpp \
 	tests/test_signal_executor.cpp \
 	tests/test_cpp_memory_layout.cpp \
 	tests/test_pid.cpp \
 	tests/test_accel_enrichment.cpp \
 	tests/test_gpiochip.cpp \
+	tests/test_gpio_spi.cpp \
 	tests/test_deadband.cpp \
 	tests/test_knock.cpp \
+	tests/test_knock_dsp.cpp \
 	tests/test_lambda_monitor.cpp \
+	tests/test_module_dispatcher.cpp \
 	tests/sensor/basic_sensor.cpp \
 	tests/sensor/func_sensor.cpp \
 	tests/sensor/mock_sensor.cpp \
@@ -84,15 +93,21 @@ TESTS_SRC_CPP = \
 	tests/sensor/redundant.cpp \
 	tests/sensor/test_sensor_init.cpp \
 	tests/sensor/table_func.cpp \
+	tests/sensor/compiled_func.cpp \
+	tests/sensor/sensor_snapshot.cpp \
 	tests/util/test_closed_loop_controller.cpp \
 	tests/test_stft.cpp \
 	tests/test_hpfp.cpp \
 	tests/test_hpfp_integrated.cpp \
 	tests/test_fuel_math.cpp \
 	tests/test_binary_log.cpp \
+	tests/test_capture_log.cpp \
+	tests/test_sd_log_file.cpp \
+	tests/test_engine_sniffer.cpp \
 	tests/test_gpio.cpp \
 	tests/test_limp.cpp \
 	tests/test_can_rx.cpp \
+	tests/test_can_dash.cpp \
 	tests/test_can_serial.cpp \
 	tests/test_can_wideband.cpp \
 	tests/test_hellen_board_id.cpp \
@@ -0,0 +1,243 @@
+/*
+ * @file test_trigger_replay.cpp
+ *
+ * Trigger decoder speed over the recorded captures in tests/trigger/resources.
+ *
+ * Each capture is parsed once, then replayed straight into TriggerDecoderBase::decodeTriggerEvent, with
+ * the sync point check TriggerCentral picked for the wheel, and into TriggerCentral::handleShaftSignal
+ * with everything the engine hangs off it, for at least REPLAY_MIN_MEASURE_US each.
+ * Numbers are ns per crank edge.
+ *
+ * Disabled in the default run, it takes a while and only means something in a build without
+ * sanitizers: fome_test --gtest_also_run_disabled_tests --gtest_filter=TriggerReplay.DISABLED_Benchmark
+ *
+ * Add --replay-baseline=update to record tests/trigger/resources/trigger_replay_baseline.txt,
+ * or --replay-baseline=check to fail when a capture got more than REPLAY_TOLERANCE slower.
+ * A baseline is only meaningful on the machine and build (no sanitizers!) it was recorded with.
+ */
+
+#include "pch.h"
+#include "trigger_replay.h"
+
+#include <chrono>
+#include <climits>
+#include <map>
+
+#define REPLAY_BASELINE_FILE "tests/trigger/resources/trigger_replay_baseline.txt"
+#define REPLAY_MIN_MEASURE_US 50000
+#define REPLAY_TOLERANCE 0.25
+// Between two passes of the same capture, so the decoder sees the engine stop
+#define REPLAY_PASS_GAP_US 2'000'000
+
+TEST(TriggerReplay, MatchesCsvReader) {
+	// Same as realCrankingNB2.normalCranking
+	TriggerReplay replay;
+	ASSERT_TRUE(replay.load("tests/trigger/resources/nb2-cranking-good.csv", 1, /* vvtCount */ 1));
+
+	EngineTestHelper eth(engine_type_e::HELLEN_NB2);
+	engineConfiguration->alwaysInstantRpm = true;
+
+	replay.replay(eth);
+
+	EXPECT_NEAR(engine->triggerCentral.getVVTPosition(0, 0).value_or(0), 11.2627f, 1e-4);
+	EXPECT_EQ(engine->triggerCentral.triggerState.m_camResyncCounter, 1);
+	ASSERT_EQ(876, round(Sensor::getOrZero(SensorType::Rpm)));
+	EXPECT_EQ(0, eth.recentWarnings()->getCount());
+}
+
+TEST(TriggerReplay, TimeOnlyLines) {
+	// The cam column isn't replayed here, so most lines don't change anything
+	TriggerReplay replay;
+	ASSERT_TRUE(replay.load("tests/trigger/resources/4g93-cranking-cam-only.csv", 1, /* vvtCount */ 0));
+
+	int lines = 0;
+	for (const auto& edge : replay.getEdges()) {
+		if (edge.startsLine) {
+			lines++;
+		}
+	}
+
+	// One per line of the file, header excluded
+	EXPECT_EQ(193, lines);
+	EXPECT_EQ(193u, replay.getEdges().size());
+}
+
+namespace {
+struct ReplayCapture {
+	const char* name;
+	const char* fileName;
+	engine_type_e engineType;
+	// Or what the engine type comes with
+	bool setTriggerType;
+	trigger_type_e triggerType;
+	size_t triggerCount;
+	const int* triggerColumns;
+};
+
+struct ReplayResult {
+	double decoderNs;
+	double centralNs;
+};
+}
+
+static const ReplayCapture replayCaptures[] = {
+	{ "4b11", "4b11-running.csv", engine_type_e::TEST_ENGINE, true, trigger_type_e::TT_36_2_1, 1, NORMAL_ORDER },
+	{ "vw_aba", "nick_1.csv", engine_type_e::VW_ABA, true, trigger_type_e::TT_60_2_VW, 1, NORMAL_ORDER },
+	{ "gm_24x", "gm_24x_cranking.csv", engine_type_e::TEST_ENGINE, true, trigger_type_e::TT_GM_24x, 1, NORMAL_ORDER },
+	{ "k24a2", "cranking_honda_k24a2_no_plugs.csv", engine_type_e::TEST_ENGINE, true, trigger_type_e::TT_HONDA_K_CRANK_12_1, 1, NORMAL_ORDER },
+	{ "cas_24_plus_1", "cas_nissan_24_plus_1.csv", engine_type_e::TEST_ENGINE, true, trigger_type_e::TT_12_TOOTH_CRANK, 1, NORMAL_ORDER },
+	{ "miata_na", "cranking_na_3.csv", engine_type_e::FRANKENSO_MIATA_NA6_MAP, false, trigger_type_e::TT_TOOTHED_WHEEL, 2, REVERSE_ORDER },
+	{ "miata_nb2", "nb2-cranking-good.csv", engine_type_e::HELLEN_NB2, false, trigger_type_e::TT_TOOTHED_WHEEL, 1, NORMAL_ORDER },
+};
+
+static int64_t nowNs() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Runs passes until enough time was measured, each pass returns how long its edges took
+template <typename TPass>
+static double measureNsPerEdge(int maxPasses, size_t edgesPerPass, TPass pass) {
+	int64_t totalNs = 0;
+	int passes = 0;
+
+	while (passes < maxPasses && totalNs < REPLAY_MIN_MEASURE_US * 1000LL) {
+		totalNs += pass(passes);
+		passes++;
+	}
+
+	return (double)totalNs / (passes * edgesPerPass);
+}
+
+static ReplayResult measureCapture(const ReplayCapture& capture, const TriggerReplay& replay) {
+	EngineTestHelper eth(capture.engineType);
+
+	if (capture.setTriggerType) {
+		eth.setTriggerType(capture.triggerType);
+	}
+
+	auto& central = engine->triggerCentral;
+	const auto& shape = central.triggerShape;
+
+	ReplayResult result;
+
+	// Decoder alone: a fresh one per pass, so the same timestamps can be used again
+	auto decoderEvents = replay.getCrankEvents(shape, REPLAY_PASS_GAP_US);
+	EXPECT_FALSE(decoderEvents.empty()) << capture.name;
+
+	if (decoderEvents.empty()) {
+		return { 0, 0 };
+	}
+
+	printf("Trigger replay %s, %s, %d crank edges\n",
+		capture.name, getTrigger_type_e(engineConfiguration->trigger.type), (int)decoderEvents.size());
+
+	result.decoderNs = measureNsPerEdge(INT_MAX, decoderEvents.size(), [&](int) {
+		TriggerDecoderBase decoder("replay");
+
+		int64_t start = nowNs();
+		for (const auto& event : decoderEvents) {
+			(void)decoder.decodeTriggerEvent(central.getSyncKind(), "replay", shape, nullptr, central.primaryTriggerConfiguration, event.signal, event.nowNt);
+		}
+		return nowNs() - start;
+	});
+
+	// The whole engine: time has to keep moving forward from one pass to the next
+	int passUs = replay.getDurationUs() + REPLAY_PASS_GAP_US;
+	int maxPasses = (INT_MAX - REPLAY_PASS_GAP_US) / passUs;
+
+	result.centralNs = measureNsPerEdge(maxPasses, decoderEvents.size(), [&](int pass) {
+		auto events = replay.getCrankEvents(shape, REPLAY_PASS_GAP_US + pass * passUs);
+
+		int64_t start = nowNs();
+		for (const auto& event : events) {
+			setTimeNowUs(event.timeUs);
+			central.handleShaftSignal(event.signal, event.nowNt);
+		}
+		return nowNs() - start;
+	});
+
+	return result;
+}
+
+static std::map<std::string, ReplayResult> readBaseline() {
+	std::map<std::string, ReplayResult> baseline;
+
+	FILE* fp = fopen(REPLAY_BASELINE_FILE, "r");
+	if (!fp) {
+		return baseline;
+	}
+
+	char line[256];
+	while (fgets(line, sizeof(line), fp)) {
+		char name[64];
+		ReplayResult result;
+
+		if (line[0] != '#' && sscanf(line, "%63s %lf %lf", name, &result.decoderNs, &result.centralNs) == 3) {
+			baseline[name] = result;
+		}
+	}
+
+	fclose(fp);
+
+	return baseline;
+}
+
+static void writeBaseline(const std::map<std::string, ReplayResult>& results) {
+	FILE* fp = fopen(REPLAY_BASELINE_FILE, "w");
+	ASSERT_TRUE(fp != nullptr);
+
+	fprintf(fp, "# capture decoder_ns_per_edge central_ns_per_edge, see test_trigger_replay.cpp\n");
+	for (const auto& [name, result] : results) {
+		fprintf(fp, "%s %.1f %.1f\n", name.c_str(), result.decoderNs, result.centralNs);
+	}
+
+	fclose(fp);
+}
+
+static void checkAgainstBaseline(const char* name, const char* what, double measured, double baseline) {
+	double change = measured / baseline - 1;
+
+	printf("      %-8s %8.1f ns/edge, baseline %8.1f (%+.0f%%)\n", what, measured, baseline, 100 * change);
+
+	if (triggerReplayBaselineMode == TriggerReplayBaselineMode::Check) {
+		EXPECT_LE(change, REPLAY_TOLERANCE) << name << " " << what << " got slower";
+	}
+}
+
+TEST(TriggerReplay, DISABLED_Benchmark) {
+	auto baseline = readBaseline();
+
+	if (triggerReplayBaselineMode == TriggerReplayBaselineMode::Check) {
+		ASSERT_FALSE(baseline.empty()) << "No baseline in " REPLAY_BASELINE_FILE ", record one with --replay-baseline=update";
+	}
+
+	std::map<std::string, ReplayResult> results;
+
+	for (const auto& capture : replayCaptures) {
+		TriggerReplay replay;
+		std::string fileName = std::string("tests/trigger/resources/") + capture.fileName;
+		ASSERT_TRUE(replay.load(fileName.c_str(), capture.triggerCount, /* vvtCount */ 0, capture.triggerColumns)) << fileName;
+
+		ReplayResult result = measureCapture(capture, replay);
+		results[capture.name] = result;
+
+		auto it = baseline.find(capture.name);
+		if (it == baseline.end()) {
+			printf("      decoder  %8.1f ns/edge\n", result.decoderNs);
+			printf("      central  %8.1f ns/edge\n", result.centralNs);
+
+			if (triggerReplayBaselineMode == TriggerReplayBaselineMode::Check) {
+				ADD_FAILURE() << capture.name << " is not in the baseline";
+			}
+		} else {
+			checkAgainstBaseline(capture.name, "decoder", result.decoderNs, it->second.decoderNs);
+			checkAgainstBaseline(capture.name, "central", result.centralNs, it->second.centralNs);
+		}
+	}
+
+	if (triggerReplayBaselineMode == TriggerReplayBaselineMode::Update) {
+		writeBaseline(results);
+		printf("Trigger replay baseline written to %s\n", REPLAY_BASELINE_FILE);
+	}
+}
@@ -0,0 +1,204 @@
+/*
+ * @file test_trigger_sync_kind.cpp
+ *
+ * The wheels with a sync point check of their own have to decode exactly like the generic decoder.
+ */
+
+#include "pch.h"
+#include "trigger_replay.h"
+#include "trigger_emulator_algo.h"
+#include "trigger_simulator.h"
+
+TEST(TriggerSyncKind, PickedForCommonWheels) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+
+	auto expectKind = [&](trigger_type_e type, TriggerSyncKind kind) {
+		eth.setTriggerType(type);
+		EXPECT_EQ(kind, engine->triggerCentral.getSyncKind()) << getTrigger_type_e(type);
+	};
+
+	expectKind(trigger_type_e::TT_TOOTHED_WHEEL_60_2, TriggerSyncKind::ToothedWheel60_2);
+	expectKind(trigger_type_e::TT_TOOTHED_WHEEL_36_1, TriggerSyncKind::ToothedWheel36_1);
+	expectKind(trigger_type_e::TT_36_2_2_2, TriggerSyncKind::Subaru36_2_2_2);
+	expectKind(trigger_type_e::TT_GM_24x, TriggerSyncKind::Gm24x);
+	expectKind(trigger_type_e::TT_MIATA_VVT, TriggerSyncKind::MiataNb);
+
+	// Gaps of its own
+	expectKind(trigger_type_e::TT_TOOTHED_WHEEL_36_2, TriggerSyncKind::Generic);
+	expectKind(trigger_type_e::TT_GM_24x_2, TriggerSyncKind::Generic);
+
+	// A custom toothed wheel syncs exactly like the 60-2 one
+	engineConfiguration->trigger.customTotalToothCount = 60;
+	engineConfiguration->trigger.customSkippedToothCount = 2;
+	expectKind(trigger_type_e::TT_TOOTHED_WHEEL, TriggerSyncKind::ToothedWheel60_2);
+
+	// Overridden gaps are the user's, not the wheel's
+	engineConfiguration->overrideTriggerGaps = true;
+	engineConfiguration->gapTrackingLengthOverride = 1;
+	engineConfiguration->triggerGapOverrideFrom[0] = 1.5f;
+	engineConfiguration->triggerGapOverrideTo[0] = 4.0f;
+	expectKind(trigger_type_e::TT_TOOTHED_WHEEL_60_2, TriggerSyncKind::Generic);
+}
+
+TEST(TriggerSyncKind, ThresholdsAreExact) {
+	auto expectExact = [](const SyncGapRange& gap) {
+		EXPECT_EQ((double)gap.from, (double)gap.fromThreshold.num / (1ull << gap.fromThreshold.shift));
+		EXPECT_EQ((double)gap.to, (double)gap.toThreshold.num / (1ull << gap.toThreshold.shift));
+		EXPECT_LT(gap.fromThreshold.shift, 32);
+		EXPECT_LT(gap.toThreshold.shift, 32);
+	};
+
+	for (const auto& gap : TriggerSyncGaps<TriggerSyncKind::ToothedWheel60_2>::gaps) expectExact(gap);
+	for (const auto& gap : TriggerSyncGaps<TriggerSyncKind::ToothedWheel36_1>::gaps) expectExact(gap);
+	for (const auto& gap : TriggerSyncGaps<TriggerSyncKind::Subaru36_2_2_2>::gaps) expectExact(gap);
+	for (const auto& gap : TriggerSyncGaps<TriggerSyncKind::Gm24x>::gaps) expectExact(gap);
+	for (const auto& gap : TriggerSyncGaps<TriggerSyncKind::MiataNb>::gaps) expectExact(gap);
+
+	// 3 * 0.75 and 3 * 1.25
+	EXPECT_TRUE(isGapAbove(226, 100, toGapThreshold(2.25f)));
+	EXPECT_FALSE(isGapAbove(225, 100, toGapThreshold(2.25f)));
+	EXPECT_TRUE(isGapBelow(374, 100, toGapThreshold(3.75f)));
+	EXPECT_FALSE(isGapBelow(375, 100, toGapThreshold(3.75f)));
+}
+
+// Feeds the same edges to a generic and a specialized decoder, they have to agree on every one of them
+static void expectSameDecoding(const char* what, const std::vector<TriggerReplayCrankEvent>& events) {
+	auto& central = engine->triggerCentral;
+	const auto& shape = central.triggerShape;
+	TriggerSyncKind kind = central.getSyncKind();
+
+	TriggerDecoderBase generic("generic");
+	TriggerDecoderBase specialized("specialized");
+
+	int syncCount = 0;
+
+	for (size_t i = 0; i < events.size(); i++) {
+		const auto& event = events[i];
+
+		auto genericResult = generic.decodeTriggerEvent("generic", shape, nullptr, central.primaryTriggerConfiguration, event.signal, event.nowNt);
+		auto specializedResult = specialized.decodeTriggerEvent(kind, "specialized", shape, nullptr, central.primaryTriggerConfiguration, event.signal, event.nowNt);
+
+		ASSERT_EQ(genericResult.Valid, specializedResult.Valid) << what << " edge " << i;
+		if (genericResult.Valid) {
+			ASSERT_EQ(genericResult.Value.CurrentIndex, specializedResult.Value.CurrentIndex) << what << " edge " << i;
+			syncCount++;
+		}
+
+		ASSERT_EQ(generic.getShaftSynchronized(), specialized.getShaftSynchronized()) << what << " edge " << i;
+		ASSERT_EQ(generic.getCurrentIndex(), specialized.getCurrentIndex()) << what << " edge " << i;
+		ASSERT_EQ(generic.getCrankSynchronizationCounter(), specialized.getCrankSynchronizationCounter()) << what << " edge " << i;
+		ASSERT_EQ(generic.getTotalEventCounter(), specialized.getTotalEventCounter()) << what << " edge " << i;
+		ASSERT_EQ(generic.triggerErrorCounter, specialized.triggerErrorCounter) << what << " edge " << i;
+		ASSERT_EQ(generic.orderingErrorCounter, specialized.orderingErrorCounter) << what << " edge " << i;
+		ASSERT_EQ(0, memcmp(&generic.triggerSyncGapRatio, &specialized.triggerSyncGapRatio, sizeof(float))) << what << " edge " << i;
+	}
+
+	// Otherwise there was nothing to compare
+	EXPECT_GT(syncCount, 0) << what;
+}
+
+// The shape's own edges while the engine speeds up from cranking, with some jitter on every tooth
+static std::vector<TriggerReplayCrankEvent> simulateSpinUp(const TriggerWaveform& shape) {
+	std::vector<TriggerReplayCrankEvent> events;
+
+	constexpr TriggerEvent riseEvents[] = { TriggerEvent::PrimaryRising, TriggerEvent::SecondaryRising };
+	constexpr TriggerEvent fallEvents[] = { TriggerEvent::PrimaryFalling, TriggerEvent::SecondaryFalling };
+
+	uint32_t seed = 12345;
+	double timeUs = 1'000'000;
+	double cycleUs = 400'000;
+
+	for (int cycle = 0; cycle < 40; cycle++) {
+		float previousSwitch = 0;
+
+		for (size_t index = 0; index < shape.getSize(); index++) {
+			seed = seed * 1103515245 + 12345;
+			// +-5% on each tooth
+			double jitter = 1 + ((int)((seed >> 16) % 201) - 100) / 2000.0;
+
+			float switchTime = shape.wave.getSwitchTime(index);
+			timeUs += (switchTime - previousSwitch) * cycleUs * jitter;
+			previousSwitch = switchTime;
+
+			for (size_t j = 0; j < PWM_PHASE_MAX_WAVE_PER_PWM; j++) {
+				if (!needEvent(index, shape.wave, j)) {
+					continue;
+				}
+
+				bool isRising = shape.wave.getChannelState(j, index);
+				TriggerEvent signal = (isRising ? riseEvents : fallEvents)[j];
+
+				if (isUsefulSignal(signal, shape)) {
+					events.push_back({ signal, (int)timeUs, US2NT((int)timeUs).count() });
+				}
+			}
+		}
+
+		timeUs += (1 - previousSwitch) * cycleUs;
+		cycleUs = std::max(20'000.0, cycleUs * 0.9);
+	}
+
+	return events;
+}
+
+TEST(TriggerSyncKind, SameAsGenericOnSimulatedWheels) {
+	EngineTestHelper eth(engine_type_e::TEST_ENGINE);
+
+	const trigger_type_e types[] = {
+		trigger_type_e::TT_TOOTHED_WHEEL_60_2,
+		trigger_type_e::TT_TOOTHED_WHEEL_36_1,
+		trigger_type_e::TT_36_2_2_2,
+		trigger_type_e::TT_GM_24x,
+		trigger_type_e::TT_MIATA_VVT,
+	};
+
+	for (auto type : types) {
+		eth.setTriggerType(type);
+		ASSERT_NE(TriggerSyncKind::Generic, engine->triggerCentral.getSyncKind()) << getTrigger_type_e(type);
+
+		expectSameDecoding(getTrigger_type_e(type), simulateSpinUp(engine->triggerCentral.triggerShape));
+	}
+}
+
+/**
+ * Every recording in tests/trigger/resources of a wheel with a sync kind of its own. There are
+ * none of a 36-1 or a 36-2-2-2 wheel, SameAsGenericOnSimulatedWheels has to do for those.
+ */
+TEST(TriggerSyncKind, SameAsGenericOnRecordedCaptures) {
+	struct Capture {
+		const char* fileName;
+		engine_type_e engineType;
+		bool setTriggerType;
+		trigger_type_e triggerType;
+		TriggerSyncKind kind;
+	};
+
+	const Capture captures[] = {
+		{ "nick_1.csv", engine_type_e::VW_ABA, true, trigger_type_e::TT_60_2_VW, TriggerSyncKind::ToothedWheel60_2 },
+		{ "gm_24x_cranking.csv", engine_type_e::TEST_ENGINE, true, trigger_type_e::TT_GM_24x, TriggerSyncKind::Gm24x },
+		{ "nb2-cranking-good.csv", engine_type_e::HELLEN_NB2, false, trigger_type_e::TT_MIATA_VVT, TriggerSyncKind::MiataNb },
+		{ "nb2-cranking-good-missing-injector-1.csv", engine_type_e::HELLEN_NB2, false, trigger_type_e::TT_MIATA_VVT, TriggerSyncKind::MiataNb },
+		{ "nb2_rev-d-1.csv", engine_type_e::HELLEN_NB2, false, trigger_type_e::TT_MIATA_VVT, TriggerSyncKind::MiataNb },
+		{ "nb2_rev-d-2.csv", engine_type_e::HELLEN_NB2, false, trigger_type_e::TT_MIATA_VVT, TriggerSyncKind::MiataNb },
+		{ "nb2_rev-d-3.csv", engine_type_e::HELLEN_NB2, false, trigger_type_e::TT_MIATA_VVT, TriggerSyncKind::MiataNb },
+		{ "nb2_rev-d-4.csv", engine_type_e::HELLEN_NB2, false, trigger_type_e::TT_MIATA_VVT, TriggerSyncKind::MiataNb },
+	};
+
+	for (const auto& capture : captures) {
+		std::string fileName = std::string("tests/trigger/resources/") + capture.fileName;
+
+		TriggerReplay replay;
+		ASSERT_TRUE(replay.load(fileName.c_str(), /* triggerCount */ 1, /* vvtCount */ 0)) << fileName;
+
+		EngineTestHelper eth(capture.engineType);
+		if (capture.setTriggerType) {
+			eth.setTriggerType(capture.triggerType);
+		}
+
+		// Comparing the generic decoder with itself would prove nothing
+		ASSERT_NE(TriggerSyncKind::Generic, engine->triggerCentral.getSyncKind()) << capture.fileName;
+		ASSERT_EQ(capture.kind, engine->triggerCentral.getSyncKind()) << capture.fileName;
+
+		expectSameDecoding(capture.fileName, replay.getCrankEvents(engine->triggerCentral.triggerShape, 1'000'000));
+	}
+}
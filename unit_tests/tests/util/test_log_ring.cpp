@@ -0,0 +1,213 @@
+#include "pch.h"
+
+#include "log_ring.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+template <size_t TSize>
+static void writeLine(LogRing<TSize>& ring, const char* line) {
+	size_t length = strlen(line);
+
+	LogRingClaim claim;
+	char* buffer = ring.claim(claim, length);
+	ASSERT_NE(buffer, nullptr);
+
+	memcpy(buffer, line, length + 1);
+	ring.commit(claim, length);
+}
+
+template <size_t TSize>
+static std::string readAll(LogRing<TSize>& ring, size_t maxLength = 1000) {
+	LogSpan spans[32];
+	size_t count = ring.peek(spans, efi::size(spans), maxLength);
+
+	std::string result;
+	for (size_t i = 0; i < count; i++) {
+		result.append(spans[i].data, spans[i].length);
+		result += '|';
+	}
+
+	ring.release();
+
+	return result;
+}
+
+TEST(LogRing, Empty) {
+	LogRing<256> dut;
+
+	LogSpan spans[4];
+	EXPECT_EQ(0u, dut.peek(spans, efi::size(spans), 1000));
+	EXPECT_EQ(0u, dut.getUsed());
+}
+
+TEST(LogRing, WriteRead) {
+	LogRing<256> dut;
+
+	writeLine(dut, "first");
+	writeLine(dut, "second");
+
+	// Unused room was given back
+	EXPECT_EQ(2u * 12, dut.getUsed());
+
+	EXPECT_EQ("first|second|", readAll(dut));
+	EXPECT_EQ(0u, dut.getUsed());
+	EXPECT_EQ("", readAll(dut));
+}
+
+TEST(LogRing, UncommittedHoldsLaterLines) {
+	LogRing<256> dut;
+
+	writeLine(dut, "before");
+
+	LogRingClaim claim;
+	char* buffer = dut.claim(claim, 20);
+	ASSERT_NE(buffer, nullptr);
+
+	writeLine(dut, "after");
+
+	// Only the line before the one still being written
+	EXPECT_EQ("before|", readAll(dut));
+
+	strcpy(buffer, "during");
+	// Somebody claimed after, the claim can't shrink, but the line is complete
+	dut.commit(claim, 6);
+
+	EXPECT_EQ("during|after|", readAll(dut));
+	EXPECT_EQ(0u, dut.getUsed());
+}
+
+TEST(LogRing, WrapsWithPadding) {
+	LogRing<64> dut;
+
+	// Each takes a 16 byte record
+	writeLine(dut, "aaaaaaaaa");
+	writeLine(dut, "bbbbbbbbb");
+	writeLine(dut, "ccccccccc");
+	EXPECT_EQ("aaaaaaaaa|bbbbbbbbb|ccccccccc|", readAll(dut));
+
+	// Needs 20 bytes, only 16 are left before the end, so it skips to the start
+	writeLine(dut, "dddddddddddd");
+	EXPECT_EQ("dddddddddddd|", readAll(dut));
+
+	for (int i = 0; i < 20; i++) {
+		writeLine(dut, "xyz");
+		writeLine(dut, "0123456789");
+		EXPECT_EQ("xyz|0123456789|", readAll(dut));
+	}
+
+	EXPECT_EQ(0u, dut.getDroppedCount());
+}
+
+TEST(LogRing, DropsWhenFull) {
+	LogRing<64> dut;
+
+	LogRingClaim claim;
+	int written = 0;
+	while (char* buffer = dut.claim(claim, 9)) {
+		strcpy(buffer, "line");
+		dut.commit(claim, 4);
+		written++;
+	}
+
+	// 8 byte records, but the last claim needs 16 bytes
+	EXPECT_EQ(7, written);
+	EXPECT_EQ(1u, dut.getDroppedCount());
+
+	EXPECT_EQ(nullptr, dut.claim(claim, 9));
+	EXPECT_EQ(2u, dut.getDroppedCount());
+
+	readAll(dut);
+
+	// Room again after the reader is done
+	writeLine(dut, "again");
+	EXPECT_EQ("again|", readAll(dut));
+}
+
+TEST(LogRing, ReaderLimit) {
+	LogRing<256> dut;
+
+	writeLine(dut, "0123456789");
+	writeLine(dut, "abcdefghij");
+
+	// Second line doesn't fit this time, it stays for the next read
+	EXPECT_EQ("0123456789|", readAll(dut, 15));
+	EXPECT_EQ("abcdefghij|", readAll(dut, 15));
+
+	// A single line longer than the limit is cut
+	writeLine(dut, "0123456789");
+	EXPECT_EQ("01234|", readAll(dut, 5));
+	EXPECT_EQ(0u, dut.getUsed());
+}
+
+TEST(LogRing, ManyWriters) {
+	static constexpr int writerCount = 4;
+	static constexpr int linesPerWriter = 20000;
+
+	static LogRing<4096> dut;
+
+	std::vector<std::thread> writers;
+	std::atomic<int> running{writerCount};
+
+	for (int w = 0; w < writerCount; w++) {
+		writers.emplace_back([w, &running]() {
+			for (int i = 0; i < linesPerWriter; i++) {
+				LogRingClaim claim;
+				char* buffer = dut.claim(claim, 40);
+
+				if (buffer) {
+					size_t length = snprintf(buffer, 41, "w%d line %d", w, i);
+					dut.commit(claim, length);
+				}
+			}
+
+			running--;
+		});
+	}
+
+	int lastLine[writerCount];
+	for (int w = 0; w < writerCount; w++) {
+		lastLine[w] = -1;
+	}
+
+	int received = 0;
+	bool inOrder = true;
+
+	auto read = [&]() {
+		LogSpan spans[64];
+		size_t count = dut.peek(spans, efi::size(spans), 2000);
+
+		for (size_t i = 0; i < count; i++) {
+			std::string line(spans[i].data, spans[i].length);
+
+			int w, n;
+			ASSERT_EQ(2, sscanf(line.c_str(), "w%d line %d", &w, &n)) << line;
+			ASSERT_EQ(line, "w" + std::to_string(w) + " line " + std::to_string(n));
+
+			// Lines of one writer may be dropped, but never reordered
+			inOrder &= n > lastLine[w];
+			lastLine[w] = n;
+			received++;
+		}
+
+		dut.release();
+	};
+
+	while (running) {
+		read();
+	}
+
+	for (auto& writer : writers) {
+		writer.join();
+	}
+
+	// Everything is committed now, the reader takes a limited amount at once
+	while (dut.getUsed()) {
+		read();
+	}
+
+	EXPECT_TRUE(inOrder);
+	EXPECT_EQ(writerCount * linesPerWriter, received + (int)dut.getDroppedCount());
+	EXPECT_EQ(0u, dut.getUsed());
+}
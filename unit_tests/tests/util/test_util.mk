@@ -2,6 +2,7 @@
 
 CPPSRC += 	$(PROJECT_DIR)/../unit_tests/tests/util/test_buffered_writer.cpp \
 	$(PROJECT_DIR)/../unit_tests/tests/util/test_hash.cpp \
+	$(PROJECT_DIR)/../unit_tests/tests/util/test_log_ring.cpp \
 	
 INCDIR += $(PROJECT_DIR)/controllers/system	
 	
\ No newline at end of file
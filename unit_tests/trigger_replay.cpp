@@ -0,0 +1,179 @@
+/*
+ * @file trigger_replay.cpp
+ */
+
+#include "pch.h"
+#include "trigger_replay.h"
+#include "trigger_simulator.h"
+
+TriggerReplayBaselineMode triggerReplayBaselineMode = TriggerReplayBaselineMode::Report;
+
+static char* nextToken(char*& p) {
+	while (*p == ' ') {
+		p++;
+	}
+
+	char* token = p;
+
+	while (*p && *p != ',') {
+		p++;
+	}
+
+	if (*p) {
+		*p++ = 0;
+	}
+
+	return token;
+}
+
+bool TriggerReplay::load(const char* fileName, size_t triggerCount, size_t vvtCount,
+		const int* triggerColumnIndeces, const int* vvtColumnIndeces, double timestampOffset) {
+	m_edges.clear();
+
+	FILE* fp = fopen(fileName, "r");
+	if (!fp) {
+		return false;
+	}
+
+	bool currentState[TRIGGER_INPUT_PIN_COUNT] = {};
+	bool currentVvtState[CAM_INPUTS_COUNT] = {};
+
+	char buffer[255];
+	bool isHeader = true;
+
+	while (fgets(buffer, sizeof(buffer), fp)) {
+		if (isHeader) {
+			isHeader = false;
+			continue;
+		}
+
+		char* p = buffer;
+		char* timeStampStr = nextToken(p);
+
+		bool newTriggerState[TRIGGER_INPUT_PIN_COUNT] = {};
+		bool newVvtState[CAM_INPUTS_COUNT] = {};
+
+		for (size_t i = 0; i < triggerCount; i++) {
+			newTriggerState[triggerColumnIndeces[i]] = nextToken(p)[0] == '1';
+		}
+
+		for (size_t i = 0; i < vvtCount; i++) {
+			newVvtState[vvtColumnIndeces[i]] = nextToken(p)[0] == '1';
+		}
+
+		double timeStamp = std::stod(timeStampStr) + timestampOffset;
+
+		TriggerReplayEdge edge;
+		// Same conversion as CsvReader
+		edge.timeUs = 1'000'000 * timeStamp;
+		edge.startsLine = true;
+
+		size_t edgeCountBefore = m_edges.size();
+
+		for (size_t index = 0; index < triggerCount; index++) {
+			if (currentState[index] == newTriggerState[index]) {
+				continue;
+			}
+
+			edge.input = TriggerReplayInput::Crank;
+			edge.index = index;
+			edge.isRising = newTriggerState[index];
+			m_edges.push_back(edge);
+			edge.startsLine = false;
+
+			currentState[index] = newTriggerState[index];
+		}
+
+		for (size_t index = 0; index < vvtCount; index++) {
+			if (currentVvtState[index] == newVvtState[index]) {
+				continue;
+			}
+
+			edge.input = TriggerReplayInput::Cam;
+			edge.index = index;
+			edge.isRising = newVvtState[index];
+			m_edges.push_back(edge);
+			edge.startsLine = false;
+
+			currentVvtState[index] = newVvtState[index];
+		}
+
+		if (m_edges.size() == edgeCountBefore) {
+			// Time still moves, and events still fire
+			edge.input = TriggerReplayInput::None;
+			edge.index = 0;
+			edge.isRising = false;
+			m_edges.push_back(edge);
+		}
+	}
+
+	fclose(fp);
+
+	return true;
+}
+
+void TriggerReplay::replay(EngineTestHelper& eth) const {
+	for (const auto& edge : m_edges) {
+		if (edge.startsLine) {
+			eth.setTimeAndInvokeEventsUs(edge.timeUs);
+		}
+
+		efitick_t nowNt = getTimeNowNt();
+
+		switch (edge.input) {
+		case TriggerReplayInput::Crank:
+			hwHandleShaftSignal(edge.index, edge.isRising, nowNt);
+			break;
+		case TriggerReplayInput::Cam: {
+			int bankIndex = twoBanksSingleCamMode ? edge.index : edge.index / 2;
+			int camIndex = twoBanksSingleCamMode ? 0 : edge.index % 2;
+			hwHandleVvtCamSignal(edge.isRising, nowNt, bankIndex * 2 + camIndex);
+			break;
+		}
+		case TriggerReplayInput::None:
+			break;
+		}
+	}
+}
+
+std::vector<TriggerReplayCrankEvent> TriggerReplay::getCrankEvents(const TriggerWaveform& shape, int startUs) const {
+	std::vector<TriggerReplayCrankEvent> events;
+
+	if (m_edges.empty()) {
+		return events;
+	}
+
+	int firstUs = m_edges.front().timeUs;
+
+	for (const auto& edge : m_edges) {
+		if (edge.input != TriggerReplayInput::Crank) {
+			continue;
+		}
+
+		bool isPrimary = edge.index == 0;
+		if (!isPrimary && !shape.needSecondTriggerInput) {
+			continue;
+		}
+
+		TriggerEvent signal = isPrimary
+			? (edge.isRising ? TriggerEvent::PrimaryRising : TriggerEvent::PrimaryFalling)
+			: (edge.isRising ? TriggerEvent::SecondaryRising : TriggerEvent::SecondaryFalling);
+
+		if (!isUsefulSignal(signal, shape)) {
+			continue;
+		}
+
+		int timeUs = edge.timeUs - firstUs + startUs;
+		events.push_back({ signal, timeUs, US2NT(timeUs).count() });
+	}
+
+	return events;
+}
+
+int TriggerReplay::getDurationUs() const {
+	if (m_edges.empty()) {
+		return 0;
+	}
+
+	return m_edges.back().timeUs - m_edges.front().timeUs;
+}
@@ -0,0 +1,86 @@
+/*
+ * @file trigger_replay.h
+ *
+ * Recorded trigger captures, parsed once and kept in memory as a list of edges, so that they can be
+ * replayed as many times as needed without going back to the text file.
+ */
+
+#pragma once
+
+#include "logicdata_csv_reader.h"
+
+#include <string>
+#include <vector>
+
+enum class TriggerReplayInput : uint8_t {
+	// A line of the capture where nothing changed, only time moves
+	None,
+	Crank,
+	Cam,
+};
+
+struct TriggerReplayEdge {
+	// What CsvReader would hand to setTimeAndInvokeEventsUs for this line
+	int timeUs;
+
+	TriggerReplayInput input;
+	// Crank channel or cam index, after the column mapping
+	uint8_t index;
+	bool isRising;
+	// First edge of its line of the capture
+	bool startsLine;
+};
+
+// Crank edge, ready to be handed to the trigger decoder
+struct TriggerReplayCrankEvent {
+	TriggerEvent signal;
+	int timeUs;
+	efitick_t nowNt;
+};
+
+class TriggerReplay {
+public:
+	/**
+	 * Same arguments and column rules as CsvReader
+	 * @return false if the file can't be read
+	 */
+	bool load(const char* fileName, size_t triggerCount, size_t vvtCount,
+		const int* triggerColumnIndeces = NORMAL_ORDER, const int* vvtColumnIndeces = NORMAL_ORDER,
+		double timestampOffset = 0);
+
+	bool twoBanksSingleCamMode = true;
+
+	/**
+	 * Replays the whole capture exactly the way CsvReader::processLine does, line after line,
+	 * time and scheduled events included.
+	 */
+	void replay(EngineTestHelper& eth) const;
+
+	/**
+	 * Crank edges that would make it past hwHandleShaftSignal to the decoder for this trigger shape,
+	 * with time starting at startUs.
+	 */
+	std::vector<TriggerReplayCrankEvent> getCrankEvents(const TriggerWaveform& shape, int startUs) const;
+
+	const std::vector<TriggerReplayEdge>& getEdges() const {
+		return m_edges;
+	}
+
+	// From the first line of the capture to the last
+	int getDurationUs() const;
+
+private:
+	std::vector<TriggerReplayEdge> m_edges;
+};
+
+enum class TriggerReplayBaselineMode {
+	// Print the numbers next to the baseline, if there is one
+	Report,
+	// Fail on a capture that got slower than the baseline allows
+	Check,
+	// Write the numbers of this run as the new baseline
+	Update,
+};
+
+// Set from the command line, see main.cpp
+extern TriggerReplayBaselineMode triggerReplayBaselineMode;